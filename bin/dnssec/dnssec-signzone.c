@@ -111,11 +111,33 @@ static int nsec_datatype = dns_rdatatype_nsec;
 #define SOA_SERIAL_UNIXTIME	2
 #define SOA_SERIAL_DATE		3
 
+/*%
+ * Number of nodes handed to a worker at a time, and the minimum
+ * interval in microseconds between progress reports.
+ */
+#define SIGNER_BATCH		64
+#define PROGRESS_INTERVAL	5000000
+
+typedef struct signer_entry sentry_t;
+struct signer_entry {
+	dns_fixedname_t fname;
+	dns_dbnode_t *node;
+	isc_boolean_t sign;
+};
+
+typedef struct signer_batch sbatch_t;
+struct signer_batch {
+	unsigned int seq;
+	unsigned int count;
+	unsigned int tosign;
+	sentry_t entries[SIGNER_BATCH];
+	ISC_LINK(sbatch_t) link;
+};
+
 typedef struct signer_event sevent_t;
 struct signer_event {
 	ISC_EVENT_COMMON(sevent_t);
-	dns_fixedname_t *fname;
-	dns_dbnode_t *node;
+	sbatch_t *batch;
 };
 
 static dns_dnsseckeylist_t keylist;
@@ -154,6 +176,9 @@ static unsigned char *gsalt = saltbuf;
 static size_t salt_length = 0;
 static isc_task_t *master = NULL;
 static unsigned int ntasks = 0;
+static ISC_LIST(sbatch_t) pending;	/* Batches waiting to be written. */
+static unsigned int nwritten = 0;
+static isc_time_t sign_start;
 static isc_boolean_t shuttingdown = ISC_FALSE, finished = ISC_FALSE;
 static isc_boolean_t nokeys = ISC_FALSE;
 static isc_boolean_t removefile = ISC_FALSE;
@@ -1422,12 +1447,32 @@ signapex(void) {
 }
 
 /*%
- * Assigns a node to a worker thread.  This is protected by the master task's
- * lock.
+ * Release the nodes held by a batch that has been written out, and
+ * free it.
+ */
+static void
+batch_release(sbatch_t *batch) {
+	unsigned int i;
+
+	for (i = 0; i < batch->count; i++) {
+		if (batch->entries[i].node != NULL)
+			dns_db_detachnode(gdb, &batch->entries[i].node);
+	}
+	isc_mem_put(mctx, batch, sizeof(*batch));
+}
+
+/*%
+ * Assigns a batch of nodes to a worker thread.  This is only called from
+ * the master task.
+ *
+ * Nodes are taken from the database iterator in name order; those which
+ * do not need signing are carried in the batch too, so that they are
+ * written out in their proper place.
  */
 static void
 assignwork(isc_task_t *task, isc_task_t *worker) {
-	dns_fixedname_t *fname;
+	sbatch_t *batch;
+	sentry_t *entry;
 	dns_name_t *name;
 	dns_dbnode_t *node;
 	sevent_t *sevent;
@@ -1437,6 +1482,7 @@ assignwork(isc_task_t *task, isc_task_t *worker) {
 	static dns_name_t *zonecut = NULL;	/* Protected by namelock. */
 	static dns_fixedname_t fzonecut;	/* Protected by namelock. */
 	static unsigned int ended = 0;		/* Protected by namelock. */
+	static unsigned int nextbatch = 0;	/* Protected by namelock. */
 
 	if (shuttingdown)
 		return;
@@ -1445,20 +1491,26 @@ assignwork(isc_task_t *task, isc_task_t *worker) {
 	if (finished) {
 		ended++;
 		if (ended == ntasks) {
+			INSIST(ISC_LIST_EMPTY(pending));
 			isc_task_detach(&task);
 			isc_app_shutdown();
 		}
 		goto unlock;
 	}
 
-	fname = isc_mem_get(mctx, sizeof(dns_fixedname_t));
-	if (fname == NULL)
+	batch = isc_mem_get(mctx, sizeof(*batch));
+	if (batch == NULL)
 		fatal("out of memory");
-	dns_fixedname_init(fname);
-	name = dns_fixedname_name(fname);
-	node = NULL;
-	found = ISC_FALSE;
-	while (!found) {
+	batch->count = 0;
+	batch->tosign = 0;
+	ISC_LINK_INIT(batch, link);
+
+	while (batch->tosign < SIGNER_BATCH && batch->count < SIGNER_BATCH) {
+		entry = &batch->entries[batch->count];
+		dns_fixedname_init(&entry->fname);
+		name = dns_fixedname_name(&entry->fname);
+		node = NULL;
+		found = ISC_FALSE;
 		result = dns_dbiterator_current(gdbiter, &node, name);
 		check_dns_dbiterator_current(result);
 		/*
@@ -1474,7 +1526,7 @@ assignwork(isc_task_t *task, isc_task_t *worker) {
 		 * For NSEC3 zones the NSEC3 nodes are zone data but
 		 * outside of the zone name space.  For the rest we need
 		 * to track the bottom of zone cuts.
-		 * Nodes which don't need to be signed are dumped here.
+		 * Nodes which don't need to be signed are only dumped.
 		 */
 		dns_rdataset_init(&nsec);
 		result = dns_db_findrdataset(gdb, node, gversion,
@@ -1500,10 +1552,11 @@ assignwork(isc_task_t *task, isc_task_t *worker) {
 			}
 		}
 
-		if (!found) {
-			dumpnode(name, node);
-			dns_db_detachnode(gdb, &node);
-		}
+		entry->node = node;
+		entry->sign = found;
+		batch->count++;
+		if (found)
+			batch->tosign++;
 
  next:
 		result = dns_dbiterator_next(gdbiter);
@@ -1514,23 +1567,33 @@ assignwork(isc_task_t *task, isc_task_t *worker) {
 			fatal("failure iterating database: %s",
 			      isc_result_totext(result));
 	}
-	if (!found) {
+
+	/*
+	 * Release the iterator's lock on the database so that the
+	 * workers can update it.
+	 */
+	result = dns_dbiterator_pause(gdbiter);
+	check_result(result, "dns_dbiterator_pause()");
+
+	if (batch->count == 0) {
 		ended++;
 		if (ended == ntasks) {
+			INSIST(ISC_LIST_EMPTY(pending));
 			isc_task_detach(&task);
 			isc_app_shutdown();
 		}
-		isc_mem_put(mctx, fname, sizeof(dns_fixedname_t));
+		isc_mem_put(mctx, batch, sizeof(*batch));
 		goto unlock;
 	}
+
+	batch->seq = nextbatch++;
 	sevent = (sevent_t *)
 		 isc_event_allocate(mctx, task, SIGNER_EVENT_WORK,
 				    sign, NULL, sizeof(sevent_t));
 	if (sevent == NULL)
 		fatal("failed to allocate event\n");
 
-	sevent->node = node;
-	sevent->fname = fname;
+	sevent->batch = batch;
 	isc_task_send(worker, ISC_EVENT_PTR(&sevent));
  unlock:
 	UNLOCK(&namelock);
@@ -1549,44 +1612,104 @@ startworker(isc_task_t *task, isc_event_t *event) {
 }
 
 /*%
- * Write a node to the output file, and restart the worker task.
+ * Print a progress report if one is due.  Called from the master task.
+ */
+static void
+progress(isc_boolean_t final) {
+	static isc_time_t last;
+	isc_time_t now;
+	isc_uint64_t us, rate;
+
+	if (!printstats)
+		return;
+
+	TIME_NOW(&now);
+	if (isc_time_isepoch(&last))
+		last = sign_start;
+	if (!final && isc_time_microdiff(&now, &last) < PROGRESS_INTERVAL)
+		return;
+	last = now;
+
+	us = isc_time_microdiff(&now, &sign_start);
+	rate = (us == 0) ? 0 : ((isc_uint64_t)nsigned * 1000000) / us;
+	fprintf(stderr, "%s: %u nodes written, "
+		"%u signatures (%u per second)\n", program,
+		nwritten, nsigned, (unsigned int)rate);
+}
+
+/*%
+ * Write out every batch that is now next in name order, then give the
+ * worker another batch.  Batches can come back from the workers in any
+ * order; those which arrive early are held on the pending list, which
+ * is kept sorted by sequence number, until the batches before them
+ * have been written.
  */
 static void
 writenode(isc_task_t *task, isc_event_t *event) {
 	isc_task_t *worker;
 	sevent_t *sevent = (sevent_t *)event;
+	sbatch_t *batch, *prev;
+	sentry_t *entry;
+	static unsigned int nextwrite = 0;	/* Only used by master. */
+	unsigned int i;
 
 	worker = (isc_task_t *)event->ev_sender;
-	dumpnode(dns_fixedname_name(sevent->fname), sevent->node);
-	cleannode(gdb, gversion, sevent->node);
-	dns_db_detachnode(gdb, &sevent->node);
-	isc_mem_put(mctx, sevent->fname, sizeof(dns_fixedname_t));
+
+	batch = sevent->batch;
+	prev = ISC_LIST_TAIL(pending);
+	while (prev != NULL && prev->seq > batch->seq)
+		prev = ISC_LIST_PREV(prev, link);
+	if (prev == NULL)
+		ISC_LIST_PREPEND(pending, batch, link);
+	else
+		ISC_LIST_INSERTAFTER(pending, prev, batch, link);
+
+	while ((batch = ISC_LIST_HEAD(pending)) != NULL &&
+	       batch->seq == nextwrite)
+	{
+		ISC_LIST_UNLINK(pending, batch, link);
+		for (i = 0; i < batch->count; i++) {
+			entry = &batch->entries[i];
+			dumpnode(dns_fixedname_name(&entry->fname),
+				 entry->node);
+			if (entry->sign)
+				cleannode(gdb, gversion, entry->node);
+		}
+		nwritten += batch->count;
+		batch_release(batch);
+		nextwrite++;
+	}
+	progress(ISC_FALSE);
+
 	assignwork(task, worker);
 	isc_event_free(&event);
 }
 
 /*%
- *  Sign a database node.
+ *  Sign a batch of database nodes.
  */
 static void
 sign(isc_task_t *task, isc_event_t *event) {
-	dns_fixedname_t *fname;
-	dns_dbnode_t *node;
+	sbatch_t *batch;
+	sentry_t *entry;
 	sevent_t *sevent, *wevent;
+	unsigned int i;
 
 	sevent = (sevent_t *)event;
-	node = sevent->node;
-	fname = sevent->fname;
+	batch = sevent->batch;
 	isc_event_free(&event);
 
-	signname(node, dns_fixedname_name(fname));
+	for (i = 0; i < batch->count; i++) {
+		entry = &batch->entries[i];
+		if (entry->sign)
+			signname(entry->node, dns_fixedname_name(&entry->fname));
+	}
 	wevent = (sevent_t *)
 		 isc_event_allocate(mctx, task, SIGNER_EVENT_WRITE,
 				    writenode, NULL, sizeof(sevent_t));
 	if (wevent == NULL)
 		fatal("failed to allocate event\n");
-	wevent->node = node;
-	wevent->fname = fname;
+	wevent->batch = batch;
 	isc_task_send(master, ISC_EVENT_PTR(&wevent));
 }
 
@@ -3166,7 +3289,7 @@ main(int argc, char *argv[]) {
 	int ndskeys = 0;
 	char *endp;
 	isc_time_t timer_start, timer_finish;
-	isc_time_t sign_start, sign_finish;
+	isc_time_t sign_finish;
 	dns_dnsseckey_t *key;
 	isc_result_t result;
 	isc_log_t *log = NULL;
@@ -3838,6 +3961,7 @@ main(int argc, char *argv[]) {
 	if (printstats)
 		RUNTIME_CHECK(isc_mutex_init(&statslock) == ISC_R_SUCCESS);
 
+	ISC_LIST_INIT(pending);
 	presign();
 	TIME_NOW(&sign_start);
 	signapex();
@@ -3856,6 +3980,7 @@ main(int argc, char *argv[]) {
 		(void)isc_app_run();
 		if (!finished)
 			fatal("process aborted by user");
+		progress(ISC_TRUE);
 	} else
 		isc_task_detach(&master);
 	shuttingdown = ISC_TRUE;
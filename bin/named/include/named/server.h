@@ -59,6 +59,7 @@ struct named_server {
 	dns_loadmgr_t *		loadmgr;
 	dns_zonemgr_t *		zonemgr;
 	dns_viewlist_t		viewlist;
+	named_viewindex_t *	viewindex;	/*%< View selection index */
 	ns_interfacemgr_t *	interfacemgr;
 	dns_db_t *		in_roothints;
 
@@ -86,6 +87,14 @@ struct named_server {
 
 	named_statschannellist_t statschannels;
 
+	/* Phases of the most recent (re)configuration, in microseconds. */
+	isc_uint64_t		parsetime;	/*%< Parsing the config file */
+	isc_uint64_t		conftime;	/*%< Configuring views, zones */
+	isc_uint64_t		exclusivetime;	/*%< Tasks paused for the above */
+	isc_time_t		loadstart;	/*%< When zone loading began */
+	isc_uint64_t		loadtime;	/*%< Loading zones; 0 if busy */
+	unsigned int		zonesunchanged;	/*%< Zones not reconfigured */
+
 	dns_tsigkey_t		*sessionkey;
 	char			*session_keyfile;
 	dns_name_t		*session_keyname;
@@ -96,6 +105,7 @@ struct named_server {
 	ns_cookiealg_t		cookiealg;
 
 	dns_dtenv_t		*dtenv;		/*%< Dnstap environment */
+	dns_qlog_t		*qlog;		/*%< Binary query log */
 
 	char *			lockfile;
 };
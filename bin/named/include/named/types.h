@@ -23,5 +23,6 @@ typedef struct named_dispatch		named_dispatch_t;
 typedef ISC_LIST(named_dispatch_t)	named_dispatchlist_t;
 typedef struct named_statschannel	named_statschannel_t;
 typedef ISC_LIST(named_statschannel_t)	named_statschannellist_t;
+typedef struct named_viewindex		named_viewindex_t;
 
 #endif /* NAMED_TYPES_H */
@@ -298,6 +298,7 @@ named_logconfig(isc_logconfig_t *logconfig, const cfg_obj_t *logstmt) {
 	isc_result_t result;
 	const cfg_obj_t *channels = NULL;
 	const cfg_obj_t *categories = NULL;
+	const cfg_obj_t *async = NULL;
 	const cfg_listelt_t *element;
 	isc_boolean_t default_set = ISC_FALSE;
 	isc_boolean_t unmatched_set = ISC_FALSE;
@@ -340,6 +341,10 @@ named_logconfig(isc_logconfig_t *logconfig, const cfg_obj_t *logstmt) {
 	if (logconfig != NULL && !unmatched_set)
 		CHECK(named_log_setunmatchedcategory(logconfig));
 
+	(void)cfg_map_get(logstmt, "async", &async);
+	if (logconfig != NULL && async != NULL)
+		isc_logconfig_setasync(logconfig, cfg_obj_asboolean(async));
+
 	return (ISC_R_SUCCESS);
 
  cleanup:
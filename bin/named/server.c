@@ -21,6 +21,7 @@
 #include <isc/app.h>
 #include <isc/base64.h>
 #include <isc/commandline.h>
+#include <isc/crc64.h>
 #include <isc/dir.h>
 #include <isc/entropy.h>
 #include <isc/file.h>
@@ -77,6 +78,7 @@
 #include <dns/peer.h>
 #include <dns/portlist.h>
 #include <dns/private.h>
+#include <dns/qlog.h>
 #include <dns/rbt.h>
 #include <dns/rdataclass.h>
 #include <dns/rdatalist.h>
@@ -258,6 +260,27 @@ struct zonelistentry {
 	ISC_LINK(struct zonelistentry)	link;
 };
 
+/*%
+ * The view selection index: the views in the order in which they are
+ * tried, and maps from client and destination addresses to the views
+ * whose "match-clients" and "match-destinations" ACLs allow them.
+ * 'check' flags views whose ACLs have elements other than IP
+ * prefixes, which still have to be matched in full.
+ *
+ * The views are not attached: the index is rebuilt, in exclusive
+ * mode, whenever the view list is replaced.
+ */
+#define VIEWINDEX_CLIENTS	0x01
+#define VIEWINDEX_DESTINATIONS	0x02
+
+struct named_viewindex {
+	unsigned int			nviews;
+	dns_view_t			**views;
+	unsigned char			*check;
+	dns_aclmap_t			*clients;
+	dns_aclmap_t			*destinations;
+};
+
 /*%
  * Configuration context to retain for each view that allows
  * new zones to be added at runtime.
@@ -289,18 +312,30 @@ typedef struct {
 		isc_refcount_t refs;
 } ns_zoneload_t;
 
+typedef struct catz_chgzone catz_chgzone_t;
+typedef ISC_LIST(catz_chgzone_t) catz_chgzonelist_t;
+
+/*%
+ * Changes to catalog zone member zones are queued on 'changes', and
+ * applied in batches by the exclusive task; a batch is scheduled
+ * whenever a change is queued on an empty list.
+ */
 typedef struct {
 	named_server_t *server;
+	isc_mutex_t lock;
+	catz_chgzonelist_t changes;
 } catz_cb_data_t;
 
-typedef struct catz_chgzone_event {
-	ISC_EVENT_COMMON(struct catz_chgzone_event);
+struct catz_chgzone {
+	isc_eventtype_t type;
 	dns_catz_entry_t *entry;
 	dns_catz_zone_t *origin;
 	dns_view_t *view;
 	catz_cb_data_t *cbd;
 	isc_boolean_t mod;
-} catz_chgzone_event_t;
+	dns_zone_t *zone;	/* configured, waiting to be loaded */
+	ISC_LINK(catz_chgzone_t) link;
+};
 
 /*
  * These zones should not leak onto the Internet.
@@ -426,6 +461,12 @@ fatal(const char *msg, isc_result_t result) ISC_PLATFORM_NORETURN_POST;
 static void
 named_server_reload(isc_task_t *task, isc_event_t *event);
 
+static isc_result_t
+viewindex_build(named_server_t *server);
+
+static void
+viewindex_free(isc_mem_t *mctx, named_viewindex_t **indexp);
+
 static isc_result_t
 ns_listenelt_fromconfig(const cfg_obj_t *listener, const cfg_obj_t *config,
 			cfg_aclconfctx_t *actx, isc_mem_t *mctx,
@@ -449,7 +490,7 @@ configure_zone(const cfg_obj_t *config, const cfg_obj_t *zconfig,
 	       const cfg_obj_t *vconfig, isc_mem_t *mctx, dns_view_t *view,
 	       dns_viewlist_t *viewlist, cfg_aclconfctx_t *aclconf,
 	       isc_boolean_t added, isc_boolean_t old_rpz_ok,
-	       isc_boolean_t modify);
+	       isc_boolean_t modify, const isc_uint64_t *envcrc);
 
 static isc_result_t
 configure_newzones(dns_view_t *view, cfg_obj_t *config, cfg_obj_t *vconfig,
@@ -2465,9 +2506,14 @@ configure_rpz(dns_view_t *view, const cfg_obj_t **maps,
 	return (ISC_R_SUCCESS);
 }
 
+/*
+ * Add or modify the zone for catalog entry 'ev->entry' in the
+ * view's zone table.  On success the zone is left in 'ev->zone' to
+ * be loaded by catz_addmodzone_load().  Must be called in exclusive
+ * mode with the view thawed.
+ */
 static void
-catz_addmodzone_taskaction(isc_task_t *task, isc_event_t *event0) {
-	catz_chgzone_event_t *ev = (catz_chgzone_event_t *) event0;
+catz_addmodzone_configure(catz_chgzone_t *ev) {
 	isc_result_t result;
 	isc_buffer_t namebuf;
 	isc_buffer_t *confbuf;
@@ -2511,7 +2557,7 @@ catz_addmodzone_taskaction(isc_task_t *task, isc_event_t *event0) {
 					      NAMED_LOGMODULE_SERVER,
 					      ISC_LOG_WARNING,
 					      "catz: "
-					      "catz_addmodzone_taskaction: "
+					      "catz_addmodzone_configure: "
 					      "zone '%s' is not a dynamically "
 					      "added zone",
 					      nameb);
@@ -2522,7 +2568,8 @@ catz_addmodzone_taskaction(isc_task_t *task, isc_event_t *event0) {
 					      NAMED_LOGCATEGORY_GENERAL,
 					      NAMED_LOGMODULE_SERVER,
 					      ISC_LOG_WARNING,
-					      "catz: catz_delzone_taskaction: "
+					      "catz: "
+					      "catz_addmodzone_configure: "
 					      "zone '%s' exists in multiple "
 					      "catalog zones",
 					      nameb);
@@ -2574,17 +2621,10 @@ catz_addmodzone_taskaction(isc_task_t *task, isc_event_t *event0) {
 	/* For now we only support adding one zone at a time */
 	zoneobj = cfg_listelt_value(cfg_list_first(zlist));
 
-	/* Mark view unfrozen so that zone can be added */
-
-	result = isc_task_beginexclusive(task);
-	RUNTIME_CHECK(result == ISC_R_SUCCESS);
-	dns_view_thaw(ev->view);
 	result = configure_zone(cfg->config, zoneobj, cfg->vconfig,
 				ev->cbd->server->mctx, ev->view,
 				&ev->cbd->server->viewlist, cfg->actx,
-				ISC_TRUE, ISC_FALSE, ev->mod);
-	dns_view_freeze(ev->view);
-	isc_task_endexclusive(task);
+				ISC_TRUE, ISC_FALSE, ev->mod, NULL);
 
 	if (result != ISC_R_SUCCESS) {
 		isc_log_write(named_g_lctx, NAMED_LOGCATEGORY_GENERAL,
@@ -2598,6 +2638,56 @@ catz_addmodzone_taskaction(isc_task_t *task, isc_event_t *event0) {
 	CHECK(dns_zt_find(ev->view->zonetable,
 			dns_catz_entry_getname(ev->entry), 0, NULL, &zone));
 
+	/*
+	 * Flag the zone as having been added at runtime straight away,
+	 * so that later changes in the same batch can find it.
+	 */
+	dns_zone_setadded(zone, ISC_TRUE);
+	dns_zone_set_parentcatz(zone, ev->origin);
+	dns_zone_attach(zone, &ev->zone);
+
+ cleanup:
+	if (zone != NULL)
+		dns_zone_detach(&zone);
+	if (zoneconf != NULL)
+		cfg_obj_destroy(cfg->add_parser, &zoneconf);
+}
+
+/*
+ * Load a zone configured by catz_addmodzone_configure().  If this
+ * fails, undo the configuration.
+ */
+static void
+catz_addmodzone_load(catz_chgzone_t *ev) {
+	isc_result_t result;
+	dns_zone_t *zone = ev->zone;
+	dns_zone_t *zt_zone = NULL;
+	isc_boolean_t current;
+	char cname[DNS_NAME_FORMATSIZE];
+
+	/*
+	 * A later change in the same batch may have deleted or
+	 * replaced the zone; only load it if it is still the one
+	 * in the zone table.
+	 */
+	result = dns_zt_find(ev->view->zonetable,
+			     dns_catz_entry_getname(ev->entry), 0, NULL,
+			     &zt_zone);
+	current = ISC_TF(result == ISC_R_SUCCESS && zt_zone == zone);
+	if (zt_zone != NULL)
+		dns_zone_detach(&zt_zone);
+	if (!current) {
+		dns_name_format(dns_catz_entry_getname(ev->entry), cname,
+				DNS_NAME_FORMATSIZE);
+		isc_log_write(named_g_lctx, NAMED_LOGCATEGORY_GENERAL,
+			      NAMED_LOGMODULE_SERVER, ISC_LOG_DEBUG(1),
+			      "catz: catz_addmodzone_load: zone '%s' was "
+			      "changed again before loading; skipped",
+			      cname);
+		dns_zone_detach(&ev->zone);
+		return;
+	}
+
 	/*
 	 * Load the zone from the master file.	If this fails, we'll
 	 * need to undo the configuration we've done already.
@@ -2618,37 +2708,25 @@ catz_addmodzone_taskaction(isc_task_t *task, isc_event_t *event0) {
 		}
 
 		/* Remove the zone from the zone table */
+		dns_zone_setadded(zone, ISC_FALSE);
 		dns_zt_unmount(ev->view->zonetable, zone);
-		goto cleanup;
 	}
 
-	/* Flag the zone as having been added at runtime */
-	dns_zone_setadded(zone, ISC_TRUE);
-	dns_zone_set_parentcatz(zone, ev->origin);
-
- cleanup:
-	if (zone != NULL)
-		dns_zone_detach(&zone);
-	if (zoneconf != NULL)
-		cfg_obj_destroy(cfg->add_parser, &zoneconf);
-	dns_catz_entry_detach(ev->origin, &ev->entry);
-	dns_catz_zone_detach(&ev->origin);
-	dns_view_detach(&ev->view);
-	isc_event_free(ISC_EVENT_PTR(&ev));
+	dns_zone_detach(&ev->zone);
 }
 
+/*
+ * Delete the zone for catalog entry 'ev->entry'.  Must be called in
+ * exclusive mode.
+ */
 static void
-catz_delzone_taskaction(isc_task_t *task, isc_event_t *event0) {
-	catz_chgzone_event_t *ev = (catz_chgzone_event_t *) event0;
+catz_delzone_apply(catz_chgzone_t *ev) {
 	isc_result_t result;
 	dns_zone_t *zone = NULL;
 	dns_db_t *dbp = NULL;
 	char cname[DNS_NAME_FORMATSIZE];
 	const char * file;
 
-	result = isc_task_beginexclusive(task);
-	RUNTIME_CHECK(result == ISC_R_SUCCESS);
-
 	dns_name_format(dns_catz_entry_getname(ev->entry), cname,
 			DNS_NAME_FORMATSIZE);
 	result = dns_zt_find(ev->view->zonetable,
@@ -2656,7 +2734,7 @@ catz_delzone_taskaction(isc_task_t *task, isc_event_t *event0) {
 	if (result != ISC_R_SUCCESS) {
 		isc_log_write(named_g_lctx, NAMED_LOGCATEGORY_GENERAL,
 			      NAMED_LOGMODULE_SERVER, ISC_LOG_WARNING,
-			      "catz: catz_delzone_taskaction: "
+			      "catz: catz_delzone_apply: "
 			      "zone '%s' not found", cname);
 		goto cleanup;
 	}
@@ -2664,7 +2742,7 @@ catz_delzone_taskaction(isc_task_t *task, isc_event_t *event0) {
 	if (!dns_zone_getadded(zone)) {
 		isc_log_write(named_g_lctx, NAMED_LOGCATEGORY_GENERAL,
 			      NAMED_LOGMODULE_SERVER, ISC_LOG_WARNING,
-			      "catz: catz_delzone_taskaction: "
+			      "catz: catz_delzone_apply: "
 			      "zone '%s' is not a dynamically added zone",
 			      cname);
 		goto cleanup;
@@ -2673,7 +2751,7 @@ catz_delzone_taskaction(isc_task_t *task, isc_event_t *event0) {
 	if (dns_zone_get_parentcatz(zone) != ev->origin) {
 		isc_log_write(named_g_lctx, NAMED_LOGCATEGORY_GENERAL,
 			      NAMED_LOGMODULE_SERVER, ISC_LOG_WARNING,
-			      "catz: catz_delzone_taskaction: zone "
+			      "catz: catz_delzone_apply: zone "
 			      "'%s' exists in multiple catalog zones",
 			      cname);
 		goto cleanup;
@@ -2692,16 +2770,74 @@ catz_delzone_taskaction(isc_task_t *task, isc_event_t *event0) {
 
 	isc_log_write(named_g_lctx, NAMED_LOGCATEGORY_GENERAL,
 		      NAMED_LOGMODULE_SERVER, ISC_LOG_WARNING,
-		      "catz: catz_delzone_taskaction: "
+		      "catz: catz_delzone_apply: "
 		      "zone '%s' deleted", cname);
   cleanup:
-	isc_task_endexclusive(task);
 	if (zone != NULL)
 		dns_zone_detach(&zone);
-	dns_catz_entry_detach(ev->origin, &ev->entry);
-	dns_catz_zone_detach(&ev->origin);
-	dns_view_detach(&ev->view);
-	isc_event_free(ISC_EVENT_PTR(&ev));
+}
+
+/*
+ * Apply every queued catalog zone change.  The zone tables are
+ * changed in a single exclusive-mode section, thawing each affected
+ * view once; new zones are then loaded outside it.
+ */
+static void
+catz_chgzone_taskaction(isc_task_t *task, isc_event_t *event0) {
+	catz_cb_data_t *cbd = event0->ev_arg;
+	catz_chgzonelist_t changes;
+	catz_chgzone_t *ev, *next;
+	dns_view_t *view;
+	isc_result_t result;
+	unsigned int count = 0;
+
+	isc_event_free(&event0);
+
+	ISC_LIST_INIT(changes);
+	LOCK(&cbd->lock);
+	ISC_LIST_APPENDLIST(changes, cbd->changes, link);
+	UNLOCK(&cbd->lock);
+
+	result = isc_task_beginexclusive(task);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+	for (ev = ISC_LIST_HEAD(changes);
+	     ev != NULL;
+	     ev = ISC_LIST_NEXT(ev, link))
+	{
+		count++;
+		if (ev->type == DNS_EVENT_CATZDELZONE) {
+			catz_delzone_apply(ev);
+			continue;
+		}
+		/* Mark view unfrozen so that zone can be added */
+		if (ev->view->frozen)
+			dns_view_thaw(ev->view);
+		catz_addmodzone_configure(ev);
+	}
+	for (ev = ISC_LIST_HEAD(changes);
+	     ev != NULL;
+	     ev = ISC_LIST_NEXT(ev, link))
+	{
+		if (!ev->view->frozen)
+			dns_view_freeze(ev->view);
+	}
+	isc_task_endexclusive(task);
+
+	for (ev = ISC_LIST_HEAD(changes); ev != NULL; ev = next) {
+		next = ISC_LIST_NEXT(ev, link);
+		ISC_LIST_UNLINK(changes, ev, link);
+		if (ev->zone != NULL)
+			catz_addmodzone_load(ev);
+		dns_catz_entry_detach(ev->origin, &ev->entry);
+		dns_catz_zone_detach(&ev->origin);
+		view = ev->view;
+		isc_mem_put(view->mctx, ev, sizeof(*ev));
+		dns_view_detach(&view);
+	}
+
+	isc_log_write(named_g_lctx, NAMED_LOGCATEGORY_GENERAL,
+		      NAMED_LOGMODULE_SERVER, ISC_LOG_DEBUG(1),
+		      "catz: applied %u zone changes", count);
 }
 
 static isc_result_t
@@ -2709,43 +2845,53 @@ catz_create_chg_task(dns_catz_entry_t *entry, dns_catz_zone_t *origin,
 		     dns_view_t *view, isc_taskmgr_t *taskmgr, void *udata,
 		     isc_eventtype_t type)
 {
-	catz_chgzone_event_t *event;
+	catz_cb_data_t *cbd = (catz_cb_data_t *) udata;
+	catz_chgzone_t *chg;
+	isc_event_t *batch = NULL;
 	isc_task_t *task;
 	isc_result_t result;
-	isc_taskaction_t action;
 
-	switch (type) {
-	case DNS_EVENT_CATZADDZONE:
-	case DNS_EVENT_CATZMODZONE:
-		action = catz_addmodzone_taskaction;
-		break;
-	case DNS_EVENT_CATZDELZONE:
-		action = catz_delzone_taskaction;
-		break;
-	default:
-		REQUIRE(0);
-	}
+	REQUIRE(type == DNS_EVENT_CATZADDZONE ||
+		type == DNS_EVENT_CATZMODZONE ||
+		type == DNS_EVENT_CATZDELZONE);
 
-	event = (catz_chgzone_event_t *) isc_event_allocate(view->mctx, origin,
-							    type, action, NULL,
-							    sizeof(*event));
-	if (event == NULL)
+	chg = isc_mem_get(view->mctx, sizeof(*chg));
+	if (chg == NULL)
 		return (ISC_R_NOMEMORY);
 
-	event->cbd = (catz_cb_data_t *) udata;
-	event->entry = NULL;
-	event->origin = NULL;
-	event->view = NULL;
-	event->mod = ISC_TF(type == DNS_EVENT_CATZMODZONE);
-	dns_catz_entry_attach(entry, &event->entry);
-	dns_catz_zone_attach(origin, &event->origin);
-	dns_view_attach(view, &event->view);
-
-	task = NULL;
-	result = isc_taskmgr_excltask(taskmgr, &task);
-	REQUIRE(result == ISC_R_SUCCESS);
-	isc_task_send(task, ISC_EVENT_PTR(&event));
-	isc_task_detach(&task);
+	batch = isc_event_allocate(view->mctx, origin, type,
+				   catz_chgzone_taskaction, cbd,
+				   sizeof(*batch));
+	if (batch == NULL) {
+		isc_mem_put(view->mctx, chg, sizeof(*chg));
+		return (ISC_R_NOMEMORY);
+	}
+
+	chg->type = type;
+	chg->cbd = cbd;
+	chg->entry = NULL;
+	chg->origin = NULL;
+	chg->view = NULL;
+	chg->zone = NULL;
+	chg->mod = ISC_TF(type == DNS_EVENT_CATZMODZONE);
+	ISC_LINK_INIT(chg, link);
+	dns_catz_entry_attach(entry, &chg->entry);
+	dns_catz_zone_attach(origin, &chg->origin);
+	dns_view_attach(view, &chg->view);
+
+	LOCK(&cbd->lock);
+	if (!ISC_LIST_EMPTY(cbd->changes))
+		isc_event_free(&batch);
+	ISC_LIST_APPEND(cbd->changes, chg, link);
+	UNLOCK(&cbd->lock);
+
+	if (batch != NULL) {
+		task = NULL;
+		result = isc_taskmgr_excltask(taskmgr, &task);
+		REQUIRE(result == ISC_R_SUCCESS);
+		isc_task_send(task, &batch);
+		isc_task_detach(&task);
+	}
 
 	return (ISC_R_SUCCESS);
 }
@@ -3010,7 +3156,7 @@ configure_rrl(dns_view_t *view, const cfg_obj_t *config, const cfg_obj_t *map) {
 		if (min_entries < 1)
 			min_entries = 1;
 	}
-	result = dns_rrl_init(&rrl, view, min_entries);
+	result = dns_rrl_init(&rrl, view, min_entries, named_g_cpus);
 	if (result != ISC_R_SUCCESS)
 		return (result);
 
@@ -3383,9 +3529,12 @@ configure_dnstap(const cfg_obj_t **maps, dns_view_t *view) {
 	const char *dpath = named_g_defaultdnstap;
 	const cfg_obj_t *dlist = NULL;
 	dns_dtmsgtype_t dttypes = 0;
+	isc_uint32_t dtsample[DNS_DTTYPE_COUNT];
 	unsigned int i;
 	struct fstrm_iothr_options *fopt = NULL;
 
+	memset(dtsample, 0, sizeof(dtsample));
+
 	result = named_config_get(maps, "dnstap", &dlist);
 	if (result != ISC_R_SUCCESS)
 		return (ISC_R_SUCCESS);
@@ -3416,16 +3565,27 @@ configure_dnstap(const cfg_obj_t **maps, dns_view_t *view) {
 		}
 
 		obj2 = cfg_tuple_get(obj, "mode");
-		if (obj2 == NULL || cfg_obj_isvoid(obj2)) {
-			dttypes |= dt;
-			continue;
+		if (obj2 != NULL && !cfg_obj_isvoid(obj2)) {
+			str = cfg_obj_asstring(obj2);
+			if (strcasecmp(str, "query") == 0) {
+				dt &= ~DNS_DTTYPE_RESPONSE;
+			} else if (strcasecmp(str, "response") == 0) {
+				dt &= ~DNS_DTTYPE_QUERY;
+			}
 		}
 
-		str = cfg_obj_asstring(obj2);
-		if (strcasecmp(str, "query") == 0) {
-			dt &= ~DNS_DTTYPE_RESPONSE;
-		} else if (strcasecmp(str, "response") == 0) {
-			dt &= ~DNS_DTTYPE_QUERY;
+		/*
+		 * "sample N" logs one message in N of these types;
+		 * without it, every message is logged.
+		 */
+		obj2 = cfg_tuple_get(obj, "sample");
+		for (i = 0; i < DNS_DTTYPE_COUNT; i++) {
+			if ((dt & (1U << i)) == 0)
+				continue;
+			if (obj2 != NULL && cfg_obj_isuint32(obj2))
+				dtsample[i] = cfg_obj_asuint32(obj2);
+			else
+				dtsample[i] = 0;
 		}
 
 		dttypes |= dt;
@@ -3587,6 +3747,7 @@ configure_dnstap(const cfg_obj_t **maps, dns_view_t *view) {
 
 	dns_dt_attach(named_g_server->dtenv, &view->dtenv);
 	view->dttypes = dttypes;
+	memmove(view->dtsample, dtsample, sizeof(view->dtsample));
 
 	result = ISC_R_SUCCESS;
 
@@ -3619,6 +3780,41 @@ create_mapped_acl(void) {
 	return (result);
 }
 
+/*
+ * cfg_printx() callback feeding the printed text into a CRC.
+ */
+static void
+crc64_cfgprint(void *closure, const char *text, int textlen) {
+	isc_crc64_update(closure, text, textlen);
+}
+
+/*
+ * Add every clause set in 'map' to '*crc', except for zone and view
+ * statements.
+ */
+static void
+crc64_mapclauses(isc_uint64_t *crc, const cfg_obj_t *map) {
+	const void *clauses = NULL;
+	const char *clause;
+	unsigned int idx = 0;
+
+	for (clause = cfg_map_firstclause(map->type, &clauses, &idx);
+	     clause != NULL;
+	     clause = cfg_map_nextclause(map->type, &clauses, &idx))
+	{
+		const cfg_obj_t *obj = NULL;
+
+		if (strcasecmp(clause, "zone") == 0 ||
+		    strcasecmp(clause, "view") == 0 ||
+		    cfg_map_get(map, clause, &obj) != ISC_R_SUCCESS)
+		{
+			continue;
+		}
+		isc_crc64_update(crc, clause, strlen(clause) + 1);
+		cfg_printx(obj, 0, crc64_cfgprint, crc);
+	}
+}
+
 /*
  * Configure 'view' according to 'vconfig', taking defaults from 'config'
  * where values are missing in 'vconfig'.
@@ -3679,6 +3875,7 @@ configure_view(dns_view_t *view, dns_viewlist_t *viewlist,
 	isc_boolean_t empty_zones_enable;
 	const cfg_obj_t *disablelist = NULL;
 	isc_stats_t *resstats = NULL;
+	isc_stats_t *viewstats = NULL;
 	dns_stats_t *resquerystats = NULL;
 	isc_boolean_t auto_root = ISC_FALSE;
 	named_cache_t *nsc;
@@ -3689,6 +3886,7 @@ configure_view(dns_view_t *view, dns_viewlist_t *viewlist,
 	isc_dscp_t dscp4 = -1, dscp6 = -1;
 	dns_dyndbctx_t *dctx = NULL;
 	unsigned int resolver_param;
+	isc_uint64_t envcrc;
 
 	REQUIRE(DNS_VIEW_VALID(view));
 
@@ -3753,6 +3951,17 @@ configure_view(dns_view_t *view, dns_viewlist_t *viewlist,
 	else
 		(void)cfg_map_get(config, "zone", &zonelist);
 
+	/*
+	 * Hash everything zone statements can inherit from, so that
+	 * zones whose own statement is also unchanged can keep their
+	 * current configuration.
+	 */
+	isc_crc64_init(&envcrc);
+	if (config != NULL)
+		crc64_mapclauses(&envcrc, config);
+	if (voptions != NULL)
+		crc64_mapclauses(&envcrc, voptions);
+
 	/*
 	 * Load zone configuration
 	 */
@@ -3763,7 +3972,7 @@ configure_view(dns_view_t *view, dns_viewlist_t *viewlist,
 		const cfg_obj_t *zconfig = cfg_listelt_value(element);
 		CHECK(configure_zone(config, zconfig, vconfig, mctx, view,
 				     viewlist, actx, ISC_FALSE, old_rpz_ok,
-				     ISC_FALSE));
+				     ISC_FALSE, &envcrc));
 	}
 
 	/*
@@ -4630,6 +4839,24 @@ configure_view(dns_view_t *view, dns_viewlist_t *viewlist,
 	else
 		view->matchrecursiveonly = ISC_FALSE;
 
+	/*
+	 * Keep counting view selections across reconfiguration.
+	 */
+	result = dns_viewlist_find(&named_g_server->viewlist, view->name,
+				   view->rdclass, &pview);
+	if (result != ISC_R_NOTFOUND && result != ISC_R_SUCCESS)
+		goto cleanup;
+	if (pview != NULL) {
+		dns_view_getviewstats(pview, &viewstats);
+		dns_view_detach(&pview);
+	}
+	if (viewstats == NULL) {
+		CHECK(isc_stats_create(mctx, &viewstats,
+				       dns_viewstatscounter_max));
+	}
+	dns_view_setviewstats(view, viewstats);
+	isc_stats_detach(&viewstats);
+
 	/*
 	 * Configure other configurable data.
 	 */
@@ -5318,6 +5545,15 @@ configure_view(dns_view_t *view, dns_viewlist_t *viewlist,
 	CHECK(configure_dnstap(maps, view));
 #endif /* HAVE_DNSTAP */
 
+	/*
+	 * Log queries to the binary query log, if there is one.
+	 */
+	if (named_g_server->qlog != NULL) {
+		dns_qlog_attach(named_g_server->qlog, &view->qlog);
+		CHECK(dns_qlog_addview(view->qlog, view->name,
+				       &view->qlogid));
+	}
+
 	result = ISC_R_SUCCESS;
 
  cleanup:
@@ -5688,7 +5924,7 @@ configure_zone(const cfg_obj_t *config, const cfg_obj_t *zconfig,
 	       const cfg_obj_t *vconfig, isc_mem_t *mctx, dns_view_t *view,
 	       dns_viewlist_t *viewlist, cfg_aclconfctx_t *aclconf,
 	       isc_boolean_t added, isc_boolean_t old_rpz_ok,
-	       isc_boolean_t modify)
+	       isc_boolean_t modify, const isc_uint64_t *envcrc)
 {
 	dns_view_t *pview = NULL;	/* Production view */
 	dns_zone_t *zone = NULL;	/* New or reused zone */
@@ -5712,6 +5948,8 @@ configure_zone(const cfg_obj_t *config, const cfg_obj_t *zconfig,
 	const char *ztypestr;
 	dns_rpz_num_t rpz_num;
 	isc_boolean_t zone_is_catz = ISC_FALSE;
+	isc_boolean_t reused = ISC_FALSE;
+	isc_uint64_t confighash = 0;
 
 	options = NULL;
 	(void)cfg_map_get(config, "options", &options);
@@ -5981,6 +6219,7 @@ configure_zone(const cfg_obj_t *config, const cfg_obj_t *zconfig,
 		 * new view.
 		 */
 		dns_zone_setview(zone, view);
+		reused = ISC_TRUE;
 	} else {
 		/*
 		 * We cannot reuse an existing zone, we have
@@ -6055,10 +6294,43 @@ configure_zone(const cfg_obj_t *config, const cfg_obj_t *zconfig,
 	}
 
 	/*
-	 * Configure the zone.
+	 * Configure the zone, unless it was configured from exactly the
+	 * same zone statement and inherited settings last time.  Policy
+	 * and catalog zones are always reconfigured.
 	 */
-	CHECK(named_zone_configure(config, vconfig, zconfig,
-				   aclconf, zone, raw));
+	if (envcrc != NULL) {
+		confighash = *envcrc;
+		cfg_printx(zconfig, 0, crc64_cfgprint, &confighash);
+		isc_crc64_final(&confighash);
+	}
+	if (reused && !modify && confighash != 0 &&
+	    rpz_num == DNS_RPZ_INVALID_NUM && !zone_is_catz &&
+	    dns_zone_getconfighash(zone) == confighash)
+	{
+		dns_zone_t *mayberaw = (raw != NULL) ? raw : zone;
+
+		/*
+		 * named_zone_configure() would also have kept the
+		 * zone's notify and transfer source dispatches and the
+		 * view's default allow-query-on ACL alive.
+		 */
+		named_add_reserved_dispatch(named_g_server,
+					    dns_zone_getnotifysrc4(zone));
+		named_add_reserved_dispatch(named_g_server,
+					    dns_zone_getnotifysrc6(zone));
+		named_add_reserved_dispatch(named_g_server,
+					    dns_zone_getxfrsource4(mayberaw));
+		named_add_reserved_dispatch(named_g_server,
+					    dns_zone_getxfrsource6(mayberaw));
+		if (view->queryonacl == NULL && pview->queryonacl != NULL)
+			dns_acl_attach(pview->queryonacl, &view->queryonacl);
+		named_g_server->zonesunchanged++;
+	} else {
+		dns_zone_setconfighash(zone, 0);
+		CHECK(named_zone_configure(config, vconfig, zconfig,
+					   aclconf, zone, raw));
+		dns_zone_setconfighash(zone, confighash);
+	}
 
 	/*
 	 * Add the zone to its view in the new view list.
@@ -7291,7 +7563,7 @@ configure_newzones(dns_view_t *view, cfg_obj_t *config, cfg_obj_t *vconfig,
 		const cfg_obj_t *zconfig = cfg_listelt_value(element);
 		CHECK(configure_zone(config, zconfig, vconfig, mctx,
 				     view, &named_g_server->viewlist, actx,
-				     ISC_TRUE, ISC_FALSE, ISC_FALSE));
+				     ISC_TRUE, ISC_FALSE, ISC_FALSE, NULL));
 	}
 
 	result = ISC_R_SUCCESS;
@@ -7476,7 +7748,7 @@ configure_newzone(const cfg_obj_t *zconfig, cfg_obj_t *config,
 {
 	return (configure_zone(config, zconfig, vconfig, mctx, view,
 			       &named_g_server->viewlist, actx, ISC_TRUE,
-			       ISC_FALSE, ISC_FALSE));
+			       ISC_FALSE, ISC_FALSE, NULL));
 }
 
 /*%
@@ -7723,6 +7995,7 @@ load_configuration(const char *filename, named_server_t *server,
 	isc_boolean_t exclusive = ISC_FALSE;
 	isc_interval_t interval;
 	isc_logconfig_t *logc = NULL;
+	isc_time_t start, parsed, exclstart;
 	isc_portset_t *v4portset = NULL;
 	isc_portset_t *v6portset = NULL;
 	isc_resourcevalue_t nfiles;
@@ -7747,6 +8020,9 @@ load_configuration(const char *filename, named_server_t *server,
 	ISC_LIST_INIT(cachelist);
 	ISC_LIST_INIT(altsecrets);
 
+	isc_time_now(&start);
+	server->zonesunchanged = 0;
+
 	/* Create the ACL configuration context */
 	if (named_g_aclconfctx != NULL) {
 		cfg_aclconfctx_detach(&named_g_aclconfctx);
@@ -7794,6 +8070,8 @@ load_configuration(const char *filename, named_server_t *server,
 	 */
 	CHECK(bind9_check_namedconf(config, named_g_lctx, named_g_mctx));
 
+	isc_time_now(&parsed);
+
 	/*
 	 * Fill in the maps array, used for resolving defaults.
 	 */
@@ -7841,6 +8119,7 @@ load_configuration(const char *filename, named_server_t *server,
 		result = isc_task_beginexclusive(server->task);
 		RUNTIME_CHECK(result == ISC_R_SUCCESS);
 		exclusive = ISC_TRUE;
+		isc_time_now(&exclstart);
 	}
 
 	/*
@@ -8421,6 +8700,41 @@ load_configuration(const char *filename, named_server_t *server,
 		      "sizing zone task pool based on %d zones", num_zones);
 	CHECK(dns_zonemgr_setsize(named_g_server->zonemgr, num_zones));
 
+	/*
+	 * Set up the binary query log.  If the file name has not
+	 * changed, the file is reopened so that it can be rotated.
+	 */
+	obj = NULL;
+	(void)named_config_get(maps, "querylog-binary", &obj);
+	if (obj == NULL) {
+		if (server->qlog != NULL)
+			dns_qlog_detach(&server->qlog);
+	} else if (server->qlog != NULL &&
+		   strcmp(dns_qlog_getpath(server->qlog),
+			  cfg_obj_asstring(obj)) == 0)
+	{
+		result = dns_qlog_reopen(server->qlog);
+		if (result != ISC_R_SUCCESS) {
+			cfg_obj_log(obj, named_g_lctx, ISC_LOG_ERROR,
+				    "unable to reopen binary query log "
+				    "'%s': %s", cfg_obj_asstring(obj),
+				    isc_result_totext(result));
+		}
+	} else {
+		if (server->qlog != NULL)
+			dns_qlog_detach(&server->qlog);
+		result = dns_qlog_create(named_g_mctx, named_g_taskmgr,
+					 named_g_timermgr,
+					 cfg_obj_asstring(obj), &server->qlog);
+		if (result != ISC_R_SUCCESS) {
+			cfg_obj_log(obj, named_g_lctx, ISC_LOG_ERROR,
+				    "unable to open binary query log "
+				    "'%s': %s", cfg_obj_asstring(obj),
+				    isc_result_totext(result));
+			goto cleanup;
+		}
+	}
+
 	/*
 	 * Configure and freeze all explicit views.  Explicit
 	 * views that have zones were already created at parsing
@@ -8504,6 +8818,19 @@ load_configuration(const char *filename, named_server_t *server,
 		view = ISC_LIST_NEXT(view, link);
 	}
 
+	/*
+	 * Index the new views by their match-clients and
+	 * match-destinations ACLs.  Without the index, every view's
+	 * ACLs are matched in turn.
+	 */
+	result = viewindex_build(server);
+	if (result != ISC_R_SUCCESS) {
+		isc_log_write(named_g_lctx, NAMED_LOGCATEGORY_GENERAL,
+			      NAMED_LOGMODULE_SERVER, ISC_LOG_WARNING,
+			      "unable to build the view selection index: %s",
+			      isc_result_totext(result));
+	}
+
 	/* Swap our new cache list with the production one. */
 	tmpcachelist = server->cachelist;
 	server->cachelist = cachelist;
@@ -8848,6 +9175,12 @@ load_configuration(const char *filename, named_server_t *server,
 		INSIST(0);
 	}
 
+	obj = NULL;
+	result = named_config_get(maps, "trust-server-cookie", &obj);
+	INSIST(result == ISC_R_SUCCESS);
+	ns_server_setoption(server->sctx, NS_SERVER_TRUSTCOOKIE,
+			    cfg_obj_asboolean(obj));
+
 	obj = NULL;
 	result = named_config_get(maps, "cookie-secret", &obj);
 	if (result == ISC_R_SUCCESS) {
@@ -8940,6 +9273,11 @@ load_configuration(const char *filename, named_server_t *server,
 	server->sctx->altsecrets = altsecrets;
 	altsecrets = tmpaltsecrets;
 
+	/*
+	 * Cookies validated with the old secret must be checked again.
+	 */
+	ns_server_flushcookies(server->sctx);
+
 	(void) named_server_loadnta(server);
 
 #ifdef USE_DNSRPS
@@ -9043,9 +9381,26 @@ load_configuration(const char *filename, named_server_t *server,
 				      isc_result_totext(result));
 	}
 
+	if (result == ISC_R_SUCCESS) {
+		server->parsetime = isc_time_microdiff(&parsed, &start);
+		server->conftime = isc_time_microdiff(&named_g_configtime,
+						      &parsed);
+	}
+
 	/* Relinquish exclusive access to configuration data. */
 	if (exclusive) {
 		isc_task_endexclusive(server->task);
+		if (result == ISC_R_SUCCESS) {
+			server->exclusivetime =
+				isc_time_microdiff(&named_g_configtime,
+						   &exclstart);
+			isc_log_write(named_g_lctx, NAMED_LOGCATEGORY_GENERAL,
+				      NAMED_LOGMODULE_SERVER, ISC_LOG_INFO,
+				      "configuration: %u zones unchanged, "
+				      "exclusive for %" ISC_PRINT_QUADFORMAT
+				      "u us", server->zonesunchanged,
+				      server->exclusivetime);
+		}
 	}
 
 	isc_log_write(named_g_lctx, NAMED_LOGCATEGORY_GENERAL,
@@ -9063,6 +9418,7 @@ view_loaded(void *arg) {
 	named_server_t *server = zl->server;
 	isc_boolean_t reconfig = zl->reconfig;
 	unsigned int refs;
+	isc_time_t now;
 
 
 	/*
@@ -9080,6 +9436,11 @@ view_loaded(void *arg) {
 	isc_refcount_destroy(&zl->refs);
 	isc_mem_put(server->mctx, zl, sizeof (*zl));
 
+	isc_time_now(&now);
+	server->loadtime = isc_time_microdiff(&now, &server->loadstart);
+	if (server->loadtime == 0)
+		server->loadtime = 1;
+
 	/*
 	 * To maintain compatibility with log parsing tools that might
 	 * be looking for this string after "rndc reconfig", we keep it
@@ -9121,6 +9482,9 @@ load_zones(named_server_t *server, isc_boolean_t init, isc_boolean_t reconfig) {
 	result = isc_task_beginexclusive(server->task);
 	RUNTIME_CHECK(result == ISC_R_SUCCESS);
 
+	isc_time_now(&server->loadstart);
+	server->loadtime = 0;
+
 	isc_refcount_init(&zl->refs, 1);
 
 	/*
@@ -9291,6 +9655,9 @@ shutdown_server(isc_task_t *task, isc_event_t *event) {
 
 	(void) named_server_saventa(server);
 
+	if (server->viewindex != NULL)
+		viewindex_free(server->mctx, &server->viewindex);
+
 	for (view = ISC_LIST_HEAD(server->viewlist);
 	     view != NULL;
 	     view = view_next) {
@@ -9302,6 +9669,13 @@ shutdown_server(isc_task_t *task, isc_event_t *event) {
 			dns_view_detach(&view);
 	}
 
+	/*
+	 * The binary query log flushes and closes from its own task,
+	 * so it has to go before the task manager does.
+	 */
+	if (server->qlog != NULL)
+		dns_qlog_detach(&server->qlog);
+
 	dns_dyndb_cleanup(ISC_TRUE);
 
 	while ((nsc = ISC_LIST_HEAD(server->cachelist)) != NULL) {
@@ -9345,6 +9719,149 @@ shutdown_server(isc_task_t *task, isc_event_t *event) {
 /*%
  * Find a view that matches the source and destination addresses of a query.
  */
+static void
+viewindex_free(isc_mem_t *mctx, named_viewindex_t **indexp) {
+	named_viewindex_t *index = *indexp;
+
+	*indexp = NULL;
+	if (index->clients != NULL)
+		dns_aclmap_destroy(&index->clients);
+	if (index->destinations != NULL)
+		dns_aclmap_destroy(&index->destinations);
+	if (index->views != NULL)
+		isc_mem_put(mctx, index->views,
+			    index->nviews * sizeof(dns_view_t *));
+	if (index->check != NULL)
+		isc_mem_put(mctx, index->check, index->nviews);
+	isc_mem_put(mctx, index, sizeof(*index));
+}
+
+/*
+ * Build the view selection index for server->viewlist, replacing
+ * the old one.  If this fails, there is no index and views are
+ * selected by matching each view's ACLs in turn.
+ */
+static isc_result_t
+viewindex_build(named_server_t *server) {
+	named_viewindex_t *index = NULL;
+	dns_acl_t **acls = NULL;
+	dns_view_t *view;
+	unsigned int i, nviews = 0;
+	isc_result_t result;
+
+	if (server->viewindex != NULL)
+		viewindex_free(server->mctx, &server->viewindex);
+
+	for (view = ISC_LIST_HEAD(server->viewlist);
+	     view != NULL;
+	     view = ISC_LIST_NEXT(view, link))
+		nviews++;
+	if (nviews == 0)
+		return (ISC_R_SUCCESS);
+
+	index = isc_mem_get(server->mctx, sizeof(*index));
+	if (index == NULL)
+		return (ISC_R_NOMEMORY);
+	memset(index, 0, sizeof(*index));
+	index->nviews = nviews;
+	index->views = isc_mem_get(server->mctx,
+				   nviews * sizeof(dns_view_t *));
+	index->check = isc_mem_get(server->mctx, nviews);
+	acls = isc_mem_get(server->mctx, nviews * sizeof(dns_acl_t *));
+	if (index->views == NULL || index->check == NULL || acls == NULL) {
+		result = ISC_R_NOMEMORY;
+		goto cleanup;
+	}
+
+	i = 0;
+	for (view = ISC_LIST_HEAD(server->viewlist);
+	     view != NULL;
+	     view = ISC_LIST_NEXT(view, link))
+	{
+		index->views[i] = view;
+		index->check[i] = 0;
+		if (view->matchclients != NULL &&
+		    view->matchclients->length != 0)
+			index->check[i] |= VIEWINDEX_CLIENTS;
+		if (view->matchdestinations != NULL &&
+		    view->matchdestinations->length != 0)
+			index->check[i] |= VIEWINDEX_DESTINATIONS;
+		acls[i++] = view->matchclients;
+	}
+	CHECK(dns_aclmap_create(server->mctx, acls, nviews,
+				&index->clients));
+
+	for (i = 0; i < nviews; i++)
+		acls[i] = index->views[i]->matchdestinations;
+	CHECK(dns_aclmap_create(server->mctx, acls, nviews,
+				&index->destinations));
+
+	server->viewindex = index;
+	index = NULL;
+
+ cleanup:
+	if (acls != NULL)
+		isc_mem_put(server->mctx, acls, nviews * sizeof(dns_acl_t *));
+	if (index != NULL)
+		viewindex_free(server->mctx, &index);
+	return (result);
+}
+
+/*
+ * Select a view for an unsigned query without an EDNS client subnet
+ * option, using the view selection index.  Views are still tried in
+ * order, but only those whose ACLs may allow the query are looked at.
+ */
+static isc_result_t
+get_indexed_view(named_viewindex_t *index, isc_netaddr_t *srcaddr,
+		 isc_netaddr_t *destaddr, dns_message_t *message,
+		 dns_aclenv_t *env, isc_result_t *sigresult,
+		 dns_view_t **viewp)
+{
+	const isc_uint64_t *clients, *destinations;
+	dns_view_t *view;
+	unsigned int i;
+
+	clients = dns_aclmap_find(index->clients, srcaddr, env);
+	destinations = dns_aclmap_find(index->destinations, destaddr, env);
+
+	for (i = 0; i < index->nviews; i++) {
+		if ((clients[i / 64] & destinations[i / 64]) == 0) {
+			/* Skip the rest of this word. */
+			i |= 63;
+			continue;
+		}
+		if (!DNS_ACLMAP_ISSET(clients, i) ||
+		    !DNS_ACLMAP_ISSET(destinations, i))
+			continue;
+
+		view = index->views[i];
+		if (message->rdclass != view->rdclass &&
+		    message->rdclass != dns_rdataclass_any)
+			continue;
+		if ((index->check[i] & VIEWINDEX_CLIENTS) != 0 &&
+		    !dns_acl_allowed(srcaddr, NULL, NULL, 0, NULL,
+				     view->matchclients, env))
+			continue;
+		if ((index->check[i] & VIEWINDEX_DESTINATIONS) != 0 &&
+		    !dns_acl_allowed(destaddr, NULL, NULL, 0, NULL,
+				     view->matchdestinations, env))
+			continue;
+		if (view->matchrecursiveonly &&
+		    (message->flags & DNS_MESSAGEFLAG_RD) == 0)
+			continue;
+
+		*sigresult = dns_message_rechecksig(message, view);
+		if (view->viewstats != NULL)
+			isc_stats_increment(view->viewstats,
+					    dns_viewstatscounter_matched);
+		dns_view_attach(view, viewp);
+		return (ISC_R_SUCCESS);
+	}
+
+	return (ISC_R_NOTFOUND);
+}
+
 static isc_result_t
 get_matching_view(isc_netaddr_t *srcaddr, isc_netaddr_t *destaddr,
 		  dns_message_t *message, dns_aclenv_t *env, dns_ecs_t *ecs,
@@ -9356,6 +9873,19 @@ get_matching_view(isc_netaddr_t *srcaddr, isc_netaddr_t *destaddr,
 	REQUIRE(sigresult != NULL);
 	REQUIRE(viewp != NULL && *viewp == NULL);
 
+	/*
+	 * Only the addresses matter for an unsigned query without an
+	 * EDNS client subnet option.
+	 */
+	if (named_g_server->viewindex != NULL && ecs == NULL &&
+	    dns_message_gettsig(message, NULL) == NULL &&
+	    dns_message_getsig0(message, NULL) == NULL)
+	{
+		return (get_indexed_view(named_g_server->viewindex,
+					 srcaddr, destaddr, message, env,
+					 sigresult, viewp));
+	}
+
 	for (view = ISC_LIST_HEAD(named_g_server->viewlist);
 	     view != NULL;
 	     view = ISC_LIST_NEXT(view, link))
@@ -9389,6 +9919,12 @@ get_matching_view(isc_netaddr_t *srcaddr, isc_netaddr_t *destaddr,
 			    !(view->matchrecursiveonly &&
 			      (message->flags & DNS_MESSAGEFLAG_RD) == 0))
 			{
+				if (view->viewstats != NULL) {
+					isc_stats_increment(view->viewstats,
+						dns_viewstatscounter_matched);
+					isc_stats_increment(view->viewstats,
+						dns_viewstatscounter_evaluated);
+				}
 				dns_view_attach(view, viewp);
 				return (ISC_R_SUCCESS);
 			}
@@ -9418,6 +9954,7 @@ named_server_create(isc_mem_t *mctx, named_server_t **serverp) {
 	/* Initialize server data structures. */
 	server->interfacemgr = NULL;
 	ISC_LIST_INIT(server->viewlist);
+	server->viewindex = NULL;
 	server->in_roothints = NULL;
 
 	/* Must be first. */
@@ -9431,6 +9968,9 @@ named_server_create(isc_mem_t *mctx, named_server_t **serverp) {
 
 	CHECKFATAL(isc_mutex_init(&server->reload_event_lock),
 		   "initializing reload event lock");
+	CHECKFATAL(isc_mutex_init(&ns_catz_cbdata.lock),
+		   "initializing catalog zone change lock");
+	ISC_LIST_INIT(ns_catz_cbdata.changes);
 	server->reload_event =
 		isc_event_allocate(named_g_mctx, server,
 				   NAMED_EVENT_RELOAD,
@@ -9492,6 +10032,21 @@ named_server_create(isc_mem_t *mctx, named_server_t **serverp) {
 	CHECKFATAL(dns_zonemgr_setsize(server->zonemgr, 1000),
 		   "dns_zonemgr_setsize");
 
+	/*
+	 * The zone manager reads one zone file at a time by default,
+	 * which leaves all but one worker thread idle while zones are
+	 * loaded.  Allow two files per worker thread, but no fewer
+	 * than 20, to be read concurrently.
+	 */
+	dns_zonemgr_setiolimit(server->zonemgr,
+			       ISC_MAX(20, 2 * named_g_cpus));
+
+	/*
+	 * Compute DNSSEC signatures for zones being signed on one
+	 * thread per CPU, counting the zone's own task.
+	 */
+	dns_zonemgr_setsigners(server->zonemgr, named_g_cpus - 1);
+
 	server->statsfile = isc_mem_strdup(server->mctx, "named.stats");
 	CHECKFATAL(server->statsfile == NULL ? ISC_R_NOMEMORY : ISC_R_SUCCESS,
 		   "isc_mem_strdup");
@@ -9545,6 +10100,13 @@ named_server_create(isc_mem_t *mctx, named_server_t **serverp) {
 
 	ISC_LIST_INIT(server->statschannels);
 
+	server->parsetime = 0;
+	server->conftime = 0;
+	server->exclusivetime = 0;
+	isc_time_settoepoch(&server->loadstart);
+	server->loadtime = 0;
+	server->zonesunchanged = 0;
+
 	ISC_LIST_INIT(server->cachelist);
 
 	server->sessionkey = NULL;
@@ -9556,6 +10118,7 @@ named_server_create(isc_mem_t *mctx, named_server_t **serverp) {
 	server->lockfile = NULL;
 
 	server->dtenv = NULL;
+	server->qlog = NULL;
 
 	server->magic = NAMED_SERVER_MAGIC;
 	*serverp = server;
@@ -9603,6 +10166,7 @@ named_server_destroy(named_server_t **serverp) {
 	dst_lib_destroy();
 
 	isc_event_free(&server->reload_event);
+	DESTROYLOCK(&ns_catz_cbdata.lock);
 
 	INSIST(ISC_LIST_EMPTY(server->viewlist));
 	INSIST(ISC_LIST_EMPTY(server->cachelist));
@@ -12676,7 +13240,8 @@ do_addzone(named_server_t *server, ns_cfgctx_t *cfg, dns_view_t *view,
 	dns_view_thaw(view);
 	result = configure_zone(cfg->config, zoneobj, cfg->vconfig,
 				server->mctx, view, &server->viewlist,
-				cfg->actx, ISC_TRUE, ISC_FALSE, ISC_FALSE);
+				cfg->actx, ISC_TRUE, ISC_FALSE, ISC_FALSE,
+				NULL);
 	dns_view_freeze(view);
 
 	isc_task_endexclusive(server->task);
@@ -12854,7 +13419,8 @@ do_modzone(named_server_t *server, ns_cfgctx_t *cfg, dns_view_t *view,
 	dns_view_thaw(view);
 	result = configure_zone(cfg->config, zoneobj, cfg->vconfig,
 				server->mctx, view, &server->viewlist,
-				cfg->actx, ISC_TRUE, ISC_FALSE, ISC_TRUE);
+				cfg->actx, ISC_TRUE, ISC_FALSE, ISC_TRUE,
+				NULL);
 	dns_view_freeze(view);
 
 	exclusive = ISC_FALSE;
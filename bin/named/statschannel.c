@@ -29,10 +29,12 @@
 #include <dns/rdataclass.h>
 #include <dns/rdatatype.h>
 #include <dns/resolver.h>
+#include <dns/rpz.h>
 #include <dns/stats.h>
 #include <dns/view.h>
 #include <dns/zt.h>
 
+#include <ns/client.h>
 #include <ns/stats.h>
 
 #include <named/log.h>
@@ -128,6 +130,7 @@ static const char *tcpinsizestats_desc[dns_sizecounter_in_max];
 static const char *tcpoutsizestats_desc[dns_sizecounter_out_max];
 static const char *dnstapstats_desc[dns_dnstapcounter_max];
 static const char *gluecachestats_desc[dns_gluecachestatscounter_max];
+static const char *viewstats_desc[dns_viewstatscounter_max];
 #if defined(EXTENDED_STATS)
 static const char *nsstats_xmldesc[ns_statscounter_max];
 static const char *resstats_xmldesc[dns_resstatscounter_max];
@@ -141,6 +144,7 @@ static const char *tcpinsizestats_xmldesc[dns_sizecounter_in_max];
 static const char *tcpoutsizestats_xmldesc[dns_sizecounter_out_max];
 static const char *dnstapstats_xmldesc[dns_dnstapcounter_max];
 static const char *gluecachestats_xmldesc[dns_gluecachestatscounter_max];
+static const char *viewstats_xmldesc[dns_viewstatscounter_max];
 #else
 #define nsstats_xmldesc NULL
 #define resstats_xmldesc NULL
@@ -154,6 +158,7 @@ static const char *gluecachestats_xmldesc[dns_gluecachestatscounter_max];
 #define tcpoutsizestats_xmldesc NULL
 #define dnstapstats_xmldesc NULL
 #define gluecachestats_xmldesc NULL
+#define viewstats_xmldesc NULL
 #endif	/* EXTENDED_STATS */
 
 #define TRY0(a) do { xmlrc = (a); if (xmlrc < 0) goto error; } while(0)
@@ -175,6 +180,7 @@ static int tcpinsizestats_index[dns_sizecounter_in_max];
 static int tcpoutsizestats_index[dns_sizecounter_out_max];
 static int dnstapstats_index[dns_dnstapcounter_max];
 static int gluecachestats_index[dns_gluecachestatscounter_max];
+static int viewstats_index[dns_viewstatscounter_max];
 
 static inline void
 set_desc(int counter, int maxcounter, const char *fdesc, const char **fdescs,
@@ -308,6 +314,34 @@ init_desc(void) {
 		       "QryUsedStale");
 	SET_NSSTATDESC(prefetch, "queries triggered prefetch", "Prefetch");
 	SET_NSSTATDESC(keytagopt, "Keytag option received", "KeyTagOpt");
+	SET_NSSTATDESC(fastpath, "queries answered on the fast path",
+		       "QryFastPath");
+	SET_NSSTATDESC(fastpathlat0, "fast path answers in < "
+		       NS_CLIENT_LATCLASS0STR "us",
+		       "QryFastPath" NS_CLIENT_LATCLASS0STR "us");
+	SET_NSSTATDESC(fastpathlat1, "fast path answers in "
+		       NS_CLIENT_LATCLASS0STR "-" NS_CLIENT_LATCLASS1STR "us",
+		       "QryFastPath" NS_CLIENT_LATCLASS1STR "us");
+	SET_NSSTATDESC(fastpathlat2, "fast path answers in "
+		       NS_CLIENT_LATCLASS1STR "-" NS_CLIENT_LATCLASS2STR "us",
+		       "QryFastPath" NS_CLIENT_LATCLASS2STR "us");
+	SET_NSSTATDESC(fastpathlat3, "fast path answers in > "
+		       NS_CLIENT_LATCLASS2STR "us",
+		       "QryFastPath" NS_CLIENT_LATCLASS2STR "us+");
+	SET_NSSTATDESC(slowpath, "queries answered on the slow path",
+		       "QrySlowPath");
+	SET_NSSTATDESC(slowpathlat0, "slow path answers in < "
+		       NS_CLIENT_LATCLASS0STR "us",
+		       "QrySlowPath" NS_CLIENT_LATCLASS0STR "us");
+	SET_NSSTATDESC(slowpathlat1, "slow path answers in "
+		       NS_CLIENT_LATCLASS0STR "-" NS_CLIENT_LATCLASS1STR "us",
+		       "QrySlowPath" NS_CLIENT_LATCLASS1STR "us");
+	SET_NSSTATDESC(slowpathlat2, "slow path answers in "
+		       NS_CLIENT_LATCLASS1STR "-" NS_CLIENT_LATCLASS2STR "us",
+		       "QrySlowPath" NS_CLIENT_LATCLASS2STR "us");
+	SET_NSSTATDESC(slowpathlat3, "slow path answers in > "
+		       NS_CLIENT_LATCLASS2STR "us",
+		       "QrySlowPath" NS_CLIENT_LATCLASS2STR "us+");
 	INSIST(i == ns_statscounter_max);
 
 	/* Initialize resolver statistics */
@@ -619,6 +653,10 @@ init_desc(void) {
 	i = 0;
 	SET_DNSTAPSTATDESC(success, "dnstap messges written", "DNSTAPsuccess");
 	SET_DNSTAPSTATDESC(drop, "dnstap messages dropped", "DNSTAPdropped");
+	SET_DNSTAPSTATDESC(sampled, "dnstap messages skipped by sampling",
+			   "DNSTAPsampled");
+	SET_DNSTAPSTATDESC(queued, "dnstap messages queued for writing",
+			   "DNSTAPqueued");
 	INSIST(i == dns_dnstapcounter_max);
 
 #define SET_GLUECACHESTATDESC(counterid, desc, xmldesc) \
@@ -645,6 +683,28 @@ init_desc(void) {
 			      "GLUECACHEinsertsabsent");
 	INSIST(i == dns_gluecachestatscounter_max);
 
+	/* Initialize view selection statistics */
+	for (i = 0; i < dns_viewstatscounter_max; i++)
+		viewstats_desc[i] = NULL;
+#if defined(EXTENDED_STATS)
+	for (i = 0; i < dns_viewstatscounter_max; i++)
+		viewstats_xmldesc[i] = NULL;
+#endif
+
+#define SET_VIEWSTATDESC(counterid, desc, xmldesc) \
+	do { \
+		set_desc(dns_viewstatscounter_ ## counterid, \
+			 dns_viewstatscounter_max, \
+			 desc, viewstats_desc, xmldesc, viewstats_xmldesc); \
+		viewstats_index[i++] = dns_viewstatscounter_ ## counterid; \
+	} while (0)
+	i = 0;
+	SET_VIEWSTATDESC(matched, "requests matched to this view",
+			 "Matched");
+	SET_VIEWSTATDESC(evaluated, "matched by evaluating every ACL",
+			 "MatchEvaluated");
+	INSIST(i == dns_viewstatscounter_max);
+
 	/* Sanity check */
 	for (i = 0; i < ns_statscounter_max; i++)
 		INSIST(nsstats_desc[i] != NULL);
@@ -662,6 +722,8 @@ init_desc(void) {
 		INSIST(dnstapstats_desc[i] != NULL);
 	for (i = 0; i < dns_gluecachestatscounter_max; i++)
 		INSIST(gluecachestats_desc[i] != NULL);
+	for (i = 0; i < dns_viewstatscounter_max; i++)
+		INSIST(viewstats_desc[i] != NULL);
 #if defined(EXTENDED_STATS)
 	for (i = 0; i < ns_statscounter_max; i++)
 		INSIST(nsstats_xmldesc[i] != NULL);
@@ -679,6 +741,8 @@ init_desc(void) {
 		INSIST(dnstapstats_xmldesc[i] != NULL);
 	for (i = 0; i < dns_gluecachestatscounter_max; i++)
 		INSIST(gluecachestats_xmldesc[i] != NULL);
+	for (i = 0; i < dns_viewstatscounter_max; i++)
+		INSIST(viewstats_xmldesc[i] != NULL);
 #endif
 
 	/* Initialize traffic size statistics */
@@ -1439,6 +1503,68 @@ rcodestat_dump(dns_rcode_t code, isc_uint64_t val, void *arg) {
 #endif
 }
 
+#if defined(HAVE_LIBXML2) || defined(HAVE_JSON)
+/*
+ * Progress and phase timing of the most recent (re)configuration: the
+ * milliseconds spent parsing the configuration, configuring views and
+ * zones, with tasks paused for the reconfiguration, and loading zones
+ * (so far, while loading is still under way), followed by the number
+ * of zones, how many of them are still waiting to be loaded and how
+ * many were left unchanged by the reconfiguration.
+ */
+#define STARTUPSTATS_COUNT	7
+
+static const char *startupstats_names[STARTUPSTATS_COUNT] = {
+	"parse-time", "configure-time", "exclusive-time", "load-time",
+	"zones", "zones-loading", "zones-unchanged"
+};
+
+static void
+startupstats_get(named_server_t *server, const isc_time_t *now,
+		 isc_uint64_t *values)
+{
+	isc_uint64_t loadtime = server->loadtime;
+
+	if (loadtime == 0 && !isc_time_isepoch(&server->loadstart))
+		loadtime = isc_time_microdiff(now, &server->loadstart);
+
+	values[0] = server->parsetime / 1000;
+	values[1] = server->conftime / 1000;
+	values[2] = server->exclusivetime / 1000;
+	values[3] = loadtime / 1000;
+	values[4] = dns_zonemgr_getcount(server->zonemgr, DNS_ZONESTATE_ANY);
+	values[5] = dns_zonemgr_getcount(server->zonemgr,
+					 DNS_ZONESTATE_LOADPENDING);
+	values[6] = server->zonesunchanged;
+}
+
+/*
+ * Signatures computed for 'zone' so far and the rate at which they
+ * were computed, in signatures per second.
+ */
+static void
+signingstats_get(dns_zone_t *zone, isc_uint64_t *signatures,
+		 isc_uint64_t *rate)
+{
+	isc_uint64_t usecs;
+
+	dns_zone_getsigningstats(zone, signatures, &usecs);
+	*rate = *signatures * 1000000 / ISC_MAX(usecs, 1);
+}
+
+/*
+ * Bytes sent in outgoing transfers of 'zone' so far and the rate at
+ * which they were sent, in bytes per second.
+ */
+static void
+xfroutstats_get(dns_zone_t *zone, isc_uint64_t *bytes, isc_uint64_t *rate) {
+	isc_uint64_t usecs;
+
+	dns_zone_getxfroutstats(zone, bytes, &usecs);
+	*rate = *bytes * 1000000 / ISC_MAX(usecs, 1);
+}
+#endif
+
 #ifdef HAVE_LIBXML2
 /*
  * Which statistics to include when rendering to XML
@@ -1463,6 +1589,7 @@ zone_xmlrender(dns_zone_t *zone, void *arg) {
 	int xmlrc;
 	stats_dumparg_t dumparg;
 	const char *ztype;
+	isc_uint64_t signatures, rate, bytes;
 
 	statlevel = dns_zone_getstatlevel(zone);
 	if (statlevel == dns_zonestat_none)
@@ -1497,6 +1624,37 @@ zone_xmlrender(dns_zone_t *zone, void *arg) {
 		TRY0(xmlTextWriterWriteString(writer, ISC_XMLCHAR "-"));
 	TRY0(xmlTextWriterEndElement(writer)); /* serial */
 
+	signingstats_get(zone, &signatures, &rate);
+	if (signatures != 0) {
+		TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "signing"));
+		TRY0(xmlTextWriterStartElement(writer,
+					       ISC_XMLCHAR "signatures"));
+		TRY0(xmlTextWriterWriteFormatString(writer,
+				"%" ISC_PRINT_QUADFORMAT "u", signatures));
+		TRY0(xmlTextWriterEndElement(writer)); /* signatures */
+		TRY0(xmlTextWriterStartElement(writer,
+				ISC_XMLCHAR "signatures-per-second"));
+		TRY0(xmlTextWriterWriteFormatString(writer,
+				"%" ISC_PRINT_QUADFORMAT "u", rate));
+		TRY0(xmlTextWriterEndElement(writer)); /* signatures-per-second */
+		TRY0(xmlTextWriterEndElement(writer)); /* signing */
+	}
+
+	xfroutstats_get(zone, &bytes, &rate);
+	if (bytes != 0) {
+		TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "xfrout"));
+		TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "bytes"));
+		TRY0(xmlTextWriterWriteFormatString(writer,
+				"%" ISC_PRINT_QUADFORMAT "u", bytes));
+		TRY0(xmlTextWriterEndElement(writer)); /* bytes */
+		TRY0(xmlTextWriterStartElement(writer,
+				ISC_XMLCHAR "bytes-per-second"));
+		TRY0(xmlTextWriterWriteFormatString(writer,
+				"%" ISC_PRINT_QUADFORMAT "u", rate));
+		TRY0(xmlTextWriterEndElement(writer)); /* bytes-per-second */
+		TRY0(xmlTextWriterEndElement(writer)); /* xfrout */
+	}
+
 	if (statlevel == dns_zonestat_full) {
 		isc_stats_t *zonestats;
 		isc_stats_t *gluecachestats;
@@ -1590,6 +1748,7 @@ generatexml(named_server_t *server, isc_uint32_t flags,
 	dns_stats_t *cacherrstats;
 	isc_uint64_t nsstat_values[ns_statscounter_max];
 	isc_uint64_t resstat_values[dns_resstatscounter_max];
+	isc_uint64_t viewstat_values[dns_viewstatscounter_max];
 	isc_uint64_t adbstat_values[dns_adbstats_max];
 	isc_uint64_t zonestat_values[dns_zonestatscounter_max];
 	isc_uint64_t sockstat_values[isc_sockstatscounter_max];
@@ -1597,10 +1756,12 @@ generatexml(named_server_t *server, isc_uint32_t flags,
 	isc_uint64_t udpoutsizestat_values[dns_sizecounter_out_max];
 	isc_uint64_t tcpinsizestat_values[dns_sizecounter_in_max];
 	isc_uint64_t tcpoutsizestat_values[dns_sizecounter_out_max];
+	isc_uint64_t startupstat_values[STARTUPSTATS_COUNT];
 #if HAVE_DNSTAP
 	isc_uint64_t dnstapstat_values[dns_dnstapcounter_max];
 #endif
 	isc_result_t result;
+	int i;
 
 	isc_time_now(&now);
 	isc_time_formatISO8601ms(&named_g_boottime, boottime, sizeof boottime);
@@ -1630,6 +1791,17 @@ generatexml(named_server_t *server, isc_uint32_t flags,
 	TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "config-time"));
 	TRY0(xmlTextWriterWriteString(writer, ISC_XMLCHAR configtime));
 	TRY0(xmlTextWriterEndElement(writer)); /* config-time */
+	TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "startup"));
+	startupstats_get(server, &now, startupstat_values);
+	for (i = 0; i < STARTUPSTATS_COUNT; i++) {
+		TRY0(xmlTextWriterStartElement(writer,
+				ISC_XMLCHAR startupstats_names[i]));
+		TRY0(xmlTextWriterWriteFormatString(writer,
+				"%" ISC_PRINT_QUADFORMAT "u",
+				startupstat_values[i]));
+		TRY0(xmlTextWriterEndElement(writer));
+	}
+	TRY0(xmlTextWriterEndElement(writer)); /* startup */
 	TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "current-time"));
 	TRY0(xmlTextWriterWriteString(writer, ISC_XMLCHAR nowstr));
 	TRY0(xmlTextWriterEndElement(writer));  /* current-time */
@@ -1955,6 +2127,22 @@ generatexml(named_server_t *server, isc_uint32_t flags,
 		}
 		TRY0(xmlTextWriterEndElement(writer)); /* </resstats> */
 
+		/* <viewstats> */
+		TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "counters"));
+		TRY0(xmlTextWriterWriteAttribute(writer, ISC_XMLCHAR "type",
+						 ISC_XMLCHAR "viewstats"));
+		if (view->viewstats != NULL) {
+			result = dump_counters(view->viewstats,
+					       isc_statsformat_xml, writer,
+					       NULL, viewstats_xmldesc,
+					       dns_viewstatscounter_max,
+					       viewstats_index, viewstat_values,
+					       ISC_STATSDUMP_VERBOSE);
+			if (result != ISC_R_SUCCESS)
+				goto error;
+		}
+		TRY0(xmlTextWriterEndElement(writer)); /* </viewstats> */
+
 		cacherrstats = dns_db_getrrsetstats(view->cachedb);
 		if (cacherrstats != NULL) {
 			TRY0(xmlTextWriterStartElement(writer,
@@ -1994,6 +2182,17 @@ generatexml(named_server_t *server, isc_uint32_t flags,
 		TRY0(dns_cache_renderxml(view->cache, writer));
 		TRY0(xmlTextWriterEndElement(writer)); /* </cachestats> */
 
+		if (view->rpzs != NULL && !view->rpzs->p.dnsrps_enabled) {
+			/* <rpzstats> */
+			TRY0(xmlTextWriterStartElement(writer,
+						ISC_XMLCHAR "counters"));
+			TRY0(xmlTextWriterWriteAttribute(writer,
+						ISC_XMLCHAR "type",
+						ISC_XMLCHAR "rpzstats"));
+			TRY0(dns_rpz_renderxml(view->rpzs, writer));
+			TRY0(xmlTextWriterEndElement(writer)); /* </rpzstats> */
+		}
+
 		TRY0(xmlTextWriterEndElement(writer)); /* view */
 
 		view = ISC_LIST_NEXT(view, link);
@@ -2256,6 +2455,7 @@ zone_jsonrender(dns_zone_t *zone, void *arg) {
 	json_object *zonearray = (json_object *) arg;
 	json_object *zoneobj = NULL;
 	dns_zonestat_level_t statlevel;
+	isc_uint64_t signatures, rate, bytes;
 
 	statlevel = dns_zone_getstatlevel(zone);
 	if (statlevel == dns_zonestat_none)
@@ -2278,6 +2478,34 @@ zone_jsonrender(dns_zone_t *zone, void *arg) {
 	if (zoneobj == NULL)
 		return (ISC_R_NOMEMORY);
 
+	signingstats_get(zone, &signatures, &rate);
+	if (signatures != 0) {
+		json_object *signing = json_object_new_object();
+		if (signing == NULL) {
+			result = ISC_R_NOMEMORY;
+			goto error;
+		}
+		json_object_object_add(signing, "signatures",
+				       json_object_new_int64(signatures));
+		json_object_object_add(signing, "signatures-per-second",
+				       json_object_new_int64(rate));
+		json_object_object_add(zoneobj, "signing", signing);
+	}
+
+	xfroutstats_get(zone, &bytes, &rate);
+	if (bytes != 0) {
+		json_object *xfrout = json_object_new_object();
+		if (xfrout == NULL) {
+			result = ISC_R_NOMEMORY;
+			goto error;
+		}
+		json_object_object_add(xfrout, "bytes",
+				       json_object_new_int64(bytes));
+		json_object_object_add(xfrout, "bytes-per-second",
+				       json_object_new_int64(rate));
+		json_object_object_add(zoneobj, "xfrout", xfrout);
+	}
+
 	if (statlevel == dns_zonestat_full) {
 		isc_stats_t *zonestats;
 		isc_stats_t *gluecachestats;
@@ -2378,13 +2606,14 @@ generatejson(named_server_t *server, size_t *msglen,
 	dns_view_t *view;
 	isc_result_t result = ISC_R_SUCCESS;
 	json_object *bindstats, *viewlist, *counters, *obj;
-	json_object *traffic = NULL;
+	json_object *traffic = NULL, *startup = NULL;
 	json_object *udpreq4 = NULL, *udpresp4 = NULL;
 	json_object *tcpreq4 = NULL, *tcpresp4 = NULL;
 	json_object *udpreq6 = NULL, *udpresp6 = NULL;
 	json_object *tcpreq6 = NULL, *tcpresp6 = NULL;
 	isc_uint64_t nsstat_values[ns_statscounter_max];
 	isc_uint64_t resstat_values[dns_resstatscounter_max];
+	isc_uint64_t viewstat_values[dns_viewstatscounter_max];
 	isc_uint64_t adbstat_values[dns_adbstats_max];
 	isc_uint64_t zonestat_values[dns_zonestatscounter_max];
 	isc_uint64_t sockstat_values[isc_sockstatscounter_max];
@@ -2392,6 +2621,7 @@ generatejson(named_server_t *server, size_t *msglen,
 	isc_uint64_t udpoutsizestat_values[dns_sizecounter_out_max];
 	isc_uint64_t tcpinsizestat_values[dns_sizecounter_in_max];
 	isc_uint64_t tcpoutsizestat_values[dns_sizecounter_out_max];
+	isc_uint64_t startupstat_values[STARTUPSTATS_COUNT];
 #if HAVE_DNSTAP
 	isc_uint64_t dnstapstat_values[dns_dnstapcounter_max];
 #endif
@@ -2400,6 +2630,7 @@ generatejson(named_server_t *server, size_t *msglen,
 	char configtime[sizeof "yyyy-mm-ddThh:mm:ss.sssZ"];
 	char nowstr[sizeof "yyyy-mm-ddThh:mm:ss.sssZ"];
 	isc_time_t now;
+	int i;
 
 	REQUIRE(msglen != NULL);
 	REQUIRE(msg != NULL && *msg == NULL);
@@ -2431,6 +2662,16 @@ generatejson(named_server_t *server, size_t *msglen,
 	CHECKMEM(obj);
 	json_object_object_add(bindstats, "config-time", obj);
 
+	startup = json_object_new_object();
+	CHECKMEM(startup);
+	json_object_object_add(bindstats, "startup", startup);
+	startupstats_get(server, &now, startupstat_values);
+	for (i = 0; i < STARTUPSTATS_COUNT; i++) {
+		obj = json_object_new_int64(startupstat_values[i]);
+		CHECKMEM(obj);
+		json_object_object_add(startup, startupstats_names[i], obj);
+	}
+
 	obj = json_object_new_string(nowstr);
 	CHECKMEM(obj);
 	json_object_object_add(bindstats, "current-time", obj);
@@ -2623,6 +2864,28 @@ generatejson(named_server_t *server, size_t *msglen,
 				dns_stats_t *dstats;
 				isc_stats_t *istats;
 
+				istats = view->viewstats;
+				if (istats != NULL) {
+					counters = json_object_new_object();
+					CHECKMEM(counters);
+
+					result = dump_counters(istats,
+						       isc_statsformat_json,
+						       counters, NULL,
+						       viewstats_xmldesc,
+						       dns_viewstatscounter_max,
+						       viewstats_index,
+						       viewstat_values, 0);
+					if (result != ISC_R_SUCCESS) {
+						json_object_put(counters);
+						result = dumparg.result;
+						goto error;
+					}
+
+					json_object_object_add(v, "viewstats",
+							       counters);
+				}
+
 				res = json_object_new_object();
 				CHECKMEM(res);
 				json_object_object_add(v, "resolver", res);
@@ -2703,6 +2966,23 @@ generatejson(named_server_t *server, size_t *msglen,
 				json_object_object_add(res, "cachestats",
 						       counters);
 
+				if (view->rpzs != NULL &&
+				    !view->rpzs->p.dnsrps_enabled)
+				{
+					counters = json_object_new_object();
+					CHECKMEM(counters);
+
+					result = dns_rpz_renderjson(view->rpzs,
+								    counters);
+					if (result != ISC_R_SUCCESS) {
+						json_object_put(counters);
+						goto error;
+					}
+
+					json_object_object_add(res, "rpzstats",
+							       counters);
+				}
+
 				istats = view->adbstats;
 				if (istats != NULL) {
 					counters = json_object_new_object();
@@ -3546,6 +3826,7 @@ named_stats_dump(named_server_t *server, FILE *fp) {
 	stats_dumparg_t dumparg;
 	isc_uint64_t nsstat_values[ns_statscounter_max];
 	isc_uint64_t resstat_values[dns_resstatscounter_max];
+	isc_uint64_t viewstat_values[dns_viewstatscounter_max];
 	isc_uint64_t adbstat_values[dns_adbstats_max];
 	isc_uint64_t zonestat_values[dns_zonestatscounter_max];
 	isc_uint64_t sockstat_values[isc_sockstatscounter_max];
@@ -3617,6 +3898,22 @@ named_stats_dump(named_server_t *server, FILE *fp) {
 				     resstat_values, 0);
 	}
 
+	fprintf(fp, "++ View Selection Statistics ++\n");
+	for (view = ISC_LIST_HEAD(server->viewlist);
+	     view != NULL;
+	     view = ISC_LIST_NEXT(view, link)) {
+		if (view->viewstats == NULL)
+			continue;
+		if (strcmp(view->name, "_default") == 0)
+			fprintf(fp, "[View: default]\n");
+		else
+			fprintf(fp, "[View: %s]\n", view->name);
+		(void) dump_counters(view->viewstats, isc_statsformat_file, fp,
+				     NULL, viewstats_desc,
+				     dns_viewstatscounter_max, viewstats_index,
+				     viewstat_values, 0);
+	}
+
 	fprintf(fp, "++ Cache Statistics ++\n");
 	for (view = ISC_LIST_HEAD(server->viewlist);
 	     view != NULL;
@@ -3634,6 +3931,19 @@ named_stats_dump(named_server_t *server, FILE *fp) {
 		dns_cache_dumpstats(view->cache, fp);
 	}
 
+	fprintf(fp, "++ Response Policy Summary ++\n");
+	for (view = ISC_LIST_HEAD(server->viewlist);
+	     view != NULL;
+	     view = ISC_LIST_NEXT(view, link)) {
+		if (view->rpzs == NULL || view->rpzs->p.dnsrps_enabled)
+			continue;
+		if (strcmp(view->name, "_default") == 0)
+			fprintf(fp, "[View: default]\n");
+		else
+			fprintf(fp, "[View: %s]\n", view->name);
+		dns_rpz_dumpstats(view->rpzs, fp);
+	}
+
 	fprintf(fp, "++ Cache DB RRsets ++\n");
 	for (view = ISC_LIST_HEAD(server->viewlist);
 	     view != NULL;
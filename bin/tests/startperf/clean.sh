@@ -10,3 +10,4 @@
 
 rm -rf zones
 rm -f named.conf
+rm -f named.log* named.pid
@@ -38,6 +38,7 @@ options {
         listen-on { localhost; };
         listen-on-v6 { localhost; };
 	port 5300;
+	pid-file "named.pid";
         allow-query { any; };
         allow-transfer { localhost; };
         allow-recursion { none; };
@@ -53,6 +54,10 @@ controls {
         inet 127.0.0.1 port 9953 allow { any; } keys { rndc_key; };
 };
 
+statistics-channels {
+        inet 127.0.0.1 port 8888 allow { localhost; };
+};
+
 logging {
         channel basic {
                 file "`pwd`/named.log" versions 3 size 100m;
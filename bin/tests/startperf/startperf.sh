@@ -0,0 +1,68 @@
+#!/bin/sh
+#
+# Copyright (C) 2018  Internet Systems Consortium, Inc. ("ISC")
+#
+# This Source Code Form is subject to the terms of the Mozilla Public
+# License, v. 2.0. If a copy of the MPL was not distributed with this
+# file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#
+# Generate a server with setup.sh, start it, and report how long it
+# took to load all zones, broken down by the startup phases reported
+# on the statistics channel; then reload the configuration and report
+# the same for the reconfiguration.
+#
+
+usage () {
+    echo "Usage: $0 [-s] <number of zones> [<records per zone>]"
+    echo "       -s: use the same zone file all zones"
+    exit 1
+}
+
+if [ "$#" -lt 1 -o "$#" -gt 3 ]; then
+    usage
+fi
+
+. ../system/conf.sh
+
+sh setup.sh "$@" > named.conf || exit 1
+rm -f named.log named.pid
+
+now () {
+    $PERL -MTime::HiRes=time -e 'printf "%.3f\n", time'
+}
+
+start=`now`
+$NAMED -c `pwd`/named.conf || exit 1
+
+while ! grep "all zones loaded" named.log > /dev/null 2>&1
+do
+    sleep 1
+done
+end=`now`
+
+$PERL -e 'printf "total: %d ms\n", ($ARGV[1] - $ARGV[0]) * 1000' $start $end
+
+#
+# The statistics channel only answers once the server leaves the
+# privileged mode in which it loads zones at startup.
+#
+stats () {
+    $CURL -s http://127.0.0.1:8888/xml/v3/status |
+    $PERL -ne 'print "$1: $2\n" while (/<([a-z-]+)>(\d+)<\/\1>/g)'
+}
+
+stats
+
+#
+# Reload the unchanged configuration; every zone should be left alone.
+#
+echo "reconfiguration:"
+kill -HUP `cat named.pid`
+while ! grep "reloading configuration succeeded" named.log > /dev/null 2>&1
+do
+    sleep 1
+done
+stats
+
+kill `cat named.pid`
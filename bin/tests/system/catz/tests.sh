@@ -99,6 +99,13 @@ ret=0
 if [ $ret != 0 ]; then echo "I: failed"; fi
 status=`expr $status + $ret`
 
+n=`expr $n + 1`
+echo "I: checking that catalog1 was updated incrementally ($n)"
+ret=0
+sed -n "$cur,"'$p' < ns2/named.run | grep "catz: catalog zone 'catalog1.example' updated incrementally from serial .*: 1 entries changed" > /dev/null || ret=1
+if [ $ret != 0 ]; then echo "I: failed"; fi
+status=`expr $status + $ret`
+
 n=`expr $n + 1`
 echo "I: removing domain dom1.example from catalog1 zone ($n)"
 ret=0
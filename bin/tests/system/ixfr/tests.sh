@@ -134,6 +134,52 @@ $DIGCMD nil. TXT | grep 'fallback AXFR' >/dev/null || {
     status=1
 }
 
+echo "I:testing that a large IXFR is applied in bounded batches"
+
+# Send a delta adding 400 one-kilobyte TXT records, split over several
+# messages, and check that the slave never held more than about 64k
+# of it in memory before applying it to the zone.
+
+str=`printf "%0250d" 0`
+{
+	echo "/SOA/"
+	echo "nil.	300	SOA	ns.nil. root.nil. 5 300 300 604800 300"
+	echo "/IXFR/"
+	echo "nil.	300	SOA	ns.nil. root.nil. 5 300 300 604800 300"
+	echo "nil.	300	SOA	ns.nil. root.nil. 3 300 300 604800 300"
+	echo "nil.	300	SOA	ns.nil. root.nil. 5 300 300 604800 300"
+	i=0
+	while [ $i -lt 400 ]
+	do
+		[ `expr $i % 40` -eq 39 ] && echo "/IXFR/"
+		echo "big.nil.	300	TXT	\"$i $str\" \"$str\" \"$str\" \"$str\""
+		i=`expr $i + 1`
+	done
+	echo "/IXFR/"
+	echo "nil.	300	SOA	ns.nil. root.nil. 5 300 300 604800 300"
+} | $SENDCMD
+
+sleep 1
+
+$RNDCCMD refresh nil
+
+for i in 0 1 2 3 4 5 6 7 8 9
+do
+	$DIGCMD nil. SOA > dig.out
+	grep "root.nil. 5 " dig.out > /dev/null && break
+	sleep 1
+done
+
+ret=0
+records=`$DIGCMD nil. AXFR | grep -c "^big.nil..*TXT"`
+[ "$records" -eq 400 ] || ret=1
+pending=`sed -n 's/.*transfer of .nil.* at most \([0-9]*\) bytes of changes.*/\1/p' ns1/named.run | tail -1`
+[ "${pending:-0}" -gt 0 -a "${pending:-0}" -lt 70000 ] || ret=1
+if [ $ret != 0 ]; then
+	echo "I:failed"
+	status=1
+fi
+
 echo "I:testing ixfr-from-differences option"
 # ns3 is master; ns4 is slave 
 $CHECKZONE test. ns3/mytest.db > /dev/null 2>&1
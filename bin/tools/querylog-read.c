@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2018  Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+
+#include <isc/buffer.h>
+#include <isc/commandline.h>
+#include <isc/mem.h>
+#include <isc/print.h>
+#include <isc/util.h>
+
+#include <dns/qlog.h>
+#include <dns/result.h>
+
+static isc_mem_t *mctx = NULL;
+static isc_boolean_t memrecord = ISC_FALSE;
+
+static const char *program = "querylog-read";
+
+ISC_PLATFORM_NORETURN_PRE static void
+fatal(const char *format, ...) ISC_PLATFORM_NORETURN_POST;
+
+static void
+fatal(const char *format, ...) {
+	va_list args;
+
+	fprintf(stderr, "%s: fatal: ", program);
+	va_start(args, format);
+	vfprintf(stderr, format, args);
+	va_end(args);
+	fprintf(stderr, "\n");
+	exit(1);
+}
+
+static void
+usage(void) {
+	fprintf(stderr, "Usage: %s [-m] file...\n", program);
+	fprintf(stderr, "\t-m\ttrace memory allocations\n");
+}
+
+/*
+ * Print every query record in 'filename'.  Returns ISC_R_SUCCESS if
+ * the whole file was read.
+ */
+static isc_result_t
+printfile(const char *filename) {
+	dns_qlogreader_t *reader = NULL;
+	dns_qlogentry_t entry;
+	char text[1024];
+	isc_buffer_t b;
+	isc_result_t result;
+
+	result = dns_qlog_open(mctx, filename, &reader);
+	if (result != ISC_R_SUCCESS) {
+		fprintf(stderr, "%s: %s: %s\n", program, filename,
+			isc_result_totext(result));
+		return (result);
+	}
+
+	while ((result = dns_qlog_read(reader, &entry)) == ISC_R_SUCCESS) {
+		isc_buffer_init(&b, text, sizeof(text));
+		result = dns_qlog_totext(&entry, &b);
+		if (result != ISC_R_SUCCESS)
+			break;
+		fwrite(text, 1, isc_buffer_usedlength(&b), stdout);
+	}
+
+	if (result == ISC_R_NOMORE) {
+		result = ISC_R_SUCCESS;
+	} else {
+		fprintf(stderr, "%s: %s: %s\n", program, filename,
+			isc_result_totext(result));
+	}
+
+	dns_qlog_close(&reader);
+	return (result);
+}
+
+int
+main(int argc, char *argv[]) {
+	int ch, i, rv = 0;
+
+	while ((ch = isc_commandline_parse(argc, argv, "m")) != -1) {
+		switch (ch) {
+		case 'm':
+			isc_mem_debugging |= ISC_MEM_DEBUGRECORD;
+			memrecord = ISC_TRUE;
+			break;
+		default:
+			usage();
+			exit(1);
+		}
+	}
+
+	argc -= isc_commandline_index;
+	argv += isc_commandline_index;
+
+	if (argc < 1)
+		fatal("no file specified");
+
+	RUNTIME_CHECK(isc_mem_create(0, 0, &mctx) == ISC_R_SUCCESS);
+
+	dns_result_register();
+
+	for (i = 0; i < argc; i++) {
+		if (printfile(argv[i]) != ISC_R_SUCCESS)
+			rv = 1;
+	}
+
+	if (fflush(stdout) != 0)
+		rv = 1;
+
+	if (memrecord)
+		isc_mem_stats(mctx, stderr);
+	isc_mem_destroy(&mctx);
+
+	exit(rv);
+}
@@ -10,6 +10,8 @@
 
 #include <config.h>
 
+#include <stdlib.h>
+
 #include <isc/mem.h>
 #include <isc/once.h>
 #include <isc/string.h>
@@ -18,6 +20,60 @@
 #include <dns/acl.h>
 #include <dns/iptable.h>
 
+/*
+ * A compiled IP table.  The IPv4 and IPv6 address spaces are each
+ * divided into ranges of addresses that get the same result from the
+ * radix tree.  For each family, the first addresses of the ranges are
+ * kept in a sorted array of their own, so that a lookup is a binary
+ * search over a few cache lines, and the results (the signed node
+ * number that is returned in '*match', or 0) in a parallel array.
+ */
+typedef struct {
+	isc_uint64_t		hi;
+	isc_uint64_t		lo;
+} aclkey_t;
+
+#define DNS_ACLMAP_MAGIC	ISC_MAGIC('D','a','c','m')
+#define DNS_ACLMAP_VALID(m)	ISC_MAGIC_VALID(m, DNS_ACLMAP_MAGIC)
+
+struct dns_acltable {
+	unsigned int		generation;	/* of the iptable when compiled */
+	unsigned int		n4;
+	isc_uint32_t		*start4;
+	int			*match4;
+	unsigned int		n6;
+	aclkey_t		*start6;
+	int			*match6;
+};
+
+/*
+ * The compiled table is current if no prefix has been added to the
+ * IP table since it was built.  The node count is not enough: adding
+ * data to an existing radix node does not change it.
+ */
+#define TABLE_CURRENT(acl) \
+	((acl)->table != NULL && \
+	 (acl)->table->generation == (acl)->iptable->generation)
+
+/*
+ * A combination of several ACLs.  Like a compiled table, it divides
+ * the address space of each family into ranges, but each range has a
+ * set of ACLs, 'words' 64 bit words with one bit per ACL, instead of
+ * a match result.
+ */
+struct dns_aclmap {
+	unsigned int		magic;
+	isc_mem_t		*mctx;
+	unsigned int		nacls;
+	unsigned int		words;
+	unsigned int		n4;
+	isc_uint32_t		*start4;
+	isc_uint64_t		*sets4;
+	unsigned int		n6;
+	aclkey_t		*start6;
+	isc_uint64_t		*sets6;
+	isc_uint64_t		*all;		/* Other families */
+};
 
 /*
  * Create a new ACL, including an IP table and an array with room
@@ -60,6 +116,7 @@ dns_acl_create(isc_mem_t *mctx, int n, dns_acl_t **target) {
 	acl->alloc = 0;
 	acl->length = 0;
 	acl->has_negatives = ISC_FALSE;
+	acl->table = NULL;
 
 	ISC_LINK_INIT(acl, nextincache);
 	/*
@@ -187,6 +244,74 @@ dns_acl_match(const isc_netaddr_t *reqaddr,
 			       match, matchelt));
 }
 
+static inline int
+key_cmp(const aclkey_t *a, const aclkey_t *b) {
+	if (a->hi != b->hi)
+		return ((a->hi < b->hi) ? -1 : 1);
+	if (a->lo != b->lo)
+		return ((a->lo < b->lo) ? -1 : 1);
+	return (0);
+}
+
+/*
+ * Find the last of the 'n' sorted range starts that is not above
+ * 'key'.  The first range of each family starts at address 0, so
+ * there always is one.
+ */
+static inline unsigned int
+find4(const isc_uint32_t *starts, unsigned int n, isc_uint32_t key) {
+	unsigned int lo = 0, hi = n, mid;
+
+	while (hi - lo > 1) {
+		mid = lo + (hi - lo) / 2;
+		if (starts[mid] <= key)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	return (lo);
+}
+
+static inline unsigned int
+find6(const aclkey_t *starts, unsigned int n, const aclkey_t *key) {
+	unsigned int lo = 0, hi = n, mid;
+
+	while (hi - lo > 1) {
+		mid = lo + (hi - lo) / 2;
+		if (key_cmp(&starts[mid], key) <= 0)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	return (lo);
+}
+
+static inline void
+in6_tokey(const struct in6_addr *in6, aclkey_t *key) {
+	unsigned int i;
+
+	key->hi = key->lo = 0;
+	for (i = 0; i < 8; i++) {
+		key->hi = (key->hi << 8) | in6->s6_addr[i];
+		key->lo = (key->lo << 8) | in6->s6_addr[i + 8];
+	}
+}
+
+/*
+ * Look up 'addr', which must be IPv4 or IPv6, in the compiled table.
+ */
+static int
+table_match(const dns_acltable_t *table, const isc_netaddr_t *addr) {
+	aclkey_t key;
+
+	if (addr->family == AF_INET)
+		return (table->match4[find4(table->start4, table->n4,
+					    ntohl(addr->type.in.s_addr))]);
+
+	in6_tokey(&addr->type.in6, &key);
+	return (table->match6[find6(table->start6, table->n6, &key)]);
+}
+
 isc_result_t
 dns_acl_match2(const isc_netaddr_t *reqaddr,
 	       const dns_name_t *reqsigner,
@@ -219,27 +344,40 @@ dns_acl_match2(const isc_netaddr_t *reqaddr,
 		addr = &v4addr;
 	}
 
-	/* Always match with host addresses. */
-	bitlen = (addr->family == AF_INET6) ? 128 : 32;
-	NETADDR_TO_PREFIX_T(addr, pfx, bitlen, ISC_FALSE);
-
 	/* Assume no match. */
 	*match = 0;
 
-	/* Search radix. */
-	result = isc_radix_search(acl->iptable->radix, &node, &pfx);
+	if (TABLE_CURRENT(acl) &&
+	    (addr->family == AF_INET || addr->family == AF_INET6))
+	{
+		/* Use the compiled table, which is up to date. */
+		*match = table_match(acl->table, addr);
+		if (*match != 0)
+			match_num = abs(*match);
+
+		/* Nothing else to look at in a pure IP ACL. */
+		if (ecs == NULL && acl->length == 0)
+			return (ISC_R_SUCCESS);
+	} else {
+		/* Always match with host addresses. */
+		bitlen = (addr->family == AF_INET6) ? 128 : 32;
+		NETADDR_TO_PREFIX_T(addr, pfx, bitlen, ISC_FALSE);
+
+		/* Search radix. */
+		result = isc_radix_search(acl->iptable->radix, &node, &pfx);
 
-	/* Found a match. */
-	if (result == ISC_R_SUCCESS && node != NULL) {
-		int off = ISC_RADIX_OFF(&pfx);
-		match_num = node->node_num[off];
-		if (*(isc_boolean_t *) node->data[off])
-			*match = match_num;
-		else
-			*match = -match_num;
-	}
+		/* Found a match. */
+		if (result == ISC_R_SUCCESS && node != NULL) {
+			int off = ISC_RADIX_OFF(&pfx);
+			match_num = node->node_num[off];
+			if (*(isc_boolean_t *) node->data[off])
+				*match = match_num;
+			else
+				*match = -match_num;
+		}
 
-	isc_refcount_destroy(&pfx.refcount);
+		isc_refcount_destroy(&pfx.refcount);
+	}
 
 	/*
 	 * If ecs is not NULL, we search the radix tree again to
@@ -516,6 +654,580 @@ dns_aclelement_match2(const isc_netaddr_t *reqaddr,
 	return (ISC_FALSE);
 }
 
+/*
+ * The first and last addresses covered by a radix tree prefix, with
+ * IPv4 addresses in the top 32 bits of the key, and the result of a
+ * match on it.
+ */
+typedef struct {
+	aclkey_t		start;
+	aclkey_t		end;
+	int			num;
+	int			match;
+} aclrange_t;
+
+typedef struct {
+	aclkey_t		*start;
+	int			*match;
+	unsigned int		n;
+} aclbuild_t;
+
+static int
+range_cmp(const void *a, const void *b) {
+	const aclrange_t *ra = a, *rb = b;
+	int r;
+
+	r = key_cmp(&ra->start, &rb->start);
+	if (r == 0)
+		r = key_cmp(&rb->end, &ra->end);	/* Widest first. */
+	return (r);
+}
+
+static void
+prefix_torange(isc_prefix_t *prefix, aclrange_t *range) {
+	unsigned char bytes[16];
+	unsigned int bitlen = prefix->bitlen, i;
+	isc_uint64_t ones = ~(isc_uint64_t)0, mhi, mlo;
+
+	memset(bytes, 0, sizeof(bytes));
+	memmove(bytes, isc_prefix_touchar(prefix), (bitlen + 7) / 8);
+
+	range->start.hi = range->start.lo = 0;
+	for (i = 0; i < 8; i++) {
+		range->start.hi = (range->start.hi << 8) | bytes[i];
+		range->start.lo = (range->start.lo << 8) | bytes[i + 8];
+	}
+
+	if (bitlen == 0)
+		mhi = 0;
+	else if (bitlen < 64)
+		mhi = ones << (64 - bitlen);
+	else
+		mhi = ones;
+	mlo = (bitlen <= 64) ? 0 : ones << (128 - bitlen);
+
+	range->start.hi &= mhi;
+	range->start.lo &= mlo;
+	range->end.hi = range->start.hi | ~mhi;
+	range->end.lo = range->start.lo | ~mlo;
+}
+
+/*
+ * Append a range starting at 'start' with result 'match'.  A range
+ * that would be empty is replaced, and one with the same result as
+ * its predecessor is merged into it.
+ */
+static void
+build_add(aclbuild_t *build, const aclkey_t *start, int match) {
+	if (build->n > 0 &&
+	    key_cmp(&build->start[build->n - 1], start) == 0)
+		build->n--;
+	if (build->n > 0 && build->match[build->n - 1] == match)
+		return;
+	build->start[build->n] = *start;
+	build->match[build->n] = match;
+	build->n++;
+}
+
+/*
+ * Compile the prefixes at offset 'off' of the radix tree nodes.
+ *
+ * Prefixes are either nested or disjoint, so after sorting them by
+ * their first address (widest first) they can be processed with a
+ * stack of the prefixes containing the current address.  The result
+ * inside a prefix is that of the lowest numbered prefix on the stack.
+ */
+static isc_result_t
+compile_family(dns_acl_t *acl, int off, aclbuild_t *build,
+	       unsigned int *allocp)
+{
+	struct {
+		const aclrange_t	*range;
+		int			num;
+		int			match;
+	} stack[RADIX_MAXBITS + 1];
+	static const aclkey_t zero = { 0, 0 };
+	isc_radix_node_t *node;
+	aclrange_t *ranges = NULL;
+	unsigned int count = 0, alloc, i;
+	aclkey_t next;
+	int sp = 0;
+
+	RADIX_WALK(acl->iptable->radix->head, node) {
+		if (node->node_num[off] != -1)
+			count++;
+	} RADIX_WALK_END;
+
+	alloc = 2 * count + 1;
+	build->n = 0;
+	build->start = isc_mem_get(acl->mctx, alloc * sizeof(aclkey_t));
+	build->match = isc_mem_get(acl->mctx, alloc * sizeof(int));
+	if (count != 0)
+		ranges = isc_mem_get(acl->mctx, count * sizeof(aclrange_t));
+	if (build->start == NULL || build->match == NULL ||
+	    (count != 0 && ranges == NULL))
+	{
+		if (build->start != NULL)
+			isc_mem_put(acl->mctx, build->start,
+				    alloc * sizeof(aclkey_t));
+		if (build->match != NULL)
+			isc_mem_put(acl->mctx, build->match,
+				    alloc * sizeof(int));
+		if (ranges != NULL)
+			isc_mem_put(acl->mctx, ranges,
+				    count * sizeof(aclrange_t));
+		return (ISC_R_NOMEMORY);
+	}
+
+	i = 0;
+	RADIX_WALK(acl->iptable->radix->head, node) {
+		if (node->node_num[off] != -1) {
+			aclrange_t *range = &ranges[i++];
+
+			prefix_torange(node->prefix, range);
+			range->num = node->node_num[off];
+			if (*(isc_boolean_t *) node->data[off])
+				range->match = range->num;
+			else
+				range->match = -range->num;
+		}
+	} RADIX_WALK_END;
+	INSIST(i == count);
+
+	if (count > 1)
+		qsort(ranges, count, sizeof(aclrange_t), range_cmp);
+
+	build_add(build, &zero, 0);
+	for (i = 0; i <= count; i++) {
+		/*
+		 * Close the prefixes that end before this one starts, or
+		 * all of them once every prefix has been seen.
+		 */
+		while (sp > 0 &&
+		       (i == count ||
+			key_cmp(&stack[sp - 1].range->end,
+				&ranges[i].start) < 0))
+		{
+			next = stack[--sp].range->end;
+			if (++next.lo == 0 && ++next.hi == 0)
+				continue;	/* End of the address space. */
+			build_add(build, &next,
+				  (sp > 0) ? stack[sp - 1].match : 0);
+		}
+		if (i == count)
+			break;
+
+		INSIST(sp < RADIX_MAXBITS + 1);
+		stack[sp].range = &ranges[i];
+		if (sp > 0 && stack[sp - 1].num < ranges[i].num) {
+			stack[sp].num = stack[sp - 1].num;
+			stack[sp].match = stack[sp - 1].match;
+		} else {
+			stack[sp].num = ranges[i].num;
+			stack[sp].match = ranges[i].match;
+		}
+		build_add(build, &ranges[i].start, stack[sp].match);
+		sp++;
+	}
+
+	if (ranges != NULL)
+		isc_mem_put(acl->mctx, ranges, count * sizeof(aclrange_t));
+	*allocp = alloc;
+	return (ISC_R_SUCCESS);
+}
+
+static void
+table_free(isc_mem_t *mctx, dns_acltable_t **tablep) {
+	dns_acltable_t *table = *tablep;
+
+	if (table->start4 != NULL)
+		isc_mem_put(mctx, table->start4,
+			    table->n4 * sizeof(isc_uint32_t));
+	if (table->match4 != NULL)
+		isc_mem_put(mctx, table->match4, table->n4 * sizeof(int));
+	if (table->start6 != NULL)
+		isc_mem_put(mctx, table->start6,
+			    table->n6 * sizeof(aclkey_t));
+	if (table->match6 != NULL)
+		isc_mem_put(mctx, table->match6, table->n6 * sizeof(int));
+	isc_mem_put(mctx, table, sizeof(*table));
+	*tablep = NULL;
+}
+
+isc_result_t
+dns_acl_compile(dns_acl_t *acl) {
+	dns_acltable_t *table;
+	aclbuild_t build;
+	unsigned int alloc, i;
+	isc_result_t result;
+
+	REQUIRE(DNS_ACL_VALID(acl));
+
+	table = isc_mem_get(acl->mctx, sizeof(*table));
+	if (table == NULL)
+		return (ISC_R_NOMEMORY);
+	memset(table, 0, sizeof(*table));
+	table->generation = acl->iptable->generation;
+
+	/*
+	 * Copy the results into arrays of the right size: the IPv4
+	 * start addresses are stored as 32 bit integers.
+	 */
+	result = compile_family(acl, 0, &build, &alloc);
+	if (result != ISC_R_SUCCESS)
+		goto cleanup;
+	table->n4 = build.n;
+	table->start4 = isc_mem_get(acl->mctx,
+				    build.n * sizeof(isc_uint32_t));
+	table->match4 = isc_mem_get(acl->mctx, build.n * sizeof(int));
+	if (table->start4 != NULL && table->match4 != NULL) {
+		for (i = 0; i < build.n; i++) {
+			table->start4[i] =
+				(isc_uint32_t)(build.start[i].hi >> 32);
+			table->match4[i] = build.match[i];
+		}
+	} else {
+		result = ISC_R_NOMEMORY;
+	}
+	isc_mem_put(acl->mctx, build.start, alloc * sizeof(aclkey_t));
+	isc_mem_put(acl->mctx, build.match, alloc * sizeof(int));
+	if (result != ISC_R_SUCCESS)
+		goto cleanup;
+
+	result = compile_family(acl, 1, &build, &alloc);
+	if (result != ISC_R_SUCCESS)
+		goto cleanup;
+	table->n6 = build.n;
+	table->start6 = isc_mem_get(acl->mctx, build.n * sizeof(aclkey_t));
+	table->match6 = isc_mem_get(acl->mctx, build.n * sizeof(int));
+	if (table->start6 != NULL && table->match6 != NULL) {
+		memmove(table->start6, build.start,
+			build.n * sizeof(aclkey_t));
+		memmove(table->match6, build.match, build.n * sizeof(int));
+	} else {
+		result = ISC_R_NOMEMORY;
+	}
+	isc_mem_put(acl->mctx, build.start, alloc * sizeof(aclkey_t));
+	isc_mem_put(acl->mctx, build.match, alloc * sizeof(int));
+	if (result != ISC_R_SUCCESS)
+		goto cleanup;
+
+	if (acl->table != NULL)
+		table_free(acl->mctx, &acl->table);
+	acl->table = table;
+	return (ISC_R_SUCCESS);
+
+ cleanup:
+	table_free(acl->mctx, &table);
+	return (result);
+}
+
+/*
+ * Does the compiled table of 'acl' give the whole answer?
+ */
+#define ACLMAP_IPONLY(acl) \
+	((acl)->length == 0 && TABLE_CURRENT(acl))
+
+#define ACLMAP_SET(set, i) \
+	((set)[(i) / 64] |= (isc_uint64_t)1 << ((i) % 64))
+
+static int
+key_qsortcmp(const void *a, const void *b) {
+	return (key_cmp(a, b));
+}
+
+/*
+ * Build the sets of family 'fam' (0 for IPv4, 1 for IPv6): every
+ * range start of the ACLs is the start of a range of the map, and the
+ * set of a range is computed by advancing a cursor into each ACL's
+ * ranges.  'tables' has the compiled table of each IP only ACL, and
+ * NULL for the others.  '*startp' and '*setsp' have room for
+ * '*allocp' ranges.
+ */
+static isc_result_t
+map_family(dns_aclmap_t *map, dns_acltable_t **tables, int fam,
+	   aclkey_t **startp, isc_uint64_t **setsp, unsigned int *np,
+	   unsigned int *allocp)
+{
+	const size_t setsize = map->words * sizeof(isc_uint64_t);
+	aclkey_t *starts = NULL, prev;
+	isc_uint64_t *sets = NULL, *set;
+	unsigned int *cursor = NULL;
+	unsigned int count = 1, i, j, k, n;
+	isc_result_t result = ISC_R_SUCCESS;
+
+	for (j = 0; j < map->nacls; j++) {
+		if (tables[j] != NULL)
+			count += (fam == 0) ? tables[j]->n4 : tables[j]->n6;
+	}
+
+	starts = isc_mem_get(map->mctx, count * sizeof(aclkey_t));
+	sets = isc_mem_get(map->mctx, count * setsize);
+	cursor = isc_mem_get(map->mctx, map->nacls * sizeof(unsigned int));
+	if (starts == NULL || sets == NULL || cursor == NULL) {
+		result = ISC_R_NOMEMORY;
+		goto cleanup;
+	}
+	memset(cursor, 0, map->nacls * sizeof(unsigned int));
+
+	starts[0].hi = starts[0].lo = 0;
+	n = 1;
+	for (j = 0; j < map->nacls; j++) {
+		const dns_acltable_t *table = tables[j];
+
+		if (table == NULL)
+			continue;
+		if (fam == 0) {
+			for (k = 0; k < table->n4; k++) {
+				starts[n].hi = (isc_uint64_t)table->start4[k]
+					       << 32;
+				starts[n++].lo = 0;
+			}
+		} else {
+			for (k = 0; k < table->n6; k++)
+				starts[n++] = table->start6[k];
+		}
+	}
+	INSIST(n == count);
+	qsort(starts, count, sizeof(aclkey_t), key_qsortcmp);
+
+	n = 0;
+	prev = starts[0];
+	for (i = 0; i < count; i++) {
+		if (i > 0 && key_cmp(&starts[i], &prev) == 0)
+			continue;
+		prev = starts[i];
+
+		set = &sets[n * map->words];
+		memset(set, 0, setsize);
+		for (j = 0; j < map->nacls; j++) {
+			const dns_acltable_t *table = tables[j];
+			int match;
+
+			if (table == NULL) {
+				ACLMAP_SET(set, j);
+				continue;
+			}
+
+			k = cursor[j];
+			if (fam == 0) {
+				isc_uint32_t key = (isc_uint32_t)(prev.hi >> 32);
+
+				while (k + 1 < table->n4 &&
+				       table->start4[k + 1] <= key)
+					k++;
+				match = table->match4[k];
+			} else {
+				while (k + 1 < table->n6 &&
+				       key_cmp(&table->start6[k + 1],
+					       &prev) <= 0)
+					k++;
+				match = table->match6[k];
+			}
+			cursor[j] = k;
+			if (match > 0)
+				ACLMAP_SET(set, j);
+		}
+
+		/* Merge with the previous range if the sets are equal. */
+		if (n > 0 && memcmp(set, set - map->words, setsize) == 0)
+			continue;
+		starts[n++] = prev;
+	}
+
+	*startp = starts;
+	*setsp = sets;
+	*np = n;
+	*allocp = count;
+	starts = NULL;
+	sets = NULL;
+
+ cleanup:
+	if (starts != NULL)
+		isc_mem_put(map->mctx, starts, count * sizeof(aclkey_t));
+	if (sets != NULL)
+		isc_mem_put(map->mctx, sets, count * setsize);
+	if (cursor != NULL)
+		isc_mem_put(map->mctx, cursor,
+			    map->nacls * sizeof(unsigned int));
+	return (result);
+}
+
+isc_result_t
+dns_aclmap_create(isc_mem_t *mctx, dns_acl_t **acls, unsigned int nacls,
+		  dns_aclmap_t **mapp)
+{
+	dns_aclmap_t *map;
+	dns_acltable_t **tables = NULL;
+	aclkey_t *starts = NULL;
+	isc_uint64_t *sets = NULL;
+	unsigned int i, n, alloc;
+	size_t setsize;
+	isc_result_t result;
+
+	REQUIRE(mctx != NULL);
+	REQUIRE(acls != NULL || nacls == 0);
+	REQUIRE(mapp != NULL && *mapp == NULL);
+
+	/*
+	 * IP only ACLs need an up to date compiled table.  Whether an
+	 * ACL is IP only is decided here, once, and the tables are
+	 * passed to map_family() so that both families agree.
+	 */
+	if (nacls != 0) {
+		tables = isc_mem_get(mctx, nacls * sizeof(dns_acltable_t *));
+		if (tables == NULL)
+			return (ISC_R_NOMEMORY);
+	}
+	for (i = 0; i < nacls; i++) {
+		tables[i] = NULL;
+		if (acls[i] == NULL || acls[i]->length != 0)
+			continue;
+		if (!ACLMAP_IPONLY(acls[i])) {
+			result = dns_acl_compile(acls[i]);
+			if (result != ISC_R_SUCCESS) {
+				isc_mem_put(mctx, tables,
+					    nacls * sizeof(dns_acltable_t *));
+				return (result);
+			}
+		}
+		tables[i] = acls[i]->table;
+	}
+
+	map = isc_mem_get(mctx, sizeof(*map));
+	if (map == NULL) {
+		if (tables != NULL)
+			isc_mem_put(mctx, tables,
+				    nacls * sizeof(dns_acltable_t *));
+		return (ISC_R_NOMEMORY);
+	}
+	memset(map, 0, sizeof(*map));
+	isc_mem_attach(mctx, &map->mctx);
+	map->magic = DNS_ACLMAP_MAGIC;
+	map->nacls = nacls;
+	map->words = (nacls + 63) / 64;
+	if (map->words == 0)
+		map->words = 1;
+	setsize = map->words * sizeof(isc_uint64_t);
+
+	map->all = isc_mem_get(mctx, setsize);
+	if (map->all == NULL) {
+		result = ISC_R_NOMEMORY;
+		goto cleanup;
+	}
+	memset(map->all, 0, setsize);
+	for (i = 0; i < nacls; i++)
+		ACLMAP_SET(map->all, i);
+
+	/*
+	 * Copy the results into arrays of the right size, converting
+	 * the IPv4 range starts to 32 bit integers.
+	 */
+	result = map_family(map, tables, 0, &starts, &sets, &n, &alloc);
+	if (result != ISC_R_SUCCESS)
+		goto cleanup;
+	map->n4 = n;
+	map->start4 = isc_mem_get(mctx, n * sizeof(isc_uint32_t));
+	map->sets4 = isc_mem_get(mctx, n * setsize);
+	if (map->start4 != NULL && map->sets4 != NULL) {
+		for (i = 0; i < n; i++)
+			map->start4[i] = (isc_uint32_t)(starts[i].hi >> 32);
+		memmove(map->sets4, sets, n * setsize);
+	} else {
+		result = ISC_R_NOMEMORY;
+	}
+	isc_mem_put(mctx, starts, alloc * sizeof(aclkey_t));
+	isc_mem_put(mctx, sets, alloc * setsize);
+	if (result != ISC_R_SUCCESS)
+		goto cleanup;
+
+	result = map_family(map, tables, 1, &starts, &sets, &n, &alloc);
+	if (result != ISC_R_SUCCESS)
+		goto cleanup;
+	map->n6 = n;
+	map->start6 = isc_mem_get(mctx, n * sizeof(aclkey_t));
+	map->sets6 = isc_mem_get(mctx, n * setsize);
+	if (map->start6 != NULL && map->sets6 != NULL) {
+		memmove(map->start6, starts, n * sizeof(aclkey_t));
+		memmove(map->sets6, sets, n * setsize);
+	} else {
+		result = ISC_R_NOMEMORY;
+	}
+	isc_mem_put(mctx, starts, alloc * sizeof(aclkey_t));
+	isc_mem_put(mctx, sets, alloc * setsize);
+	if (result != ISC_R_SUCCESS)
+		goto cleanup;
+
+	*mapp = map;
+	map = NULL;
+
+ cleanup:
+	if (map != NULL)
+		dns_aclmap_destroy(&map);
+	if (tables != NULL)
+		isc_mem_put(mctx, tables, nacls * sizeof(dns_acltable_t *));
+	return (result);
+}
+
+const isc_uint64_t *
+dns_aclmap_find(const dns_aclmap_t *map, const isc_netaddr_t *addr,
+		const dns_aclenv_t *env)
+{
+	isc_netaddr_t v4addr;
+	aclkey_t key;
+	unsigned int i;
+
+	REQUIRE(DNS_ACLMAP_VALID(map));
+	REQUIRE(addr != NULL);
+
+	if (env != NULL && env->match_mapped &&
+	    addr->family == AF_INET6 &&
+	    IN6_IS_ADDR_V4MAPPED(&addr->type.in6))
+	{
+		isc_netaddr_fromv4mapped(&v4addr, addr);
+		addr = &v4addr;
+	}
+
+	switch (addr->family) {
+	case AF_INET:
+		i = find4(map->start4, map->n4, ntohl(addr->type.in.s_addr));
+		return (&map->sets4[i * map->words]);
+	case AF_INET6:
+		in6_tokey(&addr->type.in6, &key);
+		i = find6(map->start6, map->n6, &key);
+		return (&map->sets6[i * map->words]);
+	default:
+		return (map->all);
+	}
+}
+
+void
+dns_aclmap_destroy(dns_aclmap_t **mapp) {
+	dns_aclmap_t *map;
+	size_t setsize;
+
+	REQUIRE(mapp != NULL && DNS_ACLMAP_VALID(*mapp));
+
+	map = *mapp;
+	*mapp = NULL;
+	setsize = map->words * sizeof(isc_uint64_t);
+
+	if (map->start4 != NULL)
+		isc_mem_put(map->mctx, map->start4,
+			    map->n4 * sizeof(isc_uint32_t));
+	if (map->sets4 != NULL)
+		isc_mem_put(map->mctx, map->sets4, map->n4 * setsize);
+	if (map->start6 != NULL)
+		isc_mem_put(map->mctx, map->start6,
+			    map->n6 * sizeof(aclkey_t));
+	if (map->sets6 != NULL)
+		isc_mem_put(map->mctx, map->sets6, map->n6 * setsize);
+	if (map->all != NULL)
+		isc_mem_put(map->mctx, map->all, setsize);
+	map->magic = 0;
+	isc_mem_putanddetach(&map->mctx, map, sizeof(*map));
+}
+
 void
 dns_acl_attach(dns_acl_t *source, dns_acl_t **target) {
 	REQUIRE(DNS_ACL_VALID(source));
@@ -545,6 +1257,8 @@ destroy(dns_acl_t *dacl) {
 		isc_mem_free(dacl->mctx, dacl->name);
 	if (dacl->iptable != NULL)
 		dns_iptable_detach(&dacl->iptable);
+	if (dacl->table != NULL)
+		table_free(dacl->mctx, &dacl->table);
 	isc_refcount_destroy(&dacl->refcount);
 	dacl->magic = 0;
 	isc_mem_putanddetach(&dacl->mctx, dacl, sizeof(*dacl));
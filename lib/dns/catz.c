@@ -22,6 +22,7 @@
 #include <dns/catz.h>
 #include <dns/dbiterator.h>
 #include <dns/events.h>
+#include <dns/journal.h>
 #include <dns/rdatasetiter.h>
 #include <dns/view.h>
 #include <dns/zone.h>
@@ -55,6 +56,14 @@ struct dns_catz_zone {
 	isc_boolean_t		updatepending;
 	isc_uint32_t		version;
 
+	/*
+	 * Serial number of the catalog zone version that 'entries'
+	 * was last built from, if 'haveserial' is set.  Updates from
+	 * that serial are applied incrementally from the journal.
+	 */
+	isc_uint32_t		serial;
+	isc_boolean_t		haveserial;
+
 	dns_db_t		*db;
 	dns_dbversion_t		*dbversion;
 
@@ -323,6 +332,8 @@ dns_catz_zone_resetdefoptions(dns_catz_zone_t *zone) {
 
 	dns_catz_options_free(&zone->defoptions, zone->catzs->mctx);
 	dns_catz_options_init(&zone->defoptions);
+	/* Member zone options have to be recomputed from scratch. */
+	zone->haveserial = ISC_FALSE;
 }
 
 isc_result_t
@@ -647,6 +658,8 @@ dns_catz_new_zone(dns_catz_zones_t *catzs, dns_catz_zone_t **zonep,
 	new_zone->active = ISC_TRUE;
 	new_zone->db_registered = ISC_FALSE;
 	new_zone->version = (isc_uint32_t)(-1);
+	new_zone->serial = 0;
+	new_zone->haveserial = ISC_FALSE;
 	isc_refcount_init(&new_zone->refs, 1);
 
 	*zonep = new_zone;
@@ -1677,6 +1690,8 @@ dns_catz_dbupdate_callback(dns_db_t *db, void *fn_arg) {
 		 * registered at the end of update_from_db
 		 */
 		zone->db_registered = ISC_FALSE;
+		/* The journal does not cover a transfer of the whole zone. */
+		zone->haveserial = ISC_FALSE;
 	}
 	if (zone->db == NULL)
 		dns_db_attach(db, &zone->db);
@@ -1728,76 +1743,94 @@ dns_catz_dbupdate_callback(dns_db_t *db, void *fn_arg) {
 	return (result);
 }
 
-void
-dns_catz_update_from_db(dns_db_t *db, dns_catz_zones_t *catzs) {
-	dns_catz_zone_t *oldzone = NULL, *newzone = NULL;
+/*
+ * Process every rdataset at 'node', whose name is 'name', in version
+ * 'ver' of 'db' into the catalog zone 'zone'.
+ */
+static isc_result_t
+catz_process_node(dns_catz_zones_t *catzs, dns_catz_zone_t *zone,
+		  dns_db_t *db, dns_dbversion_t *ver, dns_dbnode_t *node,
+		  dns_name_t *name)
+{
 	isc_result_t result;
-	isc_region_t r;
-	dns_dbnode_t *node = NULL;
-	dns_dbiterator_t *it = NULL;
-	dns_fixedname_t fixname;
-	dns_name_t *name;
 	dns_rdatasetiter_t *rdsiter = NULL;
 	dns_rdataset_t rdataset;
-	char bname[DNS_NAME_FORMATSIZE];
-	isc_buffer_t ibname;
-	isc_uint32_t vers;
-
-	REQUIRE(DNS_DB_VALID(db));
-	REQUIRE(catzs != NULL);
 
-	/*
-	 * Create a new catz in the same context as current catz.
-	 */
-	dns_name_toregion(&db->origin, &r);
-	result = isc_ht_find(catzs->zones, r.base, r.length, (void **)&oldzone);
+	result = dns_db_allrdatasets(db, node, ver, 0, &rdsiter);
 	if (result != ISC_R_SUCCESS) {
-		/* This can happen if we remove the zone in the meantime. */
 		isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
 			      DNS_LOGMODULE_MASTER, ISC_LOG_ERROR,
-			      "catz: zone '%s' not in config",
-			      bname);
-		return;
+			      "catz: failed to fetch rrdatasets - %s",
+			      isc_result_totext(result));
+		return (result);
 	}
 
-	isc_buffer_init(&ibname, bname, DNS_NAME_FORMATSIZE);
-	result = dns_name_totext(&db->origin, ISC_TRUE, &ibname);
-	INSIST(result == ISC_R_SUCCESS);
-
-	result = dns_db_getsoaserial(db, oldzone->dbversion, &vers);
-	if (result != ISC_R_SUCCESS) {
-		/* A zone without SOA record?!? */
-		isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
-			      DNS_LOGMODULE_MASTER, ISC_LOG_ERROR,
-			      "catz: zone '%s' has no SOA record (%s)",
-			      bname, isc_result_totext(result));
-		return;
+	dns_rdataset_init(&rdataset);
+	result = dns_rdatasetiter_first(rdsiter);
+	while (result == ISC_R_SUCCESS) {
+		dns_rdatasetiter_current(rdsiter, &rdataset);
+		result = dns_catz_update_process(catzs, zone, name,
+						 &rdataset);
+		if (result != ISC_R_SUCCESS) {
+			char cname[DNS_NAME_FORMATSIZE];
+			char typebuf[DNS_RDATATYPE_FORMATSIZE];
+			char classbuf[DNS_RDATACLASS_FORMATSIZE];
+
+			dns_name_format(name, cname, DNS_NAME_FORMATSIZE);
+			dns_rdataclass_format(rdataset.rdclass, classbuf,
+					      sizeof(classbuf));
+			dns_rdatatype_format(rdataset.type, typebuf,
+					     sizeof(typebuf));
+			isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
+				      DNS_LOGMODULE_MASTER,
+				      ISC_LOG_WARNING,
+				      "catz: unknown record in catalog "
+				      "zone - %s %s %s(%s) - ignoring",
+				      cname, classbuf, typebuf,
+				      isc_result_totext(result));
+		}
+		dns_rdataset_disassociate(&rdataset);
+		if (result != ISC_R_SUCCESS) {
+			break;
+		}
+		result = dns_rdatasetiter_next(rdsiter);
 	}
 
-	isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
-		      DNS_LOGMODULE_MASTER, ISC_LOG_INFO,
-		      "catz: updating catalog zone '%s' with serial %d",
-		      bname, vers);
+	dns_rdatasetiter_destroy(&rdsiter);
 
-	result = dns_catz_new_zone(catzs, &newzone, &db->origin);
+	return (ISC_R_SUCCESS);
+}
+
+/*
+ * Rebuild the member zone list of 'oldzone' from version
+ * 'oldzone->dbversion' of 'db', and merge it into 'oldzone'.
+ */
+static isc_result_t
+catz_update_full(dns_catz_zone_t *oldzone, dns_db_t *db) {
+	dns_catz_zone_t *newzone = NULL;
+	isc_result_t result;
+	dns_dbnode_t *node = NULL;
+	dns_dbiterator_t *it = NULL;
+	dns_fixedname_t fixname;
+	dns_name_t *name;
+
+	result = dns_catz_new_zone(oldzone->catzs, &newzone, &db->origin);
 	if (result != ISC_R_SUCCESS) {
-		dns_db_closeversion(db, &oldzone->dbversion, ISC_FALSE);
 		isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
 			      DNS_LOGMODULE_MASTER, ISC_LOG_ERROR,
 			      "catz: failed to create new zone - %s",
 			      isc_result_totext(result));
-		return;
+		return (result);
 	}
 
 	result = dns_db_createiterator(db, DNS_DB_NONSEC3, &it);
 	if (result != ISC_R_SUCCESS) {
 		dns_catz_zone_detach(&newzone);
-		dns_db_closeversion(db, &oldzone->dbversion, ISC_FALSE);
 		isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
 			      DNS_LOGMODULE_MASTER, ISC_LOG_ERROR,
 			      "catz: failed to create DB iterator - %s",
 			      isc_result_totext(result));
-		return;
+		return (result);
 	}
 
 	dns_fixedname_init(&fixname);
@@ -1824,58 +1857,16 @@ dns_catz_update_from_db(dns_db_t *db, dns_catz_zones_t *catzs) {
 			break;
 		}
 
-		result = dns_db_allrdatasets(db, node, oldzone->dbversion, 0,
-					  &rdsiter);
-		if (result != ISC_R_SUCCESS) {
-			isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
-				      DNS_LOGMODULE_MASTER, ISC_LOG_ERROR,
-				      "catz: failed to fetch rrdatasets - %s",
-				      isc_result_totext(result));
-			dns_db_detachnode(db, &node);
+		result = catz_process_node(oldzone->catzs, newzone, db,
+					   oldzone->dbversion, node, name);
+		dns_db_detachnode(db, &node);
+		if (result != ISC_R_SUCCESS)
 			break;
-		}
-
-		dns_rdataset_init(&rdataset);
-		result = dns_rdatasetiter_first(rdsiter);
-		while (result == ISC_R_SUCCESS) {
-			dns_rdatasetiter_current(rdsiter, &rdataset);
-			result = dns_catz_update_process(catzs, newzone, name,
-							 &rdataset);
-			if (result != ISC_R_SUCCESS) {
-				char cname[DNS_NAME_FORMATSIZE];
-				char typebuf[DNS_RDATATYPE_FORMATSIZE];
-				char classbuf[DNS_RDATACLASS_FORMATSIZE];
-
-				dns_name_format(name, cname,
-						DNS_NAME_FORMATSIZE);
-				dns_rdataclass_format(rdataset.rdclass,
-						      classbuf,
-						      sizeof(classbuf));
-				dns_rdatatype_format(rdataset.type, typebuf,
-						     sizeof(typebuf));
-				isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
-					      DNS_LOGMODULE_MASTER,
-					      ISC_LOG_WARNING,
-					      "catz: unknown record in catalog "
-					      "zone - %s %s %s(%s) - ignoring",
-					      cname, classbuf, typebuf,
-					      isc_result_totext(result));
-			}
-			dns_rdataset_disassociate(&rdataset);
-			if (result != ISC_R_SUCCESS) {
-				break;
-			}
-			result = dns_rdatasetiter_next(rdsiter);
-		}
-
-		dns_rdatasetiter_destroy(&rdsiter);
 
-		dns_db_detachnode(db, &node);
 		result = dns_dbiterator_next(it);
 	}
 
 	dns_dbiterator_destroy(&it);
-	dns_db_closeversion(db, &oldzone->dbversion, ISC_FALSE);
 	isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
 		      DNS_LOGMODULE_MASTER, ISC_LOG_DEBUG(3),
 		      "catz: update_from_db: iteration finished");
@@ -1892,13 +1883,458 @@ dns_catz_update_from_db(dns_db_t *db, dns_catz_zones_t *catzs) {
 			      "catz: failed merging zones: %s",
 			      isc_result_totext(result));
 
+		return (result);
+	}
+
+	return (ISC_R_SUCCESS);
+}
+
+/*
+ * Read the changes between serials 'begin' and 'end' of catalog zone
+ * 'zone' from its journal, and add the label of every member entry
+ * they touch to 'changed'.  Fails if the journal does not cover those
+ * serials, or if anything other than member entries and the SOA
+ * changed.
+ */
+static isc_result_t
+catz_journal_changes(dns_catz_zone_t *zone, isc_uint32_t begin,
+		     isc_uint32_t end, isc_ht_t *changed)
+{
+	isc_result_t result;
+	dns_zone_t *dnszone = NULL;
+	dns_journal_t *journal = NULL;
+	const char *journalfile;
+	dns_name_t *name;
+	dns_rdata_t *rdata;
+	isc_uint32_t ttl;
+	dns_label_t label;
+	unsigned int zlabels;
+
+	if (zone->catzs->view == NULL)
+		return (ISC_R_NOTFOUND);
+
+	result = dns_view_findzone(zone->catzs->view, &zone->name, &dnszone);
+	if (result != ISC_R_SUCCESS)
+		return (result);
+
+	journalfile = dns_zone_getjournal(dnszone);
+	if (journalfile == NULL) {
+		result = ISC_R_NOTFOUND;
+		goto cleanup;
+	}
+
+	result = dns_journal_open(zone->catzs->mctx, journalfile,
+				  DNS_JOURNAL_READ, &journal);
+	if (result != ISC_R_SUCCESS)
+		goto cleanup;
+
+	result = dns_journal_iter_init(journal, begin, end);
+	if (result != ISC_R_SUCCESS)
+		goto cleanup;
+
+	/*
+	 * Member entries and their suboptions live below
+	 * <mhash>.zones.<catalog>.
+	 */
+	zlabels = dns_name_countlabels(&zone->name) + 1;
+	for (result = dns_journal_first_rr(journal);
+	     result == ISC_R_SUCCESS;
+	     result = dns_journal_next_rr(journal))
+	{
+		dns_journal_current_rr(journal, &name, &ttl, &rdata);
+
+		if (rdata->type == dns_rdatatype_soa &&
+		    dns_name_equal(name, &zone->name))
+			continue;
+
+		if (dns_name_countlabels(name) <= zlabels ||
+		    !dns_name_issubdomain(name, &zone->name))
+		{
+			result = ISC_R_FAILURE;
+			goto cleanup;
+		}
+		dns_name_getlabel(name, dns_name_countlabels(name) - zlabels,
+				  &label);
+		if (catz_get_option(&label) != CATZ_OPT_ZONES) {
+			result = ISC_R_FAILURE;
+			goto cleanup;
+		}
+
+		dns_name_getlabel(name,
+				  dns_name_countlabels(name) - zlabels - 1,
+				  &label);
+		result = isc_ht_add(changed, label.base,
+				    (isc_uint32_t)label.length, NULL);
+		if (result != ISC_R_SUCCESS && result != ISC_R_EXISTS)
+			goto cleanup;
+	}
+	if (result == ISC_R_NOMORE)
+		result = ISC_R_SUCCESS;
+
+ cleanup:
+	if (journal != NULL)
+		dns_journal_destroy(&journal);
+	dns_zone_detach(&dnszone);
+	return (result);
+}
+
+/*
+ * Build the member entries whose labels are in 'changed' from
+ * version 'oldzone->dbversion' of 'db' into 'newzone'.  An entry only
+ * exists if its PTR record does; suboptions without one are ignored,
+ * as they are by dns_catz_zones_merge().
+ */
+static isc_result_t
+catz_build_changed(dns_catz_zone_t *oldzone, dns_catz_zone_t *newzone,
+		   dns_db_t *db, isc_ht_t *changed)
+{
+	isc_result_t result, hresult;
+	isc_ht_iter_t *iter = NULL;
+	dns_dbiterator_t *it = NULL;
+	dns_dbnode_t *node = NULL;
+	dns_rdataset_t rdataset;
+	dns_fixedname_t fzones, fmember, fname;
+	dns_name_t *zones, *member, *name;
+
+	dns_fixedname_init(&fzones);
+	zones = dns_fixedname_name(&fzones);
+	dns_fixedname_init(&fmember);
+	member = dns_fixedname_name(&fmember);
+	dns_fixedname_init(&fname);
+	name = dns_fixedname_name(&fname);
+
+	result = dns_name_fromstring2(zones, "zones", &oldzone->name, 0, NULL);
+	if (result != ISC_R_SUCCESS)
+		return (result);
+
+	result = dns_db_createiterator(db, DNS_DB_NONSEC3, &it);
+	if (result != ISC_R_SUCCESS)
+		return (result);
+
+	result = isc_ht_iter_create(changed, &iter);
+	if (result != ISC_R_SUCCESS)
+		goto cleanup;
+
+	for (hresult = isc_ht_iter_first(iter);
+	     hresult == ISC_R_SUCCESS;
+	     hresult = isc_ht_iter_next(iter))
+	{
+		unsigned char *key;
+		size_t keysize;
+		isc_region_t r;
+		dns_name_t label;
+
+		isc_ht_iter_currentkey(iter, &key, &keysize);
+		r.base = key;
+		r.length = (unsigned int)keysize;
+		dns_name_init(&label, NULL);
+		dns_name_fromregion(&label, &r);
+		result = dns_name_concatenate(&label, zones, member, NULL);
+		if (result != ISC_R_SUCCESS)
+			goto cleanup;
+
+		result = dns_db_findnode(db, member, ISC_FALSE, &node);
+		if (result == ISC_R_NOTFOUND)
+			continue;
+		if (result != ISC_R_SUCCESS)
+			goto cleanup;
+		dns_rdataset_init(&rdataset);
+		result = dns_db_findrdataset(db, node, oldzone->dbversion,
+					     dns_rdatatype_ptr, 0, 0,
+					     &rdataset, NULL);
+		dns_db_detachnode(db, &node);
+		if (result == ISC_R_NOTFOUND)
+			continue;
+		if (result != ISC_R_SUCCESS)
+			goto cleanup;
+		dns_rdataset_disassociate(&rdataset);
+
+		for (result = dns_dbiterator_seek(it, member);
+		     result == ISC_R_SUCCESS;
+		     result = dns_dbiterator_next(it))
+		{
+			result = dns_dbiterator_current(it, &node, name);
+			if (result != ISC_R_SUCCESS)
+				goto cleanup;
+			if (!dns_name_issubdomain(name, member)) {
+				dns_db_detachnode(db, &node);
+				break;
+			}
+			result = catz_process_node(oldzone->catzs, newzone,
+						   db, oldzone->dbversion,
+						   node, name);
+			dns_db_detachnode(db, &node);
+			if (result != ISC_R_SUCCESS)
+				goto cleanup;
+		}
+		if (result != ISC_R_SUCCESS && result != ISC_R_NOMORE)
+			goto cleanup;
+		dns_dbiterator_pause(it);
+	}
+	result = (hresult == ISC_R_NOMORE) ? ISC_R_SUCCESS : hresult;
+
+ cleanup:
+	if (iter != NULL)
+		isc_ht_iter_destroy(&iter);
+	dns_dbiterator_destroy(&it);
+	return (result);
+}
+
+/*
+ * Update the member zones of 'oldzone' from serial 'oldzone->serial'
+ * to 'serial', looking only at the member entries that the journal
+ * says have changed.  Deletions are passed to the zone modification
+ * methods first, so that a member zone can be moved to a new entry,
+ * then additions and modifications.
+ */
+static isc_result_t
+catz_update_incremental(dns_catz_zone_t *oldzone, dns_db_t *db,
+			isc_uint32_t serial, unsigned int *nchangedp)
+{
+	isc_result_t result, hresult;
+	dns_catz_zones_t *catzs = oldzone->catzs;
+	dns_catz_zone_t *newzone = NULL;
+	isc_ht_t *changed = NULL;
+	isc_ht_iter_t *iter = NULL;
+	char czname[DNS_NAME_FORMATSIZE];
+	char zname[DNS_NAME_FORMATSIZE];
+	int pass;
+
+	if (!oldzone->haveserial || oldzone->serial == serial)
+		return (ISC_R_NOTFOUND);
+
+	result = isc_ht_init(&changed, catzs->mctx, 4);
+	if (result != ISC_R_SUCCESS)
+		return (result);
+
+	result = catz_journal_changes(oldzone, oldzone->serial, serial,
+				      changed);
+	if (result != ISC_R_SUCCESS)
+		goto cleanup;
+
+	result = dns_catz_new_zone(catzs, &newzone, &db->origin);
+	if (result != ISC_R_SUCCESS)
+		goto cleanup;
+
+	result = catz_build_changed(oldzone, newzone, db, changed);
+	if (result != ISC_R_SUCCESS)
+		goto cleanup;
+
+	result = isc_ht_iter_create(changed, &iter);
+	if (result != ISC_R_SUCCESS)
+		goto cleanup;
+
+	dns_name_format(&oldzone->name, czname, DNS_NAME_FORMATSIZE);
+
+	for (pass = 0; pass < 2; pass++) {
+		for (hresult = isc_ht_iter_first(iter);
+		     hresult == ISC_R_SUCCESS;
+		     hresult = isc_ht_iter_next(iter))
+		{
+			dns_catz_entry_t *oentry = NULL, *nentry = NULL;
+			unsigned char *key;
+			size_t keysize;
+			isc_uint32_t ks;
+
+			isc_ht_iter_currentkey(iter, &key, &keysize);
+			ks = (isc_uint32_t)keysize;
+			(void)isc_ht_find(oldzone->entries, key, ks,
+					  (void **) &oentry);
+			(void)isc_ht_find(newzone->entries, key, ks,
+					  (void **) &nentry);
+			if (nentry != NULL &&
+			    dns_name_countlabels(&nentry->name) == 0)
+				nentry = NULL;
+
+			if (pass == 0) {
+				if (oentry == NULL || nentry != NULL)
+					continue;
+				dns_name_format(&oentry->name, zname,
+						DNS_NAME_FORMATSIZE);
+				result = catzs->zmm->delzone(oentry, oldzone,
+							     catzs->view,
+							     catzs->taskmgr,
+							     catzs->zmm->udata);
+				isc_log_write(dns_lctx,
+					      DNS_LOGCATEGORY_GENERAL,
+					      DNS_LOGMODULE_MASTER,
+					      ISC_LOG_INFO,
+					      "catz: deleting zone '%s' from "
+					      "catalog '%s' - %s",
+					      zname, czname,
+					      isc_result_totext(result));
+				result = isc_ht_delete(oldzone->entries,
+						       key, ks);
+				RUNTIME_CHECK(result == ISC_R_SUCCESS);
+				dns_catz_entry_detach(oldzone, &oentry);
+				continue;
+			}
+
+			if (nentry == NULL)
+				continue;
+			dns_name_format(&nentry->name, zname,
+					DNS_NAME_FORMATSIZE);
+			dns_catz_options_setdefault(catzs->mctx,
+						    &oldzone->zoneoptions,
+						    &nentry->opts);
+			if (oentry == NULL) {
+				result = catzs->zmm->addzone(nentry, oldzone,
+							     catzs->view,
+							     catzs->taskmgr,
+							     catzs->zmm->udata);
+				isc_log_write(dns_lctx,
+					      DNS_LOGCATEGORY_GENERAL,
+					      DNS_LOGMODULE_MASTER,
+					      ISC_LOG_INFO,
+					      "catz: adding zone '%s' from "
+					      "catalog '%s' - %s",
+					      zname, czname,
+					      isc_result_totext(result));
+			} else {
+				if (!dns_catz_entry_cmp(oentry, nentry)) {
+					result = catzs->zmm->modzone(nentry,
+							oldzone, catzs->view,
+							catzs->taskmgr,
+							catzs->zmm->udata);
+					isc_log_write(dns_lctx,
+						DNS_LOGCATEGORY_GENERAL,
+						DNS_LOGMODULE_MASTER,
+						ISC_LOG_INFO,
+						"catz: modifying zone '%s' "
+						"from catalog '%s' - %s",
+						zname, czname,
+						isc_result_totext(result));
+				}
+				result = isc_ht_delete(oldzone->entries,
+						       key, ks);
+				RUNTIME_CHECK(result == ISC_R_SUCCESS);
+				dns_catz_entry_detach(oldzone, &oentry);
+			}
+
+			/*
+			 * Move the new entry, and the reference to it,
+			 * into 'oldzone'.
+			 */
+			result = isc_ht_delete(newzone->entries, key, ks);
+			RUNTIME_CHECK(result == ISC_R_SUCCESS);
+			result = isc_ht_add(oldzone->entries, key, ks, nentry);
+			if (result != ISC_R_SUCCESS) {
+				dns_catz_entry_detach(newzone, &nentry);
+				goto cleanup;
+			}
+		}
+		RUNTIME_CHECK(hresult == ISC_R_NOMORE);
+	}
+
+	*nchangedp = isc_ht_count(changed);
+	result = ISC_R_SUCCESS;
+
+ cleanup:
+	if (iter != NULL)
+		isc_ht_iter_destroy(&iter);
+	if (newzone != NULL)
+		dns_catz_zone_detach(&newzone);
+	isc_ht_destroy(&changed);
+	return (result);
+}
+
+void
+dns_catz_update_from_db(dns_db_t *db, dns_catz_zones_t *catzs) {
+	dns_catz_zone_t *oldzone = NULL;
+	isc_result_t result;
+	isc_region_t r;
+	char bname[DNS_NAME_FORMATSIZE];
+	isc_buffer_t ibname;
+	isc_uint32_t vers;
+	isc_time_t start, end;
+	isc_uint64_t usecs;
+	unsigned int nchanged = 0;
+
+	REQUIRE(DNS_DB_VALID(db));
+	REQUIRE(catzs != NULL);
+
+	/*
+	 * Create a new catz in the same context as current catz.
+	 */
+	dns_name_toregion(&db->origin, &r);
+	result = isc_ht_find(catzs->zones, r.base, r.length, (void **)&oldzone);
+	if (result != ISC_R_SUCCESS) {
+		/* This can happen if we remove the zone in the meantime. */
+		isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
+			      DNS_LOGMODULE_MASTER, ISC_LOG_ERROR,
+			      "catz: zone '%s' not in config",
+			      bname);
+		return;
+	}
+
+	isc_buffer_init(&ibname, bname, DNS_NAME_FORMATSIZE);
+	result = dns_name_totext(&db->origin, ISC_TRUE, &ibname);
+	INSIST(result == ISC_R_SUCCESS);
+
+	result = dns_db_getsoaserial(db, oldzone->dbversion, &vers);
+	if (result != ISC_R_SUCCESS) {
+		/* A zone without SOA record?!? */
+		isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
+			      DNS_LOGMODULE_MASTER, ISC_LOG_ERROR,
+			      "catz: zone '%s' has no SOA record (%s)",
+			      bname, isc_result_totext(result));
 		return;
 	}
 
+	isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
+		      DNS_LOGMODULE_MASTER, ISC_LOG_INFO,
+		      "catz: updating catalog zone '%s' with serial %d",
+		      bname, vers);
+
+	/*
+	 * If the journal covers every change since the serial that the
+	 * member zone list was last built from, and only member entries
+	 * changed, only those entries need to be looked at.  Otherwise
+	 * rebuild the whole list.
+	 */
+	isc_time_now(&start);
+	result = catz_update_incremental(oldzone, db, vers, &nchanged);
+	if (result != ISC_R_SUCCESS) {
+		if (oldzone->haveserial)
+			isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
+				      DNS_LOGMODULE_MASTER, ISC_LOG_DEBUG(1),
+				      "catz: catalog zone '%s' cannot be "
+				      "updated incrementally (%s)",
+				      bname, isc_result_totext(result));
+		oldzone->haveserial = ISC_FALSE;
+		result = catz_update_full(oldzone, db);
+	} else
+		oldzone->haveserial = ISC_TRUE;
+	dns_db_closeversion(db, &oldzone->dbversion, ISC_FALSE);
+	if (result != ISC_R_SUCCESS)
+		return;
+
 	isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
 		      DNS_LOGMODULE_MASTER, ISC_LOG_DEBUG(3),
 		      "catz: update_from_db: new zone merged");
 
+	isc_time_now(&end);
+	usecs = isc_time_microdiff(&end, &start);
+	if (oldzone->haveserial)
+		isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
+			      DNS_LOGMODULE_MASTER, ISC_LOG_INFO,
+			      "catz: catalog zone '%s' updated incrementally "
+			      "from serial %u: %u entries changed, "
+			      "%u.%03u secs",
+			      bname, oldzone->serial, nchanged,
+			      (unsigned int)(usecs / 1000000),
+			      (unsigned int)((usecs / 1000) % 1000));
+	else
+		isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
+			      DNS_LOGMODULE_MASTER, ISC_LOG_INFO,
+			      "catz: catalog zone '%s' rebuilt: %u entries, "
+			      "%u.%03u secs",
+			      bname, isc_ht_count(oldzone->entries),
+			      (unsigned int)(usecs / 1000000),
+			      (unsigned int)((usecs / 1000) % 1000));
+	oldzone->serial = vers;
+	oldzone->haveserial = ISC_TRUE;
+
 	/*
 	 * When we're doing reconfig and setting a new catalog zone
 	 * from an existing zone we won't have a chance to set up
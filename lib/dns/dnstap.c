@@ -77,7 +77,6 @@
 #define VALID_DTENV(env)		ISC_MAGIC_VALID(env, DTENV_MAGIC)
 
 #define DNSTAP_CONTENT_TYPE	"protobuf:dnstap.Dnstap"
-#define DNSTAP_INITIAL_BUF_SIZE 256
 
 struct dns_dtmsg {
 	void *buf;
@@ -111,6 +110,18 @@ struct dns_dtenv {
 	isc_stats_t *stats;
 };
 
+/*
+ * Per-thread state: the fstrm input queue this thread submits to,
+ * when it last checked the size of the output file, and how many
+ * messages of each type it has seen, for sampling.
+ */
+typedef struct dt_thread {
+	unsigned int generation;
+	struct fstrm_iothr_queue *ioq;
+	isc_uint32_t sizecheck;
+	isc_uint32_t count[DNS_DTTYPE_COUNT];
+} dt_thread_t;
+
 #define CHECK(x) do { \
 	result = (x); \
 	if (result != ISC_R_SUCCESS) \
@@ -454,13 +465,10 @@ dns_dt_setversion(dns_dtenv_t *env, const char *version) {
 	return (toregion(env, &env->version, version));
 }
 
-static struct fstrm_iothr_queue *
-dt_queue(dns_dtenv_t *env) {
+static dt_thread_t *
+dt_thread(dns_dtenv_t *env) {
 	isc_result_t result;
-	struct ioq {
-		unsigned int generation;
-		struct fstrm_iothr_queue *ioq;
-	} *ioq;
+	dt_thread_t *dtt;
 
 	REQUIRE(VALID_DTENV(env));
 
@@ -471,32 +479,33 @@ dt_queue(dns_dtenv_t *env) {
 	if (result != ISC_R_SUCCESS)
 		return (NULL);
 
-	ioq = (struct ioq *)isc_thread_key_getspecific(dt_key);
-	if (ioq != NULL && ioq->generation != generation) {
+	dtt = (dt_thread_t *)isc_thread_key_getspecific(dt_key);
+	if (dtt != NULL && dtt->generation != generation) {
 		result = isc_thread_key_setspecific(dt_key, NULL);
 		if (result != ISC_R_SUCCESS)
 			return (NULL);
-		free(ioq);
-		ioq = NULL;
+		free(dtt);
+		dtt = NULL;
 	}
-	if (ioq == NULL) {
-		ioq = malloc(sizeof(*ioq));
-		if (ioq == NULL)
+	if (dtt == NULL) {
+		dtt = malloc(sizeof(*dtt));
+		if (dtt == NULL)
 			return (NULL);
-		ioq->generation = generation;
-		ioq->ioq = fstrm_iothr_get_input_queue(env->iothr);
-		if (ioq->ioq == NULL) {
-			free(ioq);
+		memset(dtt, 0, sizeof(*dtt));
+		dtt->generation = generation;
+		dtt->ioq = fstrm_iothr_get_input_queue(env->iothr);
+		if (dtt->ioq == NULL) {
+			free(dtt);
 			return (NULL);
 		}
-		result = isc_thread_key_setspecific(dt_key, ioq);
+		result = isc_thread_key_setspecific(dt_key, dtt);
 		if (result != ISC_R_SUCCESS) {
-			free(ioq);
+			free(dtt);
 			return (NULL);
 		}
 	}
 
-	return (ioq->ioq);
+	return (dtt);
 }
 
 void
@@ -565,35 +574,47 @@ dns_dt_detach(dns_dtenv_t **envp) {
 		destroy(env);
 }
 
+/*
+ * Encode 'd' into a buffer of exactly the right size, so that the
+ * frame is allocated once rather than grown while it is packed.
+ */
 static isc_result_t
 pack_dt(const Dnstap__Dnstap *d, void **buf, size_t *sz) {
-	ProtobufCBufferSimple sbuf;
+	isc_uint8_t *data;
+	size_t len;
 
 	REQUIRE(d != NULL);
 	REQUIRE(sz != NULL);
 
-	memset(&sbuf, 0, sizeof(sbuf));
-	sbuf.base.append = protobuf_c_buffer_simple_append;
-	sbuf.len = 0;
-	sbuf.alloced = DNSTAP_INITIAL_BUF_SIZE;
+	len = dnstap__dnstap__get_packed_size(d);
 
-	/* Need to use malloc() here because protobuf uses free() */
-	sbuf.data = malloc(sbuf.alloced);
-	if (sbuf.data == NULL)
+	/* Need to use malloc() here because fstrm uses free() */
+	data = malloc(len);
+	if (data == NULL)
 		return (ISC_R_NOMEMORY);
-	sbuf.must_free_data = 1;
 
-	*sz = dnstap__dnstap__pack_to_buffer(d, (ProtobufCBuffer *) &sbuf);
-	if (sbuf.data == NULL)
-		return (ISC_R_FAILURE);
-	*buf = sbuf.data;
+	*sz = dnstap__dnstap__pack(d, data);
+	INSIST(*sz == len);
+	*buf = data;
 
 	return (ISC_R_SUCCESS);
 }
 
+/*
+ * Called by the fstrm I/O thread once a message has been written
+ * or discarded; it is no longer queued.
+ */
 static void
-send_dt(dns_dtenv_t *env, void *buf, size_t len) {
-	struct fstrm_iothr_queue *ioq;
+dt_free(void *buf, void *arg) {
+	isc_stats_t *stats = arg;
+
+	if (stats != NULL)
+		isc_stats_decrement(stats, dns_dnstapcounter_queued);
+	free(buf);
+}
+
+static void
+send_dt(dns_dtenv_t *env, dt_thread_t *dtt, void *buf, size_t len) {
 	fstrm_res res;
 
 	REQUIRE(env != NULL);
@@ -601,18 +622,17 @@ send_dt(dns_dtenv_t *env, void *buf, size_t len) {
 	if (buf == NULL)
 		return;
 
-	ioq = dt_queue(env);
-	if (ioq == NULL) {
-		free(buf);
-		return;
-	}
-
-	res = fstrm_iothr_submit(env->iothr, ioq, buf, len,
-				 fstrm_free_wrapper, NULL);
+	if (env->stats != NULL)
+		isc_stats_increment(env->stats, dns_dnstapcounter_queued);
+	res = fstrm_iothr_submit(env->iothr, dtt->ioq, buf, len,
+				 dt_free, env->stats);
 	if (res != fstrm_res_success) {
-		if (env->stats != NULL)
+		if (env->stats != NULL) {
+			isc_stats_decrement(env->stats,
+					    dns_dnstapcounter_queued);
 			isc_stats_increment(env->stats,
 					    dns_dnstapcounter_drop);
+		}
 		free(buf);
 	} else {
 		if (env->stats != NULL)
@@ -675,6 +695,18 @@ dnstap_type(dns_dtmsgtype_t msgtype) {
 	}
 }
 
+static unsigned int
+dt_typeindex(dns_dtmsgtype_t msgtype) {
+	unsigned int i;
+
+	for (i = 0; i < DNS_DTTYPE_COUNT; i++) {
+		if (msgtype == (1U << i))
+			return (i);
+	}
+	INSIST(0);
+	return (0);
+}
+
 static void
 cpbuf(isc_buffer_t *buf, ProtobufCBinaryData *p, protobuf_c_boolean *has) {
 	p->data = isc_buffer_base(buf);
@@ -723,6 +755,9 @@ dns_dt_send(dns_view_t *view, dns_dtmsgtype_t msgtype,
 {
 	isc_time_t now, *t;
 	dns_dtmsg_t dm;
+	dt_thread_t *dtt;
+	isc_uint32_t rate;
+	unsigned int i;
 
 	REQUIRE(DNS_VIEW_VALID(view));
 
@@ -734,18 +769,55 @@ dns_dt_send(dns_view_t *view, dns_dtmsgtype_t msgtype,
 
 	REQUIRE(VALID_DTENV(view->dtenv));
 
-	if (view->dtenv->max_size != 0) {
+	dtt = dt_thread(view->dtenv);
+	if (dtt == NULL) {
+		if (view->dtenv->stats != NULL)
+			isc_stats_increment(view->dtenv->stats,
+					    dns_dnstapcounter_drop);
+		return;
+	}
+
+	/*
+	 * Decide whether to sample this message out before doing
+	 * any work to encode it.
+	 */
+	i = dt_typeindex(msgtype);
+	rate = view->dtsample[i];
+	if (rate > 1 && (dtt->count[i]++ % rate) != 0) {
+		if (view->dtenv->stats != NULL)
+			isc_stats_increment(view->dtenv->stats,
+					    dns_dnstapcounter_sampled);
+		return;
+	}
+
+	TIME_NOW(&now);
+	t = &now;
+
+	/*
+	 * Check the size of the output file at most once a second
+	 * per thread, rather than with a stat() call for every message.
+	 */
+	if (view->dtenv->max_size != 0 &&
+	    dtt->sizecheck != isc_time_seconds(&now))
+	{
 		struct stat statbuf;
+
+		dtt->sizecheck = isc_time_seconds(&now);
 		if (stat(view->dtenv->path, &statbuf) >= 0 &&
 		    statbuf.st_size > view->dtenv->max_size)
 		{
 			dns_dt_reopen(view->dtenv, view->dtenv->rolls);
+			dtt = dt_thread(view->dtenv);
+			if (dtt == NULL) {
+				if (view->dtenv->stats != NULL)
+					isc_stats_increment(
+						view->dtenv->stats,
+						dns_dnstapcounter_drop);
+				return;
+			}
 		}
 	}
 
-	TIME_NOW(&now);
-	t = &now;
-
 	init_msg(view->dtenv, &dm, dnstap_type(msgtype));
 
 	/* Query/response times */
@@ -823,7 +895,10 @@ dns_dt_send(dns_view_t *view, dns_dtmsgtype_t msgtype,
 	}
 
 	if (pack_dt(&dm.d, &dm.buf, &dm.len) == ISC_R_SUCCESS)
-		send_dt(view->dtenv, dm.buf, dm.len);
+		send_dt(view->dtenv, dtt, dm.buf, dm.len);
+	else if (view->dtenv->stats != NULL)
+		isc_stats_increment(view->dtenv->stats,
+				    dns_dnstapcounter_drop);
 }
 
 void
@@ -55,6 +55,8 @@ typedef enum {
 } dns_aclelementtype_t;
 
 typedef struct dns_aclipprefix dns_aclipprefix_t;
+typedef struct dns_acltable dns_acltable_t;
+typedef struct dns_aclmap dns_aclmap_t;
 
 struct dns_aclipprefix {
 	isc_netaddr_t address; /* IP4/IP6 */
@@ -84,6 +86,7 @@ struct dns_acl {
 	unsigned int 		length;		/*%< Elements initialized */
 	char 			*name;		/*%< Temporary use only */
 	ISC_LINK(dns_acl_t) 	nextincache;	/*%< Ditto */
+	dns_acltable_t		*table;		/*%< Compiled iptable */
 };
 
 struct dns_aclenv {
@@ -99,6 +102,12 @@ struct dns_aclenv {
 #define DNS_ACL_MAGIC		ISC_MAGIC('D','a','c','l')
 #define DNS_ACL_VALID(a)	ISC_MAGIC_VALID(a, DNS_ACL_MAGIC)
 
+/*%
+ * Test whether ACL 'i' is in a set returned by dns_aclmap_find().
+ */
+#define DNS_ACLMAP_ISSET(set, i) \
+	(((set)[(i) / 64] & ((isc_uint64_t)1 << ((i) % 64))) != 0)
+
 /***
  *** Functions
  ***/
@@ -149,6 +158,77 @@ dns_acl_merge(dns_acl_t *dest, dns_acl_t *source, isc_boolean_t pos);
  * an unexpected positive match in the parent ACL.
  */
 
+isc_result_t
+dns_acl_compile(dns_acl_t *acl);
+/*%<
+ * Compile the IP table of 'acl' into sorted arrays of address ranges,
+ * one for IPv4 and one for IPv6, in which each range has a single
+ * match result.  dns_acl_match() then finds the result for a client
+ * address with a binary search instead of walking the radix tree.
+ *
+ * The compiled table is only used while it is current: if prefixes
+ * are added to the IP table afterwards, the radix tree is searched
+ * until dns_acl_compile() is called again.  EDNS client subnet
+ * prefixes are always looked up in the radix tree.
+ *
+ * This is intended to be called once an ACL has been fully
+ * configured.  It must not be called while other threads may be
+ * matching against 'acl'.
+ *
+ * Requires:
+ *\li	'acl' to be a valid acl.
+ *
+ * Returns:
+ *\li	#ISC_R_SUCCESS
+ *\li	#ISC_R_NOMEMORY		the radix tree continues to be used
+ */
+
+isc_result_t
+dns_aclmap_create(isc_mem_t *mctx, dns_acl_t **acls, unsigned int nacls,
+		  dns_aclmap_t **mapp);
+/*%<
+ * Combine the 'nacls' ACLs in 'acls' into a map from addresses to
+ * the set of ACLs that allow them, so that one lookup replaces
+ * matching the address against each ACL in turn.  A NULL entry in
+ * 'acls' allows every address, as in dns_acl_allowed().
+ *
+ * Only the IP prefixes of an ACL are taken into account.  ACLs that
+ * have other elements (such as keys, "localnets" or GeoIP elements)
+ * are in every set, and still have to be checked with
+ * dns_acl_allowed(); so do all the ACLs when a key or an EDNS client
+ * subnet option has to be matched.
+ *
+ * ACLs consisting of IP prefixes only are compiled with
+ * dns_acl_compile() if needed, so this must not be called while
+ * other threads may be matching against them.
+ *
+ * Requires:
+ *\li	'mctx' to be a valid memory context.
+ *\li	'acls' to be non NULL, unless 'nacls' is 0.
+ *\li	'mapp' to be non NULL and '*mapp' to be NULL.
+ *
+ * Returns:
+ *\li	#ISC_R_SUCCESS
+ *\li	#ISC_R_NOMEMORY
+ */
+
+const isc_uint64_t *
+dns_aclmap_find(const dns_aclmap_t *map, const isc_netaddr_t *addr,
+		const dns_aclenv_t *env);
+/*%<
+ * Return the set of ACLs in 'map' that allow 'addr' in environment
+ * 'env'.  The set is an array of ('nacls' + 63) / 64 words; use
+ * DNS_ACLMAP_ISSET() to test whether the ACL at index 'i' of the
+ * array passed to dns_aclmap_create() is in it.
+ */
+
+void
+dns_aclmap_destroy(dns_aclmap_t **mapp);
+/*%<
+ * Free a map created by dns_aclmap_create().  The ACLs are not
+ * affected.
+ */
+
 void
 dns_acl_attach(dns_acl_t *source, dns_acl_t **target);
 /*%<
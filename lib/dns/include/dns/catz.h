@@ -420,8 +420,12 @@ void
 dns_catz_update_from_db(dns_db_t *db, dns_catz_zones_t *catzs);
 /*%<
  * Process an updated database for a catalog zone.
- * It creates a new catz, iterates over database to fill it with content, and
- * then merges new catz into old catz.
+ * If the zone's journal holds every change since the last update, and
+ * those changes only touch member zone entries, only the changed entries
+ * are re-read and passed to the zone modification methods.  Otherwise it
+ * creates a new catz, iterates over database to fill it with content, and
+ * then merges new catz into old catz.  Either way, the time taken is
+ * logged.
  *
  * Requires:
  * \li	db is a valid DB
@@ -77,6 +77,12 @@ struct fstrm_iothr_options;
 #define DNS_DTTYPE_ALL \
 	(DNS_DTTYPE_QUERY|DNS_DTTYPE_RESPONSE)
 
+/*%
+ * Number of message types; the type with bit 'n' set is sampled
+ * according to 'view->dtsample[n]'.
+ */
+#define DNS_DTTYPE_COUNT 12
+
 typedef enum {
 	dns_dtmode_none = 0,
 	dns_dtmode_file,
@@ -265,7 +271,10 @@ dns_dt_send(dns_view_t *view, dns_dtmsgtype_t msgtype,
 	    isc_time_t *rtime, isc_buffer_t *buf);
 /*%<
  * Sends a dnstap message to the log, if 'msgtype' is one of the message
- * types represented in 'view->dttypes'.
+ * types represented in 'view->dttypes'.  If 'view->dtsample' is greater
+ * than one for 'msgtype', only one message in that many is sent by each
+ * worker thread; the others are counted as sampled out and are not
+ * encoded at all.
  *
  * Parameters are: 'qaddr' (query address, i.e, the address of the
  * query initiator); 'raddr' (response address, i.e., the address of
@@ -22,6 +22,7 @@ struct dns_iptable {
 	isc_mem_t		*mctx;
 	isc_refcount_t		refcount;
 	isc_radix_tree_t	*radix;
+	unsigned int		generation;	/*%< Bumped on every change */
 	ISC_LINK(dns_iptable_t)	nextincache;
 };
 
@@ -75,6 +75,7 @@ LIBDNS_EXTERNAL_DATA extern isc_logmodule_t dns_modules[];
 #define DNS_LOGMODULE_DYNDB		(&dns_modules[31])
 #define DNS_LOGMODULE_DNSTAP		(&dns_modules[32])
 #define DNS_LOGMODULE_SSU		(&dns_modules[33])
+#define DNS_LOGMODULE_QLOG		(&dns_modules[34])
 
 ISC_LANG_BEGINDECLS
 
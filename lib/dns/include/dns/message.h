@@ -164,6 +164,9 @@ typedef int dns_messagetextflag_t;
 						   source buffer */
 #define DNS_MESSAGEPARSE_IGNORETRUNCATION 0x0008 /*%< truncation errors are
 						  * not fatal. */
+#define DNS_MESSAGEPARSE_WIREREF	0x0010	/*%< reference uncompressed
+						   names and rdata in a
+						   copy of the source */
 
 /*
  * Control behavior of rendering
@@ -444,6 +447,14 @@ dns_message_parse(dns_message_t *msg, isc_buffer_t *source,
  * If #DNS_MESSAGEPARSE_IGNORETRUNCATION is set then return as many complete
  * RR's as possible, DNS_R_RECOVERABLE will be returned.
  *
+ * If #DNS_MESSAGEPARSE_WIREREF is set, the wire data is copied once into
+ * storage owned by the message, and names and rdata whose wire form needed
+ * no decompression point into that copy instead of being copied
+ * individually into the message's scratch buffers.  This reduces the
+ * allocations needed to parse large responses, and lets rdata be copied
+ * straight from wire form when it is later stored elsewhere (for example
+ * by dns_rdataslab_fromrdataset()).
+ *
  * OPT and TSIG records are always handled specially, regardless of the
  * 'preserve_order' setting.
  *
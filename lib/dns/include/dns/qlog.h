@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2018  Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef DNS_QLOG_H
+#define DNS_QLOG_H 1
+
+/*****
+ ***** Module Info
+ *****/
+
+/*! \file dns/qlog.h
+ * \brief
+ * The qlog module writes and reads binary query logs.
+ *
+ * A binary query log holds one fixed-layout record per client query,
+ * with the query name in uncompressed wire format.  Nothing has to be
+ * formatted as text while the server is answering queries: records
+ * are copied into a buffer which is handed to the log's own task to
+ * be written out when it fills up, and at least once a second.
+ *
+ * File format (all integers are in network byte order):
+ *
+ *\li	A 16 byte header, DNS_QLOG_MAGIC padded with NULs.
+ *
+ *\li	View records: type (1 byte, 2), name length (1 byte), view
+ *	id (2 bytes), followed by the view name.  A view record is
+ *	written before the first query record that refers to it, and
+ *	again whenever the file is reopened.
+ *
+ *\li	Query records: type (1 byte, 1), qname length (1 byte), view
+ *	id (2 bytes), seconds and nanoseconds of the time the query
+ *	was received (4 bytes each), qtype, qclass, flags, rcode and
+ *	client port (2 bytes each), address family (1 byte, 4 or 6),
+ *	EDNS version (1 byte), client address (16 bytes, IPv4
+ *	addresses use the first 4), followed by the qname.
+ *
+ * MP:
+ *\li	dns_qlog_write() may be called from any thread.
+ */
+
+#include <isc/lang.h>
+#include <isc/buffer.h>
+#include <isc/sockaddr.h>
+#include <isc/time.h>
+#include <isc/types.h>
+
+#include <dns/fixedname.h>
+#include <dns/types.h>
+
+#define DNS_QLOG_MAGIC		";BIND QLOG V1\n"
+
+/*%
+ * Query record flags.
+ */
+#define DNS_QLOG_RD		0x0001	/*%< Recursion desired */
+#define DNS_QLOG_CD		0x0002	/*%< Checking disabled */
+#define DNS_QLOG_DO		0x0004	/*%< DNSSEC OK */
+#define DNS_QLOG_EDNS		0x0008	/*%< Query had an OPT record */
+#define DNS_QLOG_TCP		0x0010	/*%< Received over TCP */
+#define DNS_QLOG_SIGNED		0x0020	/*%< Signed with TSIG or SIG(0) */
+#define DNS_QLOG_COOKIE		0x0040	/*%< Valid server cookie */
+#define DNS_QLOG_CLIENTCOOKIE	0x0080	/*%< Client cookie only */
+#define DNS_QLOG_ECS		0x0100	/*%< EDNS Client Subnet option */
+#define DNS_QLOG_TC		0x0200	/*%< Response was truncated */
+#define DNS_QLOG_NORESPONSE	0x0400	/*%< No response was sent */
+#define DNS_QLOG_XFR		0x0800	/*%< Handed to zone transfer */
+
+typedef struct dns_qlogreader dns_qlogreader_t;
+
+typedef struct dns_qlogentry {
+	isc_time_t		when;
+	isc_sockaddr_t		client;
+	dns_fixedname_t		fqname;
+	dns_name_t		*qname;
+	dns_rdataclass_t	qclass;
+	dns_rdatatype_t		qtype;
+	unsigned int		flags;
+	unsigned int		ednsversion;
+	dns_rcode_t		rcode;
+	const char		*view;	/*%< NULL if not known */
+} dns_qlogentry_t;
+
+ISC_LANG_BEGINDECLS
+
+isc_result_t
+dns_qlog_create(isc_mem_t *mctx, isc_taskmgr_t *taskmgr,
+		isc_timermgr_t *timermgr, const char *path,
+		dns_qlog_t **qlogp);
+/*%<
+ * Create a binary query log writing to the file 'path'.  An existing
+ * file is appended to.
+ *
+ * There should be a single binary query log for the server; it is
+ * attached to each view that logs to it.
+ *
+ * Requires:
+ *
+ *\li	'mctx', 'taskmgr' and 'timermgr' are valid.
+ *
+ *\li	'path' is a valid C string.
+ *
+ *\li	qlogp != NULL && *qlogp == NULL
+ *
+ * Returns:
+ *
+ *\li	#ISC_R_SUCCESS
+ *\li	#ISC_R_NOMEMORY
+ *
+ *\li	Other errors are possible if the file cannot be opened.
+ */
+
+void
+dns_qlog_attach(dns_qlog_t *source, dns_qlog_t **targetp);
+
+void
+dns_qlog_detach(dns_qlog_t **qlogp);
+/*%<
+ * Attach to or detach from a binary query log.  When the last
+ * reference is gone, the remaining records are written out and the
+ * file is closed.
+ */
+
+const char *
+dns_qlog_getpath(dns_qlog_t *qlog);
+/*%<
+ * Return the name of the file 'qlog' writes to.
+ */
+
+isc_result_t
+dns_qlog_reopen(dns_qlog_t *qlog);
+/*%<
+ * Write out any buffered records, then close and reopen the file,
+ * so that it can be rotated by an external program.  The view table
+ * is repeated at the start of the new file.
+ *
+ * Requires:
+ *
+ *\li	'qlog' is a valid binary query log.
+ */
+
+isc_result_t
+dns_qlog_addview(dns_qlog_t *qlog, const char *name, isc_uint16_t *idp);
+/*%<
+ * Find or assign the view id for the view called 'name', and store
+ * it in '*idp'.  Views keep their id when the server is reconfigured.
+ *
+ * Requires:
+ *
+ *\li	'qlog' is a valid binary query log.
+ *
+ *\li	'name' and 'idp' are not NULL.
+ *
+ * Returns:
+ *
+ *\li	#ISC_R_SUCCESS
+ *\li	#ISC_R_NOMEMORY
+ *\li	#ISC_R_NOSPACE		too many views
+ */
+
+void
+dns_qlog_write(dns_qlog_t *qlog, isc_uint16_t viewid, const isc_time_t *when,
+	       const isc_sockaddr_t *client, const dns_name_t *qname,
+	       dns_rdataclass_t qclass, dns_rdatatype_t qtype,
+	       unsigned int flags, unsigned int ednsversion,
+	       dns_rcode_t rcode);
+/*%<
+ * Append a query record to the binary query log.
+ *
+ * Requires:
+ *
+ *\li	'qlog' is a valid binary query log.
+ *
+ *\li	'when', 'client' and 'qname' are not NULL; 'qname' is absolute.
+ */
+
+isc_result_t
+dns_qlog_open(isc_mem_t *mctx, const char *filename,
+	      dns_qlogreader_t **readerp);
+/*%<
+ * Open the binary query log 'filename' for reading.
+ *
+ * Returns:
+ *
+ *\li	#ISC_R_SUCCESS
+ *\li	#ISC_R_NOMEMORY
+ *\li	#DNS_R_FORMERR		the file is not a binary query log
+ *
+ *\li	Other errors are possible if the file cannot be opened.
+ */
+
+isc_result_t
+dns_qlog_read(dns_qlogreader_t *reader, dns_qlogentry_t *entry);
+/*%<
+ * Read the next query record into 'entry'.  View records are
+ * processed as they are found.  'entry->view' remains valid until
+ * 'reader' is closed.
+ *
+ * Returns:
+ *
+ *\li	#ISC_R_SUCCESS
+ *\li	#ISC_R_NOMORE		no more records
+ *\li	#ISC_R_UNEXPECTEDEND	the file ends inside a record
+ *\li	#DNS_R_FORMERR		the record is malformed
+ */
+
+void
+dns_qlog_close(dns_qlogreader_t **readerp);
+/*%<
+ * Close a binary query log opened with dns_qlog_open().
+ */
+
+isc_result_t
+dns_qlog_totext(const dns_qlogentry_t *entry, isc_buffer_t *target);
+/*%<
+ * Convert 'entry' to a line of text similar to the one that is
+ * logged in the "queries" category, followed by the response code.
+ *
+ * Returns:
+ *
+ *\li	#ISC_R_SUCCESS
+ *\li	#ISC_R_NOSPACE
+ */
+
+ISC_LANG_ENDDECLS
+
+#endif /* DNS_QLOG_H */
@@ -13,11 +13,13 @@
 #include <isc/deprecated.h>
 #include <isc/event.h>
 #include <isc/ht.h>
+#include <isc/json.h>
 #include <isc/lang.h>
 #include <isc/refcount.h>
 #include <isc/rwlock.h>
 #include <isc/time.h>
 #include <isc/timer.h>
+#include <isc/xml.h>
 
 #include <dns/fixedname.h>
 #include <dns/rdata.h>
@@ -152,6 +154,13 @@ struct dns_rpz_zone {
 	isc_boolean_t	 db_registered;	/* is the notify event registered? */
 	isc_timer_t	 *updatetimer;
 	isc_event_t	 updateevent;
+	char		 *journal;	/* journal of the policy zone */
+	isc_uint32_t	 serial;	/* serial of the summarized version */
+	isc_boolean_t	 haveserial;	/* 'serial' of 'db' is summarized */
+	dns_dbversion_t	 *sumversion;	/* version of 'db' summarized */
+	isc_time_t	 updatestarted;	/* when the running update began */
+	isc_uint64_t	 updatetime;	/* microseconds the last update took */
+	isc_boolean_t	 incremental;	/* last update read the journal */
 };
 
 /*
@@ -238,6 +247,7 @@ struct dns_rpz_zones {
 	dns_rpz_triggers_t	total_triggers;
 
 	isc_mem_t		*mctx;
+	isc_mem_t		*smctx;		/* summary data */
 	isc_taskmgr_t		*taskmgr;
 	isc_timermgr_t		*timermgr;
 	isc_task_t		*updater;
@@ -251,7 +261,7 @@ struct dns_rpz_zones {
 	isc_rwlock_t		search_lock;
 	isc_mutex_t		maint_lock;
 
-	dns_rpz_cidr_node_t	*cidr;
+	dns_rpz_cidr_node_t	*cidr[3];	/* client-IP, IP, NSIP */
 	dns_rbt_t		*rbt;
 
 	/*
@@ -291,6 +301,7 @@ typedef struct {
 		dns_dbversion_t		*version;
 		dns_dbnode_t		*node;
 		dns_rdataset_t		*rdataset;
+		isc_boolean_t		compiled;  /* policy from summary */
 	} m;
 	/*
 	 * State for chasing IP addresses and NS names including recursion.
@@ -385,6 +396,21 @@ dns_rpz_new_zone(dns_rpz_zones_t *rpzs, dns_rpz_zone_t **rpzp);
 isc_result_t
 dns_rpz_dbupdate_callback(dns_db_t *db, void *fn_arg);
 
+isc_result_t
+dns_rpz_setjournal(dns_rpz_zone_t *rpz, const char *journal);
+/*%<
+ * Record the name of the journal of policy zone 'rpz', or forget it
+ * if 'journal' is NULL.  When a new version of the zone has a journal
+ * covering every change since the version that the summary data was
+ * built from, only the names that the journal says have changed are
+ * updated.  Otherwise the summary data is rebuilt from the whole zone.
+ *
+ * Returns:
+ *
+ *\li	#ISC_R_SUCCESS
+ *\li	#ISC_R_NOMEMORY
+ */
+
 void
 dns_rpz_attach_rpzs(dns_rpz_zones_t *source, dns_rpz_zones_t **target);
 
@@ -405,6 +431,16 @@ isc_result_t
 dns_rpz_add(dns_rpz_zones_t *rpzs, dns_rpz_num_t rpz_num,
 	    const dns_name_t *name);
 
+isc_result_t
+dns_rpz_add_policy(dns_rpz_zones_t *rpzs, dns_rpz_num_t rpz_num,
+		   const dns_name_t *name, dns_rpz_policy_t policy);
+/*%<
+ * Add a trigger to the summary data along with the policy of its policy
+ * record, if the policy does not depend on the query.  'policy' is
+ * DNS_RPZ_POLICY_RECORD if the policy record must be consulted.
+ * dns_rpz_add() is equivalent to DNS_RPZ_POLICY_RECORD.
+ */
+
 void
 dns_rpz_delete(dns_rpz_zones_t *rpzs, dns_rpz_num_t rpz_num,
 	       const dns_name_t *name);
@@ -412,11 +448,62 @@ dns_rpz_delete(dns_rpz_zones_t *rpzs, dns_rpz_num_t rpz_num,
 dns_rpz_num_t
 dns_rpz_find_ip(dns_rpz_zones_t *rpzs, dns_rpz_type_t rpz_type,
 		dns_rpz_zbits_t zbits, const isc_netaddr_t *netaddr,
-		dns_name_t *ip_name, dns_rpz_prefix_t *prefixp);
+		dns_name_t *ip_name, dns_rpz_prefix_t *prefixp,
+		dns_rpz_policy_t *policyp, dns_dbversion_t **versionp);
+/*%<
+ * Find the most eligible policy zone among 'zbits' with a 'rpz_type'
+ * trigger for 'netaddr'.  The owner name of the trigger relative to the
+ * zone is put in 'ip_name', its prefix length in '*prefixp', and its
+ * compiled policy or DNS_RPZ_POLICY_RECORD in '*policyp'.
+ *
+ * '*versionp' is set to the version of the policy zone database the
+ * compiled policy was taken from.  The compiled policy only applies to
+ * that version; '*versionp' is not attached and may only be compared
+ * with the version being answered from.
+ *
+ * Returns the number of the zone or DNS_RPZ_INVALID_NUM.
+ */
 
 dns_rpz_zbits_t
 dns_rpz_find_name(dns_rpz_zones_t *rpzs, dns_rpz_type_t rpz_type,
-		  dns_rpz_zbits_t zbits, dns_name_t *trig_name);
+		  dns_rpz_zbits_t zbits, dns_name_t *trig_name,
+		  dns_rpz_num_t *nump, dns_rpz_policy_t *policyp,
+		  dns_dbversion_t **versionp);
+/*%<
+ * Find the policy zones among 'zbits' with exact or wildcard 'rpz_type'
+ * triggers for 'trig_name'.  '*nump' is set to the most eligible of
+ * the zones with an exact trigger whose policy is known, '*policyp'
+ * to that policy and '*versionp' to the version it was taken from, as
+ * for dns_rpz_find_ip().  Otherwise '*nump' is DNS_RPZ_INVALID_NUM,
+ * '*policyp' is DNS_RPZ_POLICY_RECORD and '*versionp' is NULL.
+ *
+ * Returns the bit mask of the zones.
+ */
+
+void
+dns_rpz_dumpstats(dns_rpz_zones_t *rpzs, FILE *fp);
+/*%<
+ * Dump the number of triggers in the summary data of 'rpzs', the
+ * memory it uses, the longest time the last update of the summary
+ * data of one of the policy zones took and the number of policy zones
+ * last updated from their journal in text to 'fp'.
+ */
+
+#ifdef HAVE_LIBXML2
+int
+dns_rpz_renderxml(dns_rpz_zones_t *rpzs, xmlTextWriterPtr writer);
+/*%<
+ * Render the summary data statistics of 'rpzs' in XML for 'writer'.
+ */
+#endif /* HAVE_LIBXML2 */
+
+#ifdef HAVE_JSON
+isc_result_t
+dns_rpz_renderjson(dns_rpz_zones_t *rpzs, json_object *rstats);
+/*%<
+ * Render the summary data statistics of 'rpzs' in JSON.
+ */
+#endif /* HAVE_JSON */
 
 ISC_LANG_ENDDECLS
 
@@ -191,8 +191,44 @@ struct dns_rrl_rate {
 	const char  *str;
 };
 
+/*
+ * A shard of the rate-limit database.
+ * All of the entries for a client address block are in the same shard,
+ * so that rate limiting a response only needs the lock of one shard.
+ */
+typedef struct dns_rrl_shard dns_rrl_shard_t;
+struct dns_rrl_shard {
+	isc_mutex_t	lock;
+
+	int		num_entries;
+
+	unsigned int	probes;
+	unsigned int	searches;
+
+	ISC_LIST(dns_rrl_block_t) blocks;
+	ISC_LIST(dns_rrl_entry_t) lru;
+
+	dns_rrl_hash_t	*hash;
+	dns_rrl_hash_t	*old_hash;
+	unsigned int	hash_gen;
+
+	unsigned int	ts_gen;
+# define DNS_RRL_TS_BASES   (1<<DNS_RRL_TS_GEN_BITS)
+	isc_stdtime_t	ts_bases[DNS_RRL_TS_BASES];
+
+	isc_stdtime_t	log_stops_time;
+	dns_rrl_entry_t	*last_logged;
+	int		num_logged;
+};
+
+#define DNS_RRL_MAX_SHARDS	64
+
 /*
  * Per-view query rate limit parameters and a pointer to database.
+ * 'lock' protects the total number of entries, the qname buffers and
+ * the estimated query rate; the entries themselves are protected by
+ * the lock of their shard.  A shard lock may be held while 'lock' is
+ * taken, but not the other way around.
  */
 typedef struct dns_rrl dns_rrl_t;
 struct dns_rrl {
@@ -219,28 +255,15 @@ struct dns_rrl {
 	isc_stdtime_t	qps_time;
 	double		qps;
 
-	unsigned int	probes;
-	unsigned int	searches;
-
-	ISC_LIST(dns_rrl_block_t) blocks;
-	ISC_LIST(dns_rrl_entry_t) lru;
-
-	dns_rrl_hash_t	*hash;
-	dns_rrl_hash_t	*old_hash;
-	unsigned int	hash_gen;
-
-	unsigned int	ts_gen;
-# define DNS_RRL_TS_BASES   (1<<DNS_RRL_TS_GEN_BITS)
-	isc_stdtime_t	ts_bases[DNS_RRL_TS_BASES];
+	unsigned int	num_shards;
+	unsigned int	shard_bits;
+	dns_rrl_shard_t	*shards;
 
 	int		ipv4_prefixlen;
 	isc_uint32_t	ipv4_mask;
 	int		ipv6_prefixlen;
 	isc_uint32_t	ipv6_mask[4];
 
-	isc_stdtime_t	log_stops_time;
-	dns_rrl_entry_t	*last_logged;
-	int		num_logged;
 	int		num_qnames;
 	ISC_LIST(dns_rrl_qname_buf_t) qname_free;
 # define DNS_RRL_QNAMES	    (1<<DNS_RRL_QNAMES_BITS)
@@ -264,7 +287,14 @@ void
 dns_rrl_view_destroy(dns_view_t *view);
 
 isc_result_t
-dns_rrl_init(dns_rrl_t **rrlp, dns_view_t *view, int min_entries);
+dns_rrl_init(dns_rrl_t **rrlp, dns_view_t *view, int min_entries,
+	     unsigned int shards);
+/*%<
+ * Create the rate limit database for 'view' with at least 'min_entries'
+ * entries, divided among 'shards' shards.  The number of shards is
+ * rounded up to a power of two no larger than DNS_RRL_MAX_SHARDS;
+ * a shard per worker thread keeps them from waiting for each other.
+ */
 
 ISC_LANG_ENDDECLS
 
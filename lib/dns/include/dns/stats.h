@@ -135,7 +135,9 @@ enum {
 	 */
 	dns_dnstapcounter_success = 0,
 	dns_dnstapcounter_drop =  1,
-	dns_dnstapcounter_max = 2,
+	dns_dnstapcounter_sampled = 2,
+	dns_dnstapcounter_queued = 3,
+	dns_dnstapcounter_max = 4,
 
 	/*
 	 * Glue cache statistics counters.
@@ -146,6 +148,14 @@ enum {
 	dns_gluecachestatscounter_inserts_absent = 3,
 
 	dns_gluecachestatscounter_max = 4,
+
+	/*
+	 * View selection statistics counters.
+	 */
+	dns_viewstatscounter_matched = 0,
+	dns_viewstatscounter_evaluated = 1,
+
+	dns_viewstatscounter_max = 2,
 };
 
 /*%
@@ -108,6 +108,7 @@ typedef struct dns_order			dns_order_t;
 typedef struct dns_peer				dns_peer_t;
 typedef struct dns_peerlist			dns_peerlist_t;
 typedef struct dns_portlist			dns_portlist_t;
+typedef struct dns_qlog				dns_qlog_t;
 typedef struct dns_rbt				dns_rbt_t;
 typedef isc_uint16_t				dns_rcode_t;
 typedef struct dns_rdata			dns_rdata_t;
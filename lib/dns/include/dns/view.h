@@ -103,6 +103,7 @@ struct dns_view {
 	isc_stats_t *			adbstats;
 	isc_stats_t *			resstats;
 	dns_stats_t *			resquerystats;
+	isc_stats_t *			viewstats;
 	isc_boolean_t			cacheshared;
 
 	/* Configurable data. */
@@ -228,6 +229,11 @@ struct dns_view {
 	dns_dtenv_t			*dtenv;		/* Dnstap environment */
 	dns_dtmsgtype_t			dttypes;	/* Dnstap message types
 							   to log */
+	isc_uint32_t			dtsample[DNS_DTTYPE_COUNT];
+							/* Log 1 in N */
+
+	dns_qlog_t			*qlog;		/* Binary query log */
+	isc_uint16_t			qlogid;		/* View id in qlog */
 };
 
 #define DNS_VIEW_MAGIC			ISC_MAGIC('V','i','e','w')
@@ -1105,6 +1111,31 @@ dns_view_getresquerystats(dns_view_t *view, dns_stats_t **statsp);
  *\li	'statsp' != NULL && '*statsp' != NULL
  */
 
+void
+dns_view_setviewstats(dns_view_t *view, isc_stats_t *stats);
+/*%<
+ * Set a view selection statistics set 'stats' for 'view'.
+ *
+ * Requires:
+ * \li	'view' is valid and is not frozen.
+ *
+ *\li	stats is a valid statistics supporting view selection statistics
+ *	counters (see dns/stats.h).
+ */
+
+void
+dns_view_getviewstats(dns_view_t *view, isc_stats_t **statsp);
+/*%<
+ * Get the view selection statistics counter set for 'view'.  If a
+ * statistics set is set '*statsp' will be attached to the set;
+ * otherwise, '*statsp' will be untouched.
+ *
+ * Requires:
+ * \li	'view' is valid.
+ *
+ *\li	'statsp' != NULL && '*statsp' == NULL
+ */
+
 isc_boolean_t
 dns_view_iscacheshared(dns_view_t *view);
 /*%<
@@ -127,6 +127,7 @@ typedef enum {
 #define DNS_ZONESTATE_SOAQUERY		3
 #define DNS_ZONESTATE_ANY		4
 #define DNS_ZONESTATE_AUTOMATIC		5
+#define DNS_ZONESTATE_LOADPENDING	6
 
 ISC_LANG_BEGINDECLS
 
@@ -1813,6 +1814,30 @@ dns_zonemgr_getiolimit(dns_zonemgr_t *zmgr);
  *\li	'zmgr' to be a valid zone manager.
  */
 
+void
+dns_zonemgr_setsigners(dns_zonemgr_t *zmgr, unsigned int signers);
+/*%<
+ *	Set the number of threads (at most 32) that compute RRSIGs for
+ *	zones being signed, in addition to the zone's own task, which
+ *	waits for them and then adds the signatures to the zone.  With
+ *	no signing threads (the default) the zone's task computes all
+ *	the signatures itself.  The per-quantum signing limits
+ *	(dns_zone_setnodes(), dns_zone_setsignatures()) apply to each
+ *	thread.
+ *
+ * Requires:
+ *\li	'zmgr' to be a valid zone manager.
+ */
+
+unsigned int
+dns_zonemgr_getsigners(dns_zonemgr_t *zmgr);
+/*%<
+ *	Get the number of signing threads.
+ *
+ * Requires:
+ *\li	'zmgr' to be a valid zone manager.
+ */
+
 void
 dns_zonemgr_setnotifyrate(dns_zonemgr_t *zmgr, unsigned int value);
 /*%<
@@ -2144,6 +2169,43 @@ dns_zone_getsignatures(dns_zone_t *zone);
  * Get the number of signatures that will be generated per quantum.
  */
 
+void
+dns_zone_getsigningstats(dns_zone_t *zone, isc_uint64_t *signatures,
+			 isc_uint64_t *usecs);
+/*%<
+ * Get the number of RRSIGs computed while signing the zone or building
+ * an NSEC3 chain for it, and the time spent computing them in
+ * microseconds.  Re-signing of individual RRsets as their signatures
+ * come up for renewal is not counted.
+ *
+ * Requires:
+ *\li	'zone' to be a valid zone.
+ *\li	'signatures' and 'usecs' to be non NULL.
+ */
+
+void
+dns_zone_addxfroutstats(dns_zone_t *zone, isc_uint64_t bytes,
+			isc_uint64_t usecs);
+/*%<
+ * Record an outgoing zone transfer of 'bytes' bytes that took 'usecs'
+ * microseconds to send.
+ *
+ * Requires:
+ *\li	'zone' to be a valid zone.
+ */
+
+void
+dns_zone_getxfroutstats(dns_zone_t *zone, isc_uint64_t *bytes,
+			isc_uint64_t *usecs);
+/*%<
+ * Get the total number of bytes sent in completed outgoing zone
+ * transfers, and the time spent sending them in microseconds.
+ *
+ * Requires:
+ *\li	'zone' to be a valid zone.
+ *\li	'bytes' and 'usecs' to be non NULL.
+ */
+
 isc_result_t
 dns_zone_signwithkey(dns_zone_t *zone, dns_secalg_t algorithm,
 		     isc_uint16_t keyid, isc_boolean_t deleteit);
@@ -2233,6 +2295,26 @@ dns_zone_getadded(dns_zone_t *zone);
  * \li	'zone' to be valid.
  */
 
+void
+dns_zone_setconfighash(dns_zone_t *zone, isc_uint64_t hash);
+/*%
+ * Record a hash of the configuration 'zone' was configured from, so
+ * that a later reconfiguration can tell whether anything changed.
+ * The zone does not interpret the value; 0 means "unknown".
+ *
+ * Requires:
+ * \li	'zone' to be valid.
+ */
+
+isc_uint64_t
+dns_zone_getconfighash(dns_zone_t *zone);
+/*%
+ * Returns the value set by dns_zone_setconfighash(), or 0.
+ *
+ * Requires:
+ * \li	'zone' to be valid.
+ */
+
 void
 dns_zone_setautomatic(dns_zone_t *zone, isc_boolean_t automatic);
 /*%
@@ -31,6 +31,7 @@ dns_iptable_create(isc_mem_t *mctx, dns_iptable_t **target) {
 	isc_mem_attach(mctx, &tab->mctx);
 	isc_refcount_init(&tab->refcount, 1);
 	tab->radix = NULL;
+	tab->generation = 0;
 	tab->magic = DNS_IPTABLE_MAGIC;
 
 	result = isc_radix_create(mctx, &tab->radix, RADIX_MAXBITS);
@@ -78,6 +79,7 @@ dns_iptable_addprefix2(dns_iptable_t *tab, const isc_netaddr_t *addr,
 		isc_refcount_destroy(&pfx.refcount);
 		return(result);
 	}
+	tab->generation++;
 
 	/* If a node already contains data, don't overwrite it */
 	if (pfx.family == AF_UNSPEC) {
@@ -117,6 +119,7 @@ dns_iptable_merge(dns_iptable_t *tab, dns_iptable_t *source, isc_boolean_t pos)
 
 		if (result != ISC_R_SUCCESS)
 			return(result);
+		tab->generation++;
 
 		/*
 		 * If we're negating a nested ACL, then we should
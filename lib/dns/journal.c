@@ -12,6 +12,10 @@
 #include <unistd.h>
 #include <errno.h>
 
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
+
 #include <isc/file.h>
 #include <isc/mem.h>
 #include <isc/print.h>
@@ -46,7 +50,10 @@
  *     serial number.  Unused index entries have an "offset"
  *     field of zero.  The size of the index can vary between
  *     journal files, but does not change during the lifetime
- *     of a file.  The size can be zero.
+ *     of a file.  The size can be zero.  New journals get
+ *     JOURNAL_INDEX_SIZE entries; a compacted journal gets an
+ *     index sized to the number of transactions it holds, up to
+ *     JOURNAL_INDEX_MAX entries.
  *
  *   \li The journal data.  This  consists of one or more transactions.
  *     Each transaction begins with a transaction header of type
@@ -195,6 +202,13 @@ typedef struct {
  */
 #define JOURNAL_HEADER_SIZE 64 /* Bytes. */
 
+/*%
+ * Number of index entries in a newly created journal, and the upper
+ * bound on the index size chosen when a journal is compacted.
+ */
+#define JOURNAL_INDEX_SIZE	56
+#define JOURNAL_INDEX_MAX	8192
+
 /*%
  * The on-disk representation of the journal header.
  * All numbers are stored in big-endian order.
@@ -307,6 +321,10 @@ struct dns_journal {
 	journal_header_t 	header;		/*%< In-core journal header */
 	unsigned char		*rawindex;	/*%< In-core buffer for journal index in on-disk format */
 	journal_pos_t		*index;		/*%< In-core journal index */
+	unsigned int		dirty_lo;	/*%< Index entries changed */
+	unsigned int		dirty_hi;	/*%< since the last write */
+	unsigned char		*map;		/*%< Read-only file mapping */
+	size_t			mapsize;	/*%< Size of 'map' */
 
 	/*% Current transaction state (when writing). */
 	struct {
@@ -382,6 +400,11 @@ static isc_result_t
 journal_seek(dns_journal_t *j, isc_uint32_t offset) {
 	isc_result_t result;
 
+	if (j->map != NULL) {
+		j->offset = offset;
+		return (ISC_R_SUCCESS);
+	}
+
 	result = isc_stdio_seek(j->fp, (off_t)offset, SEEK_SET);
 	if (result != ISC_R_SUCCESS) {
 		isc_log_write(JOURNAL_COMMON_LOGARGS, ISC_LOG_ERROR,
@@ -397,6 +420,15 @@ static isc_result_t
 journal_read(dns_journal_t *j, void *mem, size_t nbytes) {
 	isc_result_t result;
 
+	if (j->map != NULL) {
+		if ((size_t)j->offset > j->mapsize ||
+		    nbytes > j->mapsize - (size_t)j->offset)
+			return (ISC_R_NOMORE);
+		memmove(mem, j->map + j->offset, nbytes);
+		j->offset += (isc_offset_t)nbytes;
+		return (ISC_R_SUCCESS);
+	}
+
 	result = isc_stdio_read(mem, 1, nbytes, j->fp, NULL);
 	if (result != ISC_R_SUCCESS) {
 		if (result == ISC_R_EOF)
@@ -490,12 +522,13 @@ journal_read_rrhdr(dns_journal_t *j, journal_rrhdr_t *rrhdr) {
 }
 
 static isc_result_t
-journal_file_create(isc_mem_t *mctx, const char *filename) {
+journal_file_create(isc_mem_t *mctx, const char *filename,
+		    unsigned int index_size)
+{
 	FILE *fp = NULL;
 	isc_result_t result;
 	journal_header_t header;
 	journal_rawheader_t rawheader;
-	int index_size = 56; /* XXX configurable */
 	int size;
 	void *mem; /* Memory for temporary index image. */
 
@@ -549,6 +582,46 @@ journal_file_create(isc_mem_t *mctx, const char *filename) {
 	return (ISC_R_SUCCESS);
 }
 
+/*
+ * Map a read-only journal into memory, up to the end of its last
+ * committed transaction.  Reads are then served from the mapping,
+ * so walking transaction and RR headers does not cost a seek and a
+ * read system call each.  Data beyond the mapped range, if any, is
+ * being appended by a writer and is never read.  If the file cannot
+ * be mapped, the stdio functions are used instead.
+ */
+static void
+journal_map(dns_journal_t *j) {
+#ifdef HAVE_MMAP
+	void *base;
+	off_t filesize = 0;
+	size_t size;
+	int fd, flags;
+
+	size = (size_t)j->header.end.offset;
+	if (size <= sizeof(journal_rawheader_t))
+		return;
+
+	fd = fileno(j->fp);
+	if (isc_file_getsizefd(fd, &filesize) != ISC_R_SUCCESS ||
+	    filesize < (off_t)size)
+		return;
+
+	flags = MAP_PRIVATE;
+#ifdef MAP_FILE
+	flags |= MAP_FILE;
+#endif
+	base = isc_file_mmap(NULL, size, PROT_READ, flags, fd, 0);
+	if (base == NULL || base == MAP_FAILED)
+		return;
+
+	j->map = base;
+	j->mapsize = size;
+#else
+	UNUSED(j);
+#endif
+}
+
 static isc_result_t
 journal_open(isc_mem_t *mctx, const char *filename, isc_boolean_t writable,
 	     isc_boolean_t create, dns_journal_t **journalp)
@@ -570,6 +643,8 @@ journal_open(isc_mem_t *mctx, const char *filename, isc_boolean_t writable,
 	j->filename = isc_mem_strdup(mctx, filename);
 	j->index = NULL;
 	j->rawindex = NULL;
+	j->map = NULL;
+	j->mapsize = 0;
 
 	if (j->filename == NULL)
 		FAIL(ISC_R_NOMEMORY);
@@ -581,7 +656,8 @@ journal_open(isc_mem_t *mctx, const char *filename, isc_boolean_t writable,
 			isc_log_write(JOURNAL_COMMON_LOGARGS, ISC_LOG_DEBUG(1),
 				      "journal file %s does not exist, "
 				      "creating it", j->filename);
-			CHECK(journal_file_create(mctx, filename));
+			CHECK(journal_file_create(mctx, filename,
+						  JOURNAL_INDEX_SIZE));
 			/*
 			 * Retry.
 			 */
@@ -646,8 +722,13 @@ journal_open(isc_mem_t *mctx, const char *filename, isc_boolean_t writable,
 		}
 		INSIST(p == j->rawindex + rawbytes);
 	}
+	j->dirty_lo = j->header.index_size;
+	j->dirty_hi = 0;
 	j->offset = -1; /* Invalid, must seek explicitly. */
 
+	if (!writable)
+		journal_map(j);
+
 	/*
 	 * Initialize the iterator.
 	 */
@@ -855,6 +936,18 @@ index_find(dns_journal_t *j, isc_uint32_t serial, journal_pos_t *best_guess) {
 	}
 }
 
+/*
+ * Note that index entries 'lo' up to but not including 'hi' have
+ * changed and need to be written out by index_to_disk().
+ */
+static inline void
+index_dirty(dns_journal_t *j, unsigned int lo, unsigned int hi) {
+	if (lo < j->dirty_lo)
+		j->dirty_lo = lo;
+	if (hi > j->dirty_hi)
+		j->dirty_hi = hi;
+}
+
 /*
  * Add a new index entry.  If there is no room, make room by removing
  * the odd-numbered entries and compacting the others into the first
@@ -889,6 +982,7 @@ index_add(dns_journal_t *j, journal_pos_t *pos) {
 			POS_INVALIDATE(j->index[k]);
 			k++;
 		}
+		index_dirty(j, 0, j->header.index_size);
 	}
 	INSIST(i < j->header.index_size);
 	INSIST(! POS_VALID(j->index[i]));
@@ -897,6 +991,7 @@ index_add(dns_journal_t *j, journal_pos_t *pos) {
 	 * Store the new index entry.
 	 */
 	j->index[i] = *pos;
+	index_dirty(j, i, i + 1);
 }
 
 /*
@@ -909,8 +1004,12 @@ index_invalidate(dns_journal_t *j, isc_uint32_t serial) {
 	if (j->index == NULL)
 		return;
 	for (i = 0; i < j->header.index_size; i++) {
-		if (! DNS_SERIAL_GT(serial, j->index[i].serial))
+		if (POS_VALID(j->index[i]) &&
+		    ! DNS_SERIAL_GT(serial, j->index[i].serial))
+		{
 			POS_INVALIDATE(j->index[i]);
+			index_dirty(j, i, i + 1);
+		}
 	}
 }
 
@@ -1241,10 +1340,12 @@ dns_journal_destroy(dns_journal_t **journalp) {
 			    sizeof(journal_pos_t));
 	if (j->it.target.base != NULL)
 		isc_mem_put(j->mctx, j->it.target.base, j->it.target.length);
-	if (j->it.source.base != NULL)
+	if (j->it.source.base != NULL && j->map == NULL)
 		isc_mem_put(j->mctx, j->it.source.base, j->it.source.length);
 	if (j->filename != NULL)
 		isc_mem_free(j->mctx, j->filename);
+	if (j->map != NULL)
+		(void)isc_file_munmap(j->map, j->mapsize);
 	if (j->fp != NULL)
 		(void)isc_stdio_close(j->fp);
 	j->magic = 0;
@@ -1704,8 +1805,20 @@ read_one_rr(dns_journal_t *j) {
 		FAIL(ISC_R_UNEXPECTED);
 	}
 
-	CHECK(size_buffer(j->mctx, &j->it.source, rrhdr.size));
-	CHECK(journal_read(j, j->it.source.base, rrhdr.size));
+	if (j->map != NULL) {
+		/*
+		 * Parse the RR in place.
+		 */
+		if ((size_t)j->offset > j->mapsize ||
+		    rrhdr.size > j->mapsize - (size_t)j->offset)
+			FAIL(ISC_R_NOMORE);
+		isc_buffer_init(&j->it.source, j->map + j->offset,
+				rrhdr.size);
+		j->offset += rrhdr.size;
+	} else {
+		CHECK(size_buffer(j->mctx, &j->it.source, rrhdr.size));
+		CHECK(journal_read(j, j->it.source.base, rrhdr.size));
+	}
 	isc_buffer_add(&j->it.source, rrhdr.size);
 
 	/*
@@ -2097,7 +2210,7 @@ dns_journal_compact(isc_mem_t *mctx, char *filename, isc_uint32_t serial,
 	char *buf = NULL;
 	unsigned int size = 0;
 	isc_result_t result;
-	unsigned int indexend;
+	unsigned int indexend, index_size, count, stride;
 	char newname[1024];
 	char backup[1024];
 	isc_boolean_t is_backup = ISC_FALSE;
@@ -2155,8 +2268,6 @@ dns_journal_compact(isc_mem_t *mctx, char *filename, isc_uint32_t serial,
 		return (ISC_R_SUCCESS);
 	}
 
-	CHECK(journal_open(mctx, newname, ISC_TRUE, ISC_TRUE, &j2));
-
 	/*
 	 * Remove overhead so space test below can succeed.
 	 */
@@ -2202,6 +2313,25 @@ dns_journal_compact(isc_mem_t *mctx, char *filename, isc_uint32_t serial,
 	 */
 	copy_length = j1->header.end.offset - best_guess.offset;
 
+	/*
+	 * Size the new index to the number of transactions being kept,
+	 * so that deep serial histories stay quick to search.
+	 */
+	count = 0;
+	current_pos = best_guess;
+	while (current_pos.serial != j1->header.end.serial) {
+		CHECK(journal_next(j1, &current_pos));
+		count++;
+	}
+	index_size = ISC_MIN(ISC_MAX(count, JOURNAL_INDEX_SIZE),
+			     JOURNAL_INDEX_MAX);
+
+	(void)isc_file_remove(newname);
+	CHECK(journal_file_create(mctx, newname, index_size));
+	CHECK(journal_open(mctx, newname, ISC_TRUE, ISC_FALSE, &j2));
+	indexend = sizeof(journal_rawheader_t) +
+		   index_size * sizeof(journal_rawpos_t);
+
 	if (copy_length != 0) {
 		/*
 		 * Copy best_guess to end into space just freed.
@@ -2245,11 +2375,15 @@ dns_journal_compact(isc_mem_t *mctx, char *filename, isc_uint32_t serial,
 		CHECK(journal_fsync(j2));
 
 		/*
-		 * Build new index.
+		 * Build new index.  The entries are spread evenly over
+		 * the transactions that were kept, rather than added one
+		 * at a time, which would leave old ones sparse.
 		 */
+		stride = (count + index_size - 1) / index_size;
 		current_pos = j2->header.begin;
-		while (current_pos.serial != j2->header.end.serial) {
-			index_add(j2, &current_pos);
+		for (i = 0; current_pos.serial != j2->header.end.serial; i++) {
+			if (i % stride == 0)
+				index_add(j2, &current_pos);
 			CHECK(journal_next(j2, &current_pos));
 		}
 
@@ -2312,28 +2446,39 @@ dns_journal_compact(isc_mem_t *mctx, char *filename, isc_uint32_t serial,
 	return (result);
 }
 
+/*
+ * Write the index entries that have changed since the last call
+ * to disk.  A commit normally changes only the entry it adds, so
+ * this keeps the cost of a commit independent of the index size.
+ */
 static isc_result_t
 index_to_disk(dns_journal_t *j) {
 	isc_result_t result = ISC_R_SUCCESS;
 
-	if (j->header.index_size != 0) {
+	if (j->header.index_size != 0 && j->dirty_lo < j->dirty_hi) {
 		unsigned int i;
-		unsigned char *p;
+		unsigned char *p, *start;
 		unsigned int rawbytes;
 
-		rawbytes = j->header.index_size * sizeof(journal_rawpos_t);
+		INSIST(j->dirty_hi <= j->header.index_size);
+		rawbytes = (j->dirty_hi - j->dirty_lo) *
+			   sizeof(journal_rawpos_t);
 
-		p = j->rawindex;
-		for (i = 0; i < j->header.index_size; i++) {
+		start = p = j->rawindex +
+			    j->dirty_lo * sizeof(journal_rawpos_t);
+		for (i = j->dirty_lo; i < j->dirty_hi; i++) {
 			encode_uint32(j->index[i].serial, p);
 			p += 4;
 			encode_uint32(j->index[i].offset, p);
 			p += 4;
 		}
-		INSIST(p == j->rawindex + rawbytes);
+		INSIST(p == start + rawbytes);
 
-		CHECK(journal_seek(j, sizeof(journal_rawheader_t)));
-		CHECK(journal_write(j, j->rawindex, rawbytes));
+		CHECK(journal_seek(j, sizeof(journal_rawheader_t) +
+				      j->dirty_lo * sizeof(journal_rawpos_t)));
+		CHECK(journal_write(j, start, rawbytes));
+		j->dirty_lo = j->header.index_size;
+		j->dirty_hi = 0;
 	}
 failure:
 	return (result);
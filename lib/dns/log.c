@@ -81,6 +81,7 @@ LIBDNS_EXTERNAL_DATA isc_logmodule_t dns_modules[] = {
 	{ "dns/dyndb",		0 },
 	{ "dns/dnstap",		0 },
 	{ "dns/ssu",		0 },
+	{ "dns/qlog",		0 },
 	{ NULL, 		0 }
 };
 
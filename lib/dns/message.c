@@ -883,13 +883,15 @@ dns_message_findtype(const dns_name_t *name, dns_rdatatype_t type,
  */
 static isc_result_t
 getname(dns_name_t *name, isc_buffer_t *source, dns_message_t *msg,
-	dns_decompress_t *dctx)
+	dns_decompress_t *dctx, unsigned int options)
 {
 	isc_buffer_t *scratch;
 	isc_result_t result;
 	unsigned int tries;
+	unsigned char *wire;
 
 	scratch = currentbuffer(msg);
+	wire = isc_buffer_current(source);
 
 	/*
 	 * First try:  use current buffer.
@@ -910,6 +912,20 @@ getname(dns_name_t *name, isc_buffer_t *source, dns_message_t *msg,
 			scratch = currentbuffer(msg);
 			dns_name_reset(name);
 		} else {
+			/*
+			 * A name that used no compression pointer is
+			 * identical to its wire form, which the message
+			 * owns; point at it and give the scratch space back.
+			 */
+			if (result == ISC_R_SUCCESS &&
+			    (options & DNS_MESSAGEPARSE_WIREREF) != 0 &&
+			    name->length ==
+			    (unsigned int)((unsigned char *)
+					   isc_buffer_current(source) - wire))
+			{
+				isc_buffer_subtract(scratch, name->length);
+				name->ndata = wire;
+			}
 			return (result);
 		}
 	}
@@ -921,14 +937,16 @@ getname(dns_name_t *name, isc_buffer_t *source, dns_message_t *msg,
 static isc_result_t
 getrdata(isc_buffer_t *source, dns_message_t *msg, dns_decompress_t *dctx,
 	 dns_rdataclass_t rdclass, dns_rdatatype_t rdtype,
-	 unsigned int rdatalen, dns_rdata_t *rdata)
+	 unsigned int rdatalen, dns_rdata_t *rdata, unsigned int options)
 {
 	isc_buffer_t *scratch;
 	isc_result_t result;
 	unsigned int tries;
 	unsigned int trysize;
+	unsigned char *wire;
 
 	scratch = currentbuffer(msg);
+	wire = isc_buffer_current(source);
 
 	isc_buffer_setactive(source, rdatalen);
 
@@ -966,6 +984,19 @@ getrdata(isc_buffer_t *source, dns_message_t *msg, dns_decompress_t *dctx,
 
 			scratch = currentbuffer(msg);
 		} else {
+			/*
+			 * If decompression left the rdata byte-for-byte
+			 * identical to the wire, reference the wire copy
+			 * and release the scratch space.
+			 */
+			if (result == ISC_R_SUCCESS &&
+			    (options & DNS_MESSAGEPARSE_WIREREF) != 0 &&
+			    rdata->length == rdatalen && rdatalen != 0 &&
+			    memcmp(rdata->data, wire, rdatalen) == 0)
+			{
+				isc_buffer_subtract(scratch, rdatalen);
+				rdata->data = wire;
+			}
 			return (result);
 		}
 	}
@@ -1027,7 +1058,7 @@ getquestions(isc_buffer_t *source, dns_message_t *msg, dns_decompress_t *dctx,
 		 */
 		isc_buffer_remainingregion(source, &r);
 		isc_buffer_setactive(source, r.length);
-		result = getname(name, source, msg, dctx);
+		result = getname(name, source, msg, dctx, options);
 		if (result != ISC_R_SUCCESS)
 			goto cleanup;
 
@@ -1265,7 +1296,7 @@ getsection(isc_buffer_t *source, dns_message_t *msg, dns_decompress_t *dctx,
 		 */
 		isc_buffer_remainingregion(source, &r);
 		isc_buffer_setactive(source, r.length);
-		result = getname(name, source, msg, dctx);
+		result = getname(name, source, msg, dctx, options);
 		if (result != ISC_R_SUCCESS)
 			goto cleanup;
 
@@ -1409,10 +1440,10 @@ getsection(isc_buffer_t *source, dns_message_t *msg, dns_decompress_t *dctx,
 			   msg->opcode == dns_opcode_update &&
 			   sectionid == DNS_SECTION_UPDATE) {
 			result = getrdata(source, msg, dctx, msg->rdclass,
-					  rdtype, rdatalen, rdata);
+					  rdtype, rdatalen, rdata, options);
 		} else
 			result = getrdata(source, msg, dctx, rdclass,
-					  rdtype, rdatalen, rdata);
+					  rdtype, rdatalen, rdata, options);
 		if (result != ISC_R_SUCCESS)
 			goto cleanup;
 		rdata->rdclass = rdclass;
@@ -1654,10 +1685,8 @@ getsection(isc_buffer_t *source, dns_message_t *msg, dns_decompress_t *dctx,
 	return (result);
 }
 
-isc_result_t
-dns_message_parse(dns_message_t *msg, isc_buffer_t *source,
-		  unsigned int options)
-{
+static isc_result_t
+parsemessage(dns_message_t *msg, isc_buffer_t *source, unsigned int options) {
 	isc_region_t r;
 	dns_decompress_t dctx;
 	isc_result_t ret;
@@ -1666,10 +1695,6 @@ dns_message_parse(dns_message_t *msg, isc_buffer_t *source,
 	isc_boolean_t seen_problem;
 	isc_boolean_t ignore_tc;
 
-	REQUIRE(DNS_MESSAGE_VALID(msg));
-	REQUIRE(source != NULL);
-	REQUIRE(msg->from_to_wire == DNS_MESSAGE_INTENTPARSE);
-
 	seen_problem = ISC_FALSE;
 	ignore_tc = ISC_TF(options & DNS_MESSAGEPARSE_IGNORETRUNCATION);
 
@@ -1772,6 +1797,48 @@ dns_message_parse(dns_message_t *msg, isc_buffer_t *source,
 	return (ISC_R_SUCCESS);
 }
 
+isc_result_t
+dns_message_parse(dns_message_t *msg, isc_buffer_t *source,
+		  unsigned int options)
+{
+	isc_result_t result;
+	isc_buffer_t *wire = NULL;
+	unsigned int length;
+
+	REQUIRE(DNS_MESSAGE_VALID(msg));
+	REQUIRE(source != NULL);
+	REQUIRE(msg->from_to_wire == DNS_MESSAGE_INTENTPARSE);
+
+	if ((options & DNS_MESSAGEPARSE_WIREREF) == 0)
+		return (parsemessage(msg, source, options));
+
+	/*
+	 * Take a single message-owned copy of the wire data so that
+	 * names and rdata which need no decompression can reference it
+	 * for as long as the message contents are valid, rather than
+	 * each being copied into the scratchpad.
+	 */
+	length = isc_buffer_usedlength(source);
+	result = isc_buffer_allocate(msg->mctx, &wire, ISC_MAX(length, 1));
+	if (result != ISC_R_SUCCESS)
+		return (result);
+	isc_buffer_putmem(wire, isc_buffer_base(source), length);
+	wire->current = source->current;
+	wire->active = source->active;
+	dns_message_takebuffer(msg, &wire);
+
+	wire = ISC_LIST_TAIL(msg->cleanup);
+	result = parsemessage(msg, wire, options);
+
+	/*
+	 * Leave the caller's buffer consumed as if it had been parsed.
+	 */
+	source->current = wire->current;
+	source->active = wire->active;
+
+	return (result);
+}
+
 isc_result_t
 dns_message_renderbegin(dns_message_t *msg, dns_compress_t *cctx,
 			isc_buffer_t *buffer)
@@ -0,0 +1,901 @@
+/*
+ * Copyright (C) 2018  Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*! \file */
+
+#include <config.h>
+
+#include <stdio.h>
+
+#include <isc/buffer.h>
+#include <isc/event.h>
+#include <isc/magic.h>
+#include <isc/mem.h>
+#include <isc/mutex.h>
+#include <isc/netaddr.h>
+#include <isc/print.h>
+#include <isc/refcount.h>
+#include <isc/stdio.h>
+#include <isc/string.h>
+#include <isc/task.h>
+#include <isc/timer.h>
+#include <isc/util.h>
+
+#include <dns/compress.h>
+#include <dns/events.h>
+#include <dns/log.h>
+#include <dns/name.h>
+#include <dns/qlog.h>
+#include <dns/rcode.h>
+#include <dns/rdataclass.h>
+#include <dns/rdatatype.h>
+#include <dns/result.h>
+
+#define QLOG_MAGIC		ISC_MAGIC('Q', 'L', 'o', 'g')
+#define VALID_QLOG(q)		ISC_MAGIC_VALID(q, QLOG_MAGIC)
+
+#define QLOGREADER_MAGIC	ISC_MAGIC('Q', 'L', 'o', 'R')
+#define VALID_QLOGREADER(r)	ISC_MAGIC_VALID(r, QLOGREADER_MAGIC)
+
+#define QLOG_HEADERSIZE		16
+#define QLOG_RECORDHDRSIZE	4	/* type, length and view id */
+#define QLOG_QUERYSIZE		40	/* query record without the qname */
+#define QLOG_MAXVIEWS		65536
+
+#define QLOG_TYPE_QUERY		1
+#define QLOG_TYPE_VIEW		2
+
+#define QLOG_BUFSIZE		(64 * 1024)	/* write buffer */
+#define QLOG_FLUSHINTERVAL	1		/* seconds */
+
+typedef struct qlogbuf qlogbuf_t;
+
+struct qlogbuf {
+	size_t			used;
+	ISC_LINK(qlogbuf_t)	link;
+	unsigned char		data[QLOG_BUFSIZE];
+};
+
+/*
+ * Queries are added to 'buf' under 'lock'.  A full buffer is queued
+ * on 'full' and written out by the log's task, which holds only
+ * 'filelock' while it writes so that queries are not held up by the
+ * file I/O.  'filelock' is always taken before 'lock'.
+ */
+struct dns_qlog {
+	unsigned int		magic;
+	isc_mem_t		*mctx;
+	isc_refcount_t		refcount;
+	isc_mutex_t		lock;
+	isc_mutex_t		filelock;
+	char			*path;
+	FILE			*fp;		/* locked by filelock */
+	isc_boolean_t		failed;		/* last write failed */
+	qlogbuf_t		*buf;		/* being filled */
+	qlogbuf_t		*spare;
+	ISC_LIST(qlogbuf_t)	full;		/* waiting to be written */
+	isc_boolean_t		writing;	/* writeevent sent */
+	unsigned int		dropped;
+	char			**views;
+	unsigned int		nviews;
+	unsigned int		maxviews;
+	isc_task_t		*task;
+	isc_timer_t		*timer;
+	isc_event_t		writeevent;
+	isc_event_t		destroyevent;
+};
+
+struct dns_qlogreader {
+	unsigned int		magic;
+	isc_mem_t		*mctx;
+	FILE			*fp;
+	char			**views;	/* indexed by view id */
+	unsigned int		maxviews;
+};
+
+/*
+ * Write 'buf' to the file.  Called with 'filelock' held.
+ */
+static void
+qlog_writebuf(dns_qlog_t *qlog, qlogbuf_t *buf) {
+	isc_result_t result;
+
+	if (buf->used == 0 || qlog->fp == NULL)
+		return;
+
+	result = isc_stdio_write(buf->data, 1, buf->used, qlog->fp, NULL);
+	if (result == ISC_R_SUCCESS)
+		result = isc_stdio_flush(qlog->fp);
+	if (result != ISC_R_SUCCESS && !qlog->failed) {
+		isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
+			      DNS_LOGMODULE_QLOG, ISC_LOG_ERROR,
+			      "binary query log '%s': write failed: %s",
+			      qlog->path, isc_result_totext(result));
+	}
+	qlog->failed = ISC_TF(result != ISC_R_SUCCESS);
+}
+
+/*
+ * Write out the queued buffers in order.  Called with 'filelock'
+ * held; 'lock' is only held while taking a buffer off the queue.
+ */
+static void
+qlog_writequeued(dns_qlog_t *qlog) {
+	qlogbuf_t *buf;
+	unsigned int dropped;
+
+	LOCK(&qlog->lock);
+	while ((buf = ISC_LIST_HEAD(qlog->full)) != NULL) {
+		ISC_LIST_UNLINK(qlog->full, buf, link);
+		UNLOCK(&qlog->lock);
+
+		qlog_writebuf(qlog, buf);
+
+		LOCK(&qlog->lock);
+		if (qlog->spare == NULL)
+			qlog->spare = buf;
+		else
+			isc_mem_put(qlog->mctx, buf, sizeof(*buf));
+	}
+	dropped = qlog->dropped;
+	qlog->dropped = 0;
+	UNLOCK(&qlog->lock);
+
+	if (dropped != 0) {
+		isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
+			      DNS_LOGMODULE_QLOG, ISC_LOG_ERROR,
+			      "binary query log '%s': %u records dropped: "
+			      "out of memory", qlog->path, dropped);
+	}
+}
+
+static void
+qlog_write(isc_task_t *task, isc_event_t *event) {
+	dns_qlog_t *qlog = event->ev_arg;
+
+	REQUIRE(VALID_QLOG(qlog));
+
+	UNUSED(task);
+
+	LOCK(&qlog->lock);
+	qlog->writing = ISC_FALSE;
+	UNLOCK(&qlog->lock);
+
+	LOCK(&qlog->filelock);
+	qlog_writequeued(qlog);
+	UNLOCK(&qlog->filelock);
+}
+
+/*
+ * Queue the current buffer to be written and start a new one.
+ * Called with 'lock' held.
+ */
+static isc_result_t
+qlog_queue(dns_qlog_t *qlog) {
+	qlogbuf_t *buf;
+
+	if (qlog->buf->used == 0)
+		return (ISC_R_SUCCESS);
+
+	buf = qlog->spare;
+	if (buf != NULL) {
+		qlog->spare = NULL;
+	} else {
+		buf = isc_mem_get(qlog->mctx, sizeof(*buf));
+		if (buf == NULL)
+			return (ISC_R_NOMEMORY);
+	}
+	buf->used = 0;
+	ISC_LINK_INIT(buf, link);
+
+	ISC_LIST_APPEND(qlog->full, qlog->buf, link);
+	qlog->buf = buf;
+	return (ISC_R_SUCCESS);
+}
+
+static void
+qlog_append(dns_qlog_t *qlog, const unsigned char *data, size_t length) {
+	isc_event_t *event;
+
+	if (qlog->buf->used + length > QLOG_BUFSIZE) {
+		if (qlog_queue(qlog) != ISC_R_SUCCESS) {
+			qlog->dropped++;
+			return;
+		}
+		if (!qlog->writing) {
+			qlog->writing = ISC_TRUE;
+			ISC_EVENT_INIT(&qlog->writeevent,
+				       sizeof(qlog->writeevent), 0, NULL,
+				       DNS_EVENT_QLOGWRITE, qlog_write, qlog,
+				       NULL, NULL, NULL);
+			event = &qlog->writeevent;
+			isc_task_send(qlog->task, &event);
+		}
+	}
+	memmove(qlog->buf->data + qlog->buf->used, data, length);
+	qlog->buf->used += length;
+}
+
+static size_t
+qlog_viewrecord(dns_qlog_t *qlog, unsigned int id, unsigned char *data) {
+	size_t length;
+
+	length = strlen(qlog->views[id]);
+	if (length > 255)
+		length = 255;
+
+	data[0] = QLOG_TYPE_VIEW;
+	data[1] = (unsigned char)length;
+	data[2] = (id >> 8) & 0xff;
+	data[3] = id & 0xff;
+	memmove(data + QLOG_RECORDHDRSIZE, qlog->views[id], length);
+	return (QLOG_RECORDHDRSIZE + length);
+}
+
+static void
+qlog_putview(dns_qlog_t *qlog, unsigned int id) {
+	unsigned char data[QLOG_RECORDHDRSIZE + 255];
+
+	qlog_append(qlog, data, qlog_viewrecord(qlog, id, data));
+}
+
+/*
+ * Open (or reopen) the log file.  A new file gets a header, and the
+ * view table is repeated so the file can be read on its own; both
+ * are written directly, ahead of anything still in 'buf'.  Called
+ * with 'filelock' and 'lock' held.
+ */
+static isc_result_t
+qlog_openfile(dns_qlog_t *qlog) {
+	unsigned char header[QLOG_HEADERSIZE];
+	unsigned char data[QLOG_RECORDHDRSIZE + 255];
+	isc_result_t result;
+	off_t offset = 0;
+	unsigned int i;
+
+	INSIST(qlog->fp == NULL);
+
+	result = isc_stdio_open(qlog->path, "ab", &qlog->fp);
+	if (result != ISC_R_SUCCESS)
+		return (result);
+
+	result = isc_stdio_seek(qlog->fp, 0, SEEK_END);
+	if (result == ISC_R_SUCCESS)
+		result = isc_stdio_tell(qlog->fp, &offset);
+	if (result == ISC_R_SUCCESS && offset == 0) {
+		memset(header, 0, sizeof(header));
+		memmove(header, DNS_QLOG_MAGIC, sizeof(DNS_QLOG_MAGIC) - 1);
+		result = isc_stdio_write(header, sizeof(header), 1,
+					 qlog->fp, NULL);
+	}
+	for (i = 0; result == ISC_R_SUCCESS && i < qlog->nviews; i++)
+		result = isc_stdio_write(data, qlog_viewrecord(qlog, i, data),
+					 1, qlog->fp, NULL);
+	if (result == ISC_R_SUCCESS)
+		result = isc_stdio_flush(qlog->fp);
+	if (result != ISC_R_SUCCESS) {
+		(void)isc_stdio_close(qlog->fp);
+		qlog->fp = NULL;
+		return (result);
+	}
+
+	return (ISC_R_SUCCESS);
+}
+
+static void
+qlog_tick(isc_task_t *task, isc_event_t *event) {
+	dns_qlog_t *qlog = event->ev_arg;
+
+	REQUIRE(VALID_QLOG(qlog));
+
+	UNUSED(task);
+
+	isc_event_free(&event);
+
+	LOCK(&qlog->filelock);
+	LOCK(&qlog->lock);
+	(void)qlog_queue(qlog);
+	UNLOCK(&qlog->lock);
+	qlog_writequeued(qlog);
+	UNLOCK(&qlog->filelock);
+}
+
+/*
+ * Runs in the log's own task, so that it cannot overlap with a
+ * flush that was already under way when the last reference went.
+ */
+static void
+qlog_destroy(isc_task_t *task, isc_event_t *event) {
+	dns_qlog_t *qlog = event->ev_arg;
+	unsigned int i;
+
+	REQUIRE(VALID_QLOG(qlog));
+
+	UNUSED(task);
+
+	if (qlog->buf->used != 0) {
+		ISC_LIST_APPEND(qlog->full, qlog->buf, link);
+		qlog->buf = NULL;
+	}
+	qlog_writequeued(qlog);
+	if (qlog->fp != NULL)
+		(void)isc_stdio_close(qlog->fp);
+
+	for (i = 0; i < qlog->nviews; i++)
+		isc_mem_free(qlog->mctx, qlog->views[i]);
+	if (qlog->views != NULL)
+		isc_mem_put(qlog->mctx, qlog->views,
+			    qlog->maxviews * sizeof(char *));
+	if (qlog->buf != NULL)
+		isc_mem_put(qlog->mctx, qlog->buf, sizeof(*qlog->buf));
+	if (qlog->spare != NULL)
+		isc_mem_put(qlog->mctx, qlog->spare, sizeof(*qlog->spare));
+	isc_mem_free(qlog->mctx, qlog->path);
+
+	isc_task_detach(&qlog->task);
+	DESTROYLOCK(&qlog->filelock);
+	DESTROYLOCK(&qlog->lock);
+	isc_refcount_destroy(&qlog->refcount);
+	qlog->magic = 0;
+	isc_mem_putanddetach(&qlog->mctx, qlog, sizeof(*qlog));
+}
+
+isc_result_t
+dns_qlog_create(isc_mem_t *mctx, isc_taskmgr_t *taskmgr,
+		isc_timermgr_t *timermgr, const char *path,
+		dns_qlog_t **qlogp)
+{
+	dns_qlog_t *qlog;
+	isc_interval_t interval;
+	isc_result_t result;
+
+	REQUIRE(mctx != NULL);
+	REQUIRE(taskmgr != NULL);
+	REQUIRE(timermgr != NULL);
+	REQUIRE(path != NULL);
+	REQUIRE(qlogp != NULL && *qlogp == NULL);
+
+	qlog = isc_mem_get(mctx, sizeof(*qlog));
+	if (qlog == NULL)
+		return (ISC_R_NOMEMORY);
+	memset(qlog, 0, sizeof(*qlog));
+
+	result = isc_mutex_init(&qlog->lock);
+	if (result != ISC_R_SUCCESS)
+		goto cleanup_qlog;
+
+	result = isc_mutex_init(&qlog->filelock);
+	if (result != ISC_R_SUCCESS)
+		goto cleanup_lock;
+
+	result = isc_refcount_init(&qlog->refcount, 1);
+	if (result != ISC_R_SUCCESS)
+		goto cleanup_filelock;
+
+	qlog->path = isc_mem_strdup(mctx, path);
+	if (qlog->path == NULL) {
+		result = ISC_R_NOMEMORY;
+		goto cleanup_refcount;
+	}
+
+	qlog->buf = isc_mem_get(mctx, sizeof(*qlog->buf));
+	if (qlog->buf == NULL) {
+		result = ISC_R_NOMEMORY;
+		goto cleanup_path;
+	}
+	qlog->buf->used = 0;
+	ISC_LINK_INIT(qlog->buf, link);
+	ISC_LIST_INIT(qlog->full);
+
+	result = qlog_openfile(qlog);
+	if (result != ISC_R_SUCCESS)
+		goto cleanup_buf;
+
+	result = isc_task_create(taskmgr, 0, &qlog->task);
+	if (result != ISC_R_SUCCESS)
+		goto cleanup_file;
+	isc_task_setname(qlog->task, "qlog", qlog);
+
+	isc_interval_set(&interval, QLOG_FLUSHINTERVAL, 0);
+	result = isc_timer_create(timermgr, isc_timertype_ticker, NULL,
+				  &interval, qlog->task, qlog_tick, qlog,
+				  &qlog->timer);
+	if (result != ISC_R_SUCCESS)
+		goto cleanup_task;
+
+	ISC_EVENT_INIT(&qlog->destroyevent, sizeof(qlog->destroyevent), 0,
+		       NULL, DNS_EVENT_QLOGDESTROY, qlog_destroy, qlog,
+		       NULL, NULL, NULL);
+
+	isc_mem_attach(mctx, &qlog->mctx);
+	qlog->magic = QLOG_MAGIC;
+	*qlogp = qlog;
+	return (ISC_R_SUCCESS);
+
+ cleanup_task:
+	isc_task_detach(&qlog->task);
+ cleanup_file:
+	(void)isc_stdio_close(qlog->fp);
+ cleanup_buf:
+	isc_mem_put(mctx, qlog->buf, sizeof(*qlog->buf));
+ cleanup_path:
+	isc_mem_free(mctx, qlog->path);
+ cleanup_refcount:
+	isc_refcount_decrement(&qlog->refcount, NULL);
+	isc_refcount_destroy(&qlog->refcount);
+ cleanup_filelock:
+	DESTROYLOCK(&qlog->filelock);
+ cleanup_lock:
+	DESTROYLOCK(&qlog->lock);
+ cleanup_qlog:
+	isc_mem_put(mctx, qlog, sizeof(*qlog));
+	return (result);
+}
+
+void
+dns_qlog_attach(dns_qlog_t *source, dns_qlog_t **targetp) {
+	REQUIRE(VALID_QLOG(source));
+	REQUIRE(targetp != NULL && *targetp == NULL);
+
+	isc_refcount_increment(&source->refcount, NULL);
+	*targetp = source;
+}
+
+void
+dns_qlog_detach(dns_qlog_t **qlogp) {
+	dns_qlog_t *qlog;
+	isc_event_t *event;
+	unsigned int refs;
+
+	REQUIRE(qlogp != NULL && VALID_QLOG(*qlogp));
+
+	qlog = *qlogp;
+	*qlogp = NULL;
+
+	isc_refcount_decrement(&qlog->refcount, &refs);
+	if (refs == 0) {
+		isc_timer_detach(&qlog->timer);
+		event = &qlog->destroyevent;
+		isc_task_send(qlog->task, &event);
+	}
+}
+
+const char *
+dns_qlog_getpath(dns_qlog_t *qlog) {
+	REQUIRE(VALID_QLOG(qlog));
+
+	return (qlog->path);
+}
+
+isc_result_t
+dns_qlog_reopen(dns_qlog_t *qlog) {
+	isc_result_t result;
+
+	REQUIRE(VALID_QLOG(qlog));
+
+	/*
+	 * Everything logged so far goes to the old file.
+	 */
+	LOCK(&qlog->filelock);
+	LOCK(&qlog->lock);
+	(void)qlog_queue(qlog);
+	UNLOCK(&qlog->lock);
+	qlog_writequeued(qlog);
+	if (qlog->fp != NULL) {
+		(void)isc_stdio_close(qlog->fp);
+		qlog->fp = NULL;
+	}
+	LOCK(&qlog->lock);
+	result = qlog_openfile(qlog);
+	qlog->failed = ISC_FALSE;
+	UNLOCK(&qlog->lock);
+	UNLOCK(&qlog->filelock);
+
+	return (result);
+}
+
+isc_result_t
+dns_qlog_addview(dns_qlog_t *qlog, const char *name, isc_uint16_t *idp) {
+	isc_result_t result = ISC_R_SUCCESS;
+	unsigned int i;
+
+	REQUIRE(VALID_QLOG(qlog));
+	REQUIRE(name != NULL);
+	REQUIRE(idp != NULL);
+
+	LOCK(&qlog->lock);
+	for (i = 0; i < qlog->nviews; i++) {
+		if (strcmp(qlog->views[i], name) == 0)
+			goto done;
+	}
+
+	if (qlog->nviews == QLOG_MAXVIEWS) {
+		result = ISC_R_NOSPACE;
+		goto unlock;
+	}
+
+	if (qlog->nviews == qlog->maxviews) {
+		unsigned int newmax = ISC_MAX(qlog->maxviews * 2, 8);
+		char **views;
+
+		newmax = ISC_MIN(newmax, QLOG_MAXVIEWS);
+		views = isc_mem_get(qlog->mctx, newmax * sizeof(char *));
+		if (views == NULL) {
+			result = ISC_R_NOMEMORY;
+			goto unlock;
+		}
+		if (qlog->views != NULL) {
+			memmove(views, qlog->views,
+				qlog->nviews * sizeof(char *));
+			isc_mem_put(qlog->mctx, qlog->views,
+				    qlog->maxviews * sizeof(char *));
+		}
+		qlog->views = views;
+		qlog->maxviews = newmax;
+	}
+
+	qlog->views[i] = isc_mem_strdup(qlog->mctx, name);
+	if (qlog->views[i] == NULL) {
+		result = ISC_R_NOMEMORY;
+		goto unlock;
+	}
+	qlog->nviews++;
+	qlog_putview(qlog, i);
+
+ done:
+	*idp = (isc_uint16_t)i;
+ unlock:
+	UNLOCK(&qlog->lock);
+	return (result);
+}
+
+void
+dns_qlog_write(dns_qlog_t *qlog, isc_uint16_t viewid, const isc_time_t *when,
+	       const isc_sockaddr_t *client, const dns_name_t *qname,
+	       dns_rdataclass_t qclass, dns_rdatatype_t qtype,
+	       unsigned int flags, unsigned int ednsversion,
+	       dns_rcode_t rcode)
+{
+	unsigned char data[QLOG_QUERYSIZE + DNS_NAME_MAXWIRE];
+	unsigned char addr[16];
+	unsigned char family = 0;
+	isc_netaddr_t netaddr;
+	isc_region_t r;
+	isc_buffer_t b;
+
+	REQUIRE(VALID_QLOG(qlog));
+	REQUIRE(when != NULL);
+	REQUIRE(client != NULL);
+	REQUIRE(qname != NULL && dns_name_isabsolute(qname));
+
+	memset(addr, 0, sizeof(addr));
+	isc_netaddr_fromsockaddr(&netaddr, client);
+	switch (netaddr.family) {
+	case AF_INET:
+		family = 4;
+		memmove(addr, &netaddr.type.in, 4);
+		break;
+	case AF_INET6:
+		family = 6;
+		memmove(addr, &netaddr.type.in6, 16);
+		break;
+	}
+
+	dns_name_toregion(qname, &r);
+
+	isc_buffer_init(&b, data, sizeof(data));
+	isc_buffer_putuint8(&b, QLOG_TYPE_QUERY);
+	isc_buffer_putuint8(&b, (isc_uint8_t)r.length);
+	isc_buffer_putuint16(&b, viewid);
+	isc_buffer_putuint32(&b, isc_time_seconds(when));
+	isc_buffer_putuint32(&b, isc_time_nanoseconds(when));
+	isc_buffer_putuint16(&b, qtype);
+	isc_buffer_putuint16(&b, qclass);
+	isc_buffer_putuint16(&b, (isc_uint16_t)flags);
+	isc_buffer_putuint16(&b, rcode);
+	isc_buffer_putuint16(&b, isc_sockaddr_getport(client));
+	isc_buffer_putuint8(&b, family);
+	isc_buffer_putuint8(&b, (isc_uint8_t)ednsversion);
+	isc_buffer_putmem(&b, addr, sizeof(addr));
+	isc_buffer_putmem(&b, r.base, r.length);
+
+	LOCK(&qlog->lock);
+	qlog_append(qlog, data, isc_buffer_usedlength(&b));
+	UNLOCK(&qlog->lock);
+}
+
+static isc_result_t
+readrecord(FILE *fp, void *buf, size_t length, isc_boolean_t first) {
+	isc_result_t result;
+	size_t n = 0;
+
+	if (length == 0)
+		return (ISC_R_SUCCESS);
+
+	result = isc_stdio_read(buf, 1, length, fp, &n);
+	if (result == ISC_R_EOF)
+		return ((first && n == 0) ? ISC_R_NOMORE :
+					    ISC_R_UNEXPECTEDEND);
+	return (result);
+}
+
+isc_result_t
+dns_qlog_open(isc_mem_t *mctx, const char *filename,
+	      dns_qlogreader_t **readerp)
+{
+	unsigned char header[QLOG_HEADERSIZE];
+	dns_qlogreader_t *reader;
+	isc_result_t result;
+	FILE *fp = NULL;
+
+	REQUIRE(mctx != NULL);
+	REQUIRE(filename != NULL);
+	REQUIRE(readerp != NULL && *readerp == NULL);
+
+	result = isc_stdio_open(filename, "rb", &fp);
+	if (result != ISC_R_SUCCESS)
+		return (result);
+
+	result = readrecord(fp, header, sizeof(header), ISC_FALSE);
+	if (result == ISC_R_UNEXPECTEDEND ||
+	    (result == ISC_R_SUCCESS &&
+	     memcmp(header, DNS_QLOG_MAGIC, sizeof(DNS_QLOG_MAGIC) - 1) != 0))
+	{
+		result = DNS_R_FORMERR;
+	}
+	if (result != ISC_R_SUCCESS)
+		goto cleanup;
+
+	reader = isc_mem_get(mctx, sizeof(*reader));
+	if (reader == NULL) {
+		result = ISC_R_NOMEMORY;
+		goto cleanup;
+	}
+	reader->mctx = NULL;
+	isc_mem_attach(mctx, &reader->mctx);
+	reader->fp = fp;
+	reader->views = NULL;
+	reader->maxviews = 0;
+	reader->magic = QLOGREADER_MAGIC;
+
+	*readerp = reader;
+	return (ISC_R_SUCCESS);
+
+ cleanup:
+	(void)isc_stdio_close(fp);
+	return (result);
+}
+
+static isc_result_t
+setview(dns_qlogreader_t *reader, unsigned int id, const unsigned char *name,
+	size_t length)
+{
+	char *view;
+
+	if (id >= reader->maxviews) {
+		unsigned int newmax = ISC_MAX(reader->maxviews * 2, 8);
+		char **views;
+
+		while (newmax <= id)
+			newmax *= 2;
+		views = isc_mem_get(reader->mctx, newmax * sizeof(char *));
+		if (views == NULL)
+			return (ISC_R_NOMEMORY);
+		memset(views, 0, newmax * sizeof(char *));
+		if (reader->views != NULL) {
+			memmove(views, reader->views,
+				reader->maxviews * sizeof(char *));
+			isc_mem_put(reader->mctx, reader->views,
+				    reader->maxviews * sizeof(char *));
+		}
+		reader->views = views;
+		reader->maxviews = newmax;
+	}
+
+	view = isc_mem_allocate(reader->mctx, length + 1);
+	if (view == NULL)
+		return (ISC_R_NOMEMORY);
+	memmove(view, name, length);
+	view[length] = '\0';
+
+	if (reader->views[id] != NULL)
+		isc_mem_free(reader->mctx, reader->views[id]);
+	reader->views[id] = view;
+
+	return (ISC_R_SUCCESS);
+}
+
+isc_result_t
+dns_qlog_read(dns_qlogreader_t *reader, dns_qlogentry_t *entry) {
+	unsigned char data[QLOG_QUERYSIZE + DNS_NAME_MAXWIRE];
+	unsigned char *addr;
+	unsigned int type, length, id, family, port;
+	isc_uint32_t seconds, nanoseconds;
+	dns_decompress_t dctx;
+	isc_result_t result;
+	isc_buffer_t b;
+
+	REQUIRE(VALID_QLOGREADER(reader));
+	REQUIRE(entry != NULL);
+
+	for (;;) {
+		result = readrecord(reader->fp, data, QLOG_RECORDHDRSIZE,
+				    ISC_TRUE);
+		if (result != ISC_R_SUCCESS)
+			return (result);
+
+		type = data[0];
+		length = data[1];
+		id = (data[2] << 8) | data[3];
+
+		if (type == QLOG_TYPE_QUERY)
+			break;
+		if (type != QLOG_TYPE_VIEW)
+			return (DNS_R_FORMERR);
+
+		result = readrecord(reader->fp, data, length, ISC_FALSE);
+		if (result != ISC_R_SUCCESS)
+			return (result);
+		result = setview(reader, id, data, length);
+		if (result != ISC_R_SUCCESS)
+			return (result);
+	}
+
+	result = readrecord(reader->fp, data + QLOG_RECORDHDRSIZE,
+			    QLOG_QUERYSIZE - QLOG_RECORDHDRSIZE + length,
+			    ISC_FALSE);
+	if (result != ISC_R_SUCCESS)
+		return (result);
+
+	isc_buffer_init(&b, data, QLOG_QUERYSIZE + length);
+	isc_buffer_add(&b, QLOG_QUERYSIZE + length);
+	isc_buffer_forward(&b, QLOG_RECORDHDRSIZE);
+
+	seconds = isc_buffer_getuint32(&b);
+	nanoseconds = isc_buffer_getuint32(&b);
+	if (nanoseconds >= 1000000000)
+		return (DNS_R_FORMERR);
+	isc_time_set(&entry->when, seconds, nanoseconds);
+
+	entry->qtype = isc_buffer_getuint16(&b);
+	entry->qclass = isc_buffer_getuint16(&b);
+	entry->flags = isc_buffer_getuint16(&b);
+	entry->rcode = isc_buffer_getuint16(&b);
+	port = isc_buffer_getuint16(&b);
+	family = isc_buffer_getuint8(&b);
+	entry->ednsversion = isc_buffer_getuint8(&b);
+
+	addr = isc_buffer_current(&b);
+	isc_buffer_forward(&b, 16);
+	switch (family) {
+	case 0:
+		isc_sockaddr_any(&entry->client);
+		break;
+	case 4: {
+		struct in_addr ina;
+
+		memmove(&ina, addr, 4);
+		isc_sockaddr_fromin(&entry->client, &ina, port);
+		break;
+	}
+	case 6: {
+		struct in6_addr in6a;
+
+		memmove(&in6a, addr, 16);
+		isc_sockaddr_fromin6(&entry->client, &in6a, port);
+		break;
+	}
+	default:
+		return (DNS_R_FORMERR);
+	}
+
+	dns_fixedname_init(&entry->fqname);
+	entry->qname = dns_fixedname_name(&entry->fqname);
+	isc_buffer_setactive(&b, length);
+	dns_decompress_init(&dctx, -1, DNS_DECOMPRESS_NONE);
+	result = dns_name_fromwire(entry->qname, &b, &dctx, 0, NULL);
+	dns_decompress_invalidate(&dctx);
+	if (result != ISC_R_SUCCESS || isc_buffer_remaininglength(&b) != 0)
+		return (DNS_R_FORMERR);
+
+	entry->view = (id < reader->maxviews) ? reader->views[id] : NULL;
+
+	return (ISC_R_SUCCESS);
+}
+
+void
+dns_qlog_close(dns_qlogreader_t **readerp) {
+	dns_qlogreader_t *reader;
+	unsigned int i;
+
+	REQUIRE(readerp != NULL && VALID_QLOGREADER(*readerp));
+
+	reader = *readerp;
+	*readerp = NULL;
+
+	(void)isc_stdio_close(reader->fp);
+	for (i = 0; i < reader->maxviews; i++) {
+		if (reader->views[i] != NULL)
+			isc_mem_free(reader->mctx, reader->views[i]);
+	}
+	if (reader->views != NULL)
+		isc_mem_put(reader->mctx, reader->views,
+			    reader->maxviews * sizeof(char *));
+
+	reader->magic = 0;
+	isc_mem_putanddetach(&reader->mctx, reader, sizeof(*reader));
+}
+
+isc_result_t
+dns_qlog_totext(const dns_qlogentry_t *entry, isc_buffer_t *target) {
+	char timebuf[64];
+	char clientbuf[ISC_SOCKADDR_FORMATSIZE];
+	char namebuf[DNS_NAME_FORMATSIZE];
+	char classbuf[DNS_RDATACLASS_FORMATSIZE];
+	char typebuf[DNS_RDATATYPE_FORMATSIZE];
+	char ednsbuf[sizeof("E(255)")] = { 0 };
+	char viewbuf[256 + sizeof("view : ")] = { 0 };
+	char rcodebuf[sizeof("BADCOOKIE") + 8] = { 0 };
+	char line[1024];
+	const char *rcode = rcodebuf;
+	unsigned int flags = entry->flags;
+	isc_buffer_t b;
+	int n;
+
+	REQUIRE(entry != NULL);
+	REQUIRE(target != NULL);
+
+	isc_time_formattimestamp(&entry->when, timebuf, sizeof(timebuf));
+	isc_sockaddr_format(&entry->client, clientbuf, sizeof(clientbuf));
+	dns_name_format(entry->qname, namebuf, sizeof(namebuf));
+	dns_rdataclass_format(entry->qclass, classbuf, sizeof(classbuf));
+	dns_rdatatype_format(entry->qtype, typebuf, sizeof(typebuf));
+
+	if ((flags & DNS_QLOG_EDNS) != 0)
+		snprintf(ednsbuf, sizeof(ednsbuf), "E(%u)",
+			 entry->ednsversion);
+
+	if (entry->view != NULL && strcmp(entry->view, "_default") != 0 &&
+	    strcmp(entry->view, "_bind") != 0)
+	{
+		snprintf(viewbuf, sizeof(viewbuf), "view %s: ", entry->view);
+	}
+
+	if ((flags & DNS_QLOG_NORESPONSE) != 0) {
+		rcode = "no-response";
+	} else if ((flags & DNS_QLOG_XFR) != 0) {
+		rcode = "transfer";
+	} else {
+		isc_buffer_init(&b, rcodebuf, sizeof(rcodebuf) - 1);
+		if (dns_rcode_totext(entry->rcode, &b) != ISC_R_SUCCESS)
+			rcode = "?";
+	}
+
+	n = snprintf(line, sizeof(line),
+		     "%s client %s (%s): %squery: %s %s %s %s%s%s%s%s%s%s%s "
+		     "%s%s\n",
+		     timebuf, clientbuf, namebuf, viewbuf,
+		     namebuf, classbuf, typebuf,
+		     ((flags & DNS_QLOG_RD) != 0) ? "+" : "-",
+		     ((flags & DNS_QLOG_SIGNED) != 0) ? "S" : "", ednsbuf,
+		     ((flags & DNS_QLOG_TCP) != 0) ? "T" : "",
+		     ((flags & DNS_QLOG_DO) != 0) ? "D" : "",
+		     ((flags & DNS_QLOG_CD) != 0) ? "C" : "",
+		     ((flags & DNS_QLOG_COOKIE) != 0) ? "V" :
+		     ((flags & DNS_QLOG_CLIENTCOOKIE) != 0) ? "K" : "",
+		     ((flags & DNS_QLOG_ECS) != 0) ? " [ECS]" : "",
+		     rcode,
+		     ((flags & DNS_QLOG_TC) != 0) ? " TC" : "");
+	if (n < 0 || (size_t)n >= sizeof(line))
+		return (ISC_R_NOSPACE);
+	if (isc_buffer_availablelength(target) < (unsigned int)n)
+		return (ISC_R_NOSPACE);
+
+	isc_buffer_putmem(target, (unsigned char *)line, (unsigned int)n);
+	return (ISC_R_SUCCESS);
+}
@@ -758,6 +758,14 @@ typedef struct {
 typedef struct {
 	dns_rbtdb_t *           rbtdb;
 	isc_stdtime_t           now;
+	/*
+	 * The node the last rdataset was added to, and whether it is in
+	 * the NSEC3 tree.  Rdatasets are usually loaded grouped by owner
+	 * name, so most additions go to the same node as the previous one.
+	 */
+	dns_fixedname_t         lastname;
+	dns_rbtnode_t *         lastnode;
+	isc_boolean_t           lastnsec3;
 } rbtdb_load_t;
 
 static void delete_callback(void *data, void *arg);
@@ -7352,6 +7360,7 @@ loading_addrdataset(void *arg, const dns_name_t *name,
 	isc_result_t result;
 	isc_region_t region;
 	rdatasetheader_t *newheader;
+	isc_boolean_t nsec3;
 
 	REQUIRE(rdataset->rdclass == rbtdb->common.rdclass);
 
@@ -7368,8 +7377,23 @@ loading_addrdataset(void *arg, const dns_name_t *name,
 	    !IS_CACHE(rbtdb) && !dns_name_equal(name, &rbtdb->common.origin))
 		return (DNS_R_NOTZONETOP);
 
-	if (rdataset->type != dns_rdatatype_nsec3 &&
-	    rdataset->covers != dns_rdatatype_nsec3)
+	nsec3 = ISC_TF(rdataset->type == dns_rdatatype_nsec3 ||
+		       rdataset->covers == dns_rdatatype_nsec3);
+
+	/*
+	 * If this rdataset has the same owner as the last one, the
+	 * node and any wildcard nodes above it already exist and the
+	 * tree need not be searched again; a first NSEC still has to
+	 * go through loadnode() to be added to the auxiliary tree.
+	 */
+	node = NULL;
+	if (loadctx->lastnode != NULL && loadctx->lastnsec3 == nsec3 &&
+	    (rdataset->type != dns_rdatatype_nsec ||
+	     loadctx->lastnode->nsec == DNS_RBT_NSEC_HAS_NSEC) &&
+	    dns_name_equal(name, dns_fixedname_name(&loadctx->lastname)))
+		node = loadctx->lastnode;
+
+	if (node == NULL && !nsec3)
 		add_empty_wildcards(rbtdb, name);
 
 	if (dns_name_iswildcard(name)) {
@@ -7383,34 +7407,41 @@ loading_addrdataset(void *arg, const dns_name_t *name,
 		 */
 		if (rdataset->type == dns_rdatatype_nsec3)
 			return (DNS_R_INVALIDNSEC3);
-		result = add_wildcard_magic(rbtdb, name);
-		if (result != ISC_R_SUCCESS)
-			return (result);
+		if (node == NULL) {
+			result = add_wildcard_magic(rbtdb, name);
+			if (result != ISC_R_SUCCESS)
+				return (result);
+		}
 	}
 
-	node = NULL;
-	if (rdataset->type == dns_rdatatype_nsec3 ||
-	    rdataset->covers == dns_rdatatype_nsec3) {
-		result = dns_rbt_addnode(rbtdb->nsec3, name, &node);
-		if (result == ISC_R_SUCCESS)
-			node->nsec = DNS_RBT_NSEC_NSEC3;
-	} else if (rdataset->type == dns_rdatatype_nsec) {
-		result = loadnode(rbtdb, name, &node, ISC_TRUE);
-	} else {
-		result = loadnode(rbtdb, name, &node, ISC_FALSE);
-	}
-	if (result != ISC_R_SUCCESS && result != ISC_R_EXISTS)
-		return (result);
-	if (result == ISC_R_SUCCESS) {
-		dns_name_t foundname;
-		dns_name_init(&foundname, NULL);
-		dns_rbt_namefromnode(node, &foundname);
+	if (node == NULL) {
+		if (nsec3) {
+			result = dns_rbt_addnode(rbtdb->nsec3, name, &node);
+			if (result == ISC_R_SUCCESS)
+				node->nsec = DNS_RBT_NSEC_NSEC3;
+		} else if (rdataset->type == dns_rdatatype_nsec) {
+			result = loadnode(rbtdb, name, &node, ISC_TRUE);
+		} else {
+			result = loadnode(rbtdb, name, &node, ISC_FALSE);
+		}
+		if (result != ISC_R_SUCCESS && result != ISC_R_EXISTS)
+			return (result);
+		if (result == ISC_R_SUCCESS) {
+			dns_name_t foundname;
+			dns_name_init(&foundname, NULL);
+			dns_rbt_namefromnode(node, &foundname);
 #ifdef DNS_RBT_USEHASH
-		node->locknum = node->hashval % rbtdb->node_lock_count;
+			node->locknum = node->hashval % rbtdb->node_lock_count;
 #else
-		node->locknum = dns_name_hash(&foundname, ISC_TRUE) %
-			rbtdb->node_lock_count;
+			node->locknum = dns_name_hash(&foundname, ISC_TRUE) %
+				rbtdb->node_lock_count;
 #endif
+		}
+		RUNTIME_CHECK(dns_name_copy(name,
+					    dns_fixedname_name(&loadctx->lastname),
+					    NULL) == ISC_R_SUCCESS);
+		loadctx->lastnode = node;
+		loadctx->lastnsec3 = nsec3;
 	}
 
 	result = dns_rdataslab_fromrdataset(rdataset, rbtdb->common.mctx,
@@ -7650,6 +7681,9 @@ beginload(dns_db_t *db, dns_rdatacallbacks_t *callbacks) {
 		isc_stdtime_get(&loadctx->now);
 	else
 		loadctx->now = 0;
+	dns_fixedname_init(&loadctx->lastname);
+	loadctx->lastnode = NULL;
+	loadctx->lastnsec3 = ISC_FALSE;
 
 	RBTDB_LOCK(&rbtdb->lock, isc_rwlocktype_write);
 
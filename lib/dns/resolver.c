@@ -7507,7 +7507,8 @@ rctx_parse(respctx_t *rctx) {
 	fetchctx_t *fctx = rctx->fctx;
 	resquery_t *query = rctx->query;
 
-	result = dns_message_parse(fctx->rmessage, &rctx->devent->buffer, 0);
+	result = dns_message_parse(fctx->rmessage, &rctx->devent->buffer,
+				   DNS_MESSAGEPARSE_WIREREF);
 	if (result == ISC_R_SUCCESS) {
 		return (ISC_R_SUCCESS);
 	}
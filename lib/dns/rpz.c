@@ -11,6 +11,7 @@
 #include <config.h>
 
 #include <isc/buffer.h>
+#include <isc/json.h>
 #include <isc/mem.h>
 #include <isc/net.h>
 #include <isc/netaddr.h>
@@ -20,12 +21,14 @@
 #include <isc/string.h>
 #include <isc/task.h>
 #include <isc/util.h>
+#include <isc/xml.h>
 
 #include <dns/db.h>
 #include <dns/dbiterator.h>
 #include <dns/dnsrps.h>
 #include <dns/events.h>
 #include <dns/fixedname.h>
+#include <dns/journal.h>
 #include <dns/log.h>
 #include <dns/rdata.h>
 #include <dns/rdataset.h>
@@ -122,26 +125,30 @@ typedef struct {
 				     - 1 - ((n) % DNS_RPZ_CIDR_WORD_BITS))))
 
 /*
- * A triplet of arrays of bits flagging the existence of
- * client-IP, IP, and NSIP policy triggers.
+ * The policy of the most eligible policy zone with a trigger for a name
+ * or address, compiled from its policy record when the zone was loaded
+ * so that queries need not look it up in the policy zone.
+ * DNS_RPZ_POLICY_RECORD means that the policy record must be consulted.
  */
-typedef struct dns_rpz_addr_zbits dns_rpz_addr_zbits_t;
-struct dns_rpz_addr_zbits {
-	dns_rpz_zbits_t		client_ip;
-	dns_rpz_zbits_t		ip;
-	dns_rpz_zbits_t		nsip;
+typedef struct dns_rpz_cpol dns_rpz_cpol_t;
+struct dns_rpz_cpol {
+	dns_rpz_num_t		num;	/* DNS_RPZ_INVALID_NUM if unknown */
+	isc_uint8_t		policy;
 };
 
 /*
- * A CIDR or radix tree node.
+ * A CIDR or radix tree node.  There is a separate tree for each of
+ * client-IP, IP, and NSIP triggers, so that a node only carries the
+ * bits of the policy zones with triggers of one type.
  */
 struct dns_rpz_cidr_node {
 	dns_rpz_cidr_node_t	*parent;
 	dns_rpz_cidr_node_t	*child[2];
 	dns_rpz_cidr_key_t	ip;
+	dns_rpz_zbits_t		set;	/* zones with this trigger */
+	dns_rpz_zbits_t		sum;	/* zones with it or one below */
+	dns_rpz_cpol_t		pol;
 	dns_rpz_prefix_t	prefix;
-	dns_rpz_addr_zbits_t	set;
-	dns_rpz_addr_zbits_t	sum;
 };
 
 /*
@@ -163,8 +170,31 @@ typedef struct dns_rpz_nm_data dns_rpz_nm_data_t;
 struct dns_rpz_nm_data {
 	dns_rpz_nm_zbits_t	set;
 	dns_rpz_nm_zbits_t	wild;
+	dns_rpz_cpol_t		qname_pol;
+	dns_rpz_cpol_t		ns_pol;
 };
 
+/*
+ * Most names are triggers in only one policy zone.  Their data is
+ * packed into the RBT node's data pointer instead of being allocated,
+ * tagged by the low bit, which is never set in an allocated pointer:
+ *	bit 0		NM_PACKED
+ *	bits 1-4	set.qname, set.ns, wild.qname, wild.ns
+ *	bits 5-10	the policy zone number
+ *	bits 11-15	qname_pol: policy, and whether it is valid
+ *	bits 16-20	ns_pol: policy, and whether it is valid
+ */
+#define NM_PACKED		0x1
+#define NM_SET_QNAME		0x2
+#define NM_SET_NS		0x4
+#define NM_WILD_QNAME		0x8
+#define NM_WILD_NS		0x10
+#define NM_NUM_SHIFT		5
+#define NM_QNAME_POL_SHIFT	11
+#define NM_NS_POL_SHIFT		16
+#define NM_POL_VALID		0x10
+#define NM_POL_MASK		0x0f
+
 #if 0
 /*
  * Catch a name while debugging.
@@ -308,31 +338,20 @@ zbit_to_num(dns_rpz_zbits_t zbit) {
 }
 
 /*
- * Make a set of bit masks given one or more bits and their type.
+ * Get the radix tree for a type of address trigger.
  */
-static void
-make_addr_set(dns_rpz_addr_zbits_t *tgt_set, dns_rpz_zbits_t zbits,
-	      dns_rpz_type_t type)
-{
+static dns_rpz_cidr_node_t **
+cidr_root(dns_rpz_zones_t *rpzs, dns_rpz_type_t type) {
 	switch (type) {
 	case DNS_RPZ_TYPE_CLIENT_IP:
-		tgt_set->client_ip = zbits;
-		tgt_set->ip = 0;
-		tgt_set->nsip = 0;
-		break;
+		return (&rpzs->cidr[0]);
 	case DNS_RPZ_TYPE_IP:
-		tgt_set->client_ip = 0;
-		tgt_set->ip = zbits;
-		tgt_set->nsip = 0;
-		break;
+		return (&rpzs->cidr[1]);
 	case DNS_RPZ_TYPE_NSIP:
-		tgt_set->client_ip = 0;
-		tgt_set->ip = 0;
-		tgt_set->nsip = zbits;
-		break;
+		return (&rpzs->cidr[2]);
 	default:
 		INSIST(0);
-		break;
+		return (NULL);
 	}
 }
 
@@ -356,33 +375,165 @@ make_nm_set(dns_rpz_nm_zbits_t *tgt_set,
 }
 
 /*
- * Mark a node and all of its parents as having client-IP, IP, or NSIP data
+ * Get the compiled policy of a name for a trigger type.
+ */
+static dns_rpz_cpol_t *
+nm_cpol(dns_rpz_nm_data_t *nm_data, dns_rpz_type_t type) {
+	switch (type) {
+	case DNS_RPZ_TYPE_QNAME:
+		return (&nm_data->qname_pol);
+	case DNS_RPZ_TYPE_NSDNAME:
+		return (&nm_data->ns_pol);
+	default:
+		INSIST(0);
+		return (NULL);
+	}
+}
+
+static uintptr_t
+pack_cpol(const dns_rpz_cpol_t *cpol, dns_rpz_num_t rpz_num) {
+	if (cpol->num != rpz_num)
+		return (0);
+	return (NM_POL_VALID | cpol->policy);
+}
+
+static void
+unpack_cpol(dns_rpz_cpol_t *cpol, uintptr_t bits, dns_rpz_num_t rpz_num) {
+	if ((bits & NM_POL_VALID) != 0) {
+		cpol->num = rpz_num;
+		cpol->policy = (isc_uint8_t)(bits & NM_POL_MASK);
+	} else {
+		cpol->num = DNS_RPZ_INVALID_NUM;
+		cpol->policy = DNS_RPZ_POLICY_RECORD;
+	}
+}
+
+/*
+ * Get a copy of the data of a node in the summary RBT database.
+ */
+static void
+nm_load(const void *data, dns_rpz_nm_data_t *nm_data) {
+	uintptr_t v = (uintptr_t)data;
+	dns_rpz_num_t rpz_num;
+	dns_rpz_zbits_t zbit;
+
+	if ((v & NM_PACKED) == 0) {
+		*nm_data = *(const dns_rpz_nm_data_t *)data;
+		return;
+	}
+
+	rpz_num = (dns_rpz_num_t)((v >> NM_NUM_SHIFT) & 0x3f);
+	zbit = DNS_RPZ_ZBIT(rpz_num);
+	nm_data->set.qname = (v & NM_SET_QNAME) != 0 ? zbit : 0;
+	nm_data->set.ns = (v & NM_SET_NS) != 0 ? zbit : 0;
+	nm_data->wild.qname = (v & NM_WILD_QNAME) != 0 ? zbit : 0;
+	nm_data->wild.ns = (v & NM_WILD_NS) != 0 ? zbit : 0;
+	unpack_cpol(&nm_data->qname_pol, v >> NM_QNAME_POL_SHIFT, rpz_num);
+	unpack_cpol(&nm_data->ns_pol, v >> NM_NS_POL_SHIFT, rpz_num);
+}
+
+/*
+ * Store the data of a node in the summary RBT database, packed if it
+ * concerns only one policy zone.
+ */
+static isc_result_t
+nm_store(dns_rpz_zones_t *rpzs, dns_rbtnode_t *nmnode,
+	 const dns_rpz_nm_data_t *nm_data)
+{
+	dns_rpz_zbits_t zbits;
+	dns_rpz_num_t rpz_num;
+	dns_rpz_nm_data_t *data;
+	uintptr_t v;
+
+	zbits = nm_data->set.qname | nm_data->set.ns |
+		nm_data->wild.qname | nm_data->wild.ns;
+	INSIST(zbits != 0);
+	if ((zbits & (zbits - 1)) == 0) {
+		rpz_num = zbit_to_num(zbits);
+		if ((nm_data->qname_pol.num == DNS_RPZ_INVALID_NUM ||
+		     nm_data->qname_pol.num == rpz_num) &&
+		    (nm_data->ns_pol.num == DNS_RPZ_INVALID_NUM ||
+		     nm_data->ns_pol.num == rpz_num))
+		{
+			v = NM_PACKED | ((uintptr_t)rpz_num << NM_NUM_SHIFT);
+			if (nm_data->set.qname != 0)
+				v |= NM_SET_QNAME;
+			if (nm_data->set.ns != 0)
+				v |= NM_SET_NS;
+			if (nm_data->wild.qname != 0)
+				v |= NM_WILD_QNAME;
+			if (nm_data->wild.ns != 0)
+				v |= NM_WILD_NS;
+			v |= pack_cpol(&nm_data->qname_pol, rpz_num) <<
+				NM_QNAME_POL_SHIFT;
+			v |= pack_cpol(&nm_data->ns_pol, rpz_num) <<
+				NM_NS_POL_SHIFT;
+			if (nmnode->data != NULL &&
+			    ((uintptr_t)nmnode->data & NM_PACKED) == 0)
+				isc_mem_put(rpzs->smctx, nmnode->data,
+					    sizeof(*nm_data));
+			nmnode->data = (void *)v;
+			return (ISC_R_SUCCESS);
+		}
+	}
+
+	if (nmnode->data == NULL ||
+	    ((uintptr_t)nmnode->data & NM_PACKED) != 0)
+	{
+		data = isc_mem_get(rpzs->smctx, sizeof(*data));
+		if (data == NULL)
+			return (ISC_R_NOMEMORY);
+		nmnode->data = data;
+	}
+	*(dns_rpz_nm_data_t *)nmnode->data = *nm_data;
+	return (ISC_R_SUCCESS);
+}
+
+/*
+ * Remember the policy of a trigger if its policy zone is at least as
+ * eligible as the zone whose policy is already known.
+ */
+static void
+set_cpol(dns_rpz_cpol_t *cpol, dns_rpz_num_t rpz_num,
+	 dns_rpz_policy_t policy)
+{
+	if (cpol->num == DNS_RPZ_INVALID_NUM || cpol->num >= rpz_num) {
+		cpol->num = rpz_num;
+		cpol->policy = policy;
+	}
+}
+
+/*
+ * Forget the policy of a trigger that has been removed from its zone.
+ * The policies of less eligible zones are recompiled when those zones
+ * are next updated; until then their policy records are consulted.
+ */
+static void
+clear_cpol(dns_rpz_cpol_t *cpol, dns_rpz_num_t rpz_num) {
+	if (cpol->num == rpz_num)
+		cpol->num = DNS_RPZ_INVALID_NUM;
+}
+
+/*
+ * Mark a node and all of its parents as having data
  */
 static void
 set_sum_pair(dns_rpz_cidr_node_t *cnode) {
 	dns_rpz_cidr_node_t *child;
-	dns_rpz_addr_zbits_t sum;
+	dns_rpz_zbits_t sum;
 
 	do {
 		sum = cnode->set;
 
 		child = cnode->child[0];
-		if (child != NULL) {
-			sum.client_ip |= child->sum.client_ip;
-			sum.ip |= child->sum.ip;
-			sum.nsip |= child->sum.nsip;
-		}
+		if (child != NULL)
+			sum |= child->sum;
 
 		child = cnode->child[1];
-		if (child != NULL) {
-			sum.client_ip |= child->sum.client_ip;
-			sum.ip |= child->sum.ip;
-			sum.nsip |= child->sum.nsip;
-		}
+		if (child != NULL)
+			sum |= child->sum;
 
-		if (cnode->sum.client_ip == sum.client_ip &&
-		    cnode->sum.ip == sum.ip &&
-		    cnode->sum.nsip == sum.nsip)
+		if (cnode->sum == sum)
 			break;
 		cnode->sum = sum;
 		cnode = cnode->parent;
@@ -634,10 +785,11 @@ new_node(dns_rpz_zones_t *rpzs,
 	dns_rpz_cidr_node_t *node;
 	int i, words, wlen;
 
-	node = isc_mem_get(rpzs->mctx, sizeof(*node));
+	node = isc_mem_get(rpzs->smctx, sizeof(*node));
 	if (node == NULL)
 		return (NULL);
 	memset(node, 0, sizeof(*node));
+	node->pol.num = DNS_RPZ_INVALID_NUM;
 
 	if (child != NULL)
 		node->sum = child->sum;
@@ -805,7 +957,7 @@ name2ipkey(int log_level,
 	   const dns_rpz_zones_t *rpzs, dns_rpz_num_t rpz_num,
 	   dns_rpz_type_t rpz_type, const dns_name_t *src_name,
 	   dns_rpz_cidr_key_t *tgt_ip, dns_rpz_prefix_t *tgt_prefix,
-	   dns_rpz_addr_zbits_t *new_set)
+	   dns_rpz_zbits_t *new_set)
 {
 	dns_rpz_zone_t *rpz;
 	char ip_str[DNS_NAME_FORMATSIZE], ip2_str[DNS_NAME_FORMATSIZE];
@@ -824,7 +976,7 @@ name2ipkey(int log_level,
 	rpz = rpzs->zones[rpz_num];
 	REQUIRE(rpz != NULL);
 
-	make_addr_set(new_set, DNS_RPZ_ZBIT(rpz_num), rpz_type);
+	*new_set = DNS_RPZ_ZBIT(rpz_num);
 
 	ip_labels = dns_name_countlabels(src_name);
 	if (rpz_type == DNS_RPZ_TYPE_QNAME)
@@ -1112,21 +1264,23 @@ trim_zbits(dns_rpz_zbits_t zbits, dns_rpz_zbits_t found) {
  *	or with create==ISC_TRUE, ISC_R_EXISTS or ISC_R_NOMEMORY
  */
 static isc_result_t
-search(dns_rpz_zones_t *rpzs,
+search(dns_rpz_zones_t *rpzs, dns_rpz_type_t rpz_type,
        const dns_rpz_cidr_key_t *tgt_ip, dns_rpz_prefix_t tgt_prefix,
-       const dns_rpz_addr_zbits_t *tgt_set, isc_boolean_t create,
+       dns_rpz_zbits_t tgt_set, isc_boolean_t create,
        dns_rpz_cidr_node_t **found)
 {
-	dns_rpz_cidr_node_t *cur, *parent, *child, *new_parent, *sibling;
-	dns_rpz_addr_zbits_t set;
+	dns_rpz_cidr_node_t **root, *cur, *parent, *child, *new_parent;
+	dns_rpz_cidr_node_t *sibling;
+	dns_rpz_zbits_t set;
 	int cur_num, child_num;
 	dns_rpz_prefix_t dbit;
 	isc_result_t find_result;
 
-	set = *tgt_set;
+	set = tgt_set;
 	find_result = ISC_R_NOTFOUND;
 	*found = NULL;
-	cur = rpzs->cidr;
+	root = cidr_root(rpzs, rpz_type);
+	cur = *root;
 	parent = NULL;
 	cur_num = 0;
 	for (;;) {
@@ -1142,21 +1296,17 @@ search(dns_rpz_zones_t *rpzs,
 			if (child == NULL)
 				return (ISC_R_NOMEMORY);
 			if (parent == NULL)
-				rpzs->cidr = child;
+				*root = child;
 			else
 				parent->child[cur_num] = child;
 			child->parent = parent;
-			child->set.client_ip |= tgt_set->client_ip;
-			child->set.ip |= tgt_set->ip;
-			child->set.nsip |= tgt_set->nsip;
+			child->set |= tgt_set;
 			set_sum_pair(child);
 			*found = child;
 			return (ISC_R_SUCCESS);
 		}
 
-		if ((cur->sum.client_ip & set.client_ip) == 0 &&
-		    (cur->sum.ip & set.ip) == 0 &&
-		    (cur->sum.nsip & set.nsip) == 0) {
+		if ((cur->sum & set) == 0) {
 			/*
 			 * This node has no relevant data
 			 * and is in none of the target trees.
@@ -1179,9 +1329,7 @@ search(dns_rpz_zones_t *rpzs,
 				/*
 				 * The node's key matches the target exactly.
 				 */
-				if ((cur->set.client_ip & set.client_ip) != 0 ||
-				    (cur->set.ip & set.ip) != 0 ||
-				    (cur->set.nsip & set.nsip) != 0) {
+				if ((cur->set & set) != 0) {
 					/*
 					 * It is the answer if it has data.
 					 */
@@ -1196,10 +1344,7 @@ search(dns_rpz_zones_t *rpzs,
 					 * The node lacked relevant data,
 					 * but will have it now.
 					 */
-					cur->set.client_ip |=
-						tgt_set->client_ip;
-					cur->set.ip |= tgt_set->ip;
-					cur->set.nsip |= tgt_set->nsip;
+					cur->set |= tgt_set;
 					set_sum_pair(cur);
 					*found = cur;
 					find_result = ISC_R_SUCCESS;
@@ -1220,22 +1365,20 @@ search(dns_rpz_zones_t *rpzs,
 				return (ISC_R_NOMEMORY);
 			new_parent->parent = parent;
 			if (parent == NULL)
-				rpzs->cidr = new_parent;
+				*root = new_parent;
 			else
 				parent->child[cur_num] = new_parent;
 			child_num = DNS_RPZ_IP_BIT(&cur->ip, tgt_prefix);
 			new_parent->child[child_num] = cur;
 			cur->parent = new_parent;
-			new_parent->set = *tgt_set;
+			new_parent->set = tgt_set;
 			set_sum_pair(new_parent);
 			*found = new_parent;
 			return (ISC_R_SUCCESS);
 		}
 
 		if (dbit == cur->prefix) {
-			if ((cur->set.client_ip & set.client_ip) != 0 ||
-			    (cur->set.ip & set.ip) != 0 ||
-			    (cur->set.nsip & set.nsip) != 0) {
+			if ((cur->set & set) != 0) {
 				/*
 				 * We have a partial match between of all of the
 				 * current node but only part of the target.
@@ -1244,12 +1387,7 @@ search(dns_rpz_zones_t *rpzs,
 				 */
 				find_result = DNS_R_PARTIALMATCH;
 				*found = cur;
-				set.client_ip = trim_zbits(set.client_ip,
-							   cur->set.client_ip);
-				set.ip = trim_zbits(set.ip,
-						    cur->set.ip);
-				set.nsip = trim_zbits(set.nsip,
-						      cur->set.nsip);
+				set = trim_zbits(set, cur->set);
 			}
 			parent = cur;
 			cur_num = DNS_RPZ_IP_BIT(tgt_ip, dbit);
@@ -1272,12 +1410,12 @@ search(dns_rpz_zones_t *rpzs,
 			return (ISC_R_NOMEMORY);
 		new_parent = new_node(rpzs, tgt_ip, dbit, cur);
 		if (new_parent == NULL) {
-			isc_mem_put(rpzs->mctx, sibling, sizeof(*sibling));
+			isc_mem_put(rpzs->smctx, sibling, sizeof(*sibling));
 			return (ISC_R_NOMEMORY);
 		}
 		new_parent->parent = parent;
 		if (parent == NULL)
-			rpzs->cidr = new_parent;
+			*root = new_parent;
 		else
 			parent->child[cur_num] = new_parent;
 		child_num = DNS_RPZ_IP_BIT(tgt_ip, dbit);
@@ -1285,7 +1423,7 @@ search(dns_rpz_zones_t *rpzs,
 		new_parent->child[1-child_num] = cur;
 		cur->parent = new_parent;
 		sibling->parent = new_parent;
-		sibling->set = *tgt_set;
+		sibling->set = tgt_set;
 		set_sum_pair(sibling);
 		*found = sibling;
 		return (ISC_R_SUCCESS);
@@ -1297,11 +1435,12 @@ search(dns_rpz_zones_t *rpzs,
  */
 static isc_result_t
 add_cidr(dns_rpz_zones_t *rpzs, dns_rpz_num_t rpz_num,
-	 dns_rpz_type_t rpz_type, const dns_name_t *src_name)
+	 dns_rpz_type_t rpz_type, const dns_name_t *src_name,
+	 dns_rpz_policy_t policy)
 {
 	dns_rpz_cidr_key_t tgt_ip;
 	dns_rpz_prefix_t tgt_prefix;
-	dns_rpz_addr_zbits_t set;
+	dns_rpz_zbits_t set;
 	dns_rpz_cidr_node_t *found;
 	isc_result_t result;
 
@@ -1313,16 +1452,20 @@ add_cidr(dns_rpz_zones_t *rpzs, dns_rpz_num_t rpz_num,
 	if (result != ISC_R_SUCCESS)
 		return (ISC_R_SUCCESS);
 
-	result = search(rpzs, &tgt_ip, tgt_prefix, &set, ISC_TRUE, &found);
+	result = search(rpzs, rpz_type, &tgt_ip, tgt_prefix, set, ISC_TRUE,
+			&found);
 	if (result != ISC_R_SUCCESS) {
 		char namebuf[DNS_NAME_FORMATSIZE];
 
 		/*
 		 * Do not worry if the radix tree already exists,
 		 * because diff_apply() likes to add nodes before deleting.
+		 * The policy might have changed.
 		 */
-		if (result == ISC_R_EXISTS)
+		if (result == ISC_R_EXISTS) {
+			set_cpol(&found->pol, rpz_num, policy);
 			return (ISC_R_SUCCESS);
+		}
 
 		/*
 		 * bin/tests/system/rpz/tests.sh looks for "rpz.*failed".
@@ -1335,56 +1478,77 @@ add_cidr(dns_rpz_zones_t *rpzs, dns_rpz_num_t rpz_num,
 		return (result);
 	}
 
+	set_cpol(&found->pol, rpz_num, policy);
 	adj_trigger_cnt(rpzs, rpz_num, rpz_type, &tgt_ip, tgt_prefix, ISC_TRUE);
 	return (result);
 }
 
 static isc_result_t
-add_nm(dns_rpz_zones_t *rpzs, dns_name_t *trig_name,
-	 const dns_rpz_nm_data_t *new_data)
+add_nm(dns_rpz_zones_t *rpzs, dns_rpz_num_t rpz_num,
+       dns_rpz_type_t rpz_type, dns_name_t *trig_name,
+       const dns_rpz_nm_data_t *new_data, dns_rpz_policy_t policy)
 {
 	dns_rbtnode_t *nmnode;
-	dns_rpz_nm_data_t *nm_data;
-	isc_result_t result;
+	dns_rpz_nm_data_t nm_data;
+	isc_boolean_t exact;
+	isc_result_t result, sresult;
+
+	/*
+	 * Only exact triggers have compiled policies.  Wildcard triggers
+	 * are matched against the policy zone.
+	 */
+	exact = ISC_TF(new_data->set.qname != 0 || new_data->set.ns != 0);
 
 	nmnode = NULL;
 	result = dns_rbt_addnode(rpzs->rbt, trig_name, &nmnode);
 	switch (result) {
 	case ISC_R_SUCCESS:
 	case ISC_R_EXISTS:
-		nm_data = nmnode->data;
-		if (nm_data == NULL) {
-			nm_data = isc_mem_get(rpzs->mctx, sizeof(*nm_data));
-			if (nm_data == NULL)
-				return (ISC_R_NOMEMORY);
-			*nm_data = *new_data;
-			nmnode->data = nm_data;
-			return (ISC_R_SUCCESS);
+		if (nmnode->data == NULL) {
+			nm_data = *new_data;
+			nm_data.qname_pol.num = DNS_RPZ_INVALID_NUM;
+			nm_data.ns_pol.num = DNS_RPZ_INVALID_NUM;
+			if (exact)
+				set_cpol(nm_cpol(&nm_data, rpz_type),
+					 rpz_num, policy);
+			return (nm_store(rpzs, nmnode, &nm_data));
 		}
 		break;
 	default:
 		return (result);
 	}
 
+	nm_load(nmnode->data, &nm_data);
+	if (exact)
+		set_cpol(nm_cpol(&nm_data, rpz_type), rpz_num, policy);
+
 	/*
 	 * Do not count bits that are already present
 	 */
-	if ((nm_data->set.qname & new_data->set.qname) != 0 ||
-	    (nm_data->set.ns & new_data->set.ns) != 0 ||
-	    (nm_data->wild.qname & new_data->wild.qname) != 0 ||
-	    (nm_data->wild.ns & new_data->wild.ns) != 0)
-		return (ISC_R_EXISTS);
-
-	nm_data->set.qname |= new_data->set.qname;
-	nm_data->set.ns |= new_data->set.ns;
-	nm_data->wild.qname |= new_data->wild.qname;
-	nm_data->wild.ns |= new_data->wild.ns;
-	return (ISC_R_SUCCESS);
+	if ((nm_data.set.qname & new_data->set.qname) != 0 ||
+	    (nm_data.set.ns & new_data->set.ns) != 0 ||
+	    (nm_data.wild.qname & new_data->wild.qname) != 0 ||
+	    (nm_data.wild.ns & new_data->wild.ns) != 0)
+	{
+		result = ISC_R_EXISTS;
+	} else {
+		nm_data.set.qname |= new_data->set.qname;
+		nm_data.set.ns |= new_data->set.ns;
+		nm_data.wild.qname |= new_data->wild.qname;
+		nm_data.wild.ns |= new_data->wild.ns;
+		result = ISC_R_SUCCESS;
+	}
+
+	sresult = nm_store(rpzs, nmnode, &nm_data);
+	if (sresult != ISC_R_SUCCESS)
+		return (sresult);
+	return (result);
 }
 
 static isc_result_t
 add_name(dns_rpz_zones_t *rpzs, dns_rpz_num_t rpz_num,
-	 dns_rpz_type_t rpz_type, const dns_name_t *src_name)
+	 dns_rpz_type_t rpz_type, const dns_name_t *src_name,
+	 dns_rpz_policy_t policy)
 {
 	dns_rpz_nm_data_t new_data;
 	dns_fixedname_t trig_namef;
@@ -1400,7 +1564,7 @@ add_name(dns_rpz_zones_t *rpzs, dns_rpz_num_t rpz_num,
 	trig_name = dns_fixedname_name(&trig_namef);
 	name2data(rpzs, rpz_num, rpz_type, src_name, trig_name, &new_data);
 
-	result = add_nm(rpzs, trig_name, &new_data);
+	result = add_nm(rpzs, rpz_num, rpz_type, trig_name, &new_data, policy);
 
 	/*
 	 * Do not worry if the node already exists,
@@ -1418,7 +1582,8 @@ add_name(dns_rpz_zones_t *rpzs, dns_rpz_num_t rpz_num,
  */
 static void
 rpz_node_deleter(void *nm_data, void *mctx) {
-	isc_mem_put(mctx, nm_data, sizeof(dns_rpz_nm_data_t));
+	if (((uintptr_t)nm_data & NM_PACKED) == 0)
+		isc_mem_put(mctx, nm_data, sizeof(dns_rpz_nm_data_t));
 }
 
 /*
@@ -1451,6 +1616,15 @@ dns_rpz_new_zones(dns_rpz_zones_t **rpzsp, char *rps_cstr,
 	if (result != ISC_R_SUCCESS)
 		goto cleanup_refcount;
 
+	/*
+	 * The summary data gets its own memory context so that its size
+	 * can be reported.
+	 */
+	result = isc_mem_create(0, 0, &zones->smctx);
+	if (result != ISC_R_SUCCESS)
+		goto cleanup_smctx;
+	isc_mem_setname(zones->smctx, "rpz", NULL);
+
 	zones->rps_cstr = rps_cstr;
 	zones->rps_cstr_size = rps_cstr_size;
 #ifdef USE_DNSRPS
@@ -1461,8 +1635,8 @@ dns_rpz_new_zones(dns_rpz_zones_t **rpzsp, char *rps_cstr,
 	INSIST(!zones->p.dnsrps_enabled);
 #endif
 	if (result == ISC_R_SUCCESS && !zones->p.dnsrps_enabled) {
-		result = dns_rbt_create(mctx, rpz_node_deleter,
-					mctx, &zones->rbt);
+		result = dns_rbt_create(zones->smctx, rpz_node_deleter,
+					zones->smctx, &zones->rbt);
 	}
 
 	if (result != ISC_R_SUCCESS)
@@ -1483,6 +1657,9 @@ cleanup_task:
 	dns_rbt_destroy(&zones->rbt);
 
 cleanup_rbt:
+	isc_mem_detach(&zones->smctx);
+
+cleanup_smctx:
 	isc_refcount_decrement(&zones->refs, NULL);
 	isc_refcount_destroy(&zones->refs);
 
@@ -1555,6 +1732,12 @@ dns_rpz_new_zone(dns_rpz_zones_t *rpzs, dns_rpz_zone_t **rpzp) {
 	zone->updbit = NULL;
 	zone->rpzs = rpzs;
 	zone->db_registered = ISC_FALSE;
+	zone->journal = NULL;
+	zone->serial = 0;
+	zone->haveserial = ISC_FALSE;
+	zone->sumversion = NULL;
+	zone->updatetime = 0;
+	zone->incremental = ISC_FALSE;
 	ISC_EVENT_INIT(&zone->updateevent, sizeof(zone->updateevent),
 		       0, NULL, 0, NULL, NULL, NULL, NULL, NULL);
 
@@ -1578,6 +1761,33 @@ cleanup_refcount:
 	return (result);
 }
 
+/*
+ * Record that the summary data of 'rpz' reflects version 'version' of
+ * 'rpz->db', or nothing in particular if 'version' is NULL.  Compiled
+ * policies are only used for queries answered from that version.  The
+ * version is kept open so that its address cannot be reused for a
+ * later version while it is compared against.
+ *
+ * Caller must hold rpzs->maint_lock.
+ */
+static void
+setsumversion(dns_rpz_zone_t *rpz, dns_dbversion_t *version) {
+	dns_dbversion_t *old;
+
+	if (version == rpz->sumversion)
+		return;
+
+	RWLOCK(&rpz->rpzs->search_lock, isc_rwlocktype_write);
+	old = rpz->sumversion;
+	rpz->sumversion = NULL;
+	if (version != NULL)
+		dns_db_attachversion(rpz->db, version, &rpz->sumversion);
+	RWUNLOCK(&rpz->rpzs->search_lock, isc_rwlocktype_write);
+
+	if (old != NULL)
+		dns_db_closeversion(rpz->db, &old, ISC_FALSE);
+}
+
 isc_result_t
 dns_rpz_dbupdate_callback(dns_db_t *db, void *fn_arg) {
 	dns_rpz_zone_t *zone = (dns_rpz_zone_t *) fn_arg;
@@ -1599,10 +1809,13 @@ dns_rpz_dbupdate_callback(dns_db_t *db, void *fn_arg) {
 		if (zone->dbversion != NULL)
 			dns_db_closeversion(zone->db, &zone->dbversion,
 					    ISC_FALSE);
+		setsumversion(zone, NULL);
 		dns_db_updatenotify_unregister(zone->db,
 					       dns_rpz_dbupdate_callback,
 					       zone);
 		dns_db_detach(&zone->db);
+		/* The journal does not cover a transfer of the whole zone. */
+		zone->haveserial = ISC_FALSE;
 	}
 
 	if (zone->db == NULL) {
@@ -1662,6 +1875,27 @@ dns_rpz_dbupdate_callback(dns_db_t *db, void *fn_arg) {
 	return (result);
 }
 
+isc_result_t
+dns_rpz_setjournal(dns_rpz_zone_t *rpz, const char *journal) {
+	char *copy = NULL;
+
+	REQUIRE(rpz != NULL);
+
+	if (journal != NULL) {
+		copy = isc_mem_strdup(rpz->rpzs->mctx, journal);
+		if (copy == NULL)
+			return (ISC_R_NOMEMORY);
+	}
+
+	LOCK(&rpz->rpzs->maint_lock);
+	if (rpz->journal != NULL)
+		isc_mem_free(rpz->rpzs->mctx, rpz->journal);
+	rpz->journal = copy;
+	UNLOCK(&rpz->rpzs->maint_lock);
+
+	return (ISC_R_SUCCESS);
+}
+
 static void
 dns_rpz_update_taskaction(isc_task_t *task, isc_event_t *event) {
 	isc_result_t result;
@@ -1753,13 +1987,81 @@ setup_update(dns_rpz_zone_t *rpz) {
 	return (result);
 }
 
+/*
+ * The summary data of 'rpz' now reflects version 'rpz->updbversion'.
+ * Log how long that took, remember the serial number of the version
+ * for the next update, and schedule that update if another version
+ * arrived in the meantime.
+ */
+static void
+update_done(dns_rpz_zone_t *rpz, isc_boolean_t incremental,
+	    unsigned int count)
+{
+	isc_result_t result;
+	isc_uint32_t serial = 0;
+	isc_uint64_t usecs;
+	isc_time_t now;
+	char dname[DNS_NAME_FORMATSIZE];
+
+	result = dns_db_getsoaserial(rpz->updb, rpz->updbversion, &serial);
+	isc_time_now(&now);
+	usecs = isc_time_microdiff(&now, &rpz->updatestarted);
+	dns_name_format(&rpz->origin, dname, DNS_NAME_FORMATSIZE);
+
+	LOCK(&rpz->rpzs->maint_lock);
+	if (incremental)
+		isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
+			      DNS_LOGMODULE_MASTER, ISC_LOG_INFO,
+			      "rpz: %s: updated incrementally from serial "
+			      "%u to %u: %u names changed, %u.%03u secs",
+			      dname, rpz->serial, serial, count,
+			      (unsigned int)(usecs / 1000000),
+			      (unsigned int)((usecs / 1000) % 1000));
+	else
+		isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
+			      DNS_LOGMODULE_MASTER, ISC_LOG_INFO,
+			      "rpz: %s: reload done: %u names, %u.%03u secs",
+			      dname, count,
+			      (unsigned int)(usecs / 1000000),
+			      (unsigned int)((usecs / 1000) % 1000));
+	rpz->updatetime = usecs;
+	rpz->incremental = incremental;
+
+	/*
+	 * The journal can only be used for the next update if the
+	 * zone has not been transferred or loaded again since this
+	 * one started.
+	 */
+	rpz->serial = serial;
+	rpz->haveserial = ISC_TF(result == ISC_R_SUCCESS &&
+				 rpz->updb == rpz->db);
+	setsumversion(rpz, (rpz->updb == rpz->db) ? rpz->updbversion : NULL);
+
+	rpz->updaterunning = ISC_FALSE;
+	/*
+	 * If there's an update pending schedule it
+	 */
+	if (rpz->updatepending == ISC_TRUE) {
+		isc_uint64_t defer = rpz->min_update_int;
+		isc_interval_t interval;
+		isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
+			      DNS_LOGMODULE_MASTER, ISC_LOG_INFO,
+			      "rpz: %s: new zone version came "
+			      "too soon, deferring update for "
+			      "%llu seconds", dname, defer);
+		isc_interval_set(&interval, (unsigned int)defer, 0);
+		isc_timer_reset(rpz->updatetimer, isc_timertype_once,
+				NULL, &interval, ISC_TRUE);
+	}
+	UNLOCK(&rpz->rpzs->maint_lock);
+}
+
 static void
 finish_update(dns_rpz_zone_t *rpz) {
 	isc_result_t result;
 	isc_ht_t *tmpht = NULL;
 	isc_ht_iter_t *iter = NULL;
 	dns_fixedname_t fname;
-	char dname[DNS_NAME_FORMATSIZE];
 	dns_name_t *name;
 
 	/*
@@ -1800,37 +2102,52 @@ finish_update(dns_rpz_zone_t *rpz) {
 	rpz->nodes = rpz->newnodes;
 	rpz->newnodes = tmpht;
 
-	LOCK(&rpz->rpzs->maint_lock);
-	rpz->updaterunning = ISC_FALSE;
-	/*
-	 * If there's an update pending schedule it
-	 */
-	if (rpz->updatepending == ISC_TRUE) {
-		isc_uint64_t defer = rpz->min_update_int;
-		isc_interval_t interval;
-		dns_name_format(&rpz->origin, dname,
-				DNS_NAME_FORMATSIZE);
-		isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
-			      DNS_LOGMODULE_MASTER, ISC_LOG_INFO,
-			      "rpz: %s: new zone version came "
-			      "too soon, deferring update for "
-			      "%llu seconds", dname, defer);
-		isc_interval_set(&interval, (unsigned int)defer, 0);
-		isc_timer_reset(rpz->updatetimer, isc_timertype_once,
-				NULL, &interval, ISC_TRUE);
-	}
-	UNLOCK(&rpz->rpzs->maint_lock);
+	update_done(rpz, ISC_FALSE, isc_ht_count(rpz->nodes));
 
 cleanup:
 	if (iter != NULL)
 		isc_ht_iter_destroy(&iter);
 }
 
+/*
+ * Compile the policy of a policy zone node that consists of a CNAME
+ * whose meaning does not depend on the query, with the iterator at the
+ * node's first rdataset.  The server looks up everything else in the
+ * policy zone.
+ */
+static dns_rpz_policy_t
+compile_policy(dns_rpz_zone_t *rpz, dns_rdatasetiter_t *rdsiter) {
+	dns_rdataset_t rdataset;
+	dns_rpz_policy_t policy = DNS_RPZ_POLICY_RECORD;
+
+	dns_rdataset_init(&rdataset);
+	dns_rdatasetiter_current(rdsiter, &rdataset);
+	if (rdataset.type == dns_rdatatype_cname &&
+	    dns_rdatasetiter_next(rdsiter) == ISC_R_NOMORE)
+	{
+		policy = dns_rpz_decode_cname(rpz, &rdataset, NULL);
+		switch (policy) {
+		case DNS_RPZ_POLICY_PASSTHRU:
+		case DNS_RPZ_POLICY_DROP:
+		case DNS_RPZ_POLICY_TCP_ONLY:
+		case DNS_RPZ_POLICY_NXDOMAIN:
+		case DNS_RPZ_POLICY_NODATA:
+			break;
+		default:
+			policy = DNS_RPZ_POLICY_RECORD;
+			break;
+		}
+	}
+	dns_rdataset_disassociate(&rdataset);
+	return (policy);
+}
+
 static void
 update_quantum(isc_task_t *task, isc_event_t *event) {
 	isc_result_t result = ISC_R_SUCCESS;
 	dns_dbnode_t *node = NULL;
 	dns_rpz_zone_t *rpz;
+	dns_rpz_policy_t policy;
 	char domain[DNS_NAME_FORMATSIZE];
 	dns_fixedname_t fixname;
 	dns_name_t *name;
@@ -1865,6 +2182,11 @@ update_quantum(isc_task_t *task, isc_event_t *event) {
 			dns_db_detachnode(rpz->updb, &node);
 			break;
 		}
+		/*
+		 * The node tables are keyed on the lower case name, as
+		 * in update_from_journal().
+		 */
+		(void)dns_name_downcase(name, name, NULL);
 
 		result = dns_db_allrdatasets(rpz->updb, node, rpz->updbversion,
 					     0, &rdsiter);
@@ -1879,6 +2201,8 @@ update_quantum(isc_task_t *task, isc_event_t *event) {
 		}
 
 		result = dns_rdatasetiter_first(rdsiter);
+		if (result == ISC_R_SUCCESS)
+			policy = compile_policy(rpz, rdsiter);
 		dns_rdatasetiter_destroy(&rdsiter);
 		if (result != ISC_R_SUCCESS) { /* empty non-terminal */
 			if (result != ISC_R_NOMORE)
@@ -1906,12 +2230,19 @@ update_quantum(isc_task_t *task, isc_event_t *event) {
 			continue;
 		}
 
+		/*
+		 * Names that were already in the summary data are added
+		 * again in case their policies changed.
+		 */
 		result = isc_ht_find(rpz->nodes, name->ndata,
 				     name->length, NULL);
 		if (result == ISC_R_SUCCESS) {
 			isc_ht_delete(rpz->nodes, name->ndata, name->length);
+			(void)dns_rpz_add_policy(rpz->rpzs, rpz->num,
+						 name, policy);
 		} else { /* not found */
-			result = dns_rpz_add(rpz->rpzs, rpz->num, name);
+			result = dns_rpz_add_policy(rpz->rpzs, rpz->num,
+						    name, policy);
 			if (result != ISC_R_SUCCESS) {
 				dns_name_format(name, namebuf, sizeof(namebuf));
 				isc_log_write(dns_lctx,
@@ -1960,9 +2291,6 @@ update_quantum(isc_task_t *task, isc_event_t *event) {
 		 * All done.
 		 */
 		finish_update(rpz);
-		isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
-			      DNS_LOGMODULE_MASTER, ISC_LOG_INFO,
-			      "rpz: %s: reload done", domain);
 	}
 
 	/*
@@ -1977,6 +2305,230 @@ update_quantum(isc_task_t *task, isc_event_t *event) {
 	dns_db_detach(&rpz->updb);
 }
 
+/*
+ * Bring the summary data for 'name' up to date with version
+ * 'rpz->updbversion' of the policy zone, adding it with its current
+ * policy if it owns records there, and deleting it otherwise.
+ */
+static isc_result_t
+update_name(dns_rpz_zone_t *rpz, const dns_name_t *name) {
+	isc_result_t result;
+	dns_dbnode_t *node = NULL;
+	dns_rdatasetiter_t *rdsiter = NULL;
+	dns_rpz_policy_t policy = DNS_RPZ_POLICY_RECORD;
+	isc_boolean_t exists = ISC_FALSE, known;
+	char namebuf[DNS_NAME_FORMATSIZE];
+
+	result = dns_db_findnode(rpz->updb, name, ISC_FALSE, &node);
+	if (result == ISC_R_SUCCESS) {
+		result = dns_db_allrdatasets(rpz->updb, node,
+					     rpz->updbversion, 0, &rdsiter);
+		if (result == ISC_R_SUCCESS) {
+			result = dns_rdatasetiter_first(rdsiter);
+			if (result == ISC_R_SUCCESS) {
+				policy = compile_policy(rpz, rdsiter);
+				exists = ISC_TRUE;
+			}
+			dns_rdatasetiter_destroy(&rdsiter);
+		}
+		dns_db_detachnode(rpz->updb, &node);
+	}
+	if (result != ISC_R_SUCCESS && result != ISC_R_NOTFOUND &&
+	    result != ISC_R_NOMORE)
+		return (result);
+
+	known = ISC_TF(isc_ht_find(rpz->nodes, name->ndata, name->length,
+				   NULL) == ISC_R_SUCCESS);
+	if (!exists) {
+		if (known) {
+			isc_ht_delete(rpz->nodes, name->ndata, name->length);
+			dns_rpz_delete(rpz->rpzs, rpz->num, name);
+		}
+		return (ISC_R_SUCCESS);
+	}
+
+	if (!known) {
+		result = isc_ht_add(rpz->nodes, name->ndata, name->length,
+				    rpz);
+		if (result != ISC_R_SUCCESS)
+			return (result);
+	}
+	result = dns_rpz_add_policy(rpz->rpzs, rpz->num, name, policy);
+	if (result != ISC_R_SUCCESS && !known) {
+		char domain[DNS_NAME_FORMATSIZE];
+
+		dns_name_format(&rpz->origin, domain, DNS_NAME_FORMATSIZE);
+		dns_name_format(name, namebuf, sizeof(namebuf));
+		isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
+			      DNS_LOGMODULE_MASTER, ISC_LOG_ERROR,
+			      "rpz: %s: adding node %s to RPZ error %s",
+			      domain, namebuf, isc_result_totext(result));
+	}
+
+	return (ISC_R_SUCCESS);
+}
+
+/*
+ * Update the summary data of 'rpz' from serial 'rpz->serial' to the
+ * serial of version 'rpz->updbversion', looking only at the names
+ * that the zone's journal says have changed.  Fails without changing
+ * anything if there is no journal or it does not cover those serials.
+ */
+static isc_result_t
+update_from_journal(dns_rpz_zone_t *rpz, unsigned int *countp) {
+	isc_result_t result, hresult;
+	isc_mem_t *mctx = rpz->rpzs->mctx;
+	dns_journal_t *journal = NULL;
+	isc_ht_t *changed = NULL;
+	isc_ht_iter_t *iter = NULL;
+	char *journalfile = NULL;
+	isc_uint32_t begin, end;
+	dns_fixedname_t fname;
+	dns_name_t *name, *downname;
+	dns_rdata_t *rdata;
+	isc_uint32_t ttl;
+	unsigned int count = 0;
+
+	LOCK(&rpz->rpzs->maint_lock);
+	begin = rpz->serial;
+	if (rpz->journal != NULL)
+		journalfile = isc_mem_strdup(mctx, rpz->journal);
+	UNLOCK(&rpz->rpzs->maint_lock);
+	if (journalfile == NULL)
+		return (ISC_R_NOTFOUND);
+
+	result = dns_db_getsoaserial(rpz->updb, rpz->updbversion, &end);
+	if (result != ISC_R_SUCCESS)
+		goto cleanup;
+	if (begin == end)
+		goto cleanup;
+
+	result = dns_journal_open(mctx, journalfile, DNS_JOURNAL_READ,
+				  &journal);
+	if (result != ISC_R_SUCCESS)
+		goto cleanup;
+
+	result = dns_journal_iter_init(journal, begin, end);
+	if (result != ISC_R_SUCCESS)
+		goto cleanup;
+
+	result = isc_ht_init(&changed, mctx, 8);
+	if (result != ISC_R_SUCCESS)
+		goto cleanup;
+
+	/*
+	 * Journal names keep the case they were transferred or updated
+	 * with, so key them on the lower case name.
+	 */
+	dns_fixedname_init(&fname);
+	downname = dns_fixedname_name(&fname);
+	for (result = dns_journal_first_rr(journal);
+	     result == ISC_R_SUCCESS;
+	     result = dns_journal_next_rr(journal))
+	{
+		dns_journal_current_rr(journal, &name, &ttl, &rdata);
+		if (rdata->type == dns_rdatatype_soa &&
+		    dns_name_equal(name, &rpz->origin))
+			continue;
+		result = dns_name_downcase(name, downname, NULL);
+		if (result != ISC_R_SUCCESS)
+			goto cleanup;
+		result = isc_ht_add(changed, downname->ndata,
+				    downname->length, NULL);
+		if (result != ISC_R_SUCCESS && result != ISC_R_EXISTS)
+			goto cleanup;
+	}
+	if (result != ISC_R_NOMORE)
+		goto cleanup;
+	dns_journal_destroy(&journal);
+
+	/*
+	 * Nothing has been changed so far.  A failure from here on
+	 * leaves the summary data partly updated, which the walk of
+	 * the whole zone that follows it puts right.
+	 */
+	result = isc_ht_iter_create(changed, &iter);
+	if (result != ISC_R_SUCCESS)
+		goto cleanup;
+
+	dns_fixedname_init(&fname);
+	name = dns_fixedname_name(&fname);
+	for (hresult = isc_ht_iter_first(iter);
+	     hresult == ISC_R_SUCCESS;
+	     hresult = isc_ht_iter_next(iter))
+	{
+		isc_region_t region;
+		unsigned char *key;
+		size_t keysize;
+
+		isc_ht_iter_currentkey(iter, &key, &keysize);
+		region.base = key;
+		region.length = (unsigned int)keysize;
+		dns_name_fromregion(name, &region);
+		result = update_name(rpz, name);
+		if (result != ISC_R_SUCCESS)
+			goto cleanup;
+		count++;
+	}
+	result = (hresult == ISC_R_NOMORE) ? ISC_R_SUCCESS : hresult;
+
+ cleanup:
+	if (iter != NULL)
+		isc_ht_iter_destroy(&iter);
+	if (changed != NULL)
+		isc_ht_destroy(&changed);
+	if (journal != NULL)
+		dns_journal_destroy(&journal);
+	isc_mem_free(mctx, journalfile);
+	*countp = count;
+	return (result);
+}
+
+static void
+update_incremental(isc_task_t *task, isc_event_t *event) {
+	isc_result_t result;
+	dns_rpz_zone_t *rpz;
+	unsigned int count = 0;
+	char domain[DNS_NAME_FORMATSIZE];
+
+	UNUSED(task);
+
+	REQUIRE(event != NULL);
+	REQUIRE(event->ev_arg != NULL);
+
+	rpz = (dns_rpz_zone_t *) event->ev_arg;
+	isc_event_free(&event);
+
+	result = update_from_journal(rpz, &count);
+	if (result == ISC_R_SUCCESS) {
+		update_done(rpz, ISC_TRUE, count);
+		goto cleanup;
+	}
+
+	dns_name_format(&rpz->origin, domain, DNS_NAME_FORMATSIZE);
+	isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
+		      DNS_LOGMODULE_MASTER, ISC_LOG_DEBUG(1),
+		      "rpz: %s: cannot be updated incrementally (%s)",
+		      domain, isc_result_totext(result));
+
+	result = setup_update(rpz);
+	if (result != ISC_R_SUCCESS)
+		goto cleanup;
+
+	event = &rpz->updateevent;
+	INSIST(!ISC_LINK_LINKED(&rpz->updateevent, ev_link));
+	ISC_EVENT_INIT(&rpz->updateevent, sizeof(rpz->updateevent),
+		       0, NULL, DNS_EVENT_RPZUPDATED,
+		       update_quantum, rpz, rpz, NULL, NULL);
+	isc_task_send(rpz->rpzs->updater, &event);
+	return;
+
+ cleanup:
+	if (rpz->updbversion != NULL)
+		dns_db_closeversion(rpz->updb, &rpz->updbversion, ISC_FALSE);
+	dns_db_detach(&rpz->updb);
+}
+
 static void
 dns_rpz_update_from_db(dns_rpz_zone_t *rpz) {
 	isc_result_t result;
@@ -1992,6 +2544,21 @@ dns_rpz_update_from_db(dns_rpz_zone_t *rpz) {
 	dns_db_attach(rpz->db, &rpz->updb);
 	rpz->updbversion = rpz->dbversion;
 	rpz->dbversion = NULL;
+	isc_time_now(&rpz->updatestarted);
+
+	/*
+	 * If the summary data was built from an earlier version of this
+	 * database, try to apply just the changes since then.
+	 */
+	if (rpz->haveserial) {
+		event = &rpz->updateevent;
+		INSIST(!ISC_LINK_LINKED(&rpz->updateevent, ev_link));
+		ISC_EVENT_INIT(&rpz->updateevent, sizeof(rpz->updateevent),
+			       0, NULL, DNS_EVENT_RPZUPDATED,
+			       update_incremental, rpz, rpz, NULL, NULL);
+		isc_task_send(rpz->rpzs->updater, &event);
+		return;
+	}
 
 	result = setup_update(rpz);
 	if (result != ISC_R_SUCCESS) {
@@ -2019,10 +2586,10 @@ dns_rpz_update_from_db(dns_rpz_zone_t *rpz) {
  * Free the radix tree of a response policy database.
  */
 static void
-cidr_free(dns_rpz_zones_t *rpzs) {
+cidr_free(dns_rpz_zones_t *rpzs, dns_rpz_cidr_node_t **root) {
 	dns_rpz_cidr_node_t *cur, *child, *parent;
 
-	cur = rpzs->cidr;
+	cur = *root;
 	while (cur != NULL) {
 		/* Depth first. */
 		child = cur->child[0];
@@ -2039,10 +2606,10 @@ cidr_free(dns_rpz_zones_t *rpzs) {
 		/* Delete this leaf and go up. */
 		parent = cur->parent;
 		if (parent == NULL)
-			rpzs->cidr = NULL;
+			*root = NULL;
 		else
 			parent->child[parent->child[1] == cur] = NULL;
-		isc_mem_put(rpzs->mctx, cur, sizeof(*cur));
+		isc_mem_put(rpzs->smctx, cur, sizeof(*cur));
 		cur = parent;
 	}
 }
@@ -2087,8 +2654,13 @@ rpz_detach(dns_rpz_zone_t **rpzp, dns_rpz_zones_t *rpzs) {
 	if (rpz->dbversion != NULL)
 		dns_db_closeversion(rpz->db, &rpz->dbversion,
 				    ISC_FALSE);
+	if (rpz->sumversion != NULL)
+		dns_db_closeversion(rpz->db, &rpz->sumversion,
+				    ISC_FALSE);
 	if (rpz->db)
 		dns_db_detach(&rpz->db);
+	if (rpz->journal != NULL)
+		isc_mem_free(rpzs->mctx, rpz->journal);
 	isc_ht_destroy(&rpz->nodes);
 	isc_timer_detach(&rpz->updatetimer);
 
@@ -2141,10 +2713,13 @@ dns_rpz_detach_rpzs(dns_rpz_zones_t **rpzsp) {
 			    rpzs->rps_cstr_size);
 	}
 
-	cidr_free(rpzs);
+	cidr_free(rpzs, &rpzs->cidr[0]);
+	cidr_free(rpzs, &rpzs->cidr[1]);
+	cidr_free(rpzs, &rpzs->cidr[2]);
 	if (rpzs->rbt != NULL) {
 		dns_rbt_destroy(&rpzs->rbt);
 	}
+	isc_mem_detach(&rpzs->smctx);
 	DESTROYLOCK(&rpzs->maint_lock);
 	isc_rwlock_destroy(&rpzs->search_lock);
 	isc_refcount_destroy(&rpzs->refs);
@@ -2186,6 +2761,18 @@ dns_rpz_ready(dns_rpz_zones_t *rpzs,
 isc_result_t
 dns_rpz_add(dns_rpz_zones_t *rpzs, dns_rpz_num_t rpz_num,
 	    const dns_name_t *src_name)
+{
+	return (dns_rpz_add_policy(rpzs, rpz_num, src_name,
+				   DNS_RPZ_POLICY_RECORD));
+}
+
+/*
+ * Add an IP address or name along with the policy compiled from its
+ * policy record.
+ */
+isc_result_t
+dns_rpz_add_policy(dns_rpz_zones_t *rpzs, dns_rpz_num_t rpz_num,
+		   const dns_name_t *src_name, dns_rpz_policy_t policy)
 {
 	dns_rpz_zone_t *rpz;
 	dns_rpz_type_t rpz_type;
@@ -2202,12 +2789,12 @@ dns_rpz_add(dns_rpz_zones_t *rpzs, dns_rpz_num_t rpz_num,
 	switch (rpz_type) {
 	case DNS_RPZ_TYPE_QNAME:
 	case DNS_RPZ_TYPE_NSDNAME:
-		result = add_name(rpzs, rpz_num, rpz_type, src_name);
+		result = add_name(rpzs, rpz_num, rpz_type, src_name, policy);
 		break;
 	case DNS_RPZ_TYPE_CLIENT_IP:
 	case DNS_RPZ_TYPE_IP:
 	case DNS_RPZ_TYPE_NSIP:
-		result = add_cidr(rpzs, rpz_num, rpz_type, src_name);
+		result = add_cidr(rpzs, rpz_num, rpz_type, src_name, policy);
 		break;
 	case DNS_RPZ_TYPE_BAD:
 		break;
@@ -2227,8 +2814,8 @@ del_cidr(dns_rpz_zones_t *rpzs, dns_rpz_num_t rpz_num,
 	isc_result_t result;
 	dns_rpz_cidr_key_t tgt_ip;
 	dns_rpz_prefix_t tgt_prefix;
-	dns_rpz_addr_zbits_t tgt_set;
-	dns_rpz_cidr_node_t *tgt, *parent, *child;
+	dns_rpz_zbits_t tgt_set;
+	dns_rpz_cidr_node_t **root, *tgt, *parent, *child;
 
 	/*
 	 * Do not worry about invalid rpz IP address names.  If we
@@ -2240,7 +2827,8 @@ del_cidr(dns_rpz_zones_t *rpzs, dns_rpz_num_t rpz_num,
 	if (result != ISC_R_SUCCESS)
 		return;
 
-	result = search(rpzs, &tgt_ip, tgt_prefix, &tgt_set, ISC_FALSE, &tgt);
+	result = search(rpzs, rpz_type, &tgt_ip, tgt_prefix, tgt_set,
+			ISC_FALSE, &tgt);
 	if (result != ISC_R_SUCCESS) {
 		INSIST(result == ISC_R_NOTFOUND ||
 		       result == DNS_R_PARTIALMATCH);
@@ -2257,13 +2845,10 @@ del_cidr(dns_rpz_zones_t *rpzs, dns_rpz_num_t rpz_num,
 	 * Mark the node and its parents to reflect the deleted IP address.
 	 * Do not count bits that are already clear for internal RBTDB nodes.
 	 */
-	tgt_set.client_ip &= tgt->set.client_ip;
-	tgt_set.ip &= tgt->set.ip;
-	tgt_set.nsip &= tgt->set.nsip;
-	tgt->set.client_ip &= ~tgt_set.client_ip;
-	tgt->set.ip &= ~tgt_set.ip;
-	tgt->set.nsip &= ~tgt_set.nsip;
+	tgt_set &= tgt->set;
+	tgt->set &= ~tgt_set;
 	set_sum_pair(tgt);
+	clear_cpol(&tgt->pol, rpz_num);
 
 	adj_trigger_cnt(rpzs, rpz_num, rpz_type, &tgt_ip, tgt_prefix,
 			ISC_FALSE);
@@ -2282,9 +2867,7 @@ del_cidr(dns_rpz_zones_t *rpzs, dns_rpz_num_t rpz_num,
 		} else {
 			child = tgt->child[1];
 		}
-		if (tgt->set.client_ip != 0 ||
-		    tgt->set.ip != 0 ||
-		    tgt->set.nsip != 0)
+		if (tgt->set != 0)
 			break;
 
 		/*
@@ -2293,7 +2876,8 @@ del_cidr(dns_rpz_zones_t *rpzs, dns_rpz_num_t rpz_num,
 		 */
 		parent = tgt->parent;
 		if (parent == NULL) {
-			rpzs->cidr = child;
+			root = cidr_root(rpzs, rpz_type);
+			*root = child;
 		} else {
 			parent->child[parent->child[1] == tgt] = child;
 		}
@@ -2302,7 +2886,7 @@ del_cidr(dns_rpz_zones_t *rpzs, dns_rpz_num_t rpz_num,
 		 */
 		if (child != NULL)
 			child->parent = parent;
-		isc_mem_put(rpzs->mctx, tgt, sizeof(*tgt));
+		isc_mem_put(rpzs->smctx, tgt, sizeof(*tgt));
 
 		tgt = parent;
 	} while (tgt != NULL);
@@ -2316,7 +2900,7 @@ del_name(dns_rpz_zones_t *rpzs, dns_rpz_num_t rpz_num,
 	dns_fixedname_t trig_namef;
 	dns_name_t *trig_name;
 	dns_rbtnode_t *nmnode;
-	dns_rpz_nm_data_t *nm_data, del_data;
+	dns_rpz_nm_data_t nm_data, del_data;
 	isc_result_t result;
 	isc_boolean_t exists;
 
@@ -2350,28 +2934,39 @@ del_name(dns_rpz_zones_t *rpzs, dns_rpz_num_t rpz_num,
 		return;
 	}
 
-	nm_data = nmnode->data;
-	INSIST(nm_data != NULL);
+	INSIST(nmnode->data != NULL);
+	nm_load(nmnode->data, &nm_data);
 
 	/*
 	 * Do not count bits that next existed for RBT nodes that would we
 	 * would not have found in a summary for a single RBTDB tree.
 	 */
-	del_data.set.qname &= nm_data->set.qname;
-	del_data.set.ns &= nm_data->set.ns;
-	del_data.wild.qname &= nm_data->wild.qname;
-	del_data.wild.ns &= nm_data->wild.ns;
+	del_data.set.qname &= nm_data.set.qname;
+	del_data.set.ns &= nm_data.set.ns;
+	del_data.wild.qname &= nm_data.wild.qname;
+	del_data.wild.ns &= nm_data.wild.ns;
 
 	exists = ISC_TF(del_data.set.qname != 0 || del_data.set.ns != 0 ||
 			del_data.wild.qname != 0 || del_data.wild.ns != 0);
 
-	nm_data->set.qname &= ~del_data.set.qname;
-	nm_data->set.ns &= ~del_data.set.ns;
-	nm_data->wild.qname &= ~del_data.wild.qname;
-	nm_data->wild.ns &= ~del_data.wild.ns;
+	nm_data.set.qname &= ~del_data.set.qname;
+	nm_data.set.ns &= ~del_data.set.ns;
+	nm_data.wild.qname &= ~del_data.wild.qname;
+	nm_data.wild.ns &= ~del_data.wild.ns;
+	if (del_data.set.qname != 0 || del_data.set.ns != 0)
+		clear_cpol(nm_cpol(&nm_data, rpz_type), rpz_num);
 
-	if (nm_data->set.qname == 0 && nm_data->set.ns == 0 &&
-	    nm_data->wild.qname == 0 && nm_data->wild.ns == 0) {
+	if (nm_data.set.qname != 0 || nm_data.set.ns != 0 ||
+	    nm_data.wild.qname != 0 || nm_data.wild.ns != 0)
+	{
+		/*
+		 * Removing zones from data that was allocated can only
+		 * pack it, and packed data stays packed, so this does
+		 * not allocate memory.
+		 */
+		result = nm_store(rpzs, nmnode, &nm_data);
+		INSIST(result == ISC_R_SUCCESS);
+	} else {
 		result = dns_rbt_deletenode(rpzs->rbt, nmnode, ISC_FALSE);
 		if (result != ISC_R_SUCCESS) {
 			/*
@@ -2430,22 +3025,27 @@ dns_rpz_delete(dns_rpz_zones_t *rpzs, dns_rpz_num_t rpz_num,
  * policy zone relevant to a triggering IP address.
  *	rpz_type and zbits limit the search for IP address netaddr
  *	return the policy zone's number or DNS_RPZ_INVALID_NUM
- *	ip_name is the relative owner name found and
- *	*prefixp is its prefix length.
+ *	ip_name is the relative owner name found,
+ *	*prefixp is its prefix length,
+ *	*policyp is its compiled policy or DNS_RPZ_POLICY_RECORD, and
+ *	*versionp is the policy zone version the policy was compiled from.
  */
 dns_rpz_num_t
 dns_rpz_find_ip(dns_rpz_zones_t *rpzs, dns_rpz_type_t rpz_type,
 		dns_rpz_zbits_t zbits, const isc_netaddr_t *netaddr,
-		dns_name_t *ip_name, dns_rpz_prefix_t *prefixp)
+		dns_name_t *ip_name, dns_rpz_prefix_t *prefixp,
+		dns_rpz_policy_t *policyp, dns_dbversion_t **versionp)
 {
 	dns_rpz_cidr_key_t tgt_ip;
-	dns_rpz_addr_zbits_t tgt_set;
 	dns_rpz_cidr_node_t *found;
 	isc_result_t result;
 	dns_rpz_num_t rpz_num;
 	dns_rpz_have_t have;
 	int i;
 
+	*policyp = DNS_RPZ_POLICY_RECORD;
+	*versionp = NULL;
+
 	RWLOCK(&rpzs->search_lock, isc_rwlocktype_read);
 	have = rpzs->have;
 	RWUNLOCK(&rpzs->search_lock, isc_rwlocktype_read);
@@ -2504,10 +3104,10 @@ dns_rpz_find_ip(dns_rpz_zones_t *rpzs, dns_rpz_type_t rpz_type,
 
 	if (zbits == 0)
 		return (DNS_RPZ_INVALID_NUM);
-	make_addr_set(&tgt_set, zbits, rpz_type);
 
 	RWLOCK(&rpzs->search_lock, isc_rwlocktype_read);
-	result = search(rpzs, &tgt_ip, 128, &tgt_set, ISC_FALSE, &found);
+	result = search(rpzs, rpz_type, &tgt_ip, 128, zbits, ISC_FALSE,
+			&found);
 	if (result == ISC_R_NOTFOUND) {
 		/*
 		 * There are no eligible zones for this IP address.
@@ -2521,19 +3121,10 @@ dns_rpz_find_ip(dns_rpz_zones_t *rpzs, dns_rpz_type_t rpz_type,
 	 * in the first eligible zone with a match.
 	 */
 	*prefixp = found->prefix;
-	switch (rpz_type) {
-	case DNS_RPZ_TYPE_CLIENT_IP:
-		rpz_num = zbit_to_num(found->set.client_ip & tgt_set.client_ip);
-		break;
-	case DNS_RPZ_TYPE_IP:
-		rpz_num = zbit_to_num(found->set.ip & tgt_set.ip);
-		break;
-	case DNS_RPZ_TYPE_NSIP:
-		rpz_num = zbit_to_num(found->set.nsip & tgt_set.nsip);
-		break;
-	default:
-		INSIST(0);
-		break;
+	rpz_num = zbit_to_num(found->set & zbits);
+	if (found->pol.num == rpz_num) {
+		*policyp = found->pol.policy;
+		*versionp = rpzs->zones[rpz_num]->sumversion;
 	}
 	result = ip2name(&found->ip, found->prefix, dns_rootname, ip_name);
 	RWUNLOCK(&rpzs->search_lock, isc_rwlocktype_read);
@@ -2552,18 +3143,29 @@ dns_rpz_find_ip(dns_rpz_zones_t *rpzs, dns_rpz_type_t rpz_type,
 
 /*
  * Search the summary radix tree for policy zones with triggers matching
- * a name.
+ * a name.  *nump and *policyp are set to the most eligible zone with an
+ * exact trigger for the name and its compiled policy, if it is known,
+ * and *versionp to the policy zone version it was compiled from.
  */
 dns_rpz_zbits_t
 dns_rpz_find_name(dns_rpz_zones_t *rpzs, dns_rpz_type_t rpz_type,
-		  dns_rpz_zbits_t zbits, dns_name_t *trig_name)
+		  dns_rpz_zbits_t zbits, dns_name_t *trig_name,
+		  dns_rpz_num_t *nump, dns_rpz_policy_t *policyp,
+		  dns_dbversion_t **versionp)
 {
 	char namebuf[DNS_NAME_FORMATSIZE];
+	dns_rbtnodechain_t chain;
 	dns_rbtnode_t *nmnode;
-	const dns_rpz_nm_data_t *nm_data;
+	dns_rpz_nm_data_t nm_data;
+	const dns_rpz_cpol_t *cpol;
 	dns_rpz_zbits_t found_zbits;
+	unsigned int i, levels = 0;
 	isc_result_t result;
 
+	*nump = DNS_RPZ_INVALID_NUM;
+	*policyp = DNS_RPZ_POLICY_RECORD;
+	*versionp = NULL;
+
 	if (zbits == 0)
 		return (0);
 
@@ -2571,31 +3173,42 @@ dns_rpz_find_name(dns_rpz_zones_t *rpzs, dns_rpz_type_t rpz_type,
 
 	RWLOCK(&rpzs->search_lock, isc_rwlocktype_read);
 
+	/*
+	 * The chain records the superdomains of the name in the summary
+	 * database.  Their wildcard triggers match the name.
+	 */
+	dns_rbtnodechain_init(&chain, NULL);
 	nmnode = NULL;
-	result = dns_rbt_findnode(rpzs->rbt, trig_name, NULL, &nmnode, NULL,
-				  DNS_RBTFIND_EMPTYDATA, NULL, NULL);
+	result = dns_rbt_findnode(rpzs->rbt, trig_name, NULL, &nmnode, &chain,
+				  DNS_RBTFIND_EMPTYDATA |
+				  DNS_RBTFIND_NOPREDECESSOR,
+				  NULL, NULL);
 	switch (result) {
 	case ISC_R_SUCCESS:
-		nm_data = nmnode->data;
-		if (nm_data != NULL) {
+		if (nmnode->data != NULL) {
+			nm_load(nmnode->data, &nm_data);
 			if (rpz_type == DNS_RPZ_TYPE_QNAME)
-				found_zbits = nm_data->set.qname;
+				found_zbits = nm_data.set.qname;
 			else
-				found_zbits = nm_data->set.ns;
-		}
-		nmnode = nmnode->parent;
-		/* fall thru */
-	case DNS_R_PARTIALMATCH:
-		while (nmnode != NULL) {
-			nm_data = nmnode->data;
-			if (nm_data != NULL) {
-				if (rpz_type == DNS_RPZ_TYPE_QNAME)
-					found_zbits |= nm_data->wild.qname;
-				else
-					found_zbits |= nm_data->wild.ns;
+				found_zbits = nm_data.set.ns;
+			cpol = nm_cpol(&nm_data, rpz_type);
+			if (cpol->num != DNS_RPZ_INVALID_NUM &&
+			    cpol->policy != DNS_RPZ_POLICY_RECORD &&
+			    (zbits & found_zbits &
+			     DNS_RPZ_ZBIT(cpol->num)) != 0)
+			{
+				*nump = cpol->num;
+				*policyp = cpol->policy;
+				*versionp = rpzs->zones[cpol->num]->sumversion;
 			}
-			nmnode = nmnode->parent;
 		}
+		levels = chain.level_matches;
+		break;
+	case DNS_R_PARTIALMATCH:
+		/*
+		 * The partially matching node is the last superdomain.
+		 */
+		levels = chain.level_matches + 1;
 		break;
 
 	case ISC_R_NOTFOUND:
@@ -2613,6 +3226,17 @@ dns_rpz_find_name(dns_rpz_zones_t *rpzs, dns_rpz_type_t rpz_type,
 		break;
 	}
 
+	for (i = 0; i < levels; i++) {
+		if (chain.levels[i]->data != NULL) {
+			nm_load(chain.levels[i]->data, &nm_data);
+			if (rpz_type == DNS_RPZ_TYPE_QNAME)
+				found_zbits |= nm_data.wild.qname;
+			else
+				found_zbits |= nm_data.wild.ns;
+		}
+	}
+
+	dns_rbtnodechain_invalidate(&chain);
 	RWUNLOCK(&rpzs->search_lock, isc_rwlocktype_read);
 	return (zbits & found_zbits);
 }
@@ -2687,3 +3311,154 @@ dns_rpz_decode_cname(dns_rpz_zone_t *rpz, dns_rdataset_t *rdataset,
 	 */
 	return (DNS_RPZ_POLICY_RECORD);
 }
+
+typedef struct {
+	isc_uint64_t	triggers;	/* in all of the policy zones */
+	isc_uint64_t	inuse;		/* summary memory in use */
+	isc_uint64_t	pertrigger;	/* summary bytes per trigger */
+	isc_uint64_t	updatetime;	/* longest last update, microseconds */
+	isc_uint64_t	incremental;	/* zones last updated from journal */
+} summarystats_t;
+
+/*
+ * Count the triggers in the summary data of all of the policy zones,
+ * and find how long the last updates of the summary data took.
+ */
+static void
+summary_stats(dns_rpz_zones_t *rpzs, summarystats_t *stats) {
+	const dns_rpz_triggers_t *cnt;
+	const dns_rpz_zone_t *rpz;
+	dns_rpz_num_t rpz_num;
+
+	memset(stats, 0, sizeof(*stats));
+
+	LOCK(&rpzs->maint_lock);
+	for (rpz_num = 0; rpz_num < rpzs->p.num_zones; rpz_num++) {
+		cnt = &rpzs->triggers[rpz_num];
+		stats->triggers += cnt->client_ipv4 + cnt->client_ipv6 +
+				   cnt->qname + cnt->ipv4 + cnt->ipv6 +
+				   cnt->nsdname + cnt->nsipv4 + cnt->nsipv6;
+		rpz = rpzs->zones[rpz_num];
+		if (rpz == NULL)
+			continue;
+		if (rpz->updatetime > stats->updatetime)
+			stats->updatetime = rpz->updatetime;
+		if (rpz->incremental)
+			stats->incremental++;
+	}
+	UNLOCK(&rpzs->maint_lock);
+
+	stats->inuse = isc_mem_inuse(rpzs->smctx);
+	if (stats->triggers != 0)
+		stats->pertrigger = stats->inuse / stats->triggers;
+}
+
+void
+dns_rpz_dumpstats(dns_rpz_zones_t *rpzs, FILE *fp) {
+	summarystats_t stats;
+
+	REQUIRE(rpzs != NULL);
+
+	summary_stats(rpzs, &stats);
+
+	fprintf(fp, "%20" ISC_PRINT_QUADFORMAT "u %s\n",
+		stats.triggers, "policy triggers");
+	fprintf(fp, "%20" ISC_PRINT_QUADFORMAT "u %s\n",
+		stats.inuse, "summary memory in use");
+	fprintf(fp, "%20" ISC_PRINT_QUADFORMAT "u %s\n",
+		(isc_uint64_t) isc_mem_maxinuse(rpzs->smctx),
+		"summary highest memory in use");
+	fprintf(fp, "%20" ISC_PRINT_QUADFORMAT "u %s\n",
+		stats.pertrigger, "summary memory bytes per trigger");
+	fprintf(fp, "%20" ISC_PRINT_QUADFORMAT "u %s\n",
+		stats.updatetime, "summary last update microseconds");
+	fprintf(fp, "%20" ISC_PRINT_QUADFORMAT "u %s\n",
+		stats.incremental, "zones last updated from the journal");
+}
+
+#ifdef HAVE_LIBXML2
+#define TRY0(a) do { xmlrc = (a); if (xmlrc < 0) goto error; } while(0)
+static int
+renderstat(const char *name, isc_uint64_t value, xmlTextWriterPtr writer) {
+	int xmlrc;
+
+	TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "counter"));
+	TRY0(xmlTextWriterWriteAttribute(writer,
+					 ISC_XMLCHAR "name", ISC_XMLCHAR name));
+	TRY0(xmlTextWriterWriteFormatString(writer,
+					    "%" ISC_PRINT_QUADFORMAT "u",
+					    value));
+	TRY0(xmlTextWriterEndElement(writer)); /* counter */
+
+error:
+	return (xmlrc);
+}
+
+int
+dns_rpz_renderxml(dns_rpz_zones_t *rpzs, xmlTextWriterPtr writer) {
+	summarystats_t stats;
+	int xmlrc;
+
+	REQUIRE(rpzs != NULL);
+
+	summary_stats(rpzs, &stats);
+
+	TRY0(renderstat("Triggers", stats.triggers, writer));
+	TRY0(renderstat("SummaryMemInUse", stats.inuse, writer));
+	TRY0(renderstat("SummaryMemMax",
+			isc_mem_maxinuse(rpzs->smctx), writer));
+	TRY0(renderstat("SummaryBytesPerTrigger", stats.pertrigger, writer));
+	TRY0(renderstat("SummaryUpdateTime", stats.updatetime, writer));
+	TRY0(renderstat("SummaryIncremental", stats.incremental, writer));
+error:
+	return (xmlrc);
+}
+#endif
+
+#ifdef HAVE_JSON
+#define CHECKMEM(m) do { \
+	if (m == NULL) { \
+		result = ISC_R_NOMEMORY;\
+		goto error;\
+	} \
+} while(0)
+
+isc_result_t
+dns_rpz_renderjson(dns_rpz_zones_t *rpzs, json_object *rstats) {
+	isc_result_t result = ISC_R_SUCCESS;
+	summarystats_t stats;
+	json_object *obj;
+
+	REQUIRE(rpzs != NULL);
+
+	summary_stats(rpzs, &stats);
+
+	obj = json_object_new_int64(stats.triggers);
+	CHECKMEM(obj);
+	json_object_object_add(rstats, "Triggers", obj);
+
+	obj = json_object_new_int64(stats.inuse);
+	CHECKMEM(obj);
+	json_object_object_add(rstats, "SummaryMemInUse", obj);
+
+	obj = json_object_new_int64(isc_mem_maxinuse(rpzs->smctx));
+	CHECKMEM(obj);
+	json_object_object_add(rstats, "SummaryMemMax", obj);
+
+	obj = json_object_new_int64(stats.pertrigger);
+	CHECKMEM(obj);
+	json_object_object_add(rstats, "SummaryBytesPerTrigger", obj);
+
+	obj = json_object_new_int64(stats.updatetime);
+	CHECKMEM(obj);
+	json_object_object_add(rstats, "SummaryUpdateTime", obj);
+
+	obj = json_object_new_int64(stats.incremental);
+	CHECKMEM(obj);
+	json_object_object_add(rstats, "SummaryIncremental", obj);
+
+	result = ISC_R_SUCCESS;
+error:
+	return (result);
+}
+#endif
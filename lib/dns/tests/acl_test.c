@@ -15,9 +15,11 @@
 #include <atf-c.h>
 
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 
 #include <isc/print.h>
+#include <isc/time.h>
 
 #include <dns/acl.h>
 #include "dnstest.h"
@@ -324,10 +326,402 @@ ATF_TC_BODY(dns_acl_isinsecure, tc) {
 	dns_test_end();
 }
 
+/*
+ * A deterministic pseudo-random sequence, so that failures can be
+ * reproduced.
+ */
+static isc_uint32_t
+nextrand(isc_uint32_t *state) {
+	*state = *state * 1103515245 + 12345;
+	return ((*state >> 16) | (*state << 16));
+}
+
+static void
+randaddr(isc_uint32_t *state, int family, isc_netaddr_t *addr) {
+	if (family == AF_INET) {
+		struct in_addr ina;
+
+		ina.s_addr = nextrand(state);
+		isc_netaddr_fromin(addr, &ina);
+	} else {
+		struct in6_addr in6a;
+		isc_uint32_t r;
+		unsigned int i;
+
+		for (i = 0; i < 16; i += 4) {
+			r = nextrand(state);
+			memmove(&in6a.s6_addr[i], &r, 4);
+		}
+		/* Keep the addresses close together. */
+		in6a.s6_addr[0] = 0x20;
+		in6a.s6_addr[1] = 0x01;
+		in6a.s6_addr[2] &= 0x0f;
+		isc_netaddr_fromin6(addr, &in6a);
+	}
+}
+
+/*
+ * Add the same prefix to each of 'acls'.
+ */
+static void
+addprefix(dns_acl_t **acls, unsigned int nacls, const isc_netaddr_t *addr,
+	  unsigned int bitlen, isc_boolean_t pos)
+{
+	isc_result_t result;
+	unsigned int i;
+
+	for (i = 0; i < nacls; i++) {
+		result = dns_iptable_addprefix(acls[i]->iptable, addr,
+					       bitlen, pos);
+		ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	}
+}
+
+/*
+ * Check that 'compiled' gives the same result as 'radix' for 'count'
+ * random addresses of each family.
+ */
+static void
+compare(dns_acl_t *radix, dns_acl_t *compiled, isc_uint32_t seed,
+	unsigned int count)
+{
+	static const int families[] = { AF_INET, AF_INET6 };
+	isc_netaddr_t addr;
+	int match1, match2;
+	unsigned int f, i;
+
+	for (f = 0; f < sizeof(families)/sizeof(families[0]); f++) {
+		for (i = 0; i < count; i++) {
+			randaddr(&seed, families[f], &addr);
+			(void)dns_acl_match(&addr, NULL, radix, NULL,
+					    &match1, NULL);
+			(void)dns_acl_match(&addr, NULL, compiled, NULL,
+					    &match2, NULL);
+			ATF_CHECK_EQ(match1, match2);
+		}
+	}
+}
+
+ATF_TC(dns_acl_compile);
+ATF_TC_HEAD(dns_acl_compile, tc) {
+	atf_tc_set_md_var(tc, "descr",
+			  "test that compiled ACLs match like the radix tree");
+}
+ATF_TC_BODY(dns_acl_compile, tc) {
+	isc_result_t result;
+	dns_acl_t *acls[2] = { NULL, NULL };
+	dns_acl_t *nested = NULL;
+	isc_uint32_t seed = 1;
+	isc_netaddr_t addr;
+	struct in_addr inaddr;
+	struct in6_addr in6addr;
+	unsigned int i, bitlen;
+	int match;
+
+	UNUSED(tc);
+
+	result = dns_test_begin(NULL, ISC_FALSE);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	result = dns_acl_create(mctx, 0, &acls[0]);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	result = dns_acl_create(mctx, 0, &acls[1]);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	/* An empty ACL matches nothing. */
+	result = dns_acl_compile(acls[1]);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	inaddr.s_addr = htonl(0x0a000001);	/* 10.0.0.1 */
+	isc_netaddr_fromin(&addr, &inaddr);
+	(void)dns_acl_match(&addr, NULL, acls[1], NULL, &match, NULL);
+	ATF_CHECK_EQ(match, 0);
+
+	/*
+	 * Nested prefixes: !10.0.0.0/24; 10.0.0.0/8; 10.0.0.1 is
+	 * matched by the first.
+	 */
+	inaddr.s_addr = htonl(0x0a000000);
+	isc_netaddr_fromin(&addr, &inaddr);
+	addprefix(acls, 2, &addr, 24, ISC_FALSE);
+	addprefix(acls, 2, &addr, 8, ISC_TRUE);
+	result = dns_acl_compile(acls[1]);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	inaddr.s_addr = htonl(0x0a000001);
+	isc_netaddr_fromin(&addr, &inaddr);
+	(void)dns_acl_match(&addr, NULL, acls[1], NULL, &match, NULL);
+	ATF_CHECK_EQ(match, -1);
+	inaddr.s_addr = htonl(0x0a000100);	/* 10.0.1.0 */
+	isc_netaddr_fromin(&addr, &inaddr);
+	(void)dns_acl_match(&addr, NULL, acls[1], NULL, &match, NULL);
+	ATF_CHECK_EQ(match, 2);
+	inaddr.s_addr = htonl(0x0b000000);	/* 11.0.0.0 */
+	isc_netaddr_fromin(&addr, &inaddr);
+	(void)dns_acl_match(&addr, NULL, acls[1], NULL, &match, NULL);
+	ATF_CHECK_EQ(match, 0);
+
+	/*
+	 * A prefix added after compiling is matched, even if it lands
+	 * on a radix node that already exists: a00::/8 shares the node
+	 * of 10.0.0.0/8.
+	 */
+	memset(&in6addr, 0, sizeof(in6addr));
+	in6addr.s6_addr[0] = 0x0a;
+	isc_netaddr_fromin6(&addr, &in6addr);
+	addprefix(acls, 2, &addr, 8, ISC_TRUE);
+	in6addr.s6_addr[15] = 1;		/* a00::1 */
+	isc_netaddr_fromin6(&addr, &in6addr);
+	(void)dns_acl_match(&addr, NULL, acls[1], NULL, &match, NULL);
+	ATF_CHECK(match > 0);
+	compare(acls[0], acls[1], 1, 20000);
+
+	/*
+	 * A list of random prefixes of both families, some of them
+	 * negated.
+	 */
+	for (i = 0; i < 5000; i++) {
+		int family = (i % 2 == 0) ? AF_INET : AF_INET6;
+
+		randaddr(&seed, family, &addr);
+		if (family == AF_INET)
+			bitlen = 8 + nextrand(&seed) % 25;
+		else
+			bitlen = 16 + nextrand(&seed) % 113;
+		addprefix(acls, 2, &addr, bitlen,
+			  ISC_TF(nextrand(&seed) % 4 != 0));
+	}
+	result = dns_acl_compile(acls[1]);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	compare(acls[0], acls[1], 2, 20000);
+
+	/*
+	 * Prefixes added after compiling are matched; "any" comes
+	 * last and only matches addresses nothing else does.
+	 */
+	addprefix(acls, 2, NULL, 0, ISC_TRUE);
+	compare(acls[0], acls[1], 3, 20000);
+	result = dns_acl_compile(acls[1]);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	compare(acls[0], acls[1], 4, 20000);
+
+	/* A negated nested ACL merged in. */
+	result = dns_acl_create(mctx, 0, &nested);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	for (i = 0; i < 1000; i++) {
+		int family = (i % 2 == 0) ? AF_INET : AF_INET6;
+
+		randaddr(&seed, family, &addr);
+		bitlen = (family == AF_INET) ? 16 + nextrand(&seed) % 17 :
+					       32 + nextrand(&seed) % 97;
+		addprefix(&nested, 1, &addr, bitlen,
+			  ISC_TF(nextrand(&seed) % 2 != 0));
+	}
+	for (i = 0; i < 2; i++) {
+		result = dns_acl_merge(acls[i], nested, ISC_FALSE);
+		ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	}
+	result = dns_acl_compile(acls[1]);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	compare(acls[0], acls[1], 5, 20000);
+
+	dns_acl_detach(&nested);
+	dns_acl_detach(&acls[0]);
+	dns_acl_detach(&acls[1]);
+	dns_test_end();
+}
+
+ATF_TC(dns_aclmap);
+ATF_TC_HEAD(dns_aclmap, tc) {
+	atf_tc_set_md_var(tc, "descr",
+			  "test that ACL maps give the ACLs that allow "
+			  "an address");
+}
+ATF_TC_BODY(dns_aclmap, tc) {
+	static const int families[] = { AF_INET, AF_INET6 };
+	isc_result_t result;
+	dns_acl_t *acls[70];
+	dns_aclmap_t *map = NULL;
+	const isc_uint64_t *set;
+	isc_uint32_t seed = 1;
+	isc_netaddr_t addr;
+	unsigned int f, i, j, nacls = sizeof(acls) / sizeof(acls[0]);
+
+	UNUSED(tc);
+
+	result = dns_test_begin(NULL, ISC_FALSE);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	/*
+	 * More than 64 ACLs, so that the sets take two words.  The
+	 * first is NULL, and the second has a key element and so is
+	 * in every set.
+	 */
+	acls[0] = NULL;
+	for (i = 1; i < nacls; i++) {
+		acls[i] = NULL;
+		result = dns_acl_create(mctx, 1, &acls[i]);
+		ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+		for (j = 0; j < 50; j++) {
+			int family = (j % 2 == 0) ? AF_INET : AF_INET6;
+			unsigned int bitlen;
+
+			randaddr(&seed, family, &addr);
+			bitlen = (family == AF_INET) ? 1 + nextrand(&seed) % 32 :
+						       8 + nextrand(&seed) % 121;
+			addprefix(&acls[i], 1, &addr, bitlen,
+				  ISC_TF(nextrand(&seed) % 3 != 0));
+		}
+	}
+	dns_name_init(&acls[1]->elements[0].keyname, NULL);
+	result = dns_name_dup(dns_rootname, mctx,
+			      &acls[1]->elements[0].keyname);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	acls[1]->elements[0].type = dns_aclelementtype_keyname;
+	acls[1]->elements[0].node_num = ++acls[1]->node_count;
+	acls[1]->length = 1;
+
+	result = dns_aclmap_create(mctx, acls, nacls, &map);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	for (f = 0; f < sizeof(families)/sizeof(families[0]); f++) {
+		for (i = 0; i < 5000; i++) {
+			randaddr(&seed, families[f], &addr);
+			set = dns_aclmap_find(map, &addr, NULL);
+			ATF_CHECK(DNS_ACLMAP_ISSET(set, 0));
+			ATF_CHECK(DNS_ACLMAP_ISSET(set, 1));
+			for (j = 2; j < nacls; j++) {
+				isc_boolean_t allowed;
+
+				allowed = dns_acl_allowed(&addr, NULL, NULL,
+							  0, NULL, acls[j],
+							  NULL);
+				ATF_CHECK_EQ(DNS_ACLMAP_ISSET(set, j),
+					     allowed);
+			}
+		}
+	}
+
+	dns_aclmap_destroy(&map);
+
+	/*
+	 * A prefix added after the map was built: the stale compiled
+	 * table is not used, and the next map sees the prefix.
+	 */
+	addprefix(&acls[2], 1, NULL, 0, ISC_TRUE);
+	result = dns_aclmap_create(mctx, acls, nacls, &map);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	for (f = 0; f < sizeof(families)/sizeof(families[0]); f++) {
+		for (i = 0; i < 1000; i++) {
+			randaddr(&seed, families[f], &addr);
+			set = dns_aclmap_find(map, &addr, NULL);
+			ATF_CHECK_EQ(DNS_ACLMAP_ISSET(set, 2),
+				     dns_acl_allowed(&addr, NULL, NULL, 0,
+						     NULL, acls[2], NULL));
+		}
+	}
+
+	dns_aclmap_destroy(&map);
+	for (i = 1; i < nacls; i++)
+		dns_acl_detach(&acls[i]);
+	dns_test_end();
+}
+
+#ifdef DNS_BENCHMARK_TESTS
+
+/*
+ * This is useful for comparing the compiled tables with the radix
+ * tree, but we don't require it as part of the unit test runs.
+ */
+
+ATF_TC(benchmark);
+ATF_TC_HEAD(benchmark, tc) {
+	atf_tc_set_md_var(tc, "descr",
+			  "Benchmark dns_acl_match() with a large blocklist");
+}
+ATF_TC_BODY(benchmark, tc) {
+	isc_result_t result;
+	dns_acl_t *acl = NULL;
+	isc_netaddr_t *addrs;
+	isc_uint32_t seed = 1;
+	unsigned int i, pass, nprefixes = 200000, naddrs = 1000000;
+	isc_time_t ts1, ts2;
+	double t;
+	int match;
+
+	UNUSED(tc);
+
+	result = dns_test_begin(NULL, ISC_FALSE);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	result = dns_acl_create(mctx, 0, &acl);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	addrs = isc_mem_get(mctx, naddrs * sizeof(*addrs));
+	ATF_REQUIRE(addrs != NULL);
+
+	/* Mostly single IPv4 addresses, as in a typical blocklist. */
+	for (i = 0; i < nprefixes; i++) {
+		int family = (i % 8 == 0) ? AF_INET6 : AF_INET;
+		isc_netaddr_t addr;
+		unsigned int bitlen;
+
+		randaddr(&seed, family, &addr);
+		if (family == AF_INET6)
+			bitlen = 48 + nextrand(&seed) % 81;
+		else
+			bitlen = (i % 4 == 0) ? 16 + nextrand(&seed) % 17 : 32;
+		addprefix(&acl, 1, &addr, bitlen, ISC_FALSE);
+	}
+	for (i = 0; i < naddrs; i++)
+		randaddr(&seed, (i % 8 == 0) ? AF_INET6 : AF_INET,
+			 &addrs[i]);
+
+	for (pass = 0; pass < 2; pass++) {
+		if (pass == 1) {
+			result = isc_time_now(&ts1);
+			ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+			result = dns_acl_compile(acl);
+			ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+			result = isc_time_now(&ts2);
+			ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+			t = isc_time_microdiff(&ts2, &ts1);
+			printf("compiled %u prefixes in %f seconds\n",
+			       nprefixes, t / 1000000.0);
+		}
+
+		result = isc_time_now(&ts1);
+		ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+		for (i = 0; i < 10 * naddrs; i++)
+			(void)dns_acl_match(&addrs[i % naddrs], NULL, acl,
+					    NULL, &match, NULL);
+
+		result = isc_time_now(&ts2);
+		ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+		t = isc_time_microdiff(&ts2, &ts1);
+		printf("%s: %u dns_acl_match() calls, %f seconds, "
+		       "%f calls/second\n", (pass == 0) ? "radix" : "compiled",
+		       10 * naddrs, t / 1000000.0,
+		       (10 * naddrs) / (t / 1000000.0));
+	}
+
+	isc_mem_put(mctx, addrs, naddrs * sizeof(*addrs));
+	dns_acl_detach(&acl);
+	dns_test_end();
+}
+
+#endif /* DNS_BENCHMARK_TESTS */
+
 /*
  * Main
  */
 ATF_TP_ADD_TCS(tp) {
 	ATF_TP_ADD_TC(tp, dns_acl_isinsecure);
+	ATF_TP_ADD_TC(tp, dns_acl_compile);
+	ATF_TP_ADD_TC(tp, dns_aclmap);
+#ifdef DNS_BENCHMARK_TESTS
+	ATF_TP_ADD_TC(tp, benchmark);
+#endif /* DNS_BENCHMARK_TESTS */
 	return (atf_no_error());
 }
@@ -22,6 +22,8 @@
 #include <dns/journal.h>
 #include <dns/name.h>
 #include <dns/rdatalist.h>
+#include <dns/rdataset.h>
+#include <dns/rdatasetiter.h>
 
 #include "dnstest.h"
 
@@ -273,6 +275,81 @@ ATF_TC_BODY(dns_dbfind_staleok, tc) {
 	isc_mem_detach(&mymctx);
 }
 
+ATF_TC(loadgrouped);
+ATF_TC_HEAD(loadgrouped, tc) {
+	atf_tc_set_md_var(tc, "descr",
+			  "load rdatasets grouped by owner name, including "
+			  "wildcard owners and NSEC records");
+}
+ATF_TC_BODY(loadgrouped, tc) {
+	static const struct {
+		const char *name;
+		unsigned int count;
+	} owners[] = {
+		{ "test", 3 },
+		{ "a.test", 4 },
+		{ "*.w.test", 3 },
+		{ "ns.test", 2 }
+	};
+	dns_db_t *db = NULL;
+	dns_dbnode_t *node = NULL;
+	dns_rdatasetiter_t *iter = NULL;
+	dns_rdataset_t rdataset;
+	dns_fixedname_t fixed, ffound;
+	dns_name_t *name, *found;
+	isc_result_t result;
+	unsigned int i, count;
+
+	UNUSED(tc);
+
+	result = dns_test_begin(NULL, ISC_FALSE);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	result = dns_test_loaddb(&db, dns_dbtype_zone, "test",
+				 "testdata/db/grouped.data");
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	dns_fixedname_init(&fixed);
+	name = dns_fixedname_name(&fixed);
+	dns_fixedname_init(&ffound);
+	found = dns_fixedname_name(&ffound);
+	dns_rdataset_init(&rdataset);
+
+	for (i = 0; i < sizeof(owners) / sizeof(owners[0]); i++) {
+		result = dns_name_fromstring(name, owners[i].name, 0, NULL);
+		ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+		result = dns_db_findnode(db, name, ISC_FALSE, &node);
+		ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+		result = dns_db_allrdatasets(db, node, NULL, 0, &iter);
+		ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+		count = 0;
+		for (result = dns_rdatasetiter_first(iter);
+		     result == ISC_R_SUCCESS;
+		     result = dns_rdatasetiter_next(iter))
+			count++;
+		ATF_CHECK_EQ_MSG(count, owners[i].count, "%s: %u rdatasets",
+				 owners[i].name, count);
+		dns_rdatasetiter_destroy(&iter);
+		dns_db_detachnode(db, &node);
+	}
+
+	/*
+	 * The wildcard was only seen on the first of its rdatasets.
+	 */
+	result = dns_name_fromstring(name, "x.w.test", 0, NULL);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	result = dns_db_find(db, name, NULL, dns_rdatatype_txt, 0, 0,
+			     &node, found, &rdataset, NULL);
+	ATF_CHECK_EQ(result, ISC_R_SUCCESS);
+	if (dns_rdataset_isassociated(&rdataset))
+		dns_rdataset_disassociate(&rdataset);
+	if (node != NULL)
+		dns_db_detachnode(db, &node);
+
+	dns_db_detach(&db);
+	dns_test_end();
+}
+
 /*
  * Main
  */
@@ -280,5 +357,6 @@ ATF_TP_ADD_TCS(tp) {
 	ATF_TP_ADD_TC(tp, getoriginnode);
 	ATF_TP_ADD_TC(tp, getsetservestalettl);
 	ATF_TP_ADD_TC(tp, dns_dbfind_staleok);
+	ATF_TP_ADD_TC(tp, loadgrouped);
 	return (atf_no_error());
 }
@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2018  Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*! \file */
+
+#include <config.h>
+
+#include <atf-c.h>
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <isc/file.h>
+#include <isc/print.h>
+#include <isc/util.h>
+
+#include <dns/diff.h>
+#include <dns/fixedname.h>
+#include <dns/journal.h>
+#include <dns/name.h>
+#include <dns/rdata.h>
+#include <dns/soa.h>
+
+#include "dnstest.h"
+
+#define TESTJOURNAL	"journal_test.jnl"
+
+/*
+ * Helper functions
+ */
+
+static void
+add_tuple(dns_diff_t *diff, dns_diffop_t op, dns_rdatatype_t type,
+	  const char *text)
+{
+	dns_fixedname_t fixed;
+	dns_name_t *name;
+	dns_rdata_t rdata = DNS_RDATA_INIT;
+	dns_difftuple_t *tuple = NULL;
+	unsigned char data[512];
+	isc_result_t result;
+
+	dns_fixedname_init(&fixed);
+	name = dns_fixedname_name(&fixed);
+	result = dns_name_fromstring(name, "example.", 0, NULL);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	result = dns_test_rdata_fromstring(&rdata, dns_rdataclass_in, type,
+					   data, sizeof(data), text);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	result = dns_difftuple_create(mctx, op, name, 300, &rdata, &tuple);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	dns_diff_append(diff, &tuple);
+}
+
+/*
+ * Append transactions taking the zone from serial 'first' to
+ * serial 'last' to the test journal.  Each one replaces the SOA and
+ * adds a TXT record.
+ */
+static void
+add_transactions(isc_uint32_t first, isc_uint32_t last) {
+	dns_journal_t *j = NULL;
+	isc_result_t result;
+	isc_uint32_t serial;
+	char text[100];
+
+	result = dns_journal_open(mctx, TESTJOURNAL, DNS_JOURNAL_CREATE, &j);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	for (serial = first; serial < last; serial++) {
+		dns_diff_t diff;
+
+		dns_diff_init(mctx, &diff);
+		snprintf(text, sizeof(text), ". . %u 0 0 0 0", serial);
+		add_tuple(&diff, DNS_DIFFOP_DEL, dns_rdatatype_soa, text);
+		snprintf(text, sizeof(text), ". . %u 0 0 0 0", serial + 1);
+		add_tuple(&diff, DNS_DIFFOP_ADD, dns_rdatatype_soa, text);
+		snprintf(text, sizeof(text), "\"%u\"", serial);
+		add_tuple(&diff, DNS_DIFFOP_ADD, dns_rdatatype_txt, text);
+
+		result = dns_journal_write_transaction(j, &diff);
+		ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+		dns_diff_clear(&diff);
+	}
+
+	dns_journal_destroy(&j);
+}
+
+/*
+ * Check that the test journal can be iterated from 'begin' to its
+ * last serial number, and that this visits every transaction.
+ */
+static void
+check_iterate(isc_uint32_t begin) {
+	dns_journal_t *j = NULL;
+	dns_name_t *name = NULL;
+	dns_rdata_t *rdata = NULL;
+	isc_uint32_t ttl, end;
+	unsigned int count = 0;
+	isc_result_t result;
+
+	result = dns_journal_open(mctx, TESTJOURNAL, DNS_JOURNAL_READ, &j);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	end = dns_journal_last_serial(j);
+	result = dns_journal_iter_init(j, begin, end);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	for (result = dns_journal_first_rr(j);
+	     result == ISC_R_SUCCESS;
+	     result = dns_journal_next_rr(j))
+	{
+		dns_journal_current_rr(j, &name, &ttl, &rdata);
+		if (count == 0) {
+			ATF_REQUIRE_EQ(rdata->type, dns_rdatatype_soa);
+			ATF_CHECK_EQ(dns_soa_getserial(rdata), begin);
+		}
+		count++;
+	}
+	ATF_CHECK_EQ(result, ISC_R_NOMORE);
+	ATF_CHECK_EQ(count, (end - begin) * 3);
+
+	dns_journal_destroy(&j);
+}
+
+/*
+ * Individual unit tests
+ */
+
+ATF_TC(find);
+ATF_TC_HEAD(find, tc) {
+	atf_tc_set_md_var(tc, "descr",
+			  "transactions are found anywhere in a long journal");
+}
+ATF_TC_BODY(find, tc) {
+	dns_journal_t *j = NULL;
+	isc_result_t result;
+
+	UNUSED(tc);
+
+	result = dns_test_begin(NULL, ISC_FALSE);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	(void)isc_file_remove(TESTJOURNAL);
+	add_transactions(1, 3001);
+
+	check_iterate(1);
+	check_iterate(2);
+	check_iterate(1500);
+	check_iterate(2999);
+	check_iterate(3000);
+	check_iterate(3001);
+
+	result = dns_journal_open(mctx, TESTJOURNAL, DNS_JOURNAL_READ, &j);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	ATF_CHECK_EQ(dns_journal_first_serial(j), 1);
+	ATF_CHECK_EQ(dns_journal_last_serial(j), 3001);
+	result = dns_journal_iter_init(j, 3002, 3001);
+	ATF_CHECK_EQ(result, ISC_R_RANGE);
+	dns_journal_destroy(&j);
+
+	(void)isc_file_remove(TESTJOURNAL);
+	dns_test_end();
+}
+
+ATF_TC(compact);
+ATF_TC_HEAD(compact, tc) {
+	atf_tc_set_md_var(tc, "descr",
+			  "a compacted journal can be read and appended to");
+}
+ATF_TC_BODY(compact, tc) {
+	dns_journal_t *j = NULL;
+	char filename[] = TESTJOURNAL;
+	isc_uint32_t first;
+	isc_result_t result;
+
+	UNUSED(tc);
+
+	result = dns_test_begin(NULL, ISC_FALSE);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	(void)isc_file_remove(TESTJOURNAL);
+	add_transactions(1, 3001);
+
+	result = dns_journal_compact(mctx, filename, 2000, 0);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	result = dns_journal_open(mctx, TESTJOURNAL, DNS_JOURNAL_READ, &j);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	first = dns_journal_first_serial(j);
+	ATF_CHECK(first > 1 && first <= 2000);
+	ATF_CHECK_EQ(dns_journal_last_serial(j), 3001);
+	dns_journal_destroy(&j);
+
+	check_iterate(first);
+	check_iterate(2000);
+
+	/*
+	 * New transactions must be found through the compacted
+	 * journal's index as well.
+	 */
+	add_transactions(3001, 4001);
+	check_iterate(first);
+	check_iterate(3500);
+	check_iterate(4000);
+
+	(void)isc_file_remove(TESTJOURNAL);
+	dns_test_end();
+}
+
+/*
+ * Main
+ */
+ATF_TP_ADD_TCS(tp) {
+	ATF_TP_ADD_TC(tp, find);
+	ATF_TP_ADD_TC(tp, compact);
+	return (atf_no_error());
+}
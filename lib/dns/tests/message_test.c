@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2018  Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*! \file */
+
+#include <config.h>
+
+#include <atf-c.h>
+
+#include <string.h>
+
+#include <isc/buffer.h>
+
+#include <dns/masterdump.h>
+#include <dns/message.h>
+
+#include "dnstest.h"
+
+/*
+ * A response for example.com/A holding two A records (the second with a
+ * partially compressed owner name) and an NS record whose rdata is
+ * compressed.
+ */
+static unsigned char response[] = {
+	0x12, 0x34, 0x81, 0x80, 0x00, 0x01, 0x00, 0x02,
+	0x00, 0x01, 0x00, 0x00,
+	/* question: example.com/A/IN */
+	0x07, 'e', 'x', 'a', 'm', 'p', 'l', 'e',
+	0x03, 'c', 'o', 'm', 0x00, 0x00, 0x01, 0x00, 0x01,
+	/* answer: example.com A 192.0.2.1 */
+	0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00,
+	0x01, 0x2c, 0x00, 0x04, 192, 0, 2, 1,
+	/* answer: www.example.com A 192.0.2.2 */
+	0x03, 'w', 'w', 'w', 0xc0, 0x0c, 0x00, 0x01,
+	0x00, 0x01, 0x00, 0x00, 0x01, 0x2c, 0x00, 0x04,
+	192, 0, 2, 2,
+	/* authority: example.com NS ns.example.com */
+	0xc0, 0x0c, 0x00, 0x02, 0x00, 0x01, 0x00, 0x00,
+	0x01, 0x2c, 0x00, 0x05, 0x02, 'n', 's', 0xc0,
+	0x0c
+};
+
+static void
+parse_totext(unsigned int options, isc_boolean_t clobber,
+	     char *text, size_t size)
+{
+	isc_result_t result;
+	dns_message_t *msg = NULL;
+	unsigned char wire[sizeof(response)];
+	isc_buffer_t source, target;
+
+	memmove(wire, response, sizeof(wire));
+	isc_buffer_init(&source, wire, sizeof(wire));
+	isc_buffer_add(&source, sizeof(wire));
+
+	result = dns_message_create(mctx, DNS_MESSAGE_INTENTPARSE, &msg);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	result = dns_message_parse(msg, &source, options);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	ATF_REQUIRE_EQ(isc_buffer_remaininglength(&source), 0);
+
+	/*
+	 * The parsed message must not depend on the caller's buffer.
+	 */
+	if (clobber)
+		memset(wire, 0xff, sizeof(wire));
+
+	memset(text, 0, size);
+	isc_buffer_init(&target, text, size - 1);
+	result = dns_message_totext(msg, &dns_master_style_debug, 0, &target);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	dns_message_destroy(&msg);
+}
+
+/*
+ * Individual unit tests
+ */
+
+ATF_TC(wireref);
+ATF_TC_HEAD(wireref, tc) {
+	atf_tc_set_md_var(tc, "descr",
+			  "DNS_MESSAGEPARSE_WIREREF parses identically");
+}
+ATF_TC_BODY(wireref, tc) {
+	isc_result_t result;
+	char copied[4096], referenced[4096];
+
+	UNUSED(tc);
+
+	result = dns_test_begin(NULL, ISC_FALSE);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	parse_totext(0, ISC_FALSE, copied, sizeof(copied));
+	parse_totext(DNS_MESSAGEPARSE_WIREREF, ISC_TRUE,
+		     referenced, sizeof(referenced));
+
+	ATF_CHECK(strstr(copied, "www.example.com.") != NULL);
+	ATF_CHECK(strstr(copied, "ns.example.com.") != NULL);
+	ATF_CHECK_STREQ(copied, referenced);
+
+	dns_test_end();
+}
+
+/*
+ * Main
+ */
+ATF_TP_ADD_TCS(tp) {
+	ATF_TP_ADD_TC(tp, wireref);
+
+	return (atf_no_error());
+}
@@ -0,0 +1,235 @@
+/*
+ * Copyright (C) 2018  Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*! \file */
+
+#include <config.h>
+
+#include <atf-c.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <isc/buffer.h>
+#include <isc/file.h>
+#include <isc/print.h>
+#include <isc/stdio.h>
+#include <isc/util.h>
+
+#include <dns/fixedname.h>
+#include <dns/name.h>
+#include <dns/qlog.h>
+#include <dns/result.h>
+
+#include "dnstest.h"
+
+#define TESTQLOG	"qlog_test.qlog"
+#define NRECORDS	5000	/* fills several write buffers */
+
+/*
+ * The client address, query name and flags used for record 'i'.
+ */
+static void
+make_record(unsigned int i, isc_sockaddr_t *client, dns_name_t *name,
+	    unsigned int *flags)
+{
+	char text[100];
+	isc_result_t result;
+
+	if (i % 2 == 0) {
+		struct in_addr ina;
+
+		ina.s_addr = htonl(0x0a000000 + i);
+		isc_sockaddr_fromin(client, &ina, 1024 + i);
+	} else {
+		struct in6_addr in6a;
+
+		memset(&in6a, 0, sizeof(in6a));
+		in6a.s6_addr[0] = 0x20;
+		in6a.s6_addr[1] = 0x01;
+		in6a.s6_addr[15] = i & 0xff;
+		isc_sockaddr_fromin6(client, &in6a, 1024 + i);
+	}
+
+	snprintf(text, sizeof(text), "host%u.example.", i);
+	result = dns_name_fromstring(name, text, 0, NULL);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	*flags = DNS_QLOG_RD | DNS_QLOG_EDNS;
+	if (i % 3 == 0)
+		*flags |= DNS_QLOG_TCP;
+	if (i % 5 == 0)
+		*flags |= DNS_QLOG_NORESPONSE;
+}
+
+/*
+ * Individual unit tests
+ */
+
+ATF_TC(roundtrip);
+ATF_TC_HEAD(roundtrip, tc) {
+	atf_tc_set_md_var(tc, "descr",
+			  "query records are read back as they were written");
+}
+ATF_TC_BODY(roundtrip, tc) {
+	dns_qlog_t *qlog = NULL;
+	dns_qlogreader_t *reader = NULL;
+	dns_qlogentry_t entry;
+	dns_fixedname_t fixed;
+	dns_name_t *name;
+	isc_sockaddr_t client;
+	isc_uint16_t id1, id2, id3;
+	unsigned int i, flags;
+	isc_time_t when;
+	char text[1024];
+	isc_buffer_t b;
+	isc_result_t result;
+
+	UNUSED(tc);
+
+	result = dns_test_begin(NULL, ISC_TRUE);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	(void)isc_file_remove(TESTQLOG);
+
+	result = dns_qlog_create(mctx, taskmgr, timermgr, TESTQLOG, &qlog);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	ATF_CHECK_STREQ(dns_qlog_getpath(qlog), TESTQLOG);
+
+	result = dns_qlog_addview(qlog, "_default", &id1);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	result = dns_qlog_addview(qlog, "internal", &id2);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	result = dns_qlog_addview(qlog, "_default", &id3);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	ATF_CHECK(id1 != id2);
+	ATF_CHECK_EQ(id1, id3);
+
+	dns_fixedname_init(&fixed);
+	name = dns_fixedname_name(&fixed);
+	for (i = 0; i < NRECORDS; i++) {
+		make_record(i, &client, name, &flags);
+		isc_time_set(&when, 1500000000 + i, i * 1000);
+		dns_qlog_write(qlog, (i % 2 == 0) ? id1 : id2, &when,
+			       &client, name, dns_rdataclass_in,
+			       dns_rdatatype_aaaa, flags, 0,
+			       (i % 7 == 0) ? dns_rcode_nxdomain :
+					      dns_rcode_noerror);
+	}
+
+	/*
+	 * Reopening writes out whatever is buffered, and repeats the
+	 * view table.
+	 */
+	result = dns_qlog_reopen(qlog);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	result = dns_qlog_open(mctx, TESTQLOG, &reader);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	for (i = 0; i < NRECORDS; i++) {
+		isc_sockaddr_t expected;
+
+		result = dns_qlog_read(reader, &entry);
+		ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+		make_record(i, &expected, name, &flags);
+		ATF_CHECK(isc_sockaddr_equal(&entry.client, &expected));
+		ATF_CHECK(dns_name_equal(entry.qname, name));
+		ATF_CHECK_EQ(entry.flags, flags);
+		ATF_CHECK_EQ(entry.qclass, dns_rdataclass_in);
+		ATF_CHECK_EQ(entry.qtype, dns_rdatatype_aaaa);
+		ATF_CHECK_EQ(entry.rcode, (i % 7 == 0) ? dns_rcode_nxdomain :
+							  dns_rcode_noerror);
+		ATF_CHECK_EQ(isc_time_seconds(&entry.when), 1500000000 + i);
+		ATF_CHECK_EQ(isc_time_nanoseconds(&entry.when), i * 1000);
+		ATF_REQUIRE(entry.view != NULL);
+		ATF_CHECK_STREQ(entry.view,
+				(i % 2 == 0) ? "_default" : "internal");
+
+		if (i != 999)
+			continue;
+		isc_buffer_init(&b, text, sizeof(text) - 1);
+		result = dns_qlog_totext(&entry, &b);
+		ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+		isc_buffer_putuint8(&b, 0);
+		ATF_CHECK(strstr(text, " client 2001::e7#2023 "
+				       "(host999.example): view internal: "
+				       "query: host999.example "
+				       "IN AAAA +E(0)T NOERROR\n") != NULL);
+	}
+
+	result = dns_qlog_read(reader, &entry);
+	ATF_CHECK_EQ(result, ISC_R_NOMORE);
+	dns_qlog_close(&reader);
+
+	dns_qlog_detach(&qlog);
+	dns_test_end();
+	(void)isc_file_remove(TESTQLOG);
+}
+
+ATF_TC(badfile);
+ATF_TC_HEAD(badfile, tc) {
+	atf_tc_set_md_var(tc, "descr",
+			  "files that are not binary query logs or are "
+			  "truncated are rejected");
+}
+ATF_TC_BODY(badfile, tc) {
+	static const unsigned char partial[] = {
+		1, 8, 0, 0, 0x59, 0x68, 0x2f, 0x00
+	};
+	unsigned char header[16];
+	dns_qlogreader_t *reader = NULL;
+	dns_qlogentry_t entry;
+	isc_result_t result;
+	FILE *fp = NULL;
+
+	UNUSED(tc);
+
+	result = dns_test_begin(NULL, ISC_FALSE);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	result = isc_stdio_open(TESTQLOG, "w", &fp);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	fputs("this is not a binary query log\n", fp);
+	(void)isc_stdio_close(fp);
+
+	result = dns_qlog_open(mctx, TESTQLOG, &reader);
+	ATF_CHECK_EQ(result, DNS_R_FORMERR);
+
+	/*
+	 * A header followed by part of a query record, as left behind
+	 * by a server that died while writing.
+	 */
+	memset(header, 0, sizeof(header));
+	memmove(header, DNS_QLOG_MAGIC, sizeof(DNS_QLOG_MAGIC) - 1);
+	fp = NULL;
+	result = isc_stdio_open(TESTQLOG, "w", &fp);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	(void)isc_stdio_write(header, sizeof(header), 1, fp, NULL);
+	(void)isc_stdio_write(partial, sizeof(partial), 1, fp, NULL);
+	(void)isc_stdio_close(fp);
+
+	result = dns_qlog_open(mctx, TESTQLOG, &reader);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	result = dns_qlog_read(reader, &entry);
+	ATF_CHECK_EQ(result, ISC_R_UNEXPECTEDEND);
+	dns_qlog_close(&reader);
+
+	(void)isc_file_remove(TESTQLOG);
+	dns_test_end();
+}
+
+/*
+ * Main
+ */
+ATF_TP_ADD_TCS(tp) {
+	ATF_TP_ADD_TC(tp, roundtrip);
+	ATF_TP_ADD_TC(tp, badfile);
+	return (atf_no_error());
+}
@@ -0,0 +1,806 @@
+/*
+ * Copyright (C) 2018  Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*! \file */
+
+#include <config.h>
+
+#include <atf-c.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <isc/file.h>
+#include <isc/netaddr.h>
+#include <isc/print.h>
+#include <isc/stdio.h>
+#include <isc/time.h>
+#include <isc/util.h>
+
+#include <dns/db.h>
+#include <dns/diff.h>
+#include <dns/fixedname.h>
+#include <dns/journal.h>
+#include <dns/name.h>
+#include <dns/result.h>
+#include <dns/rpz.h>
+
+#include "dnstest.h"
+
+#define ORIGIN		"policy.rpz."
+#define TESTJOURNAL	"rpz_test.jnl"
+#define TESTSTATS	"rpz_test.stats"
+
+/*
+ * Helper functions
+ */
+static void
+set_name(dns_name_t *name, const char *prefix, const char *origin) {
+	char text[DNS_NAME_FORMATSIZE];
+	isc_result_t result;
+
+	snprintf(text, sizeof(text), "%s%s", prefix, origin);
+	result = dns_name_fromstring(name, text, 0, mctx);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+}
+
+/*
+ * Set up a policy zone the way named.conf would.
+ */
+static dns_rpz_zone_t *
+make_zone(dns_rpz_zones_t *rpzs, const char *origin) {
+	dns_rpz_zone_t *rpz = NULL;
+	isc_result_t result;
+
+	result = dns_rpz_new_zone(rpzs, &rpz);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	set_name(&rpz->origin, "", origin);
+	set_name(&rpz->client_ip, DNS_RPZ_CLIENT_IP_ZONE".", origin);
+	set_name(&rpz->ip, DNS_RPZ_IP_ZONE".", origin);
+	set_name(&rpz->nsdname, DNS_RPZ_NSDNAME_ZONE".", origin);
+	set_name(&rpz->nsip, DNS_RPZ_NSIP_ZONE".", origin);
+	set_name(&rpz->passthru, DNS_RPZ_PASSTHRU_NAME".", "");
+	set_name(&rpz->drop, DNS_RPZ_DROP_NAME".", "");
+	set_name(&rpz->tcp_only, DNS_RPZ_TCP_ONLY_NAME".", "");
+	rpz->policy = DNS_RPZ_POLICY_GIVEN;
+	rpz->max_policy_ttl = DNS_RPZ_MAX_TTL_DEFAULT;
+	rpz->min_update_int = 0;
+
+	return (rpz);
+}
+
+static void
+add(dns_rpz_zones_t *rpzs, dns_rpz_zone_t *rpz, const char *owner,
+    dns_rpz_policy_t policy)
+{
+	dns_fixedname_t fixed;
+	dns_name_t *name;
+	isc_result_t result;
+
+	dns_fixedname_init(&fixed);
+	name = dns_fixedname_name(&fixed);
+	result = dns_name_fromstring2(name, owner, &rpz->origin, 0, NULL);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	result = dns_rpz_add_policy(rpzs, rpz->num, name, policy);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+}
+
+static void
+add_tuple(dns_diff_t *diff, dns_diffop_t op, const char *owner,
+	  dns_rdatatype_t type, const char *text)
+{
+	dns_fixedname_t fixed;
+	dns_name_t *name;
+	dns_rdata_t rdata = DNS_RDATA_INIT;
+	dns_difftuple_t *tuple = NULL;
+	unsigned char data[512];
+	isc_result_t result;
+
+	dns_fixedname_init(&fixed);
+	name = dns_fixedname_name(&fixed);
+	result = dns_name_fromstring(name, owner, 0, NULL);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	result = dns_test_rdata_fromstring(&rdata, dns_rdataclass_in, type,
+					   data, sizeof(data), text);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	result = dns_difftuple_create(mctx, op, name, 300, &rdata, &tuple);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	dns_diff_append(diff, &tuple);
+}
+
+/*
+ * Apply 'diff' to a new version of 'db', writing it to the test
+ * journal first if 'journal' is set, as an incoming IXFR would.
+ */
+static void
+commit_diff(dns_db_t *db, dns_diff_t *diff, isc_boolean_t journal) {
+	dns_dbversion_t *version = NULL;
+	dns_journal_t *j = NULL;
+	isc_result_t result;
+
+	if (journal) {
+		result = dns_journal_open(mctx, TESTJOURNAL,
+					  DNS_JOURNAL_CREATE, &j);
+		ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+		result = dns_journal_write_transaction(j, diff);
+		ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+		dns_journal_destroy(&j);
+	}
+
+	result = dns_db_newversion(db, &version);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	result = dns_diff_apply(diff, db, version);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	dns_db_closeversion(db, &version, ISC_TRUE);
+}
+
+/*
+ * Look up a QNAME trigger, returning the matching zones.
+ */
+static dns_rpz_zbits_t
+find_name(dns_rpz_zones_t *rpzs, const char *text, dns_rpz_num_t *nump,
+	  dns_rpz_policy_t *policyp, dns_dbversion_t **versionp)
+{
+	dns_fixedname_t fixed;
+	dns_name_t *name;
+	isc_result_t result;
+
+	dns_fixedname_init(&fixed);
+	name = dns_fixedname_name(&fixed);
+	result = dns_name_fromstring(name, text, 0, NULL);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	return (dns_rpz_find_name(rpzs, DNS_RPZ_TYPE_QNAME,
+				  DNS_RPZ_ALL_ZBITS, name, nump, policyp,
+				  versionp));
+}
+
+static void
+check_name(dns_rpz_zones_t *rpzs, const char *text, dns_rpz_zbits_t zbits,
+	   dns_rpz_num_t num, dns_rpz_policy_t policy)
+{
+	dns_rpz_num_t found_num;
+	dns_rpz_policy_t found_policy;
+	dns_dbversion_t *found_version;
+
+	ATF_CHECK_EQ_MSG(find_name(rpzs, text, &found_num, &found_policy,
+				   &found_version),
+			 zbits, "%s", text);
+	ATF_CHECK_EQ_MSG(found_num, num, "%s", text);
+	ATF_CHECK_EQ_MSG(found_policy, policy, "%s", text);
+}
+
+static void
+check_ip(dns_rpz_zones_t *rpzs, isc_uint32_t addr, dns_rpz_num_t num,
+	 dns_rpz_prefix_t prefix, dns_rpz_policy_t policy)
+{
+	dns_fixedname_t fixed;
+	isc_netaddr_t netaddr;
+	struct in_addr ina;
+	dns_rpz_num_t found_num;
+	dns_rpz_prefix_t found_prefix = 0;
+	dns_rpz_policy_t found_policy;
+	dns_dbversion_t *found_version;
+
+	ina.s_addr = htonl(addr);
+	isc_netaddr_fromin(&netaddr, &ina);
+	dns_fixedname_init(&fixed);
+	found_num = dns_rpz_find_ip(rpzs, DNS_RPZ_TYPE_IP, DNS_RPZ_ALL_ZBITS,
+				    &netaddr, dns_fixedname_name(&fixed),
+				    &found_prefix, &found_policy,
+				    &found_version);
+	ATF_CHECK_EQ_MSG(found_num, num, "%08x", addr);
+	if (found_num == DNS_RPZ_INVALID_NUM)
+		return;
+	ATF_CHECK_EQ_MSG(found_prefix, prefix, "%08x", addr);
+	ATF_CHECK_EQ_MSG(found_policy, policy, "%08x", addr);
+}
+
+/*
+ * Add or delete 100 name and 100 address triggers in 'rpz', or only
+ * the first 16 names.
+ */
+static void
+change_many(dns_rpz_zones_t *rpzs, dns_rpz_zone_t *rpz, isc_boolean_t all,
+	    isc_boolean_t add_them)
+{
+	dns_fixedname_t fixed;
+	dns_name_t *name;
+	char text[100];
+	unsigned int i;
+	isc_result_t result;
+
+	dns_fixedname_init(&fixed);
+	name = dns_fixedname_name(&fixed);
+	for (i = 0; i < (all ? 200U : 16U); i++) {
+		if (i < 100)
+			snprintf(text, sizeof(text), "n%u.example", i);
+		else
+			snprintf(text, sizeof(text), "32.%u.0.0.10.rpz-ip",
+				 i - 99);
+		if (add_them) {
+			add(rpzs, rpz, text,
+			    (i < 100) ? DNS_RPZ_POLICY_NXDOMAIN :
+					DNS_RPZ_POLICY_DROP);
+			continue;
+		}
+		result = dns_name_fromstring2(name, text, &rpz->origin,
+					      0, NULL);
+		ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+		dns_rpz_delete(rpzs, rpz->num, name);
+	}
+}
+
+static void
+add_many(dns_rpz_zones_t *rpzs, dns_rpz_zone_t *rpz, isc_boolean_t all) {
+	change_many(rpzs, rpz, all, ISC_TRUE);
+}
+
+static void
+del_many(dns_rpz_zones_t *rpzs, dns_rpz_zone_t *rpz, isc_boolean_t all) {
+	change_many(rpzs, rpz, all, ISC_FALSE);
+}
+
+/*
+ * Wait for the summary data of a policy zone to be brought up to date.
+ */
+static void
+wait_update(dns_rpz_zone_t *rpz) {
+	isc_boolean_t busy;
+
+	do {
+		dns_test_nap(1000);
+		LOCK(&rpz->rpzs->maint_lock);
+		busy = ISC_TF(rpz->updatepending || rpz->updaterunning);
+		UNLOCK(&rpz->rpzs->maint_lock);
+	} while (busy);
+}
+
+/*
+ * Individual unit tests
+ */
+
+ATF_TC(compiled);
+ATF_TC_HEAD(compiled, tc) {
+	atf_tc_set_md_var(tc, "descr",
+			  "policies that do not depend on the query are "
+			  "compiled into the summary data");
+}
+ATF_TC_BODY(compiled, tc) {
+	dns_rpz_zones_t *rpzs = NULL;
+	dns_rpz_zone_t *rpz;
+	dns_db_t *db = NULL;
+	isc_result_t result;
+
+	UNUSED(tc);
+
+	result = dns_test_begin(NULL, ISC_TRUE);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	result = dns_rpz_new_zones(&rpzs, NULL, 0, mctx, taskmgr, timermgr);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	rpz = make_zone(rpzs, ORIGIN);
+
+	result = dns_test_loaddb(&db, dns_dbtype_zone, ORIGIN,
+				 "testdata/rpz/policy1.data");
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	rpz->db_registered = ISC_TRUE;
+	result = dns_db_updatenotify_register(db, dns_rpz_dbupdate_callback,
+					      rpz);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	result = dns_rpz_dbupdate_callback(db, rpz);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	dns_db_detach(&db);
+	wait_update(rpz);
+
+	check_name(rpzs, "nxdomain.example.", 1, 0, DNS_RPZ_POLICY_NXDOMAIN);
+	check_name(rpzs, "nodata.example.", 1, 0, DNS_RPZ_POLICY_NODATA);
+	check_name(rpzs, "drop.example.", 1, 0, DNS_RPZ_POLICY_DROP);
+	check_name(rpzs, "passthru.example.", 1, 0, DNS_RPZ_POLICY_PASSTHRU);
+	check_name(rpzs, "tcp.example.", 1, 0, DNS_RPZ_POLICY_TCP_ONLY);
+	check_name(rpzs, "record.example.", 1,
+		   DNS_RPZ_INVALID_NUM, DNS_RPZ_POLICY_RECORD);
+	check_name(rpzs, "garden.example.", 1,
+		   DNS_RPZ_INVALID_NUM, DNS_RPZ_POLICY_RECORD);
+	check_name(rpzs, "a.wild.example.", 1,
+		   DNS_RPZ_INVALID_NUM, DNS_RPZ_POLICY_RECORD);
+	check_name(rpzs, "wild.example.", 0,
+		   DNS_RPZ_INVALID_NUM, DNS_RPZ_POLICY_RECORD);
+	check_name(rpzs, "other.example.", 0,
+		   DNS_RPZ_INVALID_NUM, DNS_RPZ_POLICY_RECORD);
+	check_ip(rpzs, 0x0a000001, 0, 128, DNS_RPZ_POLICY_NXDOMAIN);
+	check_ip(rpzs, 0x0a000002, 0, 120, DNS_RPZ_POLICY_RECORD);
+	check_ip(rpzs, 0x0a000102, DNS_RPZ_INVALID_NUM, 0, 0);
+
+	/*
+	 * A new version of the zone changes, adds, and removes policies.
+	 */
+	result = dns_test_loaddb(&db, dns_dbtype_zone, ORIGIN,
+				 "testdata/rpz/policy2.data");
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	result = dns_db_updatenotify_register(db, dns_rpz_dbupdate_callback,
+					      rpz);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	result = dns_rpz_dbupdate_callback(db, rpz);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	dns_db_detach(&db);
+	wait_update(rpz);
+
+	check_name(rpzs, "nxdomain.example.", 1, 0, DNS_RPZ_POLICY_DROP);
+	check_name(rpzs, "drop.example.", 0,
+		   DNS_RPZ_INVALID_NUM, DNS_RPZ_POLICY_RECORD);
+	check_name(rpzs, "record.example.", 1, 0, DNS_RPZ_POLICY_NXDOMAIN);
+	check_ip(rpzs, 0x0a000001, 0, 120, DNS_RPZ_POLICY_RECORD);
+
+	dns_rpz_detach_rpzs(&rpzs);
+	dns_test_end();
+}
+
+ATF_TC(incremental);
+ATF_TC_HEAD(incremental, tc) {
+	atf_tc_set_md_var(tc, "descr",
+			  "changes that are in the journal are applied to "
+			  "the summary data without walking the whole zone");
+}
+ATF_TC_BODY(incremental, tc) {
+	dns_rpz_zones_t *rpzs = NULL;
+	dns_rpz_zone_t *rpz;
+	dns_db_t *db = NULL;
+	dns_dbversion_t *version = NULL, *c_version;
+	dns_rpz_num_t num;
+	dns_rpz_policy_t policy;
+	dns_diff_t diff;
+	FILE *fp = NULL;
+	char line[100];
+	isc_boolean_t found;
+	isc_result_t result;
+
+	UNUSED(tc);
+
+	result = dns_test_begin(NULL, ISC_TRUE);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	(void)isc_file_remove(TESTJOURNAL);
+
+	result = dns_rpz_new_zones(&rpzs, NULL, 0, mctx, taskmgr, timermgr);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	rpz = make_zone(rpzs, ORIGIN);
+	result = dns_rpz_setjournal(rpz, TESTJOURNAL);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	result = dns_test_loaddb(&db, dns_dbtype_zone, ORIGIN,
+				 "testdata/rpz/policy1.data");
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	rpz->db_registered = ISC_TRUE;
+	result = dns_db_updatenotify_register(db, dns_rpz_dbupdate_callback,
+					      rpz);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	result = dns_rpz_dbupdate_callback(db, rpz);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	wait_update(rpz);
+
+	ATF_CHECK(!rpz->incremental);
+	ATF_CHECK(rpz->haveserial);
+	ATF_CHECK_EQ(rpz->serial, 1);
+
+	/*
+	 * Serial 2 changes, adds, and removes policies, with owner
+	 * names in a different case from the zone file.
+	 */
+	dns_diff_init(mctx, &diff);
+	add_tuple(&diff, DNS_DIFFOP_DEL, ORIGIN, dns_rdatatype_soa,
+		  "ns.policy.rpz. hostmaster.policy.rpz. 1 3600 1800 "
+		  "604800 600");
+	add_tuple(&diff, DNS_DIFFOP_ADD, ORIGIN, dns_rdatatype_soa,
+		  "ns.policy.rpz. hostmaster.policy.rpz. 2 3600 1800 "
+		  "604800 600");
+	add_tuple(&diff, DNS_DIFFOP_DEL, "nxdomain.example."ORIGIN,
+		  dns_rdatatype_cname, ".");
+	add_tuple(&diff, DNS_DIFFOP_ADD, "nxdomain.example."ORIGIN,
+		  dns_rdatatype_cname, "rpz-drop.");
+	add_tuple(&diff, DNS_DIFFOP_DEL, "DROP.Example."ORIGIN,
+		  dns_rdatatype_cname, "rpz-drop.");
+	add_tuple(&diff, DNS_DIFFOP_DEL, "record.example."ORIGIN,
+		  dns_rdatatype_a, "10.0.0.1");
+	add_tuple(&diff, DNS_DIFFOP_ADD, "record.example."ORIGIN,
+		  dns_rdatatype_cname, ".");
+	add_tuple(&diff, DNS_DIFFOP_ADD, "New.Example."ORIGIN,
+		  dns_rdatatype_cname, "rpz-passthru.");
+	add_tuple(&diff, DNS_DIFFOP_DEL, "32.1.0.0.10.rpz-ip."ORIGIN,
+		  dns_rdatatype_cname, ".");
+	commit_diff(db, &diff, ISC_TRUE);
+	dns_diff_clear(&diff);
+	wait_update(rpz);
+
+	ATF_CHECK(rpz->incremental);
+	ATF_CHECK(rpz->haveserial);
+	ATF_CHECK_EQ(rpz->serial, 2);
+	check_name(rpzs, "nxdomain.example.", 1, 0, DNS_RPZ_POLICY_DROP);
+	check_name(rpzs, "drop.example.", 0,
+		   DNS_RPZ_INVALID_NUM, DNS_RPZ_POLICY_RECORD);
+	check_name(rpzs, "record.example.", 1, 0, DNS_RPZ_POLICY_NXDOMAIN);
+	check_name(rpzs, "new.example.", 1, 0, DNS_RPZ_POLICY_PASSTHRU);
+	check_name(rpzs, "nodata.example.", 1, 0, DNS_RPZ_POLICY_NODATA);
+	check_ip(rpzs, 0x0a000001, 0, 120, DNS_RPZ_POLICY_RECORD);
+
+	/*
+	 * Compiled policies are marked with the version they were
+	 * compiled from.
+	 */
+	dns_db_currentversion(db, &version);
+	(void)find_name(rpzs, "nxdomain.example.", &num, &policy,
+			&c_version);
+	ATF_CHECK(c_version == version);
+
+	/*
+	 * The statistics report the update from the journal.
+	 */
+	result = isc_stdio_open(TESTSTATS, "w", &fp);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	dns_rpz_dumpstats(rpzs, fp);
+	(void)isc_stdio_close(fp);
+	fp = NULL;
+	result = isc_stdio_open(TESTSTATS, "r", &fp);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	found = ISC_FALSE;
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		if (strstr(line, "journal") != NULL) {
+			ATF_CHECK_STREQ(line, "                   1 "
+					"zones last updated from the "
+					"journal\n");
+			found = ISC_TRUE;
+		}
+	}
+	ATF_CHECK(found);
+	(void)isc_stdio_close(fp);
+	fp = NULL;
+	(void)isc_file_remove(TESTSTATS);
+
+	/*
+	 * Serial 3 is not in the journal, so the whole zone is walked.
+	 */
+	dns_diff_init(mctx, &diff);
+	add_tuple(&diff, DNS_DIFFOP_DEL, ORIGIN, dns_rdatatype_soa,
+		  "ns.policy.rpz. hostmaster.policy.rpz. 2 3600 1800 "
+		  "604800 600");
+	add_tuple(&diff, DNS_DIFFOP_ADD, ORIGIN, dns_rdatatype_soa,
+		  "ns.policy.rpz. hostmaster.policy.rpz. 3 3600 1800 "
+		  "604800 600");
+	add_tuple(&diff, DNS_DIFFOP_DEL, "new.example."ORIGIN,
+		  dns_rdatatype_cname, "rpz-passthru.");
+	add_tuple(&diff, DNS_DIFFOP_ADD, "late.example."ORIGIN,
+		  dns_rdatatype_cname, "*.");
+	commit_diff(db, &diff, ISC_FALSE);
+	dns_diff_clear(&diff);
+	wait_update(rpz);
+
+	ATF_CHECK(!rpz->incremental);
+	ATF_CHECK(rpz->haveserial);
+	ATF_CHECK_EQ(rpz->serial, 3);
+	check_name(rpzs, "new.example.", 0,
+		   DNS_RPZ_INVALID_NUM, DNS_RPZ_POLICY_RECORD);
+	check_name(rpzs, "late.example.", 1, 0, DNS_RPZ_POLICY_NODATA);
+	check_name(rpzs, "nxdomain.example.", 1, 0, DNS_RPZ_POLICY_DROP);
+
+	/*
+	 * The compiled policies are not those of serial 2 any more.
+	 */
+	(void)find_name(rpzs, "nxdomain.example.", &num, &policy,
+			&c_version);
+	ATF_CHECK(c_version != version);
+	dns_db_closeversion(db, &version, ISC_FALSE);
+	dns_db_currentversion(db, &version);
+	ATF_CHECK(c_version == version);
+	dns_db_closeversion(db, &version, ISC_FALSE);
+
+	dns_db_detach(&db);
+	dns_rpz_detach_rpzs(&rpzs);
+	dns_test_end();
+	(void)isc_file_remove(TESTJOURNAL);
+}
+
+ATF_TC(eligible);
+ATF_TC_HEAD(eligible, tc) {
+	atf_tc_set_md_var(tc, "descr",
+			  "the compiled policy is that of the most eligible "
+			  "policy zone");
+}
+ATF_TC_BODY(eligible, tc) {
+	dns_rpz_zones_t *rpzs = NULL;
+	dns_rpz_zone_t *rpz0, *rpz1;
+	dns_fixedname_t fixed;
+	dns_name_t *name;
+	isc_result_t result;
+
+	UNUSED(tc);
+
+	result = dns_test_begin(NULL, ISC_TRUE);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	result = dns_rpz_new_zones(&rpzs, NULL, 0, mctx, taskmgr, timermgr);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	rpz0 = make_zone(rpzs, "zero.rpz.");
+	rpz1 = make_zone(rpzs, "one.rpz.");
+
+	add(rpzs, rpz1, "evil.example", DNS_RPZ_POLICY_DROP);
+	check_name(rpzs, "evil.example.", 2, 1, DNS_RPZ_POLICY_DROP);
+
+	add(rpzs, rpz0, "evil.example", DNS_RPZ_POLICY_NXDOMAIN);
+	check_name(rpzs, "evil.example.", 3, 0, DNS_RPZ_POLICY_NXDOMAIN);
+
+	/*
+	 * The less eligible zone does not replace the policy.
+	 */
+	add(rpzs, rpz1, "evil.example", DNS_RPZ_POLICY_NODATA);
+	check_name(rpzs, "evil.example.", 3, 0, DNS_RPZ_POLICY_NXDOMAIN);
+
+	/*
+	 * The policy of the remaining zone is not known until it is
+	 * added again.
+	 */
+	dns_fixedname_init(&fixed);
+	name = dns_fixedname_name(&fixed);
+	result = dns_name_fromstring(name, "evil.example.zero.rpz.", 0, NULL);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	dns_rpz_delete(rpzs, rpz0->num, name);
+	check_name(rpzs, "evil.example.", 2,
+		   DNS_RPZ_INVALID_NUM, DNS_RPZ_POLICY_RECORD);
+	add(rpzs, rpz1, "evil.example", DNS_RPZ_POLICY_NODATA);
+	check_name(rpzs, "evil.example.", 2, 1, DNS_RPZ_POLICY_NODATA);
+
+	/*
+	 * Policy records that must be looked up hide compiled policies of
+	 * less eligible zones.
+	 */
+	add(rpzs, rpz0, "evil.example", DNS_RPZ_POLICY_RECORD);
+	check_name(rpzs, "evil.example.", 3,
+		   DNS_RPZ_INVALID_NUM, DNS_RPZ_POLICY_RECORD);
+
+	add(rpzs, rpz1, "32.1.0.0.10.rpz-ip", DNS_RPZ_POLICY_PASSTHRU);
+	add(rpzs, rpz0, "24.0.0.0.10.rpz-ip", DNS_RPZ_POLICY_DROP);
+	check_ip(rpzs, 0x0a000001, 0, 120, DNS_RPZ_POLICY_DROP);
+	check_ip(rpzs, 0x0a000002, 0, 120, DNS_RPZ_POLICY_DROP);
+
+	dns_rpz_detach_rpzs(&rpzs);
+	dns_test_end();
+}
+
+ATF_TC(wildcards);
+ATF_TC_HEAD(wildcards, tc) {
+	atf_tc_set_md_var(tc, "descr",
+			  "wildcard triggers match only names below them");
+}
+ATF_TC_BODY(wildcards, tc) {
+	dns_rpz_zones_t *rpzs = NULL;
+	dns_rpz_zone_t *rpz0, *rpz1;
+	char text[100];
+	unsigned int i;
+	isc_result_t result;
+
+	UNUSED(tc);
+
+	result = dns_test_begin(NULL, ISC_TRUE);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	result = dns_rpz_new_zones(&rpzs, NULL, 0, mctx, taskmgr, timermgr);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	rpz0 = make_zone(rpzs, "zero.rpz.");
+	rpz1 = make_zone(rpzs, "one.rpz.");
+
+	/*
+	 * Many siblings, half of them with wildcard triggers.
+	 */
+	for (i = 0; i < 64; i++) {
+		snprintf(text, sizeof(text), "n%u.example", i);
+		add(rpzs, rpz0, text, DNS_RPZ_POLICY_NXDOMAIN);
+		if (i % 2 == 0) {
+			snprintf(text, sizeof(text), "*.n%u.example", i);
+			add(rpzs, rpz1, text, DNS_RPZ_POLICY_RECORD);
+		}
+	}
+
+	for (i = 0; i < 64; i++) {
+		snprintf(text, sizeof(text), "n%u.example.", i);
+		check_name(rpzs, text, 1, 0, DNS_RPZ_POLICY_NXDOMAIN);
+		snprintf(text, sizeof(text), "a.n%u.example.", i);
+		check_name(rpzs, text, (i % 2 == 0) ? 2 : 0,
+			   DNS_RPZ_INVALID_NUM, DNS_RPZ_POLICY_RECORD);
+		snprintf(text, sizeof(text), "b.a.n%u.example.", i);
+		check_name(rpzs, text, (i % 2 == 0) ? 2 : 0,
+			   DNS_RPZ_INVALID_NUM, DNS_RPZ_POLICY_RECORD);
+	}
+
+	dns_rpz_detach_rpzs(&rpzs);
+	dns_test_end();
+}
+
+ATF_TC(memory);
+ATF_TC_HEAD(memory, tc) {
+	atf_tc_set_md_var(tc, "descr",
+			  "the memory used by the summary data is reported "
+			  "and released when triggers are deleted");
+}
+ATF_TC_BODY(memory, tc) {
+	dns_rpz_zones_t *rpzs = NULL;
+	dns_rpz_zone_t *rpz0, *rpz1;
+	size_t inuse[2];
+	unsigned int round;
+	char line[100];
+	FILE *fp = NULL;
+	isc_result_t result;
+
+	UNUSED(tc);
+
+	result = dns_test_begin(NULL, ISC_TRUE);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	result = dns_rpz_new_zones(&rpzs, NULL, 0, mctx, taskmgr, timermgr);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	rpz0 = make_zone(rpzs, "zero.rpz.");
+	rpz1 = make_zone(rpzs, "one.rpz.");
+
+	for (round = 0; round < 2; round++) {
+		add_many(rpzs, rpz0, ISC_TRUE);
+		add_many(rpzs, rpz1, ISC_FALSE);
+
+		/*
+		 * Names that are triggers in both zones have their own
+		 * data until one of the zones lets go of them.
+		 */
+		check_name(rpzs, "n0.example.", 3, 0, DNS_RPZ_POLICY_NXDOMAIN);
+		check_name(rpzs, "n20.example.", 1, 0, DNS_RPZ_POLICY_NXDOMAIN);
+		check_ip(rpzs, 0x0a000001, 0, 128, DNS_RPZ_POLICY_DROP);
+
+		fp = NULL;
+		result = isc_stdio_open(TESTSTATS, "w", &fp);
+		ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+		dns_rpz_dumpstats(rpzs, fp);
+		(void)isc_stdio_close(fp);
+		fp = NULL;
+		result = isc_stdio_open(TESTSTATS, "r", &fp);
+		ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+		ATF_REQUIRE(fgets(line, sizeof(line), fp) != NULL);
+		ATF_CHECK_STREQ(line, "                 216 policy triggers\n");
+		(void)isc_stdio_close(fp);
+		(void)isc_file_remove(TESTSTATS);
+
+		del_many(rpzs, rpz1, ISC_FALSE);
+		check_name(rpzs, "n0.example.", 1, 0, DNS_RPZ_POLICY_NXDOMAIN);
+		del_many(rpzs, rpz0, ISC_TRUE);
+		check_name(rpzs, "n0.example.", 0,
+			   DNS_RPZ_INVALID_NUM, DNS_RPZ_POLICY_RECORD);
+		check_ip(rpzs, 0x0a000001, DNS_RPZ_INVALID_NUM, 0, 0);
+
+		inuse[round] = isc_mem_inuse(rpzs->smctx);
+	}
+	ATF_CHECK_EQ(inuse[0], inuse[1]);
+
+	dns_rpz_detach_rpzs(&rpzs);
+	dns_test_end();
+}
+
+#ifdef DNS_BENCHMARK_TESTS
+
+#define BENCH_NAMES	1000000
+#define BENCH_ADDRS	1000000
+#define BENCH_LOOKUPS	2000000
+
+static double
+bench_rate(isc_time_t *ts1, unsigned int n) {
+	isc_time_t ts2;
+	isc_result_t result;
+
+	result = isc_time_now(&ts2);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	return (n / (isc_time_microdiff(&ts2, ts1) / 1000000.0));
+}
+
+ATF_TC(benchmark);
+ATF_TC_HEAD(benchmark, tc) {
+	atf_tc_set_md_var(tc, "descr",
+			  "Benchmark summary data with millions of triggers");
+}
+ATF_TC_BODY(benchmark, tc) {
+	dns_rpz_zones_t *rpzs = NULL;
+	dns_rpz_zone_t *rpz;
+	dns_fixedname_t fixed;
+	dns_name_t *name;
+	isc_netaddr_t netaddr;
+	struct in_addr ina;
+	dns_rpz_num_t num;
+	dns_rpz_prefix_t prefix;
+	dns_rpz_policy_t policy;
+	dns_dbversion_t *version;
+	char text[100];
+	unsigned int i, hits;
+	isc_time_t ts1;
+	isc_result_t result;
+
+	UNUSED(tc);
+
+	result = dns_test_begin(NULL, ISC_TRUE);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	result = dns_rpz_new_zones(&rpzs, NULL, 0, mctx, taskmgr, timermgr);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	rpz = make_zone(rpzs, ORIGIN);
+
+	result = isc_time_now(&ts1);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	for (i = 0; i < BENCH_NAMES; i++) {
+		snprintf(text, sizeof(text), "host%u.d%u.example", i, i % 997);
+		add(rpzs, rpz, text, DNS_RPZ_POLICY_NXDOMAIN);
+	}
+	for (i = 0; i < BENCH_ADDRS; i++) {
+		snprintf(text, sizeof(text), "32.%u.%u.%u.10.rpz-ip",
+			 i & 0xff, (i >> 8) & 0xff, (i >> 16) & 0xff);
+		add(rpzs, rpz, text, DNS_RPZ_POLICY_NXDOMAIN);
+	}
+	printf("%u triggers added, %f triggers/second\n",
+	       BENCH_NAMES + BENCH_ADDRS,
+	       bench_rate(&ts1, BENCH_NAMES + BENCH_ADDRS));
+	dns_rpz_dumpstats(rpzs, stdout);
+
+	dns_fixedname_init(&fixed);
+	name = dns_fixedname_name(&fixed);
+	hits = 0;
+	result = isc_time_now(&ts1);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	for (i = 0; i < BENCH_LOOKUPS; i++) {
+		/*
+		 * Half of the names are triggers.
+		 */
+		snprintf(text, sizeof(text), "host%u.d%u.example.",
+			 i % (2 * BENCH_NAMES) , i % 997);
+		result = dns_name_fromstring(name, text, 0, NULL);
+		ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+		if (dns_rpz_find_name(rpzs, DNS_RPZ_TYPE_QNAME,
+				      DNS_RPZ_ALL_ZBITS, name,
+				      &num, &policy, &version) != 0)
+			hits++;
+	}
+	printf("%u name lookups, %u hits, %f lookups/second\n",
+	       BENCH_LOOKUPS, hits, bench_rate(&ts1, BENCH_LOOKUPS));
+
+	hits = 0;
+	result = isc_time_now(&ts1);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	for (i = 0; i < BENCH_LOOKUPS; i++) {
+		ina.s_addr = htonl(0x0a000000 + i % (2 * BENCH_ADDRS));
+		isc_netaddr_fromin(&netaddr, &ina);
+		num = dns_rpz_find_ip(rpzs, DNS_RPZ_TYPE_IP,
+				      DNS_RPZ_ALL_ZBITS, &netaddr, name,
+				      &prefix, &policy, &version);
+		if (num != DNS_RPZ_INVALID_NUM)
+			hits++;
+	}
+	printf("%u address lookups, %u hits, %f lookups/second\n",
+	       BENCH_LOOKUPS, hits, bench_rate(&ts1, BENCH_LOOKUPS));
+
+	dns_rpz_detach_rpzs(&rpzs);
+	dns_test_end();
+}
+
+#endif /* DNS_BENCHMARK_TESTS */
+
+/*
+ * Main
+ */
+ATF_TP_ADD_TCS(tp) {
+	ATF_TP_ADD_TC(tp, compiled);
+	ATF_TP_ADD_TC(tp, incremental);
+	ATF_TP_ADD_TC(tp, eligible);
+	ATF_TP_ADD_TC(tp, wildcards);
+	ATF_TP_ADD_TC(tp, memory);
+#ifdef DNS_BENCHMARK_TESTS
+	ATF_TP_ADD_TC(tp, benchmark);
+#endif /* DNS_BENCHMARK_TESTS */
+
+	return (atf_no_error());
+}
@@ -0,0 +1,413 @@
+/*
+ * Copyright (C) 2018  Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*! \file */
+
+#include <config.h>
+
+#include <atf-c.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <isc/os.h>
+#include <isc/print.h>
+#include <isc/random.h>
+#include <isc/stdtime.h>
+#include <isc/thread.h>
+#include <isc/time.h>
+#include <isc/util.h>
+
+#include <dns/fixedname.h>
+#include <dns/name.h>
+#include <dns/result.h>
+#include <dns/rrl.h>
+#include <dns/view.h>
+
+#include "dnstest.h"
+
+#define NCLIENTS	64
+#define NQUERIES	400
+#define NNAMES		2
+#define NTHREADS	4
+
+/*
+ * Helper functions
+ */
+
+/*
+ * Create a view with a rate limit database using the defaults of
+ * named, except that responses-per-second is 5 and all-per-second is
+ * 'all'.
+ */
+static void
+make_rrl(unsigned int shards, int min_entries, int all, dns_view_t **viewp) {
+	dns_view_t *view = NULL;
+	dns_rrl_t *rrl = NULL;
+	isc_result_t result;
+
+	result = dns_test_makeview("view", &view);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	result = dns_rrl_init(&rrl, view, min_entries, shards);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+#define SET_RATE(rate, val)						\
+	do {								\
+		rrl->rate.r = val;					\
+		rrl->rate.scaled = val;					\
+		rrl->rate.str = #rate;					\
+	} while (0)
+
+	SET_RATE(responses_per_second, 5);
+	SET_RATE(referrals_per_second, 5);
+	SET_RATE(nodata_per_second, 5);
+	SET_RATE(nxdomains_per_second, 5);
+	SET_RATE(errors_per_second, 5);
+	SET_RATE(all_per_second, all);
+	SET_RATE(slip, 2);
+#undef SET_RATE
+
+	rrl->max_entries = 100000;
+	rrl->window = 15;
+	rrl->qps_scale = 0;
+	rrl->ipv4_prefixlen = 24;
+	rrl->ipv4_mask = htonl(0xffffff00);
+	rrl->ipv6_prefixlen = 56;
+	rrl->ipv6_mask[0] = 0xffffffff;
+	rrl->ipv6_mask[1] = htonl(0xffffff00);
+
+	*viewp = view;
+}
+
+static dns_rrl_result_t
+check(dns_view_t *view, const char *addr, isc_boolean_t tcp,
+      const dns_name_t *qname, isc_result_t resp_result, isc_stdtime_t now)
+{
+	char log_buf[DNS_RRL_LOG_BUF_LEN];
+	isc_sockaddr_t client;
+	struct in_addr ina;
+
+	RUNTIME_CHECK(inet_pton(AF_INET, addr, &ina) == 1);
+	isc_sockaddr_fromin(&client, &ina, 53000);
+	return (dns_rrl(view, &client, tcp, dns_rdataclass_in,
+			dns_rdatatype_a, qname, resp_result, now,
+			ISC_FALSE, log_buf, sizeof(log_buf)));
+}
+
+/*
+ * A mix of names, response types and times for each client, so that
+ * some responses are limited by responses-per-second and some by
+ * all-per-second.
+ */
+typedef struct {
+	dns_view_t	*view;
+	unsigned int	thread;
+	unsigned int	counts[NCLIENTS][3];
+} workload_t;
+
+static dns_fixedname_t fnames[NNAMES];
+
+static void *
+run_workload(void *arg) {
+	workload_t *w = arg;
+	char log_buf[DNS_RRL_LOG_BUF_LEN];
+	isc_sockaddr_t client;
+	struct in_addr ina;
+	dns_rrl_result_t rrl_result;
+	isc_result_t resp_result;
+	unsigned int i, j;
+
+	for (i = w->thread; i < NCLIENTS; i += NTHREADS) {
+		ina.s_addr = htonl(0x0a000001 + (i << 8));
+		isc_sockaddr_fromin(&client, &ina, 53000);
+		for (j = 0; j < NQUERIES; j++) {
+			resp_result = (j % 7 == 0) ? DNS_R_NXDOMAIN
+						   : ISC_R_SUCCESS;
+			rrl_result = dns_rrl(w->view, &client,
+					     ISC_TF(j % 50 == 49),
+					     dns_rdataclass_in,
+					     dns_rdatatype_a,
+					     dns_fixedname_name(
+						&fnames[j % NNAMES]),
+					     resp_result,
+					     1500000000 + j / 25, ISC_FALSE,
+					     log_buf, sizeof(log_buf));
+			w->counts[i][rrl_result]++;
+		}
+	}
+
+	return (NULL);
+}
+
+/*
+ * Individual unit tests
+ */
+
+ATF_TC(limits);
+ATF_TC_HEAD(limits, tc) {
+	atf_tc_set_md_var(tc, "descr",
+			  "responses beyond the limit are slipped or dropped");
+}
+ATF_TC_BODY(limits, tc) {
+	dns_view_t *view = NULL;
+	dns_fixedname_t fixed;
+	dns_name_t *qname;
+	isc_stdtime_t now = 1500000000;
+	int i;
+	isc_result_t result;
+
+	UNUSED(tc);
+
+	result = dns_test_begin(NULL, ISC_FALSE);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	dns_fixedname_init(&fixed);
+	qname = dns_fixedname_name(&fixed);
+	result = dns_name_fromstring(qname, "www.example.", 0, NULL);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	make_rrl(8, 500, 0, &view);
+
+	for (i = 0; i < 5; i++)
+		ATF_CHECK_EQ(check(view, "10.0.0.1", ISC_FALSE, qname,
+				   ISC_R_SUCCESS, now),
+			     DNS_RRL_RESULT_OK);
+	for (i = 0; i < 5; i++)
+		ATF_CHECK_EQ(check(view, "10.0.0.1", ISC_FALSE, qname,
+				   ISC_R_SUCCESS, now),
+			     (i % 2 == 0) ? DNS_RRL_RESULT_SLIP
+					  : DNS_RRL_RESULT_DROP);
+
+	/*
+	 * The address block shares the limit; other blocks, other
+	 * response types and TCP are not affected.
+	 */
+	ATF_CHECK_EQ(check(view, "10.0.0.2", ISC_FALSE, qname,
+			   ISC_R_SUCCESS, now),
+		     DNS_RRL_RESULT_DROP);
+	ATF_CHECK_EQ(check(view, "10.0.1.1", ISC_FALSE, qname,
+			   ISC_R_SUCCESS, now),
+		     DNS_RRL_RESULT_OK);
+	ATF_CHECK_EQ(check(view, "10.0.0.1", ISC_FALSE, qname,
+			   DNS_R_NXDOMAIN, now),
+		     DNS_RRL_RESULT_OK);
+	ATF_CHECK_EQ(check(view, "10.0.0.1", ISC_TRUE, qname,
+			   ISC_R_SUCCESS, now),
+		     DNS_RRL_RESULT_OK);
+
+	/*
+	 * A second earns 5 credits, which does not pay off the debt.
+	 */
+	ATF_CHECK_EQ(check(view, "10.0.0.1", ISC_FALSE, qname,
+			   ISC_R_SUCCESS, now + 1),
+		     DNS_RRL_RESULT_SLIP);
+
+	/*
+	 * After the window the limit starts over.
+	 */
+	ATF_CHECK_EQ(check(view, "10.0.0.1", ISC_FALSE, qname,
+			   ISC_R_SUCCESS, now + 20),
+		     DNS_RRL_RESULT_OK);
+
+	dns_view_detach(&view);
+	dns_test_end();
+}
+
+ATF_TC(shards);
+ATF_TC_HEAD(shards, tc) {
+	atf_tc_set_md_var(tc, "descr",
+			  "a sharded table used by several threads limits "
+			  "the same responses as a single table");
+}
+ATF_TC_BODY(shards, tc) {
+	static workload_t single, sharded[NTHREADS];
+	dns_view_t *view = NULL;
+	char text[100];
+	unsigned int i, j, k, sum;
+	isc_result_t result;
+#ifdef ISC_PLATFORM_USETHREADS
+	isc_thread_t threads[NTHREADS];
+#endif
+
+	UNUSED(tc);
+
+	result = dns_test_begin(NULL, ISC_TRUE);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	for (i = 0; i < NNAMES; i++) {
+		dns_fixedname_init(&fnames[i]);
+		snprintf(text, sizeof(text), "name%u.example.", i);
+		result = dns_name_fromstring(dns_fixedname_name(&fnames[i]),
+					     text, 0, NULL);
+		ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	}
+
+	/*
+	 * Make enough entries that none are recycled, as that depends on
+	 * the order of the responses of different clients.
+	 */
+	make_rrl(1, 4096, 20, &single.view);
+	for (i = 0; i < NTHREADS; i++) {
+		single.thread = i;
+		(void)run_workload(&single);
+	}
+	dns_view_detach(&single.view);
+
+	make_rrl(16, 4096, 20, &view);
+	for (i = 0; i < NTHREADS; i++) {
+		sharded[i].view = view;
+		sharded[i].thread = i;
+#ifdef ISC_PLATFORM_USETHREADS
+		result = isc_thread_create(run_workload, &sharded[i],
+					   &threads[i]);
+		ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+#else
+		(void)run_workload(&sharded[i]);
+#endif
+	}
+#ifdef ISC_PLATFORM_USETHREADS
+	for (i = 0; i < NTHREADS; i++) {
+		result = isc_thread_join(threads[i], NULL);
+		ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	}
+#endif
+	dns_view_detach(&view);
+
+	for (i = 0; i < NCLIENTS; i++) {
+		sum = 0;
+		for (k = 0; k < 3; k++) {
+			j = i % NTHREADS;
+			ATF_CHECK_EQ(sharded[j].counts[i][k],
+				     single.counts[i][k]);
+			sum += single.counts[i][k];
+		}
+		ATF_CHECK_EQ(sum, NQUERIES);
+	}
+
+	/*
+	 * The workload should be limited by both kinds of limit.
+	 */
+	ATF_CHECK(single.counts[0][DNS_RRL_RESULT_OK] < NQUERIES);
+	ATF_CHECK(single.counts[0][DNS_RRL_RESULT_SLIP] > 0);
+	ATF_CHECK(single.counts[0][DNS_RRL_RESULT_DROP] > 0);
+
+	dns_test_end();
+}
+
+#ifdef ISC_PLATFORM_USETHREADS
+#ifdef DNS_BENCHMARK_TESTS
+
+#define BENCH_CLIENTS	10000
+#define BENCH_CALLS	1000000
+
+static isc_stdtime_t bench_now;
+
+static void *
+bench_thread(void *arg) {
+	dns_view_t *view = arg;
+	char log_buf[DNS_RRL_LOG_BUF_LEN];
+	isc_sockaddr_t client;
+	struct in_addr ina;
+	isc_uint32_t r;
+	unsigned int i;
+
+	isc_random_get(&r);
+	for (i = 0; i < BENCH_CALLS; i++) {
+		r = r * 1103515245 + 12345;
+		ina.s_addr = htonl(0x0a000001 +
+				   (((r >> 8) % BENCH_CLIENTS) << 8));
+		isc_sockaddr_fromin(&client, &ina, 53000);
+		(void)dns_rrl(view, &client, ISC_FALSE, dns_rdataclass_in,
+			      dns_rdatatype_a,
+			      dns_fixedname_name(&fnames[i % NNAMES]),
+			      ISC_R_SUCCESS, bench_now + i / 100000,
+			      ISC_FALSE, log_buf, sizeof(log_buf));
+	}
+
+	return (NULL);
+}
+
+ATF_TC(benchmark);
+ATF_TC_HEAD(benchmark, tc) {
+	atf_tc_set_md_var(tc, "descr",
+			  "Benchmark a single RRL table against a sharded one");
+}
+ATF_TC_BODY(benchmark, tc) {
+	isc_thread_t threads[32];
+	unsigned int nthreads, i, pass, shards;
+	dns_view_t *view = NULL;
+	isc_time_t ts1, ts2;
+	char text[100];
+	double t;
+	isc_result_t result;
+
+	UNUSED(tc);
+
+	result = dns_test_begin(NULL, ISC_TRUE);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	for (i = 0; i < NNAMES; i++) {
+		dns_fixedname_init(&fnames[i]);
+		snprintf(text, sizeof(text), "name%u.example.", i);
+		result = dns_name_fromstring(dns_fixedname_name(&fnames[i]),
+					     text, 0, NULL);
+		ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	}
+
+	nthreads = ISC_MIN(isc_os_ncpus(), 32);
+	nthreads = ISC_MAX(nthreads, 1);
+	isc_stdtime_get(&bench_now);
+
+	for (pass = 0; pass < 2; pass++) {
+		shards = (pass == 0) ? 1 : nthreads;
+		make_rrl(shards, 20000, 0, &view);
+
+		result = isc_time_now(&ts1);
+		ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+		for (i = 0; i < nthreads; i++) {
+			result = isc_thread_create(bench_thread, view,
+						   &threads[i]);
+			ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+		}
+		for (i = 0; i < nthreads; i++) {
+			result = isc_thread_join(threads[i], NULL);
+			ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+		}
+		result = isc_time_now(&ts2);
+		ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+		t = isc_time_microdiff(&ts2, &ts1);
+		printf("%u threads, %u shards: %u calls, %f seconds, "
+		       "%f calls/second\n", nthreads, view->rrl->num_shards,
+		       nthreads * BENCH_CALLS, t / 1000000.0,
+		       (nthreads * BENCH_CALLS) / (t / 1000000.0));
+
+		dns_view_detach(&view);
+	}
+
+	dns_test_end();
+}
+
+#endif /* DNS_BENCHMARK_TESTS */
+#endif /* ISC_PLATFORM_USETHREADS */
+
+/*
+ * Main
+ */
+ATF_TP_ADD_TCS(tp) {
+	ATF_TP_ADD_TC(tp, limits);
+	ATF_TP_ADD_TC(tp, shards);
+#ifdef ISC_PLATFORM_USETHREADS
+#ifdef DNS_BENCHMARK_TESTS
+	ATF_TP_ADD_TC(tp, benchmark);
+#endif /* DNS_BENCHMARK_TESTS */
+#endif /* ISC_PLATFORM_USETHREADS */
+
+	return (atf_no_error());
+}
@@ -14,6 +14,7 @@
 
 #include <atf-c.h>
 
+#include <stdio.h>
 #include <unistd.h>
 
 #include <isc/app.h>
@@ -276,6 +277,75 @@ ATF_TC_BODY(asyncload_zt, tc) {
 	dns_test_end();
 }
 
+ATF_TC(asyncload_many);
+ATF_TC_HEAD(asyncload_many, tc) {
+	atf_tc_set_md_var(tc, "descr", "asynchronous load of many zones "
+			  "with several concurrent file reads");
+}
+ATF_TC_BODY(asyncload_many, tc) {
+	isc_result_t result;
+	dns_zone_t *zones[20];
+	dns_view_t *view = NULL;
+	dns_db_t *db = NULL;
+	isc_boolean_t done = ISC_FALSE;
+	char name[16];
+	unsigned int n;
+	int i = 0;
+	struct args args;
+
+	UNUSED(tc);
+
+	result = dns_test_begin(NULL, ISC_TRUE);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	result = dns_test_setupzonemgr();
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	dns_zonemgr_setiolimit(zonemgr, 4);
+
+	for (n = 0; n < 20; n++) {
+		zones[n] = NULL;
+		snprintf(name, sizeof(name), "zone%02u", n);
+		result = dns_test_makezone(name, &zones[n], view, ISC_TRUE);
+		ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+		dns_zone_setfile(zones[n], "testdata/zt/zone1.db");
+		if (view == NULL)
+			view = dns_zone_getview(zones[n]);
+		result = dns_test_managezone(zones[n]);
+		ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	}
+
+	ATF_CHECK_EQ(dns_zonemgr_getcount(zonemgr, DNS_ZONESTATE_ANY), 20);
+	ATF_CHECK_EQ(dns_zonemgr_getcount(zonemgr,
+					  DNS_ZONESTATE_LOADPENDING), 0);
+
+	args.arg1 = view->zonetable;
+	args.arg2 = &done;
+	isc_app_onrun(mctx, maintask, start_zt_asyncload, &args);
+
+	isc_app_run();
+	while (!done && i++ < 5000)
+		dns_test_nap(1000);
+	ATF_CHECK(done);
+
+	ATF_CHECK_EQ(dns_zonemgr_getcount(zonemgr,
+					  DNS_ZONESTATE_LOADPENDING), 0);
+	for (n = 0; n < 20; n++) {
+		result = dns_zone_getdb(zones[n], &db);
+		ATF_CHECK_EQ(result, ISC_R_SUCCESS);
+		if (db != NULL)
+			dns_db_detach(&db);
+	}
+
+	for (n = 0; n < 20; n++) {
+		dns_test_releasezone(zones[n]);
+		dns_zone_detach(&zones[n]);
+	}
+	dns_test_closezonemgr();
+	dns_view_detach(&view);
+
+	dns_test_end();
+}
+
 /*
  * Main
  */
@@ -283,5 +353,6 @@ ATF_TP_ADD_TCS(tp) {
 	ATF_TP_ADD_TC(tp, apply);
 	ATF_TP_ADD_TC(tp, asyncload_zone);
 	ATF_TP_ADD_TC(tp, asyncload_zt);
+	ATF_TP_ADD_TC(tp, asyncload_many);
 	return (atf_no_error());
 }
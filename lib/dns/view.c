@@ -42,6 +42,7 @@
 #include <dns/nta.h>
 #include <dns/order.h>
 #include <dns/peer.h>
+#include <dns/qlog.h>
 #include <dns/rbt.h>
 #include <dns/rdataset.h>
 #include <dns/request.h>
@@ -169,6 +170,7 @@ dns_view_create(isc_mem_t *mctx, dns_rdataclass_t rdclass,
 	view->adbstats = NULL;
 	view->resstats = NULL;
 	view->resquerystats = NULL;
+	view->viewstats = NULL;
 	view->cacheshared = ISC_FALSE;
 	ISC_LIST_INIT(view->dns64);
 	view->dns64cnt = 0;
@@ -251,6 +253,9 @@ dns_view_create(isc_mem_t *mctx, dns_rdataclass_t rdclass,
 	view->v6bias = 0;
 	view->dtenv = NULL;
 	view->dttypes = 0;
+	memset(view->dtsample, 0, sizeof(view->dtsample));
+	view->qlog = NULL;
+	view->qlogid = 0;
 
 	result = isc_mutex_init(&view->new_zone_lock);
 	if (result != ISC_R_SUCCESS)
@@ -491,6 +496,8 @@ destroy(dns_view_t *view) {
 		isc_stats_detach(&view->resstats);
 	if (view->resquerystats != NULL)
 		dns_stats_detach(&view->resquerystats);
+	if (view->viewstats != NULL)
+		isc_stats_detach(&view->viewstats);
 	if (view->secroots_priv != NULL)
 		dns_keytable_detach(&view->secroots_priv);
 	if (view->ntatable_priv != NULL)
@@ -509,6 +516,8 @@ destroy(dns_view_t *view) {
 	if (view->dtenv != NULL)
 		dns_dt_detach(&view->dtenv);
 #endif /* HAVE_DNSTAP */
+	if (view->qlog != NULL)
+		dns_qlog_detach(&view->qlog);
 	dns_view_setnewzones(view, ISC_FALSE, NULL, NULL, 0ULL);
 	if (view->new_zone_file != NULL) {
 		isc_mem_free(view->mctx, view->new_zone_file);
@@ -1858,6 +1867,24 @@ dns_view_getresquerystats(dns_view_t *view, dns_stats_t **statsp) {
 		dns_stats_attach(view->resquerystats, statsp);
 }
 
+void
+dns_view_setviewstats(dns_view_t *view, isc_stats_t *stats) {
+	REQUIRE(DNS_VIEW_VALID(view));
+	REQUIRE(!view->frozen);
+	REQUIRE(view->viewstats == NULL);
+
+	isc_stats_attach(stats, &view->viewstats);
+}
+
+void
+dns_view_getviewstats(dns_view_t *view, isc_stats_t **statsp) {
+	REQUIRE(DNS_VIEW_VALID(view));
+	REQUIRE(statsp != NULL && *statsp == NULL);
+
+	if (view->viewstats != NULL)
+		isc_stats_attach(view->viewstats, statsp);
+}
+
 isc_result_t
 dns_view_initntatable(dns_view_t *view,
 		      isc_taskmgr_t *taskmgr, isc_timermgr_t *timermgr)
@@ -132,6 +132,9 @@ struct dns_xfrin_ctx {
 	dns_dbversion_t 	*ver;
 	dns_diff_t 		diff;		/*%< Pending database changes */
 	int 			difflen;	/*%< Number of pending tuples */
+	size_t			diffsize;	/*%< Size of pending tuples */
+	size_t			maxdiffsize;	/*%< Peak size of pending
+						     tuples */
 
 	xfrin_state_t 		state;
 	isc_uint32_t 		end_serial;
@@ -169,6 +172,13 @@ struct dns_xfrin_ctx {
 	} ixfr;
 };
 
+/*%
+ * Received records are applied to the database whenever this many
+ * tuples, or this many bytes of tuples, are pending.
+ */
+#define XFRIN_MAXDIFFLEN	  100
+#define XFRIN_MAXDIFFSIZE	  (64 * 1024)
+
 #define XFRIN_MAGIC		  ISC_MAGIC('X', 'f', 'r', 'I')
 #define VALID_XFRIN(x)		  ISC_MAGIC_VALID(x, XFRIN_MAGIC)
 
@@ -281,6 +291,24 @@ axfr_makedb(dns_xfrin_ctx_t *xfr, dns_db_t **dbp) {
 	return (result);
 }
 
+/*
+ * Append '*tuplep' to the pending changes, and return ISC_TRUE if
+ * they have grown large enough to be applied to the database.
+ */
+static isc_boolean_t
+diff_append(dns_xfrin_ctx_t *xfr, dns_difftuple_t **tuplep) {
+	dns_difftuple_t *tuple = *tuplep;
+
+	xfr->diffsize += sizeof(*tuple) + tuple->name.length +
+			 tuple->rdata.length;
+	if (xfr->diffsize > xfr->maxdiffsize)
+		xfr->maxdiffsize = xfr->diffsize;
+	dns_diff_append(&xfr->diff, tuplep);
+
+	return (ISC_TF(++xfr->difflen > XFRIN_MAXDIFFLEN ||
+		       xfr->diffsize > XFRIN_MAXDIFFSIZE));
+}
+
 static isc_result_t
 axfr_putdata(dns_xfrin_ctx_t *xfr, dns_diffop_t op,
 	     dns_name_t *name, dns_ttl_t ttl, dns_rdata_t *rdata)
@@ -295,8 +323,7 @@ axfr_putdata(dns_xfrin_ctx_t *xfr, dns_diffop_t op,
 	CHECK(dns_zone_checknames(xfr->zone, name, rdata));
 	CHECK(dns_difftuple_create(xfr->diff.mctx, op,
 				   name, ttl, rdata, &tuple));
-	dns_diff_append(&xfr->diff, &tuple);
-	if (++xfr->difflen > 100)
+	if (diff_append(xfr, &tuple))
 		CHECK(axfr_apply(xfr));
 	result = ISC_R_SUCCESS;
  failure:
@@ -313,6 +340,7 @@ axfr_apply(dns_xfrin_ctx_t *xfr) {
 
 	CHECK(dns_diff_load(&xfr->diff, xfr->axfr.add, xfr->axfr.add_private));
 	xfr->difflen = 0;
+	xfr->diffsize = 0;
 	dns_diff_clear(&xfr->diff);
 	if (xfr->maxrecords != 0U) {
 		result = dns_db_getsize(xfr->db, xfr->ver, &records, NULL);
@@ -368,6 +396,7 @@ ixfr_init(dns_xfrin_ctx_t *xfr) {
 	xfr->is_ixfr = ISC_TRUE;
 	INSIST(xfr->db != NULL);
 	xfr->difflen = 0;
+	xfr->diffsize = 0;
 
 	journalfile = dns_zone_getjournal(xfr->zone);
 	if (journalfile != NULL)
@@ -393,8 +422,7 @@ ixfr_putdata(dns_xfrin_ctx_t *xfr, dns_diffop_t op,
 		CHECK(dns_zone_checknames(xfr->zone, name, rdata));
 	CHECK(dns_difftuple_create(xfr->diff.mctx, op,
 				   name, ttl, rdata, &tuple));
-	dns_diff_append(&xfr->diff, &tuple);
-	if (++xfr->difflen > 100)
+	if (diff_append(xfr, &tuple))
 		CHECK(ixfr_apply(xfr));
 	result = ISC_R_SUCCESS;
  failure:
@@ -429,6 +457,7 @@ ixfr_apply(dns_xfrin_ctx_t *xfr) {
 	}
 	dns_diff_clear(&xfr->diff);
 	xfr->difflen = 0;
+	xfr->diffsize = 0;
 	result = ISC_R_SUCCESS;
  failure:
 	return (result);
@@ -762,6 +791,7 @@ xfrin_reset(dns_xfrin_ctx_t *xfr) {
 
 	dns_diff_clear(&xfr->diff);
 	xfr->difflen = 0;
+	xfr->diffsize = 0;
 
 	if (xfr->ixfr.journal != NULL)
 		dns_journal_destroy(&xfr->ixfr.journal);
@@ -864,6 +894,7 @@ xfrin_create(isc_mem_t *mctx,
 	xfr->ver = NULL;
 	dns_diff_init(xfr->mctx, &xfr->diff);
 	xfr->difflen = 0;
+	xfr->diffsize = 0;
 
 	if (reqtype == dns_rdatatype_soa)
 		xfr->state = XFRST_SOAQUERY;
@@ -874,6 +905,7 @@ xfrin_create(isc_mem_t *mctx,
 	xfr->nmsg = 0;
 	xfr->nrecs = 0;
 	xfr->nbytes = 0;
+	xfr->maxdiffsize = 0;
 	xfr->maxrecords = dns_zone_getmaxrecords(zone);
 	isc_time_now(&xfr->start);
 
@@ -1153,6 +1185,7 @@ xfrin_send_request(dns_xfrin_ctx_t *xfr) {
 	xfr->nmsg = 0;
 	xfr->nrecs = 0;
 	xfr->nbytes = 0;
+	xfr->maxdiffsize = 0;
 	isc_time_now(&xfr->start);
 	msg->id = xfr->id;
 	if (xfr->tsigctx != NULL)
@@ -1511,6 +1544,9 @@ maybe_free(dns_xfrin_ctx_t *xfr) {
 		  xfr->nmsg, xfr->nrecs, xfr->nbytes,
 		  (unsigned int) (msecs / 1000), (unsigned int) (msecs % 1000),
 		  (unsigned int) persec);
+	xfrin_log(xfr, ISC_LOG_DEBUG(1),
+		  "at most %lu bytes of changes were pending",
+		  (unsigned long) xfr->maxdiffsize);
 
 	if (xfr->socket != NULL)
 		isc_socket_detach(&xfr->socket);
@@ -11,9 +11,11 @@
 #include <config.h>
 #include <errno.h>
 
+#include <isc/condition.h>
 #include <isc/file.h>
 #include <isc/hex.h>
 #include <isc/mutex.h>
+#include <isc/os.h>
 #include <isc/pool.h>
 #include <isc/print.h>
 #include <isc/random.h>
@@ -137,6 +139,9 @@ typedef struct dns_io dns_io_t;
 typedef ISC_LIST(dns_io_t) dns_iolist_t;
 typedef struct dns_signing dns_signing_t;
 typedef ISC_LIST(dns_signing_t) dns_signinglist_t;
+typedef struct dns_signjob dns_signjob_t;
+typedef struct dns_signbatch dns_signbatch_t;
+typedef ISC_LIST(dns_signbatch_t) dns_signbatchlist_t;
 typedef struct dns_nsec3chain dns_nsec3chain_t;
 typedef ISC_LIST(dns_nsec3chain_t) dns_nsec3chainlist_t;
 typedef struct dns_keyfetch dns_keyfetch_t;
@@ -350,6 +355,18 @@ struct dns_zone {
 	isc_uint32_t		signatures;
 	isc_uint32_t		nodes;
 	dns_rdatatype_t		privatetype;
+	/*%
+	 * Signatures computed in signing batches, and the time spent
+	 * computing them in microseconds.  Locked by the zone lock.
+	 */
+	isc_uint64_t		signcount;
+	isc_uint64_t		signtime;
+	/*%
+	 * Bytes sent in completed outgoing transfers, and the time
+	 * they took in microseconds.  Locked by the zone lock.
+	 */
+	isc_uint64_t		xfroutbytes;
+	isc_uint64_t		xfrouttime;
 
 	/*%
 	 * Autosigning/key-maintenance options
@@ -361,6 +378,11 @@ struct dns_zone {
 	 */
 	isc_boolean_t           added;
 
+	/*%
+	 * Hash of the configuration the zone was last configured from
+	 */
+	isc_uint64_t		confighash;
+
 	/*%
 	 * True if added by automatically by named.
 	 */
@@ -506,6 +528,8 @@ typedef struct {
 #define UNREACH_CHACHE_SIZE	10U
 #define UNREACH_HOLD_TIME	600	/* 10 minutes */
 
+#define MAXSIGNERS		32	/* Zone manager signing threads */
+
 #define CHECK(op) \
 	do { result = (op); \
 		if (result != ISC_R_SUCCESS) goto failure; \
@@ -560,6 +584,15 @@ struct dns_zonemgr {
 	/* Locked by urlock. */
 	/* LRU cache */
 	struct dns_unreachable	unreachable[UNREACH_CHACHE_SIZE];
+
+	/* Locked by signlock. */
+	isc_mutex_t		signlock;
+	isc_condition_t		signwork;	/* batch queued or exiting */
+	isc_condition_t		signdone;	/* signature computed */
+	dns_signbatchlist_t	signbatches;
+	isc_thread_t		signers[MAXSIGNERS];
+	unsigned int		nsigners;
+	isc_boolean_t		signexiting;
 };
 
 /*%
@@ -653,6 +686,41 @@ struct dns_signing {
 	ISC_LINK(dns_signing_t)	link;
 };
 
+/*%
+ * An RRset to be signed by a signing batch.  The RRset is copied so
+ * that it can be signed on another thread while the zone task goes
+ * on modifying the database version it came from.
+ */
+struct dns_signjob {
+	size_t			size;
+	dns_fixedname_t		fname;
+	dns_rdatalist_t		rdatalist;
+	dns_rdataset_t		rdataset;
+	dst_key_t		*key;
+	isc_stdtime_t		inception;
+	isc_stdtime_t		expire;
+	isc_result_t		result;
+	dns_rdata_t		sig;
+	unsigned char		*sigdata;
+	unsigned int		siglen;
+	ISC_LINK(dns_signjob_t)	link;
+};
+
+/*%
+ * RRSIGs the zone task wants computed.  The zone manager's signing
+ * threads and the zone task itself compute them in parallel; the zone
+ * task then adds them to the database and diff in the order in which
+ * they were queued.
+ */
+struct dns_signbatch {
+	isc_mem_t		*mctx;
+	ISC_LIST(dns_signjob_t)	jobs;
+	unsigned int		count;
+	dns_signjob_t		*next;		/* first unclaimed job */
+	unsigned int		pending;	/* jobs not yet computed */
+	ISC_LINK(dns_signbatch_t) link;
+};
+
 struct dns_nsec3chain {
 	unsigned int			magic;
 	dns_db_t			*db;
@@ -785,6 +853,7 @@ static isc_result_t zmgr_start_xfrin_ifquota(dns_zonemgr_t *zmgr,
 					     dns_zone_t *zone);
 static void zmgr_resume_xfrs(dns_zonemgr_t *zmgr, isc_boolean_t multi);
 static void zonemgr_free(dns_zonemgr_t *zmgr);
+static void stop_signers(dns_zonemgr_t *zmgr);
 static isc_result_t zonemgr_getio(dns_zonemgr_t *zmgr, isc_boolean_t high,
 				  isc_task_t *task, isc_taskaction_t action,
 				  void *arg, dns_io_t **iop);
@@ -1033,8 +1102,13 @@ dns_zone_create(dns_zone_t **zonep, isc_mem_t *mctx) {
 	ISC_LIST_INIT(zone->nsec3chain);
 	zone->signatures = 10;
 	zone->nodes = 100;
+	zone->signcount = 0;
+	zone->signtime = 0;
+	zone->xfroutbytes = 0;
+	zone->xfrouttime = 0;
 	zone->privatetype = (dns_rdatatype_t)0xffffU;
 	zone->added = ISC_FALSE;
+	zone->confighash = 0;
 	zone->automatic = ISC_FALSE;
 	zone->rpzs = NULL;
 	zone->rpz_num = DNS_RPZ_INVALID_NUM;
@@ -1805,6 +1879,8 @@ dns_zone_rpz_enable_db(dns_zone_t *zone, dns_db_t *db) {
 		return;
 	REQUIRE(zone->rpzs != NULL);
 	zone->rpzs->zones[zone->rpz_num]->db_registered = ISC_TRUE;
+	(void)dns_rpz_setjournal(zone->rpzs->zones[zone->rpz_num],
+				 zone->journal);
 	result = dns_db_updatenotify_register(db,
 					      dns_rpz_dbupdate_callback,
 					      zone->rpzs->zones[zone->rpz_num]);
@@ -6347,12 +6423,213 @@ del_sigs(dns_zone_t *zone, dns_db_t *db, dns_dbversion_t *ver, dns_name_t *name,
 	return (result);
 }
 
+static void
+signbatch_init(dns_signbatch_t *batch, isc_mem_t *mctx) {
+	batch->mctx = mctx;
+	ISC_LIST_INIT(batch->jobs);
+	batch->count = 0;
+	batch->next = NULL;
+	batch->pending = 0;
+	ISC_LINK_INIT(batch, link);
+}
+
+static void
+signbatch_clear(dns_signbatch_t *batch) {
+	dns_signjob_t *job;
+
+	while ((job = ISC_LIST_HEAD(batch->jobs)) != NULL) {
+		ISC_LIST_UNLINK(batch->jobs, job, link);
+		dns_rdataset_disassociate(&job->rdataset);
+		isc_mem_put(batch->mctx, job, job->size);
+	}
+	batch->count = 0;
+}
+
+/*
+ * Queue a copy of 'rdataset' to be signed with 'key'.
+ */
+static isc_result_t
+signbatch_add(dns_signbatch_t *batch, const dns_name_t *name,
+	      dns_rdataset_t *rdataset, dst_key_t *key,
+	      isc_stdtime_t inception, isc_stdtime_t expire)
+{
+	isc_result_t result;
+	dns_signjob_t *job;
+	dns_rdata_t rdata = DNS_RDATA_INIT;
+	dns_rdata_t *rdatas;
+	isc_region_t r;
+	unsigned char *data;
+	unsigned int count = 0, length = 0, siglen;
+	size_t size;
+
+	/*
+	 * The RRSIG rdata: 18 octets of fixed fields, the signer's name
+	 * and the signature.
+	 */
+	result = dst_key_sigsize(key, &siglen);
+	if (result != ISC_R_SUCCESS)
+		return (result);
+	siglen += 18 + dst_key_name(key)->length;
+
+	for (result = dns_rdataset_first(rdataset);
+	     result == ISC_R_SUCCESS;
+	     result = dns_rdataset_next(rdataset))
+	{
+		dns_rdataset_current(rdataset, &rdata);
+		count++;
+		length += rdata.length;
+		dns_rdata_reset(&rdata);
+	}
+	if (result != ISC_R_NOMORE)
+		return (result);
+
+	size = sizeof(*job) + count * sizeof(dns_rdata_t) + length + siglen;
+	job = isc_mem_get(batch->mctx, size);
+	if (job == NULL)
+		return (ISC_R_NOMEMORY);
+	job->size = size;
+	rdatas = (dns_rdata_t *)(job + 1);
+	data = (unsigned char *)(rdatas + count);
+	job->sigdata = data + length;
+	job->siglen = siglen;
+
+	dns_fixedname_init(&job->fname);
+	dns_name_copy(name, dns_fixedname_name(&job->fname), NULL);
+	dns_rdatalist_init(&job->rdatalist);
+	job->rdatalist.rdclass = rdataset->rdclass;
+	job->rdatalist.type = rdataset->type;
+	job->rdatalist.covers = rdataset->covers;
+	job->rdatalist.ttl = rdataset->ttl;
+	for (result = dns_rdataset_first(rdataset);
+	     result == ISC_R_SUCCESS;
+	     result = dns_rdataset_next(rdataset))
+	{
+		dns_rdataset_current(rdataset, &rdata);
+		dns_rdata_toregion(&rdata, &r);
+		memmove(data, r.base, r.length);
+		r.base = data;
+		data += r.length;
+		dns_rdata_init(rdatas);
+		dns_rdata_fromregion(rdatas, rdata.rdclass, rdata.type, &r);
+		ISC_LIST_APPEND(job->rdatalist.rdata, rdatas, link);
+		rdatas++;
+		dns_rdata_reset(&rdata);
+	}
+	dns_rdataset_init(&job->rdataset);
+	RUNTIME_CHECK(dns_rdatalist_tordataset(&job->rdatalist,
+					       &job->rdataset)
+		      == ISC_R_SUCCESS);
+
+	job->key = key;
+	job->inception = inception;
+	job->expire = expire;
+	job->result = ISC_R_UNSET;
+	dns_rdata_init(&job->sig);
+	ISC_LINK_INIT(job, link);
+	ISC_LIST_APPEND(batch->jobs, job, link);
+	batch->count++;
+
+	return (ISC_R_SUCCESS);
+}
+
+static void
+signjob_run(dns_signbatch_t *batch, dns_signjob_t *job) {
+	isc_buffer_t buffer;
+
+	isc_buffer_init(&buffer, job->sigdata, job->siglen);
+	job->result = dns_dnssec_sign(dns_fixedname_name(&job->fname),
+				      &job->rdataset, job->key,
+				      &job->inception, &job->expire,
+				      batch->mctx, &buffer, &job->sig);
+}
+
+/*
+ * Compute the signatures queued on 'batch', on the zone manager's
+ * signing threads as well as this one, then add them to 'ver' and
+ * 'diff' in the order in which they were queued.
+ */
+static isc_result_t
+signbatch_commit(dns_zone_t *zone, dns_signbatch_t *batch, dns_db_t *db,
+		 dns_dbversion_t *ver, dns_diff_t *diff)
+{
+	isc_result_t result = ISC_R_SUCCESS;
+	dns_zonemgr_t *zmgr = zone->zmgr;
+	dns_signjob_t *job;
+	isc_boolean_t parallel = ISC_FALSE;
+	isc_time_t start, end;
+
+	if (batch->count == 0)
+		return (ISC_R_SUCCESS);
+
+	TIME_NOW(&start);
+	if (zmgr != NULL && batch->count > 1) {
+		LOCK(&zmgr->signlock);
+		if (zmgr->nsigners > 0) {
+			parallel = ISC_TRUE;
+			batch->next = ISC_LIST_HEAD(batch->jobs);
+			batch->pending = batch->count;
+			ISC_LIST_APPEND(zmgr->signbatches, batch, link);
+			BROADCAST(&zmgr->signwork);
+			while ((job = batch->next) != NULL) {
+				batch->next = ISC_LIST_NEXT(job, link);
+				UNLOCK(&zmgr->signlock);
+				signjob_run(batch, job);
+				LOCK(&zmgr->signlock);
+				batch->pending--;
+			}
+			while (batch->pending > 0)
+				WAIT(&zmgr->signdone, &zmgr->signlock);
+			ISC_LIST_UNLINK(zmgr->signbatches, batch, link);
+		}
+		UNLOCK(&zmgr->signlock);
+	}
+	if (!parallel) {
+		for (job = ISC_LIST_HEAD(batch->jobs);
+		     job != NULL;
+		     job = ISC_LIST_NEXT(job, link))
+			signjob_run(batch, job);
+	}
+	TIME_NOW(&end);
+
+	LOCK_ZONE(zone);
+	zone->signcount += batch->count;
+	zone->signtime += isc_time_microdiff(&end, &start);
+	UNLOCK_ZONE(zone);
+
+	for (job = ISC_LIST_HEAD(batch->jobs);
+	     job != NULL;
+	     job = ISC_LIST_NEXT(job, link))
+	{
+		CHECK(job->result);
+		/* Update the database and journal with the RRSIG. */
+		/* XXX inefficient - will cause dataset merging */
+		CHECK(update_one_rr(db, ver, diff, DNS_DIFFOP_ADDRESIGN,
+				    dns_fixedname_name(&job->fname),
+				    job->rdataset.ttl, &job->sig));
+	}
+
+ failure:
+	signbatch_clear(batch);
+	return (result);
+}
+
+/*
+ * The number of threads computing signatures for 'zone'.  The quantum
+ * limits on signing apply to each of them.
+ */
+static unsigned int
+signing_threads(dns_zone_t *zone) {
+	if (zone->zmgr == NULL)
+		return (1);
+	return (zone->zmgr->nsigners + 1);
+}
+
 static isc_result_t
 add_sigs(dns_db_t *db, dns_dbversion_t *ver, dns_name_t *name,
 	 dns_rdatatype_t type, dns_diff_t *diff, dst_key_t **keys,
 	 unsigned int nkeys, isc_mem_t *mctx, isc_stdtime_t inception,
 	 isc_stdtime_t expire, isc_boolean_t check_ksk,
-	 isc_boolean_t keyset_kskonly)
+	 isc_boolean_t keyset_kskonly, dns_signbatch_t *batch)
 {
 	isc_result_t result;
 	dns_dbnode_t *node = NULL;
@@ -6437,6 +6714,12 @@ add_sigs(dns_db_t *db, dns_dbversion_t *ver, dns_name_t *name,
 			continue;
 		}
 
+		if (batch != NULL) {
+			CHECK(signbatch_add(batch, name, &rdataset, keys[i],
+					    inception, expire));
+			continue;
+		}
+
 		/* Calculate the signature, creating a RRSIG RDATA. */
 		isc_buffer_clear(&buffer);
 		CHECK(dns_dnssec_sign(name, &rdataset, keys[i],
@@ -6568,7 +6851,7 @@ zone_resigninc(dns_zone_t *zone) {
 
 		result = add_sigs(db, version, name, covers, zonediff.diff,
 				  zone_keys, nkeys, zone->mctx, inception,
-				  expire, check_ksk, keyset_kskonly);
+				  expire, check_ksk, keyset_kskonly, NULL);
 		if (result != ISC_R_SUCCESS) {
 			dns_zone_log(zone, ISC_LOG_ERROR,
 				     "zone_resigninc:add_sigs -> %s",
@@ -6626,7 +6909,8 @@ zone_resigninc(dns_zone_t *zone) {
 	 */
 	result = add_sigs(db, version, &zone->origin, dns_rdatatype_soa,
 			  zonediff.diff, zone_keys, nkeys, zone->mctx,
-			  inception, soaexpire, check_ksk, keyset_kskonly);
+			  inception, soaexpire, check_ksk, keyset_kskonly,
+			  NULL);
 	if (result != ISC_R_SUCCESS) {
 		dns_zone_log(zone, ISC_LOG_ERROR,
 			     "zone_resigninc:add_sigs -> %s",
@@ -6769,7 +7053,8 @@ sign_a_node(dns_db_t *db, dns_name_t *name, dns_dbnode_t *node,
 	    isc_stdtime_t inception, isc_stdtime_t expire,
 	    unsigned int minimum, isc_boolean_t is_ksk,
 	    isc_boolean_t keyset_kskonly, isc_boolean_t *delegation,
-	    dns_diff_t *diff, isc_int32_t *signatures, isc_mem_t *mctx)
+	    dns_diff_t *diff, isc_int32_t *signatures, isc_mem_t *mctx,
+	    dns_signbatch_t *batch)
 {
 	isc_result_t result;
 	dns_rdatasetiter_t *iterator = NULL;
@@ -6876,6 +7161,12 @@ sign_a_node(dns_db_t *db, dns_name_t *name, dns_dbnode_t *node,
 		if (signed_with_key(db, node, version, rdataset.type, key)) {
 			goto next_rdataset;
 		}
+		if (batch != NULL) {
+			CHECK(signbatch_add(batch, name, &rdataset, key,
+					    inception, expire));
+			(*signatures)--;
+			goto next_rdataset;
+		}
 		/* Calculate the signature, creating a RRSIG RDATA. */
 		isc_buffer_clear(&buffer);
 		CHECK(dns_dnssec_sign(name, &rdataset, key, &inception,
@@ -7358,8 +7649,11 @@ update_sigs(dns_diff_t *diff, dns_db_t *db, dns_dbversion_t *version,
 	    zonediff_t *zonediff)
 {
 	dns_difftuple_t *tuple;
+	dns_signbatch_t batch;
 	isc_result_t result;
 
+	signbatch_init(&batch, zone->mctx);
+
 	for (tuple = ISC_LIST_HEAD(diff->tuples);
 	     tuple != NULL;
 	     tuple = ISC_LIST_HEAD(diff->tuples)) {
@@ -7370,16 +7664,18 @@ update_sigs(dns_diff_t *diff, dns_db_t *db, dns_dbversion_t *version,
 			dns_zone_log(zone, ISC_LOG_ERROR,
 				     "update_sigs:del_sigs -> %s",
 				     dns_result_totext(result));
+			signbatch_clear(&batch);
 			return (result);
 		}
 		result = add_sigs(db, version, &tuple->name,
 				  tuple->rdata.type, zonediff->diff,
 				  zone_keys, nkeys, zone->mctx, inception,
-				  expire, check_ksk, keyset_kskonly);
+				  expire, check_ksk, keyset_kskonly, &batch);
 		if (result != ISC_R_SUCCESS) {
 			dns_zone_log(zone, ISC_LOG_ERROR,
 				     "update_sigs:add_sigs -> %s",
 				     dns_result_totext(result));
+			signbatch_clear(&batch);
 			return (result);
 		}
 
@@ -7395,7 +7691,14 @@ update_sigs(dns_diff_t *diff, dns_db_t *db, dns_dbversion_t *version,
 			tuple = next;
 		} while (tuple != NULL);
 	}
-	return (ISC_R_SUCCESS);
+
+	result = signbatch_commit(zone, &batch, db, version, zonediff->diff);
+	if (result != ISC_R_SUCCESS) {
+		dns_zone_log(zone, ISC_LOG_ERROR,
+			     "update_sigs:signbatch_commit -> %s",
+			     dns_result_totext(result));
+	}
+	return (result);
 }
 
 /*
@@ -7516,8 +7819,8 @@ zone_nsec3chain(dns_zone_t *zone) {
 	 * we have no more nodes to pull off or we reach the limits
 	 * for this quantum.
 	 */
-	nodes = zone->nodes;
-	signatures = zone->signatures;
+	nodes = zone->nodes * signing_threads(zone);
+	signatures = zone->signatures * signing_threads(zone);
 	LOCK_ZONE(zone);
 	nsec3chain = ISC_LIST_HEAD(zone->nsec3chain);
 	UNLOCK_ZONE(zone);
@@ -8104,7 +8407,8 @@ zone_nsec3chain(dns_zone_t *zone) {
 
 	result = add_sigs(db, version, &zone->origin, dns_rdatatype_soa,
 			  zonediff.diff, zone_keys, nkeys, zone->mctx,
-			  inception, soaexpire, check_ksk, keyset_kskonly);
+			  inception, soaexpire, check_ksk, keyset_kskonly,
+			  NULL);
 	if (result != ISC_R_SUCCESS) {
 		dns_zone_log(zone, ISC_LOG_ERROR, "zone_nsec3chain:"
 			     "add_sigs -> %s", dns_result_totext(result));
@@ -8319,6 +8623,7 @@ zone_sign(dns_zone_t *zone) {
 	dns_rdataset_t rdataset;
 	dns_signing_t *signing, *nextsigning;
 	dns_signinglist_t cleanup;
+	dns_signbatch_t batch;
 	dst_key_t *zone_keys[DNS_MAXZONEKEYS];
 	isc_int32_t signatures;
 	isc_boolean_t check_ksk, keyset_kskonly, is_ksk;
@@ -8345,6 +8650,7 @@ zone_sign(dns_zone_t *zone) {
 	dns_diff_init(zone->mctx, &post_diff);
 	zonediff_init(&zonediff, &_sig_diff);
 	ISC_LIST_INIT(cleanup);
+	signbatch_init(&batch, zone->mctx);
 
 	/*
 	 * Updates are disabled.  Pause for 5 minutes.
@@ -8398,8 +8704,8 @@ zone_sign(dns_zone_t *zone) {
 	 * we have no more nodes to pull off or we reach the limits
 	 * for this quantum.
 	 */
-	nodes = zone->nodes;
-	signatures = zone->signatures;
+	nodes = zone->nodes * signing_threads(zone);
+	signatures = zone->signatures * signing_threads(zone);
 	signing = ISC_LIST_HEAD(zone->signing);
 	first = ISC_TRUE;
 
@@ -8571,7 +8877,7 @@ zone_sign(dns_zone_t *zone) {
 					  expire, zone->minimum, is_ksk,
 					  ISC_TF(both && keyset_kskonly),
 					  &delegation, zonediff.diff,
-					  &signatures, zone->mctx));
+					  &signatures, zone->mctx, &batch));
 			/*
 			 * If we are adding we are done.  Look for other keys
 			 * of the same algorithm if deleting.
@@ -8645,10 +8951,33 @@ zone_sign(dns_zone_t *zone) {
 
  next_signing:
 		dns_dbiterator_pause(signing->dbiterator);
+		/*
+		 * A later signing may visit the same nodes again, so
+		 * the signatures for this one have to be in the
+		 * database before it starts.
+		 */
+		result = signbatch_commit(zone, &batch, db, version,
+					  zonediff.diff);
+		if (result != ISC_R_SUCCESS) {
+			dns_zone_log(zone, ISC_LOG_ERROR,
+				     "zone_sign:signbatch_commit -> %s",
+				     dns_result_totext(result));
+			goto failure;
+		}
 		signing = nextsigning;
 		first = ISC_TRUE;
 	}
 
+	if (signing != NULL)
+		dns_dbiterator_pause(signing->dbiterator);
+	result = signbatch_commit(zone, &batch, db, version, zonediff.diff);
+	if (result != ISC_R_SUCCESS) {
+		dns_zone_log(zone, ISC_LOG_ERROR,
+			     "zone_sign:signbatch_commit -> %s",
+			     dns_result_totext(result));
+		goto failure;
+	}
+
 	if (ISC_LIST_HEAD(post_diff.tuples) != NULL) {
 		result = update_sigs(&post_diff, db, version, zone_keys,
 				     nkeys, zone, inception, expire, now,
@@ -8697,7 +9026,8 @@ zone_sign(dns_zone_t *zone) {
 	 */
 	result = add_sigs(db, version, &zone->origin, dns_rdatatype_soa,
 			  zonediff.diff, zone_keys, nkeys, zone->mctx,
-			  inception, soaexpire, check_ksk, keyset_kskonly);
+			  inception, soaexpire, check_ksk, keyset_kskonly,
+			  NULL);
 	if (result != ISC_R_SUCCESS) {
 		dns_zone_log(zone, ISC_LOG_ERROR,
 			     "zone_sign:add_sigs -> %s",
@@ -8771,6 +9101,7 @@ zone_sign(dns_zone_t *zone) {
 		signing = ISC_LIST_HEAD(cleanup);
 	}
 
+	signbatch_clear(&batch);
 	dns_diff_clear(&_sig_diff);
 
 	for (i = 0; i < nkeys; i++)
@@ -16009,15 +16340,30 @@ dns_zonemgr_create(isc_mem_t *mctx, isc_taskmgr_t *taskmgr,
 	if (result != ISC_R_SUCCESS)
 		goto free_startuprefreshrl;
 
+	ISC_LIST_INIT(zmgr->signbatches);
+	zmgr->nsigners = 0;
+	zmgr->signexiting = ISC_FALSE;
+	result = isc_mutex_init(&zmgr->signlock);
+	if (result != ISC_R_SUCCESS)
+		goto free_iolock;
+	result = isc_condition_init(&zmgr->signwork);
+	if (result != ISC_R_SUCCESS)
+		goto free_signlock;
+	result = isc_condition_init(&zmgr->signdone);
+	if (result != ISC_R_SUCCESS)
+		goto free_signwork;
+
 	zmgr->magic = ZONEMGR_MAGIC;
 
 	*zmgrp = zmgr;
 	return (ISC_R_SUCCESS);
 
-#if 0
+ free_signwork:
+	(void)isc_condition_destroy(&zmgr->signwork);
+ free_signlock:
+	DESTROYLOCK(&zmgr->signlock);
  free_iolock:
 	DESTROYLOCK(&zmgr->iolock);
-#endif
  free_startuprefreshrl:
 	isc_ratelimiter_detach(&zmgr->startuprefreshrl);
  free_startupnotifyrl:
@@ -16228,6 +16574,8 @@ dns_zonemgr_shutdown(dns_zonemgr_t *zmgr) {
 	isc_ratelimiter_shutdown(zmgr->startupnotifyrl);
 	isc_ratelimiter_shutdown(zmgr->startuprefreshrl);
 
+	stop_signers(zmgr);
+
 	if (zmgr->task != NULL)
 		isc_task_destroy(&zmgr->task);
 	if (zmgr->zonetasks != NULL)
@@ -16355,6 +16703,11 @@ zonemgr_free(dns_zonemgr_t *zmgr) {
 
 	zmgr->magic = 0;
 
+	stop_signers(zmgr);
+	INSIST(ISC_LIST_EMPTY(zmgr->signbatches));
+	(void)isc_condition_destroy(&zmgr->signdone);
+	(void)isc_condition_destroy(&zmgr->signwork);
+	DESTROYLOCK(&zmgr->signlock);
 	DESTROYLOCK(&zmgr->iolock);
 	isc_ratelimiter_detach(&zmgr->notifyrl);
 	isc_ratelimiter_detach(&zmgr->refreshrl);
@@ -16558,6 +16911,83 @@ dns_zonemgr_getiolimit(dns_zonemgr_t *zmgr) {
 	return (zmgr->iolimit);
 }
 
+static isc_threadresult_t
+#ifdef WIN32
+WINAPI
+#endif
+signer_run(isc_threadarg_t arg) {
+	dns_zonemgr_t *zmgr = arg;
+	dns_signbatch_t *batch;
+	dns_signjob_t *job;
+
+	LOCK(&zmgr->signlock);
+	for (;;) {
+		for (batch = ISC_LIST_HEAD(zmgr->signbatches);
+		     batch != NULL && batch->next == NULL;
+		     batch = ISC_LIST_NEXT(batch, link))
+			;
+		if (zmgr->signexiting)
+			break;
+		if (batch == NULL) {
+			WAIT(&zmgr->signwork, &zmgr->signlock);
+			continue;
+		}
+		job = batch->next;
+		batch->next = ISC_LIST_NEXT(job, link);
+		UNLOCK(&zmgr->signlock);
+
+		signjob_run(batch, job);
+
+		LOCK(&zmgr->signlock);
+		if (--batch->pending == 0)
+			BROADCAST(&zmgr->signdone);
+	}
+	UNLOCK(&zmgr->signlock);
+
+	return ((isc_threadresult_t)0);
+}
+
+static void
+stop_signers(dns_zonemgr_t *zmgr) {
+	unsigned int i;
+
+	LOCK(&zmgr->signlock);
+	zmgr->signexiting = ISC_TRUE;
+	BROADCAST(&zmgr->signwork);
+	UNLOCK(&zmgr->signlock);
+
+	for (i = 0; i < zmgr->nsigners; i++)
+		(void)isc_thread_join(zmgr->signers[i], NULL);
+	zmgr->nsigners = 0;
+	zmgr->signexiting = ISC_FALSE;
+}
+
+void
+dns_zonemgr_setsigners(dns_zonemgr_t *zmgr, unsigned int signers) {
+	REQUIRE(DNS_ZONEMGR_VALID(zmgr));
+
+	stop_signers(zmgr);
+
+	LOCK(&zmgr->signlock);
+	while (zmgr->nsigners < ISC_MIN(signers, MAXSIGNERS)) {
+		if (isc_thread_create(signer_run, zmgr,
+				      &zmgr->signers[zmgr->nsigners]) !=
+		    ISC_R_SUCCESS)
+			break;
+		isc_thread_setname(zmgr->signers[zmgr->nsigners],
+				   "isc-signer");
+		zmgr->nsigners++;
+	}
+	UNLOCK(&zmgr->signlock);
+}
+
+unsigned int
+dns_zonemgr_getsigners(dns_zonemgr_t *zmgr) {
+	REQUIRE(DNS_ZONEMGR_VALID(zmgr));
+
+	return (zmgr->nsigners);
+}
+
 /*
  * Get permission to request a file handle from the OS.
  * An event will be sent to action when one is available.
@@ -17147,6 +17577,13 @@ dns_zonemgr_getcount(dns_zonemgr_t *zmgr, int state) {
 				count++;
 		}
 		break;
+	case DNS_ZONESTATE_LOADPENDING:
+		for (zone = ISC_LIST_HEAD(zmgr->zones);
+		     zone != NULL;
+		     zone = ISC_LIST_NEXT(zone, link))
+			if (DNS_ZONE_FLAG(zone, DNS_ZONEFLG_LOADPENDING))
+				count++;
+		break;
 	default:
 		INSIST(0);
 	}
@@ -17322,6 +17759,44 @@ dns_zone_getsignatures(dns_zone_t *zone) {
 	return (zone->signatures);
 }
 
+void
+dns_zone_getsigningstats(dns_zone_t *zone, isc_uint64_t *signatures,
+			 isc_uint64_t *usecs)
+{
+	REQUIRE(DNS_ZONE_VALID(zone));
+	REQUIRE(signatures != NULL && usecs != NULL);
+
+	LOCK_ZONE(zone);
+	*signatures = zone->signcount;
+	*usecs = zone->signtime;
+	UNLOCK_ZONE(zone);
+}
+
+void
+dns_zone_addxfroutstats(dns_zone_t *zone, isc_uint64_t bytes,
+			isc_uint64_t usecs)
+{
+	REQUIRE(DNS_ZONE_VALID(zone));
+
+	LOCK_ZONE(zone);
+	zone->xfroutbytes += bytes;
+	zone->xfrouttime += usecs;
+	UNLOCK_ZONE(zone);
+}
+
+void
+dns_zone_getxfroutstats(dns_zone_t *zone, isc_uint64_t *bytes,
+			isc_uint64_t *usecs)
+{
+	REQUIRE(DNS_ZONE_VALID(zone));
+	REQUIRE(bytes != NULL && usecs != NULL);
+
+	LOCK_ZONE(zone);
+	*bytes = zone->xfroutbytes;
+	*usecs = zone->xfrouttime;
+	UNLOCK_ZONE(zone);
+}
+
 void
 dns_zone_setprivatetype(dns_zone_t *zone, dns_rdatatype_t type) {
 	REQUIRE(DNS_ZONE_VALID(zone));
@@ -17622,7 +18097,7 @@ sign_apex(dns_zone_t *zone, dns_db_t *db, dns_dbversion_t *ver,
 		result = add_sigs(db, ver, &zone->origin, dns_rdatatype_dnskey,
 				  zonediff->diff, zone_keys, nkeys, zone->mctx,
 				  inception, soaexpire, check_ksk,
-				  keyset_kskonly);
+				  keyset_kskonly, NULL);
 		if (result != ISC_R_SUCCESS) {
 			dns_zone_log(zone, ISC_LOG_ERROR,
 				     "sign_apex:add_sigs -> %s",
@@ -18364,6 +18839,21 @@ dns_zone_getadded(dns_zone_t *zone) {
 	return (zone->added);
 }
 
+void
+dns_zone_setconfighash(dns_zone_t *zone, isc_uint64_t hash) {
+	REQUIRE(DNS_ZONE_VALID(zone));
+
+	LOCK_ZONE(zone);
+	zone->confighash = hash;
+	UNLOCK_ZONE(zone);
+}
+
+isc_uint64_t
+dns_zone_getconfighash(dns_zone_t *zone) {
+	REQUIRE(DNS_ZONE_VALID(zone));
+	return (zone->confighash);
+}
+
 isc_result_t
 dns_zone_dlzpostload(dns_zone_t *zone, dns_db_t *db)
 {
@@ -284,6 +284,9 @@ isc_logconfig_use(isc_log_t *lctx, isc_logconfig_t *lcfg);
  *
  * Ensures:
  *\li	Future calls to isc_log_write will use the new configuration.
+ *\li	The asynchronous writer is started or stopped to match the new
+ *	configuration; when it is stopped, every queued message has
+ *	been written.
  *
  * Returns:
  *\li	#ISC_R_SUCCESS		Success
@@ -762,6 +765,49 @@ isc_log_getduplicateinterval(isc_logconfig_t *lcfg);
  *\li	The current duplicate filtering interval.
  */
 
+void
+isc_logconfig_setasync(isc_logconfig_t *lcfg, isc_boolean_t async);
+/*%<
+ * Set whether messages are written asynchronously while 'lcfg' is in
+ * use.
+ *
+ * Notes:
+ *\li	In asynchronous mode, each thread formats its messages into a
+ *	ring buffer of its own, and a writer thread started by
+ *	isc_logconfig_use() copies them to the channels in batches.
+ *	Messages logged with isc_log_[v]write1(), and messages from
+ *	threads beyond a fixed number, are still written synchronously.
+ *
+ *\li	When a thread's ring buffer is full its messages are dropped
+ *	and counted; the writer logs how many were dropped.
+ *
+ *\li	Asynchronous mode is not available without threads and atomic
+ *	operations, in which case this setting is ignored.
+ *
+ * Requires:
+ *\li	lcfg is a valid logging configuration.
+ */
+
+isc_boolean_t
+isc_logconfig_getasync(isc_logconfig_t *lcfg);
+/*%<
+ * Get whether messages are written asynchronously while 'lcfg' is in
+ * use.
+ *
+ * Requires:
+ *\li	lcfg is a valid logging configuration.
+ */
+
+isc_uint64_t
+isc_log_getdropped(isc_log_t *lctx);
+/*%<
+ * Get the number of messages that were dropped by the asynchronous
+ * writer, because the ring buffer of the thread logging them was full.
+ *
+ * Requires:
+ *\li	lctx is a valid logging context.
+ */
+
 isc_result_t
 isc_log_settag(isc_logconfig_t *lcfg, const char *tag);
 /*%<
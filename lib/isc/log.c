@@ -26,6 +26,7 @@
 #include <isc/magic.h>
 #include <isc/mem.h>
 #include <isc/msgs.h>
+#include <isc/platform.h>
 #include <isc/print.h>
 #include <isc/stat.h>
 #include <isc/stdio.h>
@@ -33,6 +34,17 @@
 #include <isc/time.h>
 #include <isc/util.h>
 
+#if defined(ISC_PLATFORM_USETHREADS) && defined(ISC_PLATFORM_HAVESTDATOMIC)
+#define ISC_LOG_HAVEASYNC 1
+#endif
+
+#ifdef ISC_LOG_HAVEASYNC
+#include <stdatomic.h>
+
+#include <isc/condition.h>
+#include <isc/thread.h>
+#endif
+
 #define LCTX_MAGIC		ISC_MAGIC('L', 'c', 't', 'x')
 #define VALID_CONTEXT(lctx)	ISC_MAGIC_VALID(lctx, LCTX_MAGIC)
 
@@ -48,6 +60,17 @@
 #define PATH_MAX 1024	/* AIX and others don't define this. */
 #endif
 
+/*
+ * Asynchronous mode: the size of each thread's ring buffer, which must
+ * be a power of two, the most threads that get one, and how often the
+ * writer looks for new messages.
+ */
+#define LOG_RING_SIZE		(128 * 1024)
+#define LOG_MAXRINGS		64
+#define LOG_WRITER_INTERVAL	10	/* milliseconds */
+
+#define LOG_RECORD_ALIGN(x)	(((x) + 7) & ~((size_t)7))
+
 /*!
  * This is the structure that holds each named channel.  A simple linked
  * list chains all of the channels together, so an individual channel is
@@ -96,6 +119,42 @@ struct isc_logmessage {
 	ISC_LINK(isc_logmessage_t)	link;
 };
 
+#ifdef ISC_LOG_HAVEASYNC
+/*!
+ * In asynchronous mode each thread that logs has a ring buffer of its
+ * own, into which it copies formatted messages as isc_logrecord_t
+ * headers followed by the NUL-terminated text.  The thread is the only
+ * writer of 'head' and the writer thread the only writer of 'tail', so
+ * no lock is needed to use a ring.  A record never wraps around the end
+ * of the buffer: if it would, the rest of the buffer is skipped, marked
+ * by a record with a NULL category if there is room for one.
+ *
+ * Rings are only freed when the log context is destroyed.
+ */
+typedef struct isc_logring isc_logring_t;
+
+struct isc_logring {
+	unsigned char *			buf;
+	atomic_size_t			head;
+	atomic_size_t			tail;
+	atomic_uint_fast32_t		dropped;
+	isc_logring_t *			next;
+};
+
+typedef struct isc_logrecord {
+	unsigned int			length;
+	int				level;
+	isc_logcategory_t *		category;
+	isc_logmodule_t *		module;
+	isc_time_t			time;
+} isc_logrecord_t;
+
+/*!
+ * Marks a thread that could not be given a ring.
+ */
+static isc_logring_t noring;
+#endif /* ISC_LOG_HAVEASYNC */
+
 /*!
  * The isc_logconfig structure is used to store the configurable information
  * about where messages are actually supposed to be sent -- the information
@@ -113,6 +172,7 @@ struct isc_logconfig {
 	int				highest_level;
 	char *				tag;
 	isc_boolean_t			dynamic;
+	isc_boolean_t			async;
 };
 
 /*!
@@ -146,6 +206,22 @@ struct isc_log {
 	isc_logconfig_t * 		logconfig;
 	char 				buffer[LOG_BUFFER_SIZE];
 	ISC_LIST(isc_logmessage_t)	messages;
+	isc_uint64_t			dropped;
+#ifdef ISC_LOG_HAVEASYNC
+	/* Asynchronous mode. */
+	atomic_bool			async;
+	isc_thread_key_t		ringkey;
+	isc_mutex_t			ringlock;
+	/* Locked by ringlock. */
+	isc_logring_t *			rings;
+	unsigned int			nrings;
+	isc_condition_t			writerwork;
+	isc_boolean_t			writerstop;
+	isc_boolean_t			writerkick;
+	/* Only changed by isc_logconfig_use() and isc_log_destroy(). */
+	isc_boolean_t			writerrunning;
+	isc_thread_t			writer;
+#endif
 };
 
 /*!
@@ -232,6 +308,30 @@ isc_log_doit(isc_log_t *lctx, isc_logcategory_t *category,
 	     const char *format, va_list args)
      ISC_FORMAT_PRINTF(9, 0);
 
+static void
+log_output(isc_log_t *lctx, isc_logcategory_t *category,
+	   isc_logmodule_t *module, int level, isc_boolean_t write_once,
+	   const isc_time_t *when, isc_boolean_t batched,
+	   const char *iformat, va_list args)
+     ISC_FORMAT_PRINTF(8, 0);
+
+#ifdef ISC_LOG_HAVEASYNC
+static isc_threadresult_t
+#ifdef WIN32
+WINAPI
+#endif
+log_writer(isc_threadarg_t arg);
+
+static void
+log_stopwriter(isc_log_t *lctx);
+
+static isc_boolean_t
+log_enqueue(isc_log_t *lctx, isc_logcategory_t *category,
+	    isc_logmodule_t *module, int level,
+	    const char *format, va_list args)
+     ISC_FORMAT_PRINTF(5, 0);
+#endif
+
 /*@{*/
 /*!
  * Convenience macros.
@@ -272,6 +372,7 @@ isc_log_create(isc_mem_t *mctx, isc_log_t **lctxp, isc_logconfig_t **lcfgp) {
 		lctx->modules = NULL;
 		lctx->module_count = 0;
 		lctx->debug_level = 0;
+		lctx->dropped = 0;
 
 		ISC_LIST_INIT(lctx->messages);
 
@@ -281,6 +382,35 @@ isc_log_create(isc_mem_t *mctx, isc_log_t **lctxp, isc_logconfig_t **lcfgp) {
 			return (result);
 		}
 
+#ifdef ISC_LOG_HAVEASYNC
+		atomic_init(&lctx->async, ISC_FALSE);
+		lctx->rings = NULL;
+		lctx->nrings = 0;
+		lctx->writerstop = ISC_FALSE;
+		lctx->writerkick = ISC_FALSE;
+		lctx->writerrunning = ISC_FALSE;
+		result = isc_mutex_init(&lctx->ringlock);
+		if (result != ISC_R_SUCCESS) {
+			DESTROYLOCK(&lctx->lock);
+			isc_mem_putanddetach(&mctx, lctx, sizeof(*lctx));
+			return (result);
+		}
+		result = isc_condition_init(&lctx->writerwork);
+		if (result != ISC_R_SUCCESS) {
+			DESTROYLOCK(&lctx->ringlock);
+			DESTROYLOCK(&lctx->lock);
+			isc_mem_putanddetach(&mctx, lctx, sizeof(*lctx));
+			return (result);
+		}
+		if (isc_thread_key_create(&lctx->ringkey, NULL) != 0) {
+			(void)isc_condition_destroy(&lctx->writerwork);
+			DESTROYLOCK(&lctx->ringlock);
+			DESTROYLOCK(&lctx->lock);
+			isc_mem_putanddetach(&mctx, lctx, sizeof(*lctx));
+			return (ISC_R_UNEXPECTED);
+		}
+#endif
+
 		/*
 		 * Normally setting the magic number is the last step done
 		 * in a creation function, but a valid log context is needed
@@ -337,6 +467,7 @@ isc_logconfig_create(isc_log_t *lctx, isc_logconfig_t **lcfgp) {
 		lcfg->highest_level = level;
 		lcfg->tag = NULL;
 		lcfg->dynamic = ISC_FALSE;
+		lcfg->async = ISC_FALSE;
 
 		ISC_LIST_INIT(lcfg->channels);
 
@@ -447,6 +578,23 @@ isc_logconfig_use(isc_log_t *lctx, isc_logconfig_t *lcfg) {
 
 	isc_logconfig_destroy(&old_cfg);
 
+#ifdef ISC_LOG_HAVEASYNC
+	/*
+	 * Start or stop the writer.  If it cannot be started, messages
+	 * are simply written synchronously.
+	 */
+	if (lcfg->async && !lctx->writerrunning) {
+		lctx->writerstop = ISC_FALSE;
+		if (isc_thread_create(log_writer, lctx, &lctx->writer) ==
+		    ISC_R_SUCCESS)
+		{
+			lctx->writerrunning = ISC_TRUE;
+			atomic_store(&lctx->async, ISC_TRUE);
+		}
+	} else if (!lcfg->async && lctx->writerrunning)
+		log_stopwriter(lctx);
+#endif
+
 	return (ISC_R_SUCCESS);
 }
 
@@ -462,6 +610,21 @@ isc_log_destroy(isc_log_t **lctxp) {
 	lctx = *lctxp;
 	mctx = lctx->mctx;
 
+#ifdef ISC_LOG_HAVEASYNC
+	if (lctx->writerrunning)
+		log_stopwriter(lctx);
+	while (lctx->rings != NULL) {
+		isc_logring_t *ring = lctx->rings;
+
+		lctx->rings = ring->next;
+		isc_mem_put(mctx, ring->buf, LOG_RING_SIZE);
+		isc_mem_put(mctx, ring, sizeof(*ring));
+	}
+	(void)isc_thread_key_delete(lctx->ringkey);
+	(void)isc_condition_destroy(&lctx->writerwork);
+	DESTROYLOCK(&lctx->ringlock);
+#endif
+
 	if (lctx->logconfig != NULL) {
 		lcfg = lctx->logconfig;
 		lctx->logconfig = NULL;
@@ -992,6 +1155,33 @@ isc_log_getduplicateinterval(isc_logconfig_t *lcfg) {
 	return (lcfg->duplicate_interval);
 }
 
+void
+isc_logconfig_setasync(isc_logconfig_t *lcfg, isc_boolean_t async) {
+	REQUIRE(VALID_CONFIG(lcfg));
+
+	lcfg->async = async;
+}
+
+isc_boolean_t
+isc_logconfig_getasync(isc_logconfig_t *lcfg) {
+	REQUIRE(VALID_CONFIG(lcfg));
+
+	return (lcfg->async);
+}
+
+isc_uint64_t
+isc_log_getdropped(isc_log_t *lctx) {
+	isc_uint64_t dropped;
+
+	REQUIRE(VALID_CONTEXT(lctx));
+
+	LOCK(&lctx->lock);
+	dropped = lctx->dropped;
+	UNLOCK(&lctx->lock);
+
+	return (dropped);
+}
+
 isc_result_t
 isc_log_settag(isc_logconfig_t *lcfg, const char *tag) {
 	REQUIRE(VALID_CONFIG(lcfg));
@@ -1583,21 +1773,7 @@ isc_log_doit(isc_log_t *lctx, isc_logcategory_t *category,
 	     isc_msgcat_t *msgcat, int msgset, int msg,
 	     const char *format, va_list args)
 {
-	int syslog_level;
-	const char *time_string;
-	char local_time[64];
-	char iso8601z_string[64];
-	char iso8601l_string[64];
-	char level_string[24];
 	const char *iformat;
-	struct stat statbuf;
-	isc_boolean_t matched = ISC_FALSE;
-	isc_boolean_t printtime, iso8601, utc, printtag, printcolon;
-	isc_boolean_t printcategory, printmodule, printlevel, buffered;
-	isc_logconfig_t *lcfg;
-	isc_logchannel_t *channel;
-	isc_logchannellist_t *category_channels;
-	isc_result_t result;
 
 	REQUIRE(lctx == NULL || VALID_CONTEXT(lctx));
 	REQUIRE(category != NULL);
@@ -1624,13 +1800,58 @@ isc_log_doit(isc_log_t *lctx, isc_logcategory_t *category,
 	else
 		iformat = format;
 
+#ifdef ISC_LOG_HAVEASYNC
+	/*
+	 * Duplicate filtering needs the message history, so messages
+	 * that want it are always written synchronously.
+	 */
+	if (!write_once && atomic_load_explicit(&lctx->async,
+						 memory_order_relaxed) &&
+	    log_enqueue(lctx, category, module, level, iformat, args))
+		return;
+#endif
+
+	LOCK(&lctx->lock);
+	log_output(lctx, category, module, level, write_once, NULL, ISC_FALSE,
+		   iformat, args);
+	UNLOCK(&lctx->lock);
+}
+
+/*
+ * Write a message to every channel that wants it.  The message is
+ * formatted from 'iformat' and 'args' the first time a channel matches.
+ * It is stamped with 'when', or with the current time if 'when' is NULL.
+ * If 'batched' is true, unbuffered channels are not flushed; the caller
+ * will flush them.
+ *
+ * The caller must hold the log context lock.
+ */
+static void
+log_output(isc_log_t *lctx, isc_logcategory_t *category,
+	   isc_logmodule_t *module, int level, isc_boolean_t write_once,
+	   const isc_time_t *when, isc_boolean_t batched,
+	   const char *iformat, va_list args)
+{
+	int syslog_level;
+	const char *time_string;
+	char local_time[64];
+	char iso8601z_string[64];
+	char iso8601l_string[64];
+	char level_string[24];
+	struct stat statbuf;
+	isc_boolean_t matched = ISC_FALSE;
+	isc_boolean_t printtime, iso8601, utc, printtag, printcolon;
+	isc_boolean_t printcategory, printmodule, printlevel, buffered;
+	isc_logconfig_t *lcfg;
+	isc_logchannel_t *channel;
+	isc_logchannellist_t *category_channels;
+	isc_result_t result;
+
 	local_time[0] = '\0';
 	iso8601l_string[0] = '\0';
 	iso8601z_string[0] = '\0';
 	level_string[0] = '\0';
 
-	LOCK(&lctx->lock);
-
 	lctx->buffer[0] = '\0';
 
 	lcfg = lctx->logconfig;
@@ -1693,7 +1914,10 @@ isc_log_doit(isc_log_t *lctx, isc_logcategory_t *category,
 		{
 			isc_time_t isctime;
 
-			TIME_NOW(&isctime);
+			if (when != NULL)
+				isctime = *when;
+			else
+				TIME_NOW(&isctime);
 
 			isc_time_formattimestamp(&isctime,
 						 local_time,
@@ -1798,10 +2022,8 @@ isc_log_doit(isc_log_t *lctx, isc_logcategory_t *category,
 					    == 0) {
 						/*
 						 * ... and it is a duplicate.
-						 * Unlock the mutex and
-						 * get the hell out of Dodge.
+						 * Get the hell out of Dodge.
 						 */
-						UNLOCK(&lctx->lock);
 						return;
 					}
 
@@ -1925,7 +2147,7 @@ isc_log_doit(isc_log_t *lctx, isc_logcategory_t *category,
 				printlevel    ? level_string	: "",
 				lctx->buffer);
 
-			if (!buffered)
+			if (!buffered && !batched)
 				fflush(FILE_STREAM(channel));
 
 			/*
@@ -1977,6 +2199,274 @@ isc_log_doit(isc_log_t *lctx, isc_logcategory_t *category,
 		}
 
 	} while (1);
+}
+
+#ifdef ISC_LOG_HAVEASYNC
+/*
+ * Get the calling thread's ring, creating it if need be.  Returns NULL
+ * if the thread has to log synchronously.
+ */
+static isc_logring_t *
+log_getring(isc_log_t *lctx) {
+	isc_logring_t *ring;
+
+	ring = isc_thread_key_getspecific(lctx->ringkey);
+	if (ring != NULL)
+		return (ring == &noring ? NULL : ring);
+
+	LOCK(&lctx->ringlock);
+	if (lctx->nrings < LOG_MAXRINGS)
+		ring = isc_mem_get(lctx->mctx, sizeof(*ring));
+	if (ring != NULL) {
+		ring->buf = isc_mem_get(lctx->mctx, LOG_RING_SIZE);
+		if (ring->buf == NULL) {
+			isc_mem_put(lctx->mctx, ring, sizeof(*ring));
+			ring = NULL;
+		}
+	}
+	if (ring != NULL) {
+		atomic_init(&ring->head, 0);
+		atomic_init(&ring->tail, 0);
+		atomic_init(&ring->dropped, 0);
+		ring->next = lctx->rings;
+		lctx->rings = ring;
+		lctx->nrings++;
+	}
+	UNLOCK(&lctx->ringlock);
+
+	(void)isc_thread_key_setspecific(lctx->ringkey,
+					 ring != NULL ? ring : &noring);
+
+	return (ring);
+}
+
+/*
+ * Format a message into the calling thread's ring.  Returns ISC_FALSE,
+ * without having used 'args', if the thread has no ring.  If the ring
+ * is full, the message is counted as dropped.
+ */
+static isc_boolean_t
+log_enqueue(isc_log_t *lctx, isc_logcategory_t *category,
+	    isc_logmodule_t *module, int level,
+	    const char *format, va_list args)
+{
+	isc_logring_t *ring;
+	isc_logrecord_t *record;
+	char text[LOG_BUFFER_SIZE];
+	size_t head, tail, off, pad, need, len;
+	int n;
+
+	ring = log_getring(lctx);
+	if (ring == NULL)
+		return (ISC_FALSE);
+
+	n = vsnprintf(text, sizeof(text), format, args);
+	if (n < 0)
+		n = 0;
+	len = ISC_MIN((size_t)n, sizeof(text) - 1);
+	text[len] = '\0';
+	need = LOG_RECORD_ALIGN(sizeof(*record) + len + 1);
+
+	head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+	off = head & (LOG_RING_SIZE - 1);
+	pad = (LOG_RING_SIZE - off < need) ? LOG_RING_SIZE - off : 0;
+	if (head + pad + need - tail > LOG_RING_SIZE) {
+		atomic_fetch_add_explicit(&ring->dropped, 1,
+					  memory_order_relaxed);
+		return (ISC_TRUE);
+	}
+
+	if (pad != 0) {
+		if (pad >= sizeof(*record)) {
+			record = (isc_logrecord_t *)(ring->buf + off);
+			record->length = (unsigned int)pad;
+			record->category = NULL;
+		}
+		head += pad;
+		off = 0;
+	}
+
+	record = (isc_logrecord_t *)(ring->buf + off);
+	record->length = (unsigned int)need;
+	record->level = level;
+	record->category = category;
+	record->module = module;
+	TIME_NOW(&record->time);
+	memmove(record + 1, text, len + 1);
+
+	atomic_store_explicit(&ring->head, head + need, memory_order_release);
+
+	/*
+	 * Don't wait for the writer's next pass if the ring has just
+	 * become half full.  'writerkick' tells a writer that is busy
+	 * draining not to go to sleep afterwards.
+	 */
+	if (head - tail <= LOG_RING_SIZE / 2 &&
+	    head + need - tail > LOG_RING_SIZE / 2)
+	{
+		LOCK(&lctx->ringlock);
+		lctx->writerkick = ISC_TRUE;
+		SIGNAL(&lctx->writerwork);
+		UNLOCK(&lctx->ringlock);
+	}
+
+	return (ISC_TRUE);
+}
+
+static void
+log_writerecord(isc_log_t *lctx, isc_logcategory_t *category,
+		isc_logmodule_t *module, int level, const isc_time_t *when,
+		const char *format, ...)
+     ISC_FORMAT_PRINTF(6, 7);
+
+static void
+log_writerecord(isc_log_t *lctx, isc_logcategory_t *category,
+		isc_logmodule_t *module, int level, const isc_time_t *when,
+		const char *format, ...)
+{
+	va_list args;
 
+	va_start(args, format);
+	log_output(lctx, category, module, level, ISC_FALSE, when, ISC_TRUE,
+		   format, args);
+	va_end(args);
+}
+
+/*
+ * Write out every record in 'ring'.  The caller must hold the log
+ * context lock.
+ */
+static unsigned int
+log_drainring(isc_log_t *lctx, isc_logring_t *ring) {
+	isc_logrecord_t *record;
+	size_t head, tail, off;
+	unsigned int count = 0;
+
+	tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	head = atomic_load_explicit(&ring->head, memory_order_acquire);
+	while (tail != head) {
+		off = tail & (LOG_RING_SIZE - 1);
+		if (LOG_RING_SIZE - off < sizeof(*record)) {
+			tail += LOG_RING_SIZE - off;
+			continue;
+		}
+		record = (isc_logrecord_t *)(ring->buf + off);
+		if (record->category != NULL) {
+			log_writerecord(lctx, record->category,
+					record->module, record->level,
+					&record->time, "%s",
+					(const char *)(record + 1));
+			count++;
+		}
+		tail += record->length;
+	}
+	atomic_store_explicit(&ring->tail, tail, memory_order_release);
+
+	return (count);
+}
+
+/*
+ * Write out the messages queued in every ring, then flush the
+ * unbuffered file channels once.
+ */
+static void
+log_drain(isc_log_t *lctx) {
+	isc_logring_t *ring;
+	isc_logchannel_t *channel;
+	isc_uint64_t dropped = 0;
+	unsigned int count = 0;
+
+	/*
+	 * Rings are only ever added at the head of the list.
+	 */
+	LOCK(&lctx->ringlock);
+	ring = lctx->rings;
+	UNLOCK(&lctx->ringlock);
+
+	LOCK(&lctx->lock);
+	for (; ring != NULL; ring = ring->next) {
+		count += log_drainring(lctx, ring);
+		dropped += atomic_exchange_explicit(&ring->dropped, 0,
+						    memory_order_relaxed);
+	}
+
+	if (dropped != 0) {
+		lctx->dropped += dropped;
+		log_writerecord(lctx, ISC_LOGCATEGORY_GENERAL,
+				ISC_LOGMODULE_OTHER, ISC_LOG_WARNING, NULL,
+				"dropped %" ISC_PRINT_QUADFORMAT "u log "
+				"messages: the log writer fell behind",
+				dropped);
+		count++;
+	}
+
+	if (count != 0) {
+		for (channel = ISC_LIST_HEAD(lctx->logconfig->channels);
+		     channel != NULL;
+		     channel = ISC_LIST_NEXT(channel, link))
+		{
+			if ((channel->type == ISC_LOG_TOFILE ||
+			     channel->type == ISC_LOG_TOFILEDESC) &&
+			    FILE_STREAM(channel) != NULL &&
+			    (channel->flags & ISC_LOG_BUFFERED) == 0)
+				fflush(FILE_STREAM(channel));
+		}
+	}
 	UNLOCK(&lctx->lock);
 }
+
+static isc_threadresult_t
+#ifdef WIN32
+WINAPI
+#endif
+log_writer(isc_threadarg_t arg) {
+	isc_log_t *lctx = arg;
+	isc_interval_t interval;
+	isc_time_t next;
+
+	isc_interval_set(&interval, 0, LOG_WRITER_INTERVAL * 1000000);
+
+	LOCK(&lctx->ringlock);
+	while (!lctx->writerstop) {
+		lctx->writerkick = ISC_FALSE;
+		UNLOCK(&lctx->ringlock);
+		log_drain(lctx);
+		LOCK(&lctx->ringlock);
+		if (lctx->writerstop)
+			break;
+		if (!lctx->writerkick &&
+		    isc_time_nowplusinterval(&next, &interval) ==
+		    ISC_R_SUCCESS)
+			(void)isc_condition_waituntil(&lctx->writerwork,
+						      &lctx->ringlock, &next);
+	}
+	UNLOCK(&lctx->ringlock);
+
+	log_drain(lctx);
+
+	return ((isc_threadresult_t)0);
+}
+
+/*
+ * Return to synchronous mode, once everything queued has been written.
+ */
+static void
+log_stopwriter(isc_log_t *lctx) {
+	atomic_store(&lctx->async, ISC_FALSE);
+
+	LOCK(&lctx->ringlock);
+	lctx->writerstop = ISC_TRUE;
+	SIGNAL(&lctx->writerwork);
+	UNLOCK(&lctx->ringlock);
+
+	(void)isc_thread_join(lctx->writer, NULL);
+	lctx->writerrunning = ISC_FALSE;
+
+	/*
+	 * Catch anything queued by threads that had not yet seen
+	 * the change of mode.
+	 */
+	log_drain(lctx);
+}
+#endif /* ISC_LOG_HAVEASYNC */
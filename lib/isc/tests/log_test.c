@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2018  Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*! \file */
+
+#include <config.h>
+
+#include <atf-c.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <isc/file.h>
+#include <isc/log.h>
+#include <isc/print.h>
+#include <isc/stdio.h>
+#include <isc/thread.h>
+#include <isc/util.h>
+
+#include "isctest.h"
+
+#define TESTLOG		"log_test.out"
+#define NTHREADS	4
+#define NMESSAGES	2000
+
+static isc_log_t *tlctx = NULL;
+
+/*
+ * Create a configuration for 'tlctx' that logs everything to TESTLOG,
+ * and start using it.
+ */
+static void
+use_config(isc_boolean_t async) {
+	isc_logconfig_t *lcfg = NULL;
+	isc_logdestination_t destination;
+	isc_result_t result;
+
+	result = isc_logconfig_create(tlctx, &lcfg);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	destination.file.stream = NULL;
+	destination.file.name = TESTLOG;
+	destination.file.versions = ISC_LOG_ROLLNEVER;
+	destination.file.suffix = isc_log_rollsuffix_increment;
+	destination.file.maximum_size = 0;
+	result = isc_log_createchannel(lcfg, "test", ISC_LOG_TOFILE,
+				       ISC_LOG_INFO, &destination, 0);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	result = isc_log_usechannel(lcfg, "test", NULL, NULL);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	isc_logconfig_setasync(lcfg, async);
+	ATF_REQUIRE_EQ(isc_logconfig_getasync(lcfg), async);
+
+	result = isc_logconfig_use(tlctx, lcfg);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+}
+
+static isc_threadresult_t
+#ifdef WIN32
+WINAPI
+#endif
+log_messages(isc_threadarg_t arg) {
+	unsigned int id = *(unsigned int *)arg;
+	unsigned int i;
+
+	for (i = 0; i < NMESSAGES; i++)
+		isc_log_write(tlctx, ISC_LOGCATEGORY_GENERAL,
+			      ISC_LOGMODULE_OTHER, ISC_LOG_INFO,
+			      "thread %u message %u", id, i);
+
+	return ((isc_threadresult_t)0);
+}
+
+ATF_TC(async);
+ATF_TC_HEAD(async, tc) {
+	atf_tc_set_md_var(tc, "descr",
+			  "asynchronous logging writes or counts every "
+			  "message, in order for each thread");
+}
+ATF_TC_BODY(async, tc) {
+	isc_thread_t threads[NTHREADS];
+	unsigned int ids[NTHREADS];
+	unsigned int next[NTHREADS];
+	unsigned int written = 0, id, n;
+	isc_boolean_t last = ISC_FALSE;
+	char line[256];
+	isc_result_t result;
+	FILE *fp = NULL;
+	int i;
+
+	UNUSED(tc);
+
+	result = isc_test_begin(NULL, ISC_FALSE);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	(void)isc_file_remove(TESTLOG);
+
+	result = isc_log_create(mctx, &tlctx, NULL);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	use_config(ISC_TRUE);
+
+	for (i = 0; i < NTHREADS; i++) {
+		ids[i] = i;
+		next[i] = 0;
+		result = isc_thread_create(log_messages, &ids[i],
+					   &threads[i]);
+		ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	}
+	for (i = 0; i < NTHREADS; i++)
+		(void)isc_thread_join(threads[i], NULL);
+
+	/*
+	 * Going back to synchronous mode writes out whatever is still
+	 * queued, and later messages are written straight away.
+	 */
+	use_config(ISC_FALSE);
+	isc_log_write(tlctx, ISC_LOGCATEGORY_GENERAL, ISC_LOGMODULE_OTHER,
+		      ISC_LOG_INFO, "last message");
+
+	result = isc_stdio_open(TESTLOG, "r", &fp);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		if (strcmp(line, "last message\n") == 0) {
+			last = ISC_TRUE;
+			continue;
+		}
+		if (sscanf(line, "thread %u message %u", &id, &n) != 2)
+			continue;
+		ATF_REQUIRE(id < NTHREADS);
+		ATF_CHECK(n >= next[id]);
+		next[id] = n + 1;
+		written++;
+	}
+	(void)isc_stdio_close(fp);
+
+	ATF_CHECK(last);
+	ATF_CHECK_EQ(written + isc_log_getdropped(tlctx),
+		     NTHREADS * NMESSAGES);
+
+	isc_log_destroy(&tlctx);
+	(void)isc_file_remove(TESTLOG);
+	isc_test_end();
+}
+
+/*
+ * Main
+ */
+ATF_TP_ADD_TCS(tp) {
+	ATF_TP_ADD_TC(tp, async);
+	return (atf_no_error());
+}
@@ -83,6 +83,7 @@ struct isc__timer {
 	void *				arg;
 	unsigned int			index;
 	isc_time_t			due;
+	isc_boolean_t			posted;
 	LINK(isc__timer_t)		link;
 };
 
@@ -350,11 +351,12 @@ destroy(isc__timer_t *timer) {
 
 	LOCK(&manager->lock);
 
-	(void)isc_task_purgerange(timer->task,
-				  timer,
-				  ISC_TIMEREVENT_FIRSTEVENT,
-				  ISC_TIMEREVENT_LASTEVENT,
-				  NULL);
+	if (timer->posted)
+		(void)isc_task_purgerange(timer->task,
+					  timer,
+					  ISC_TIMEREVENT_FIRSTEVENT,
+					  ISC_TIMEREVENT_LASTEVENT,
+					  NULL);
 	deschedule(timer);
 	UNLINK(manager->timers, timer, link);
 
@@ -448,6 +450,7 @@ isc__timer_create(isc_timermgr_t *manager0, isc_timertype_t type,
 	 */
 	DE_CONST(arg, timer->arg);
 	timer->index = 0;
+	timer->posted = ISC_FALSE;
 	result = isc_mutex_init(&timer->lock);
 	if (result != ISC_R_SUCCESS) {
 		isc_task_detach(&timer->task);
@@ -535,12 +538,19 @@ isc__timer_reset(isc_timer_t *timer0, isc_timertype_t type,
 	LOCK(&manager->lock);
 	LOCK(&timer->lock);
 
-	if (purge)
+	/*
+	 * Purging has to search the whole event queue of the task, which
+	 * may be shared by many timers; skip it when this timer has not
+	 * posted anything since it was last purged.
+	 */
+	if (purge && timer->posted) {
 		(void)isc_task_purgerange(timer->task,
 					  timer,
 					  ISC_TIMEREVENT_FIRSTEVENT,
 					  ISC_TIMEREVENT_LASTEVENT,
 					  NULL);
+		timer->posted = ISC_FALSE;
+	}
 	timer->type = type;
 	timer->expires = *expires;
 	timer->interval = *interval;
@@ -739,6 +749,7 @@ dispatch(isc__timermgr_t *manager, isc_time_t *now) {
 
 				if (event != NULL) {
 					event->due = timer->due;
+					timer->posted = ISC_TRUE;
 					isc_task_send(timer->task,
 						      ISC_EVENT_PTR(&event));
 				} else
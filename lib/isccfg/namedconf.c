@@ -1108,6 +1108,7 @@ options_clauses[] = {
 	{ "pid-file", &cfg_type_qstringornone, 0 },
 	{ "port", &cfg_type_uint32, 0 },
 	{ "querylog", &cfg_type_boolean, 0 },
+	{ "querylog-binary", &cfg_type_qstring, 0 },
 	{ "random-device", &cfg_type_qstringornone, 0 },
 	{ "recursing-file", &cfg_type_qstring, 0 },
 	{ "recursive-clients", &cfg_type_uint32, 0 },
@@ -1139,6 +1140,7 @@ options_clauses[] = {
 	{ "transfers-out", &cfg_type_uint32, 0 },
 	{ "transfers-per-ns", &cfg_type_uint32, 0 },
 	{ "treat-cr-as-space", &cfg_type_boolean, CFG_CLAUSEFLAG_OBSOLETE },
+	{ "trust-server-cookie", &cfg_type_boolean, 0 },
 	{ "use-id-pool", &cfg_type_boolean, CFG_CLAUSEFLAG_OBSOLETE },
 	{ "use-ixfr", &cfg_type_boolean, CFG_CLAUSEFLAG_OBSOLETE },
 	{ "use-v4-udp-ports", &cfg_type_bracketed_portlist, 0 },
@@ -1265,7 +1267,7 @@ static cfg_type_t cfg_type_resppadding = {
 
 /*%
  *  dnstap {
- *      &lt;message type&gt; [query | response] ;
+ *      &lt;message type&gt; [query | response] [sample &lt;integer&gt;] ;
  *      ...
  *  }
  *
@@ -1287,9 +1289,17 @@ static cfg_type_t cfg_type_dnstap_mode = {
 	doc_optional_enum, &cfg_rep_string, dnstap_modes
 };
 
+static keyword_type_t dnstap_sample_kw = { "sample", &cfg_type_uint32 };
+
+static cfg_type_t cfg_type_dnstap_sample = {
+	"dnstap_sample", parse_optional_keyvalue, print_keyvalue,
+	doc_optional_keyvalue, &cfg_rep_uint32, &dnstap_sample_kw
+};
+
 static cfg_tuplefielddef_t dnstap_fields[] = {
 	{ "type", &cfg_type_dnstap_type, 0 },
 	{ "mode", &cfg_type_dnstap_mode, 0 },
+	{ "sample", &cfg_type_dnstap_sample, 0 },
 	{ NULL, NULL, 0 }
 };
 
@@ -2498,6 +2508,7 @@ static cfg_type_t cfg_type_destinationlist = {
  * Clauses that can be found in a 'logging' statement.
  */
 static cfg_clausedef_t logging_clauses[] = {
+	{ "async", &cfg_type_boolean, 0 },
 	{ "channel", &cfg_type_channel, CFG_CLAUSEFLAG_MULTI },
 	{ "category", &cfg_type_category, CFG_CLAUSEFLAG_MULTI },
 	{ NULL, NULL, 0 }
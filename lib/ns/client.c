@@ -37,6 +37,7 @@
 #include <dns/events.h>
 #include <dns/message.h>
 #include <dns/peer.h>
+#include <dns/qlog.h>
 #include <dns/rcode.h>
 #include <dns/rdata.h>
 #include <dns/rdataclass.h>
@@ -92,6 +93,12 @@
 #define TCP_CLIENT(c)	(((c)->attributes & NS_CLIENTATTR_TCP) != 0)
 
 #define TCP_BUFFER_SIZE			(65535 + 2)
+#define TCP_BUFFER_FREEMAX		4
+/*%<
+ * Number of TCP send buffers kept on each pool's free list once their
+ * responses have been sent, so that back-to-back TCP responses do not
+ * each allocate and free a 64k buffer.
+ */
 #define SEND_BUFFER_SIZE		4096
 #define RECV_BUFFER_SIZE		4096
 
@@ -113,7 +120,6 @@
  */
 #endif
 
-#define COOKIE_SIZE 24U /* 8 + 4 + 4 + 8 */
 #define ECS_SIZE 20U /* 2 + 1 + 1 + [0..16] */
 
 #define WANTNSID(x) (((x)->attributes & NS_CLIENTATTR_WANTNSID) != 0)
@@ -121,13 +127,28 @@
 #define WANTPAD(x) (((x)->attributes & NS_CLIENTATTR_WANTPAD) != 0)
 #define USEKEEPALIVE(x) (((x)->attributes & NS_CLIENTATTR_USEKEEPALIVE) != 0)
 
+/*%
+ * Per-worker client pool.  Each UDP dispatch (and thus each listening
+ * socket) feeds its own pool, so a client that goes inactive is only
+ * ever recycled by the same worker and the pools never contend with
+ * each other.
+ */
+typedef struct clientpool {
+	/* The queue object has its own locks */
+	client_queue_t			inactive;     /*%< To be recycled */
+
+	/* Lock covers the clients list and the TCP buffer pool */
+	isc_mutex_t			lock;
+	client_list_t			clients;      /*%< All clients */
+	isc_mempool_t *			tcpbufs;      /*%< TCP send buffers */
+} clientpool_t;
+
 /*% nameserver client manager structure */
 struct ns_clientmgr {
 	/* Unlocked. */
 	unsigned int			magic;
-
-	/* The queue object has its own locks */
-	client_queue_t			inactive;     /*%< To be recycled */
+	unsigned int			npools;
+	clientpool_t *			pools;
 
 	isc_mem_t *			mctx;
 	ns_server_t *			sctx;
@@ -139,10 +160,6 @@ struct ns_clientmgr {
 	isc_mutex_t			lock;
 	isc_boolean_t			exiting;
 
-	/* Lock covers the clients list */
-	isc_mutex_t			listlock;
-	client_list_t			clients;      /*%< All active clients */
-
 	/* Lock covers the recursing list */
 	isc_mutex_t			reclock;
 	client_list_t			recursing;    /*%< Recursing clients */
@@ -157,6 +174,8 @@ struct ns_clientmgr {
 #define MANAGER_MAGIC			ISC_MAGIC('N', 'S', 'C', 'm')
 #define VALID_MANAGER(m)		ISC_MAGIC_VALID(m, MANAGER_MAGIC)
 
+#define CLIENT_POOL(c)			(&(c)->manager->pools[(c)->pool])
+
 /*!
  * Client object states.  Ordering is significant: higher-numbered
  * states are generally "more active", meaning that the client can
@@ -237,14 +256,17 @@ static void client_read(ns_client_t *client, isc_boolean_t newconn);
 static void client_accept(ns_client_t *client);
 static void client_udprecv(ns_client_t *client);
 static void clientmgr_destroy(ns_clientmgr_t *manager);
+static void client_puttcpbuf(ns_client_t *client);
+static isc_boolean_t clientmgr_empty(ns_clientmgr_t *manager);
 static isc_boolean_t exit_check(ns_client_t *client);
 static void ns_client_endrequest(ns_client_t *client);
 static void client_start(isc_task_t *task, isc_event_t *event);
 static void ns_client_dumpmessage(ns_client_t *client, const char *reason);
 static isc_result_t get_client(ns_clientmgr_t *manager, ns_interface_t *ifp,
-			       dns_dispatch_t *disp, isc_boolean_t tcp);
+			       dns_dispatch_t *disp, unsigned int pool,
+			       isc_boolean_t tcp);
 static isc_result_t get_worker(ns_clientmgr_t *manager, ns_interface_t *ifp,
-			       isc_socket_t *sock);
+			       isc_socket_t *sock, unsigned int pool);
 static void compute_cookie(ns_client_t *client, isc_uint32_t when,
 			   isc_uint32_t nonce, const unsigned char *secret,
 			   isc_buffer_t *buf);
@@ -566,8 +588,10 @@ exit_check(ns_client_t *client) {
 			     NS_SERVER_CLIENTTEST) == 0 &&
 			    manager != NULL && !manager->exiting)
 			{
-				ISC_QUEUE_PUSH(manager->inactive, client,
-					       ilink);
+				clientpool_t *pool;
+
+				pool = &manager->pools[client->pool];
+				ISC_QUEUE_PUSH(pool->inactive, client, ilink);
 			}
 			if (client->needshutdown)
 				isc_task_shutdown(client->task);
@@ -590,15 +614,23 @@ exit_check(ns_client_t *client) {
 		INSIST(client->recursionquota == NULL);
 		INSIST(!ISC_QLINK_LINKED(client, ilink));
 
+		/*
+		 * The TCP buffer goes back to the pool before the client
+		 * is unlinked, as the manager (and the pool) may be
+		 * destroyed as soon as the last client is gone.
+		 */
+		client_puttcpbuf(client);
+
 		if (manager != NULL) {
-			LOCK(&manager->listlock);
-			ISC_LIST_UNLINK(manager->clients, client, link);
+			clientpool_t *pool = &manager->pools[client->pool];
+
 			LOCK(&manager->lock);
-			if (manager->exiting &&
-			    ISC_LIST_EMPTY(manager->clients))
+			LOCK(&pool->lock);
+			ISC_LIST_UNLINK(pool->clients, client, link);
+			UNLOCK(&pool->lock);
+			if (manager->exiting && clientmgr_empty(manager))
 				destroy_manager = ISC_TRUE;
 			UNLOCK(&manager->lock);
-			UNLOCK(&manager->listlock);
 		}
 
 		ns_query_free(client);
@@ -609,9 +641,6 @@ exit_check(ns_client_t *client) {
 		if (client->delaytimer != NULL)
 			isc_timer_detach(&client->delaytimer);
 
-		if (client->tcpbuf != NULL)
-			isc_mem_put(client->mctx, client->tcpbuf,
-				    TCP_BUFFER_SIZE);
 		if (client->opt != NULL) {
 			INSIST(dns_rdataset_isassociated(client->opt));
 			dns_rdataset_disassociate(client->opt);
@@ -722,7 +751,8 @@ client_shutdown(isc_task_t *task, isc_event_t *event) {
 	}
 
 	if (ISC_QLINK_LINKED(client, ilink))
-		ISC_QUEUE_UNLINK(client->manager->inactive, client, ilink);
+		ISC_QUEUE_UNLINK(client->manager->pools[client->pool].inactive,
+				 client, ilink);
 
 	client->newstate = NS_CLIENTSTATE_FREED;
 	client->needshutdown = ISC_FALSE;
@@ -741,6 +771,8 @@ ns_client_endrequest(ns_client_t *client) {
 
 	CTRACE("endrequest");
 
+	ns_client_qlog(client, DNS_QLOG_NORESPONSE);
+
 	if (client->next != NULL) {
 		(client->next)(client);
 		client->next = NULL;
@@ -849,13 +881,24 @@ client_senddone(isc_task_t *task, isc_event_t *event) {
 
 	if (client->tcpbuf != NULL) {
 		INSIST(TCP_CLIENT(client));
-		isc_mem_put(client->mctx, client->tcpbuf, TCP_BUFFER_SIZE);
-		client->tcpbuf = NULL;
+		client_puttcpbuf(client);
 	}
 
 	ns_client_next(client, ISC_R_SUCCESS);
 }
 
+/*%
+ * Return the client's TCP send buffer, if any, to its pool.
+ */
+static void
+client_puttcpbuf(ns_client_t *client) {
+	if (client->tcpbuf == NULL)
+		return;
+
+	isc_mempool_put(CLIENT_POOL(client)->tcpbufs, client->tcpbuf);
+	client->tcpbuf = NULL;
+}
+
 /*%
  * We only want to fail with ISC_R_NOSPACE when called from
  * ns_client_sendraw() and not when called from ns_client_send(),
@@ -883,7 +926,7 @@ client_allocsendbuf(ns_client_t *client, isc_buffer_t *buffer,
 			result = ISC_R_NOSPACE;
 			goto done;
 		}
-		client->tcpbuf = isc_mem_get(client->mctx, TCP_BUFFER_SIZE);
+		client->tcpbuf = isc_mempool_get(CLIENT_POOL(client)->tcpbufs);
 		if (client->tcpbuf == NULL) {
 			result = ISC_R_NOMEMORY;
 			goto done;
@@ -923,6 +966,38 @@ client_allocsendbuf(ns_client_t *client, isc_buffer_t *buffer,
 	return (result);
 }
 
+/*
+ * Count a UDP query response as having taken the fast path -- answered
+ * on the task that received the query without recursing, and sent without
+ * waiting for a send completion event -- or the slow path, along with
+ * its latency class.
+ */
+static void
+client_pathstats(ns_client_t *client, isc_boolean_t sentinline) {
+	isc_time_t now;
+	isc_uint64_t usecs;
+	isc_statscounter_t counter;
+
+	if (sentinline &&
+	    (client->query.attributes & NS_QUERYATTR_RECURSED) == 0)
+		counter = ns_statscounter_fastpath;
+	else
+		counter = ns_statscounter_slowpath;
+	ns_stats_increment(client->sctx->nsstats, counter);
+
+	TIME_NOW(&now);
+	usecs = isc_time_microdiff(&now, &client->requesttime);
+	if (usecs < NS_CLIENT_LATCLASS0)
+		counter += 1;
+	else if (usecs < NS_CLIENT_LATCLASS1)
+		counter += 2;
+	else if (usecs < NS_CLIENT_LATCLASS2)
+		counter += 3;
+	else
+		counter += 4;
+	ns_stats_increment(client->sctx->nsstats, counter);
+}
+
 static isc_result_t
 client_sendpkg(ns_client_t *client, isc_buffer_t *buffer) {
 	struct in6_pktinfo *pktinfo;
@@ -993,6 +1068,10 @@ client_sendpkg(ns_client_t *client, isc_buffer_t *buffer) {
 				    address, pktinfo,
 				    client->sendevent, sockflags);
 	if (result == ISC_R_SUCCESS || result == ISC_R_INPROGRESS) {
+		if (!TCP_CLIENT(client) &&
+		    client->message->opcode == dns_opcode_query)
+			client_pathstats(client,
+					 ISC_TF(result == ISC_R_SUCCESS));
 		client->nsends++;
 		if (result == ISC_R_SUCCESS)
 			client_senddone(client->task,
@@ -1041,10 +1120,7 @@ ns_client_sendraw(ns_client_t *client, dns_message_t *message) {
 		return;
 
  done:
-	if (client->tcpbuf != NULL) {
-		isc_mem_put(client->mctx, client->tcpbuf, TCP_BUFFER_SIZE);
-		client->tcpbuf = NULL;
-	}
+	client_puttcpbuf(client);
 	ns_client_next(client, result);
 }
 
@@ -1301,6 +1377,10 @@ client_send(ns_client_t *client) {
 
 	dns_rcodestats_increment(client->sctx->rcodestats,
 				 client->message->rcode);
+	if ((client->message->flags & DNS_MESSAGEFLAG_TC) != 0)
+		ns_client_qlog(client, DNS_QLOG_TC);
+	else
+		ns_client_qlog(client, 0);
 	if (opt_included) {
 		ns_stats_increment(client->sctx->nsstats,
 				   ns_statscounter_edns0out);
@@ -1321,10 +1401,7 @@ client_send(ns_client_t *client) {
 		return;
 
  done:
-	if (client->tcpbuf != NULL) {
-		isc_mem_put(client->mctx, client->tcpbuf, TCP_BUFFER_SIZE);
-		client->tcpbuf = NULL;
-	}
+	client_puttcpbuf(client);
 
 	if (cleanup_cctx)
 		dns_compress_invalidate(&cctx);
@@ -1461,9 +1538,13 @@ ns_client_error(ns_client_t *client, isc_result_t result) {
 #endif
 
 	/*
-	 * Try to rate limit error responses.
+	 * Try to rate limit error responses.  With trust-server-cookie,
+	 * clients that sent a valid server cookie are exempt.
 	 */
-	if (client->view != NULL && client->view->rrl != NULL) {
+	if (client->view != NULL && client->view->rrl != NULL &&
+	    ((client->sctx->options & NS_SERVER_TRUSTCOOKIE) == 0 ||
+	     (client->attributes & NS_CLIENTATTR_HAVECOOKIE) == 0))
+	{
 		isc_boolean_t wouldlog;
 		char log_buf[DNS_RRL_LOG_BUF_LEN];
 		dns_rrl_result_t rrl_result;
@@ -1525,8 +1606,12 @@ ns_client_error(ns_client_t *client, isc_result_t result) {
 		/*
 		 * It could be that we've got a query with a good header,
 		 * but a bad question section, so we try again with
-		 * want_question_section set to ISC_FALSE.
+		 * want_question_section set to ISC_FALSE.  The query
+		 * name goes away with the question section, so write any
+		 * pending binary query log record first.
 		 */
+		message->rcode = rcode;
+		ns_client_qlog(client, 0);
 		result = dns_message_reply(message, ISC_FALSE);
 		if (result != ISC_R_SUCCESS) {
 			ns_client_next(client, result);
@@ -1594,7 +1679,7 @@ ns_client_addopt(ns_client_t *client, dns_message_t *message,
 {
 	unsigned char ecs[ECS_SIZE];
 	char nsid[BUFSIZ], *nsidp;
-	unsigned char cookie[COOKIE_SIZE];
+	unsigned char cookie[NS_COOKIE_SIZE];
 	isc_result_t result;
 	dns_view_t *view;
 	dns_resolver_t *resolver;
@@ -1646,16 +1731,22 @@ ns_client_addopt(ns_client_t *client, dns_message_t *message,
 		isc_uint32_t nonce;
 
 		isc_buffer_init(&buf, cookie, sizeof(cookie));
-		isc_stdtime_get(&now);
-
-		isc_rng_randombytes(client->sctx->rngctx,
-				    &nonce, sizeof(nonce));
 
-		compute_cookie(client, now, nonce, client->sctx->secret, &buf);
+		if ((client->attributes & NS_CLIENTATTR_REUSECOOKIE) != 0) {
+			isc_buffer_putmem(&buf, client->cookie, 8);
+			isc_buffer_putmem(&buf, client->servercookie,
+					  sizeof(client->servercookie));
+		} else {
+			isc_stdtime_get(&now);
+			isc_rng_randombytes(client->sctx->rngctx,
+					    &nonce, sizeof(nonce));
+			compute_cookie(client, now, nonce,
+				       client->sctx->secret, &buf);
+		}
 
 		INSIST(count < DNS_EDNSOPTIONS);
 		ednsopts[count].code = DNS_OPT_COOKIE;
-		ednsopts[count].length = COOKIE_SIZE;
+		ednsopts[count].length = NS_COOKIE_SIZE;
 		ednsopts[count].value = cookie;
 		count++;
 	}
@@ -1896,15 +1987,35 @@ compute_cookie(ns_client_t *client, isc_uint32_t when, isc_uint32_t nonce,
 	}
 }
 
+/*
+ * With trust-server-cookie, a server cookie that is valid and less
+ * than half an hour old is sent back to the client unchanged rather
+ * than computing a new one for the response.
+ */
+static void
+reuse_cookie(ns_client_t *client, const unsigned char *old,
+	     isc_uint32_t when, isc_stdtime_t now)
+{
+	if ((client->sctx->options & NS_SERVER_TRUSTCOOKIE) == 0)
+		return;
+
+	if (isc_serial_le(when, now) && isc_serial_ge(when, now - 1800)) {
+		memmove(client->servercookie, old + 8,
+			sizeof(client->servercookie));
+		client->attributes |= NS_CLIENTATTR_REUSECOOKIE;
+	}
+}
+
 static void
 process_cookie(ns_client_t *client, isc_buffer_t *buf, size_t optlen) {
 	ns_altsecret_t *altsecret;
-	unsigned char dbuf[COOKIE_SIZE];
+	unsigned char dbuf[NS_COOKIE_SIZE];
 	unsigned char *old;
 	isc_stdtime_t now;
 	isc_uint32_t when;
 	isc_uint32_t nonce;
 	isc_buffer_t db;
+	isc_netaddr_t netaddr;
 
 	/*
 	 * If we have already seen a cookie option skip this cookie option.
@@ -1918,7 +2029,7 @@ process_cookie(ns_client_t *client, isc_buffer_t *buf, size_t optlen) {
 
 	ns_stats_increment(client->sctx->nsstats, ns_statscounter_cookiein);
 
-	if (optlen != COOKIE_SIZE) {
+	if (optlen != NS_COOKIE_SIZE) {
 		/*
 		 * Not our token.
 		 */
@@ -1957,13 +2068,28 @@ process_cookie(ns_client_t *client, isc_buffer_t *buf, size_t optlen) {
 		return;
 	}
 
+	/*
+	 * A cookie we have already validated with the current secret
+	 * does not need to be hashed again.
+	 */
+	isc_netaddr_fromsockaddr(&netaddr, &client->peeraddr);
+	if (ns_server_findcookie(client->sctx, &netaddr, old)) {
+		ns_stats_increment(client->sctx->nsstats,
+				   ns_statscounter_cookiematch);
+		client->attributes |= NS_CLIENTATTR_HAVECOOKIE;
+		reuse_cookie(client, old, when, now);
+		return;
+	}
+
 	isc_buffer_init(&db, dbuf, sizeof(dbuf));
 	compute_cookie(client, when, nonce, client->sctx->secret, &db);
 
-	if (isc_safe_memequal(old, dbuf, COOKIE_SIZE)) {
+	if (isc_safe_memequal(old, dbuf, NS_COOKIE_SIZE)) {
 		ns_stats_increment(client->sctx->nsstats,
 				   ns_statscounter_cookiematch);
 		client->attributes |= NS_CLIENTATTR_HAVECOOKIE;
+		ns_server_addcookie(client->sctx, &netaddr, old);
+		reuse_cookie(client, old, when, now);
 		return;
 	}
 
@@ -1973,7 +2099,7 @@ process_cookie(ns_client_t *client, isc_buffer_t *buf, size_t optlen) {
 	{
 		isc_buffer_init(&db, dbuf, sizeof(dbuf));
 		compute_cookie(client, when, nonce, altsecret->secret, &db);
-		if (isc_safe_memequal(old, dbuf, COOKIE_SIZE)) {
+		if (isc_safe_memequal(old, dbuf, NS_COOKIE_SIZE)) {
 			ns_stats_increment(client->sctx->nsstats,
 					   ns_statscounter_cookiematch);
 			client->attributes |= NS_CLIENTATTR_HAVECOOKIE;
@@ -2921,22 +3047,29 @@ get_clientmctx(ns_clientmgr_t *manager, isc_mem_t **mctxp) {
 }
 
 static isc_result_t
-client_create(ns_clientmgr_t *manager, ns_client_t **clientp) {
+client_create(ns_clientmgr_t *manager, unsigned int pool,
+	      ns_client_t **clientp)
+{
 	ns_client_t *client;
 	isc_result_t result;
 	isc_mem_t *mctx = NULL;
 
 	/*
-	 * Caller must be holding the manager lock.
-	 *
 	 * Note: creating a client does not add the client to the
 	 * manager's client list or set the client's manager pointer.
 	 * The caller is responsible for that.
 	 */
 
 	REQUIRE(clientp != NULL && *clientp == NULL);
+	REQUIRE(pool < manager->npools);
 
+	/*
+	 * Only the memory context selection needs the manager lock;
+	 * the rest of the client is private until it is put into a pool.
+	 */
+	LOCK(&manager->lock);
 	result = get_clientmctx(manager, &mctx);
+	UNLOCK(&manager->lock);
 	if (result != ISC_R_SUCCESS)
 		return (result);
 
@@ -2998,6 +3131,7 @@ client_create(ns_clientmgr_t *manager, ns_client_t **clientp) {
 
 	client->magic = NS_CLIENT_MAGIC;
 	client->manager = NULL;
+	client->pool = pool;
 	client->state = NS_CLIENTSTATE_INACTIVE;
 	client->newstate = NS_CLIENTSTATE_MAX;
 	client->naccepts = 0;
@@ -3342,10 +3476,10 @@ ns_client_replace(ns_client_t *client) {
 	tcp = TCP_CLIENT(client);
 	if (tcp && client->pipelined) {
 		result = get_worker(client->manager, client->interface,
-				    client->tcpsocket);
+				    client->tcpsocket, client->pool);
 	} else {
 		result = get_client(client->manager, client->interface,
-				    client->dispatch, tcp);
+				    client->dispatch, client->pool, tcp);
 	}
 	if (result != ISC_R_SUCCESS)
 		return (result);
@@ -3364,27 +3498,49 @@ ns_client_replace(ns_client_t *client) {
  *** Client Manager
  ***/
 
+static isc_boolean_t
+clientmgr_empty(ns_clientmgr_t *manager) {
+	isc_boolean_t empty = ISC_TRUE;
+	unsigned int i;
+
+	/*
+	 * Caller must be holding the manager lock.
+	 */
+	for (i = 0; empty && i < manager->npools; i++) {
+		LOCK(&manager->pools[i].lock);
+		empty = ISC_LIST_EMPTY(manager->pools[i].clients);
+		UNLOCK(&manager->pools[i].lock);
+	}
+
+	return (empty);
+}
+
 static void
 clientmgr_destroy(ns_clientmgr_t *manager) {
+	unsigned int i;
 #if NMCTXS > 0
-	int i;
+	int j;
 #endif
 
-	REQUIRE(ISC_LIST_EMPTY(manager->clients));
-
 	MTRACE("clientmgr_destroy");
 
+	for (i = 0; i < manager->npools; i++) {
+		REQUIRE(ISC_LIST_EMPTY(manager->pools[i].clients));
+		ISC_QUEUE_DESTROY(manager->pools[i].inactive);
+		isc_mempool_destroy(&manager->pools[i].tcpbufs);
+		DESTROYLOCK(&manager->pools[i].lock);
+	}
+	isc_mem_put(manager->mctx, manager->pools,
+		    manager->npools * sizeof(manager->pools[0]));
+
 #if NMCTXS > 0
-	for (i = 0; i < NMCTXS; i++) {
-		if (manager->mctxpool[i] != NULL)
-			isc_mem_detach(&manager->mctxpool[i]);
+	for (j = 0; j < NMCTXS; j++) {
+		if (manager->mctxpool[j] != NULL)
+			isc_mem_detach(&manager->mctxpool[j]);
 	}
 #endif
 
-	ISC_QUEUE_DESTROY(manager->inactive);
-
 	DESTROYLOCK(&manager->lock);
-	DESTROYLOCK(&manager->listlock);
 	DESTROYLOCK(&manager->reclock);
 
 	if (manager->excl != NULL)
@@ -3398,29 +3554,53 @@ clientmgr_destroy(ns_clientmgr_t *manager) {
 
 isc_result_t
 ns_clientmgr_create(isc_mem_t *mctx, ns_server_t *sctx, isc_taskmgr_t *taskmgr,
-		    isc_timermgr_t *timermgr, ns_clientmgr_t **managerp)
+		    isc_timermgr_t *timermgr, unsigned int npools,
+		    ns_clientmgr_t **managerp)
 {
 	ns_clientmgr_t *manager;
 	isc_result_t result;
-#if NMCTXS > 0
-	int i;
-#endif
+	unsigned int i;
+
+	REQUIRE(npools > 0);
 
 	manager = isc_mem_get(mctx, sizeof(*manager));
 	if (manager == NULL)
 		return (ISC_R_NOMEMORY);
 
-	result = isc_mutex_init(&manager->lock);
-	if (result != ISC_R_SUCCESS)
+	manager->pools = isc_mem_get(mctx, npools * sizeof(manager->pools[0]));
+	if (manager->pools == NULL) {
+		result = ISC_R_NOMEMORY;
 		goto cleanup_manager;
+	}
 
-	result = isc_mutex_init(&manager->listlock);
+	for (i = 0; i < npools; i++) {
+		clientpool_t *pool = &manager->pools[i];
+
+		result = isc_mutex_init(&pool->lock);
+		if (result != ISC_R_SUCCESS)
+			goto cleanup_pools;
+		pool->tcpbufs = NULL;
+		result = isc_mempool_create(mctx, TCP_BUFFER_SIZE,
+					    &pool->tcpbufs);
+		if (result != ISC_R_SUCCESS) {
+			(void) isc_mutex_destroy(&pool->lock);
+			goto cleanup_pools;
+		}
+		isc_mempool_setname(pool->tcpbufs, "client:tcpbufs");
+		isc_mempool_setfreemax(pool->tcpbufs, TCP_BUFFER_FREEMAX);
+		isc_mempool_associatelock(pool->tcpbufs, &pool->lock);
+		ISC_LIST_INIT(pool->clients);
+		ISC_QUEUE_INIT(pool->inactive, ilink);
+	}
+	manager->npools = npools;
+
+	result = isc_mutex_init(&manager->lock);
 	if (result != ISC_R_SUCCESS)
-		goto cleanup_lock;
+		goto cleanup_pools;
 
 	result = isc_mutex_init(&manager->reclock);
 	if (result != ISC_R_SUCCESS)
-		goto cleanup_listlock;
+		goto cleanup_lock;
 
 	manager->excl = NULL;
 	result = isc_taskmgr_excltask(taskmgr, &manager->excl);
@@ -3436,9 +3616,7 @@ ns_clientmgr_create(isc_mem_t *mctx, ns_server_t *sctx, isc_taskmgr_t *taskmgr,
 	manager->sctx = NULL;
 	ns_server_attach(sctx, &manager->sctx);
 
-	ISC_LIST_INIT(manager->clients);
 	ISC_LIST_INIT(manager->recursing);
-	ISC_QUEUE_INIT(manager->inactive, ilink);
 #if NMCTXS > 0
 	manager->nextmctx = 0;
 	for (i = 0; i < NMCTXS; i++)
@@ -3455,14 +3633,19 @@ ns_clientmgr_create(isc_mem_t *mctx, ns_server_t *sctx, isc_taskmgr_t *taskmgr,
  cleanup_reclock:
 	(void) isc_mutex_destroy(&manager->reclock);
 
- cleanup_listlock:
-	(void) isc_mutex_destroy(&manager->listlock);
-
  cleanup_lock:
 	(void) isc_mutex_destroy(&manager->lock);
 
+ cleanup_pools:
+	while (i-- > 0) {
+		ISC_QUEUE_DESTROY(manager->pools[i].inactive);
+		isc_mempool_destroy(&manager->pools[i].tcpbufs);
+		(void) isc_mutex_destroy(&manager->pools[i].lock);
+	}
+	isc_mem_put(mctx, manager->pools, npools * sizeof(manager->pools[0]));
+
  cleanup_manager:
-	isc_mem_put(manager->mctx, manager, sizeof(*manager));
+	isc_mem_put(mctx, manager, sizeof(*manager));
 
 	return (result);
 }
@@ -3473,6 +3656,7 @@ ns_clientmgr_destroy(ns_clientmgr_t **managerp) {
 	ns_clientmgr_t *manager;
 	ns_client_t *client;
 	isc_boolean_t need_destroy = ISC_FALSE, unlock = ISC_FALSE;
+	unsigned int i;
 
 	REQUIRE(managerp != NULL);
 	manager = *managerp;
@@ -3491,13 +3675,17 @@ ns_clientmgr_destroy(ns_clientmgr_t **managerp) {
 
 	manager->exiting = ISC_TRUE;
 
-	for (client = ISC_LIST_HEAD(manager->clients);
-	     client != NULL;
-	     client = ISC_LIST_NEXT(client, link))
-		isc_task_shutdown(client->task);
+	for (i = 0; i < manager->npools; i++) {
+		for (client = ISC_LIST_HEAD(manager->pools[i].clients);
+		     client != NULL;
+		     client = ISC_LIST_NEXT(client, link))
+			isc_task_shutdown(client->task);
+	}
 
-	if (ISC_LIST_EMPTY(manager->clients))
+	LOCK(&manager->lock);
+	if (clientmgr_empty(manager))
 		need_destroy = ISC_TRUE;
+	UNLOCK(&manager->lock);
 
 	if (unlock)
 		isc_task_endexclusive(manager->excl);
@@ -3508,9 +3696,46 @@ ns_clientmgr_destroy(ns_clientmgr_t **managerp) {
 	*managerp = NULL;
 }
 
+/*%
+ * Take a client from the inactive queue of 'pool', or create a new
+ * one for that pool if there is nothing to recycle.  Clients never
+ * move between pools, so the objects, messages and buffers that a
+ * worker recycles are always the ones it allocated itself.
+ */
+static isc_result_t
+pool_getclient(ns_clientmgr_t *manager, unsigned int pool,
+	       isc_boolean_t recycle, ns_client_t **clientp)
+{
+	isc_result_t result;
+	ns_client_t *client = NULL;
+
+	REQUIRE(pool < manager->npools);
+
+	if (recycle)
+		ISC_QUEUE_POP(manager->pools[pool].inactive, ilink, client);
+
+	if (client != NULL)
+		MTRACE("recycle");
+	else {
+		MTRACE("create new");
+
+		result = client_create(manager, pool, &client);
+		if (result != ISC_R_SUCCESS)
+			return (result);
+
+		LOCK(&manager->pools[pool].lock);
+		ISC_LIST_APPEND(manager->pools[pool].clients, client, link);
+		UNLOCK(&manager->pools[pool].lock);
+	}
+
+	*clientp = client;
+
+	return (ISC_R_SUCCESS);
+}
+
 static isc_result_t
 get_client(ns_clientmgr_t *manager, ns_interface_t *ifp,
-	   dns_dispatch_t *disp, isc_boolean_t tcp)
+	   dns_dispatch_t *disp, unsigned int pool, isc_boolean_t tcp)
 {
 	isc_result_t result = ISC_R_SUCCESS;
 	isc_event_t *ev;
@@ -3527,24 +3752,12 @@ get_client(ns_clientmgr_t *manager, ns_interface_t *ifp,
 	 * if that fails, make a new one.
 	 */
 	client = NULL;
-	if ((manager->sctx->options & NS_SERVER_CLIENTTEST) == 0)
-		ISC_QUEUE_POP(manager->inactive, ilink, client);
-
-	if (client != NULL)
-		MTRACE("recycle");
-	else {
-		MTRACE("create new");
-
-		LOCK(&manager->lock);
-		result = client_create(manager, &client);
-		UNLOCK(&manager->lock);
-		if (result != ISC_R_SUCCESS)
-			return (result);
-
-		LOCK(&manager->listlock);
-		ISC_LIST_APPEND(manager->clients, client, link);
-		UNLOCK(&manager->listlock);
-	}
+	result = pool_getclient(manager, pool,
+				ISC_TF((manager->sctx->options &
+					NS_SERVER_CLIENTTEST) == 0),
+				&client);
+	if (result != ISC_R_SUCCESS)
+		return (result);
 
 	client->manager = manager;
 	ns_interface_attach(ifp, &client->interface);
@@ -3575,7 +3788,9 @@ get_client(ns_clientmgr_t *manager, ns_interface_t *ifp,
 }
 
 static isc_result_t
-get_worker(ns_clientmgr_t *manager, ns_interface_t *ifp, isc_socket_t *sock) {
+get_worker(ns_clientmgr_t *manager, ns_interface_t *ifp, isc_socket_t *sock,
+	   unsigned int pool)
+{
 	isc_result_t result = ISC_R_SUCCESS;
 	isc_event_t *ev;
 	ns_client_t *client;
@@ -3591,24 +3806,12 @@ get_worker(ns_clientmgr_t *manager, ns_interface_t *ifp, isc_socket_t *sock) {
 	 * if that fails, make a new one.
 	 */
 	client = NULL;
-	if ((manager->sctx->options & NS_SERVER_CLIENTTEST) == 0)
-		ISC_QUEUE_POP(manager->inactive, ilink, client);
-
-	if (client != NULL)
-		MTRACE("recycle");
-	else {
-		MTRACE("create new");
-
-		LOCK(&manager->lock);
-		result = client_create(manager, &client);
-		UNLOCK(&manager->lock);
-		if (result != ISC_R_SUCCESS)
-			return (result);
-
-		LOCK(&manager->listlock);
-		ISC_LIST_APPEND(manager->clients, client, link);
-		UNLOCK(&manager->listlock);
-	}
+	result = pool_getclient(manager, pool,
+				ISC_TF((manager->sctx->options &
+					NS_SERVER_CLIENTTEST) == 0),
+				&client);
+	if (result != ISC_R_SUCCESS)
+		return (result);
 
 	client->manager = manager;
 	ns_interface_attach(ifp, &client->interface);
@@ -3657,22 +3860,9 @@ ns__clientmgr_getclient(ns_clientmgr_t *manager, ns_interface_t *ifp,
 		return (ISC_R_SHUTTINGDOWN);
 
 	client = NULL;
-	ISC_QUEUE_POP(manager->inactive, ilink, client);
-	if (client != NULL)
-		MTRACE("getclient (recycle)");
-	else {
-		MTRACE("getclient (create)");
-
-		LOCK(&manager->lock);
-		result = client_create(manager, &client);
-		UNLOCK(&manager->lock);
-		if (result != ISC_R_SUCCESS)
-			return (result);
-
-		LOCK(&manager->listlock);
-		ISC_LIST_APPEND(manager->clients, client, link);
-		UNLOCK(&manager->listlock);
-	}
+	result = pool_getclient(manager, 0, ISC_TRUE, &client);
+	if (result != ISC_R_SUCCESS)
+		return (result);
 
 	client->manager = manager;
 	ns_interface_attach(ifp, &client->interface);
@@ -3704,7 +3894,8 @@ ns_clientmgr_createclients(ns_clientmgr_t *manager, unsigned int n,
 	MTRACE("createclients");
 
 	for (disp = 0; disp < n; disp++) {
-		result = get_client(manager, ifp, ifp->udpdispatch[disp], tcp);
+		result = get_client(manager, ifp, ifp->udpdispatch[disp],
+				    disp % manager->npools, tcp);
 		if (result != ISC_R_SUCCESS)
 			break;
 	}
@@ -3850,6 +4041,55 @@ ns_client_logv(ns_client_t *client, isc_logcategory_t *category,
 		      sep4, viewname, msgbuf);
 }
 
+void
+ns_client_qlog(ns_client_t *client, unsigned int flags) {
+	dns_rdataset_t *rdataset;
+	dns_rcode_t rcode = dns_rcode_noerror;
+	unsigned int ednsversion = 0;
+
+	REQUIRE(NS_CLIENT_VALID(client));
+
+	if ((client->attributes & NS_CLIENTATTR_QLOG) == 0)
+		return;
+
+	client->attributes &= ~NS_CLIENTATTR_QLOG;
+	if (client->view == NULL || client->view->qlog == NULL ||
+	    client->query.origqname == NULL)
+	{
+		return;
+	}
+
+	if ((client->message->flags & DNS_MESSAGEFLAG_RD) != 0)
+		flags |= DNS_QLOG_RD;
+	if ((client->message->flags & DNS_MESSAGEFLAG_CD) != 0)
+		flags |= DNS_QLOG_CD;
+	if ((client->extflags & DNS_MESSAGEEXTFLAG_DO) != 0)
+		flags |= DNS_QLOG_DO;
+	if (client->ednsversion >= 0) {
+		flags |= DNS_QLOG_EDNS;
+		ednsversion = client->ednsversion;
+	}
+	if (TCP_CLIENT(client))
+		flags |= DNS_QLOG_TCP;
+	if (client->signer != NULL)
+		flags |= DNS_QLOG_SIGNED;
+	if ((client->attributes & NS_CLIENTATTR_HAVECOOKIE) != 0)
+		flags |= DNS_QLOG_COOKIE;
+	else if ((client->attributes & NS_CLIENTATTR_WANTCOOKIE) != 0)
+		flags |= DNS_QLOG_CLIENTCOOKIE;
+	if ((client->attributes & NS_CLIENTATTR_HAVEECS) != 0)
+		flags |= DNS_QLOG_ECS;
+	if ((flags & (DNS_QLOG_NORESPONSE|DNS_QLOG_XFR)) == 0)
+		rcode = client->message->rcode;
+
+	rdataset = ISC_LIST_HEAD(client->query.origqname->list);
+	INSIST(rdataset != NULL);
+	dns_qlog_write(client->view->qlog, client->view->qlogid,
+		       &client->requesttime, &client->peeraddr,
+		       client->query.origqname, rdataset->rdclass,
+		       rdataset->type, flags, ednsversion, rcode);
+}
+
 void
 ns_client_log(ns_client_t *client, isc_logcategory_t *category,
 	   isc_logmodule_t *module, int level, const char *fmt, ...)
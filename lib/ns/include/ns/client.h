@@ -80,6 +80,7 @@ struct ns_client {
 	isc_mem_t *		mctx;
 	ns_server_t *		sctx;
 	ns_clientmgr_t *	manager;
+	unsigned int		pool;	      /*%< Manager pool index */
 	int			state;
 	int			newstate;
 	int			naccepts;
@@ -162,6 +163,7 @@ struct ns_client {
 	ISC_LINK(ns_client_t)	rlink;
 	ISC_QLINK(ns_client_t)	ilink;
 	unsigned char		cookie[8];
+	unsigned char		servercookie[16];
 	isc_uint32_t		expire;
 	unsigned char		*keytag;
 	isc_uint16_t		keytag_len;
@@ -192,6 +194,8 @@ typedef ISC_LIST(ns_client_t) client_list_t;
 #define NS_CLIENTATTR_USEKEEPALIVE	0x10000 /*%< use TCP keepalive */
 
 #define NS_CLIENTATTR_NOSETFC		0x20000 /*%< don't set servfail cache */
+#define NS_CLIENTATTR_QLOG		0x40000 /*%< binary query log pending */
+#define NS_CLIENTATTR_REUSECOOKIE	0x80000 /*%< echo the server cookie */
 
 /*
  * Flag to use with the SERVFAIL cache to indicate
@@ -199,6 +203,17 @@ typedef ISC_LIST(ns_client_t) client_list_t;
  */
 #define NS_FAILCACHE_CD		0x01
 
+/*%
+ * Upper bounds, in microseconds, of the response latency classes counted
+ * for the fast and slow response paths.
+ */
+#define NS_CLIENT_LATCLASS0	100
+#define NS_CLIENT_LATCLASS0STR	"100"
+#define NS_CLIENT_LATCLASS1	1000
+#define NS_CLIENT_LATCLASS1STR	"1000"
+#define NS_CLIENT_LATCLASS2	10000
+#define NS_CLIENT_LATCLASS2STR	"10000"
+
 LIBNS_EXTERNAL_DATA extern unsigned int ns_client_requests;
 
 /***
@@ -276,9 +291,19 @@ ns_client_settimeout(ns_client_t *client, unsigned int seconds);
 
 isc_result_t
 ns_clientmgr_create(isc_mem_t *mctx, ns_server_t *sctx, isc_taskmgr_t *taskmgr,
-		    isc_timermgr_t *timermgr, ns_clientmgr_t **managerp);
+		    isc_timermgr_t *timermgr, unsigned int npools,
+		    ns_clientmgr_t **managerp);
 /*%<
- * Create a client manager.
+ * Create a client manager with 'npools' per-worker client pools.
+ *
+ * Each client belongs to one pool for its whole life and is only
+ * recycled through that pool's inactive queue.  Clients created by
+ * ns_clientmgr_createclients() are spread over the pools by dispatch
+ * index, so 'npools' would normally be the number of UDP dispatches
+ * per interface.
+ *
+ * Requires:
+ *\li	'npools' > 0.
  */
 
 void
@@ -376,6 +401,15 @@ ns_client_aclmsg(const char *msg, const dns_name_t *name, dns_rdatatype_t type,
 	(DNS_NAME_FORMATSIZE + DNS_RDATATYPE_FORMATSIZE + \
 	 DNS_RDATACLASS_FORMATSIZE + sizeof(x) + sizeof("'/'"))
 
+void
+ns_client_qlog(ns_client_t *client, unsigned int flags);
+/*%<
+ * If a binary query log record is pending for 'client', write it out,
+ * adding 'flags' (DNS_QLOG_TC, DNS_QLOG_NORESPONSE or DNS_QLOG_XFR) to
+ * the flags describing the request.  The response code is taken from
+ * client->message unless DNS_QLOG_NORESPONSE or DNS_QLOG_XFR is set.
+ */
+
 void
 ns_client_recursing(ns_client_t *client);
 /*%<
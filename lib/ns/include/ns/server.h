@@ -37,6 +37,9 @@
 #define NS_SERVER_DISABLE4	0x00000100U	/*%< -6 */
 #define NS_SERVER_DISABLE6	0x00000200U	/*%< -4 */
 #define NS_SERVER_FIXEDLOCAL	0x00000400U	/*%< -T fixedlocal */
+#define NS_SERVER_TRUSTCOOKIE	0x00000800U	/*%< trust-server-cookie */
+
+#define NS_COOKIE_SIZE		24U	/*%< 8 + 4 + 4 + 8 */
 
 /*%
  * Type for callback function to get hostname.
@@ -73,6 +76,9 @@ struct ns_server {
 	ns_cookiealg_t		cookiealg;
 	ns_altsecretlist_t	altsecrets;
 
+	/*% Recently validated server cookies */
+	ns_cookiecache_t	*cookiecache;
+
 	/*% Quotas */
 	isc_quota_t		recursionquota;
 	isc_quota_t		tcpquota;
@@ -199,4 +205,39 @@ ns_server_getoption(ns_server_t *sctx, unsigned int option);
  * Requires:
  *\li	'sctx' is valid.
  */
+
+void
+ns_server_flushcookies(ns_server_t *sctx);
+/*%<
+ * Forget the server cookies validated so far.  This must be called
+ * whenever the cookie secrets or the cookie algorithm change.
+ *
+ * Requires:
+ *\li	'sctx' is valid.
+ */
+
+isc_boolean_t
+ns_server_findcookie(ns_server_t *sctx, const isc_netaddr_t *addr,
+		     const unsigned char *cookie);
+/*%<
+ * Return ISC_TRUE if the COOKIE option 'cookie' (a client cookie followed
+ * by a server cookie, 24 octets in all) received from 'addr' has been
+ * passed to ns_server_addcookie() since the last flush.
+ *
+ * Requires:
+ *\li	'sctx' is valid.
+ *\li	'addr' is an IPv4 or IPv6 address.
+ */
+
+void
+ns_server_addcookie(ns_server_t *sctx, const isc_netaddr_t *addr,
+		    const unsigned char *cookie);
+/*%<
+ * Remember that 'cookie', received from 'addr', was validated with the
+ * current secret.  A previously remembered cookie may be forgotten.
+ *
+ * Requires:
+ *\li	'sctx' is valid.
+ *\li	'addr' is an IPv4 or IPv6 address.
+ */
 #endif /* NS_SERVER_H */
@@ -99,7 +99,18 @@ enum {
 	ns_statscounter_prefetch = 63,
 	ns_statscounter_keytagopt = 64,
 
-	ns_statscounter_max = 65
+	ns_statscounter_fastpath = 65,
+	ns_statscounter_fastpathlat0 = 66,
+	ns_statscounter_fastpathlat1 = 67,
+	ns_statscounter_fastpathlat2 = 68,
+	ns_statscounter_fastpathlat3 = 69,
+	ns_statscounter_slowpath = 70,
+	ns_statscounter_slowpathlat0 = 71,
+	ns_statscounter_slowpathlat1 = 72,
+	ns_statscounter_slowpathlat2 = 73,
+	ns_statscounter_slowpathlat3 = 74,
+
+	ns_statscounter_max = 75
 };
 
 void
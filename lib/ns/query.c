@@ -38,6 +38,7 @@
 #include <dns/nsec.h>
 #include <dns/nsec3.h>
 #include <dns/order.h>
+#include <dns/qlog.h>
 #include <dns/rdata.h>
 #include <dns/rdataclass.h>
 #include <dns/rdatalist.h>
@@ -2480,6 +2481,7 @@ static inline void
 rpz_match_clear(dns_rpz_st_t *st) {
 	rpz_clean(&st->m.zone, &st->m.db, &st->m.node, &st->m.rdataset);
 	st->m.version = NULL;
+	st->m.compiled = ISC_FALSE;
 }
 
 static inline isc_result_t
@@ -2996,6 +2998,43 @@ rpz_find_p(ns_client_t *client, dns_name_t *self_name, dns_rdatatype_t qtype,
 	}
 }
 
+/*
+ * Use a policy compiled into the summary data instead of looking up its
+ * policy record.  Only the zone and database of the policy zone are
+ * needed, for the SOA record of the response and for logging.
+ * If the policy was not compiled from 'c_version', the version of the
+ * policy zone being answered from, e.g. because an update of the
+ * summary data is pending or running, it may be out of date and
+ * rpz_find_p() looks up the policy record instead; '*compiledp' is
+ * then set to ISC_FALSE.
+ */
+static isc_result_t
+rpz_compiled_p(ns_client_t *client, dns_name_t *self_name,
+	       dns_rdatatype_t qtype, dns_name_t *p_name, dns_rpz_zone_t *rpz,
+	       dns_rpz_type_t rpz_type, dns_rpz_policy_t c_policy,
+	       dns_dbversion_t *c_version, dns_zone_t **zonep, dns_db_t **dbp,
+	       dns_dbversion_t **versionp, dns_dbnode_t **nodep, dns_rdataset_t **rdatasetp,
+	       dns_rpz_policy_t *policyp, isc_boolean_t *compiledp)
+{
+	isc_result_t result;
+
+	CTRACE(ISC_LOG_DEBUG(3), "rpz_compiled_p");
+
+	rpz_clean(zonep, dbp, nodep, rdatasetp);
+	*versionp = NULL;
+	result = rpz_getdb(client, p_name, rpz_type, zonep, dbp, versionp);
+	if (result != ISC_R_SUCCESS)
+		return (DNS_R_NXDOMAIN);
+	if (*versionp != c_version) {
+		*compiledp = ISC_FALSE;
+		return (rpz_find_p(client, self_name, qtype, p_name, rpz,
+				   rpz_type, zonep, dbp, versionp, nodep,
+				   rdatasetp, policyp));
+	}
+	*policyp = c_policy;
+	return (ISC_R_SUCCESS);
+}
+
 static void
 rpz_save_p(dns_rpz_st_t *st, dns_rpz_zone_t *rpz, dns_rpz_type_t rpz_type,
 	   dns_rpz_policy_t policy, dns_name_t *p_name, dns_rpz_prefix_t prefix,
@@ -3326,7 +3365,9 @@ rpz_rewrite_ip(ns_client_t *client, const isc_netaddr_t *netaddr,
 	dns_db_t *p_db;
 	dns_dbversion_t *p_version;
 	dns_dbnode_t *p_node;
-	dns_rpz_policy_t policy;
+	dns_rpz_policy_t policy, c_policy;
+	dns_dbversion_t *c_version;
+	isc_boolean_t compiled;
 	isc_result_t result;
 
 	CTRACE(ISC_LOG_DEBUG(3), "rpz_rewrite_ip");
@@ -3349,7 +3390,8 @@ rpz_rewrite_ip(ns_client_t *client, const isc_netaddr_t *netaddr,
 
 	while (zbits != 0) {
 		rpz_num = dns_rpz_find_ip(rpzs, rpz_type, zbits, netaddr,
-					  ip_name, &prefix);
+					  ip_name, &prefix, &c_policy,
+					  &c_version);
 		if (rpz_num == DNS_RPZ_INVALID_NUM)
 			break;
 		zbits &= (DNS_RPZ_ZMASK(rpz_num) >> 1);
@@ -3379,10 +3421,24 @@ rpz_rewrite_ip(ns_client_t *client, const isc_netaddr_t *netaddr,
 		result = rpz_get_p_name(client, p_name, rpz, rpz_type, ip_name);
 		if (result != ISC_R_SUCCESS)
 			continue;
-		result = rpz_find_p(client, ip_name, qtype,
-				    p_name, rpz, rpz_type,
-				    &p_zone, &p_db, &p_version, &p_node,
-				    p_rdatasetp, &policy);
+		/*
+		 * 'policy cname' zones need the TTL of the policy record.
+		 */
+		compiled = ISC_TF(c_policy != DNS_RPZ_POLICY_RECORD &&
+				  rpz->policy != DNS_RPZ_POLICY_CNAME);
+		if (compiled)
+			result = rpz_compiled_p(client, ip_name, qtype,
+						p_name, rpz, rpz_type,
+						c_policy, c_version,
+						&p_zone, &p_db,
+						&p_version, &p_node,
+						p_rdatasetp, &policy,
+						&compiled);
+		else
+			result = rpz_find_p(client, ip_name, qtype,
+					    p_name, rpz, rpz_type,
+					    &p_zone, &p_db, &p_version,
+					    &p_node, p_rdatasetp, &policy);
 		switch (result) {
 		case DNS_R_NXDOMAIN:
 			/*
@@ -3437,6 +3493,7 @@ rpz_rewrite_ip(ns_client_t *client, const isc_netaddr_t *netaddr,
 					   policy, p_name, prefix, result,
 					   &p_zone, &p_db, &p_node,
 					   p_rdatasetp, p_version);
+				st->m.compiled = compiled;
 				break;
 			}
 
@@ -3625,12 +3682,14 @@ rpz_rewrite_name(ns_client_t *client, dns_name_t *trig_name,
 	dns_fixedname_t p_namef;
 	dns_name_t *p_name;
 	dns_rpz_zbits_t zbits;
-	dns_rpz_num_t rpz_num;
+	dns_rpz_num_t rpz_num, c_num;
 	dns_zone_t *p_zone;
 	dns_db_t *p_db;
 	dns_dbversion_t *p_version;
 	dns_dbnode_t *p_node;
-	dns_rpz_policy_t policy;
+	dns_rpz_policy_t policy, c_policy;
+	dns_dbversion_t *c_version;
+	isc_boolean_t compiled;
 	isc_result_t result;
 
 #ifndef USE_DNSRPS
@@ -3660,7 +3719,8 @@ rpz_rewrite_name(ns_client_t *client, dns_name_t *trig_name,
 	 * is only one eligible policy zone so that wildcard triggers
 	 * are matched correctly, and not into their parent.
 	 */
-	zbits = dns_rpz_find_name(rpzs, rpz_type, zbits, trig_name);
+	zbits = dns_rpz_find_name(rpzs, rpz_type, zbits, trig_name,
+				  &c_num, &c_policy, &c_version);
 	if (zbits == 0)
 		return (ISC_R_SUCCESS);
 
@@ -3703,10 +3763,24 @@ rpz_rewrite_name(ns_client_t *client, dns_name_t *trig_name,
 					trig_name);
 		if (result != ISC_R_SUCCESS)
 			continue;
-		result = rpz_find_p(client, trig_name, qtype, p_name,
-				    rpz, rpz_type,
-				    &p_zone, &p_db, &p_version, &p_node,
-				    rdatasetp, &policy);
+		/*
+		 * 'policy cname' zones need the TTL of the policy record.
+		 */
+		compiled = ISC_TF(rpz_num == c_num &&
+				  rpz->policy != DNS_RPZ_POLICY_CNAME);
+		if (compiled)
+			result = rpz_compiled_p(client, trig_name, qtype,
+						p_name, rpz, rpz_type,
+						c_policy, c_version,
+						&p_zone, &p_db,
+						&p_version, &p_node,
+						rdatasetp, &policy,
+						&compiled);
+		else
+			result = rpz_find_p(client, trig_name, qtype, p_name,
+					    rpz, rpz_type,
+					    &p_zone, &p_db, &p_version,
+					    &p_node, rdatasetp, &policy);
 		switch (result) {
 		case DNS_R_NXDOMAIN:
 			/*
@@ -3779,6 +3853,7 @@ rpz_rewrite_name(ns_client_t *client, dns_name_t *trig_name,
 					   policy, p_name, 0, result,
 					   &p_zone, &p_db, &p_node,
 					   rdatasetp, p_version);
+				st->m.compiled = compiled;
 				/*
 				 * After a hit, higher numbered policy zones
 				 * are irrelevant
@@ -5543,6 +5618,7 @@ query_recurse(ns_client_t *client, dns_rdatatype_t qtype, dns_name_t *qname,
 
 	if (!resuming)
 		inc_stats(client, ns_statscounter_recursion);
+	client->query.attributes |= NS_QUERYATTR_RECURSED;
 
 	/*
 	 * We are about to recurse, which means that this client will
@@ -6173,10 +6249,12 @@ query_checkrpz(query_ctx_t *qctx, isc_result_t result) {
 		RESTORE(qctx->zone, qctx->rpz_st->m.zone);
 
 		/*
-		 * Add SOA record to additional section
+		 * Add SOA record to additional section.  A compiled policy
+		 * stands for the CNAME that would otherwise be here.
 		 */
 		rresult = query_addsoa(qctx,
-			       dns_rdataset_isassociated(qctx->rdataset),
+			       dns_rdataset_isassociated(qctx->rdataset) ||
+			       qctx->rpz_st->m.compiled,
 			       DNS_SECTION_ADDITIONAL);
 		if (rresult != ISC_R_SUCCESS) {
 			QUERY_ERROR(qctx, result);
@@ -10785,8 +10863,16 @@ ns_query_start(ns_client_t *client) {
 		return;
 	}
 
-	if ((client->sctx->options & NS_SERVER_LOGQUERIES) != 0)
-		log_query(client, saved_flags, saved_extflags);
+	if ((client->sctx->options & NS_SERVER_LOGQUERIES) != 0) {
+		/*
+		 * With a binary query log the record is written once the
+		 * response code is known; see ns_client_qlog().
+		 */
+		if (client->view->qlog != NULL)
+			client->attributes |= NS_CLIENTATTR_QLOG;
+		else
+			log_query(client, saved_flags, saved_extflags);
+	}
 
 	/*
 	 * Check for meta-queries like IXFR and AXFR.
@@ -10804,6 +10890,7 @@ ns_query_start(ns_client_t *client) {
 			break; /* Let the query logic handle it. */
 		case dns_rdatatype_ixfr:
 		case dns_rdatatype_axfr:
+			ns_client_qlog(client, DNS_QLOG_XFR);
 			ns_xfr_start(client, rdataset->type);
 			return;
 		case dns_rdatatype_maila:
@@ -11,6 +11,9 @@
 #include <config.h>
 
 #include <isc/mem.h>
+#include <isc/mutex.h>
+#include <isc/netaddr.h>
+#include <isc/safe.h>
 #include <isc/stats.h>
 #include <isc/util.h>
 
@@ -28,6 +31,92 @@
 		RUNTIME_CHECK(result == ISC_R_SUCCESS);		\
 	} while (0)						\
 
+/*
+ * Validated server cookies are remembered in a direct-mapped table,
+ * indexed by bits of the keyed hash in the cookie itself, so that a
+ * client which keeps sending the same cookie does not cost a keyed
+ * hash computation per query.
+ */
+#define COOKIECACHE_SIZE	4096
+#define COOKIECACHE_LOCKS	64
+
+typedef struct cookieentry {
+	unsigned int		family;		/* 0 if unused */
+	unsigned char		addr[16];
+	unsigned char		cookie[NS_COOKIE_SIZE];
+} cookieentry_t;
+
+struct ns_cookiecache {
+	isc_mutex_t		locks[COOKIECACHE_LOCKS];
+	cookieentry_t		entries[COOKIECACHE_SIZE];
+};
+
+static isc_result_t
+cookiecache_create(isc_mem_t *mctx, ns_cookiecache_t **cachep) {
+	ns_cookiecache_t *cache;
+	isc_result_t result;
+	unsigned int i;
+
+	cache = isc_mem_get(mctx, sizeof(*cache));
+	if (cache == NULL)
+		return (ISC_R_NOMEMORY);
+	memset(cache->entries, 0, sizeof(cache->entries));
+
+	for (i = 0; i < COOKIECACHE_LOCKS; i++) {
+		result = isc_mutex_init(&cache->locks[i]);
+		if (result != ISC_R_SUCCESS) {
+			while (i-- > 0)
+				DESTROYLOCK(&cache->locks[i]);
+			isc_mem_put(mctx, cache, sizeof(*cache));
+			return (result);
+		}
+	}
+
+	*cachep = cache;
+	return (ISC_R_SUCCESS);
+}
+
+static void
+cookiecache_destroy(isc_mem_t *mctx, ns_cookiecache_t **cachep) {
+	ns_cookiecache_t *cache = *cachep;
+	unsigned int i;
+
+	for (i = 0; i < COOKIECACHE_LOCKS; i++)
+		DESTROYLOCK(&cache->locks[i]);
+	isc_mem_put(mctx, cache, sizeof(*cache));
+	*cachep = NULL;
+}
+
+/*
+ * The slot for 'cookie'.  Octets 16 to 19 are part of the keyed hash
+ * and so are as good as random for cookies we issued.
+ */
+static inline unsigned int
+cookieslot(const unsigned char *cookie) {
+	isc_uint32_t h;
+
+	h = ((isc_uint32_t)cookie[16] << 24) |
+	    ((isc_uint32_t)cookie[17] << 16) |
+	    ((isc_uint32_t)cookie[18] << 8) |
+	    (isc_uint32_t)cookie[19];
+	return (h % COOKIECACHE_SIZE);
+}
+
+static inline size_t
+cookieaddr(const isc_netaddr_t *addr, const unsigned char **datap) {
+	switch (addr->family) {
+	case AF_INET:
+		*datap = (const unsigned char *)&addr->type.in;
+		return (4);
+	case AF_INET6:
+		*datap = (const unsigned char *)&addr->type.in6;
+		return (16);
+	default:
+		INSIST(0);
+	}
+	return (0);
+}
+
 isc_result_t
 ns_server_create(isc_mem_t *mctx, isc_entropy_t *entropy,
 		 ns_matchview_t matchingview, ns_server_t **sctxp)
@@ -55,6 +144,7 @@ ns_server_create(isc_mem_t *mctx, isc_entropy_t *entropy,
 
 	CHECKFATAL(dns_tkeyctx_create(mctx, entropy, &sctx->tkeyctx));
 	CHECKFATAL(isc_rng_create(mctx, entropy, &sctx->rngctx));
+	CHECKFATAL(cookiecache_create(mctx, &sctx->cookiecache));
 
 	CHECKFATAL(ns_stats_create(mctx, ns_statscounter_max, &sctx->nsstats));
 
@@ -160,6 +250,8 @@ ns_server_detach(ns_server_t **sctxp) {
 			isc_rng_detach(&sctx->rngctx);
 		if (sctx->tkeyctx != NULL)
 			dns_tkeyctx_destroy(&sctx->tkeyctx);
+		if (sctx->cookiecache != NULL)
+			cookiecache_destroy(sctx->mctx, &sctx->cookiecache);
 
 		if (sctx->nsstats != NULL)
 			ns_stats_detach(&sctx->nsstats);
@@ -259,3 +351,75 @@ ns_server_getoption(ns_server_t *sctx, unsigned int option) {
 
 	return (ISC_TF((sctx->options & option) != 0));
 }
+
+void
+ns_server_flushcookies(ns_server_t *sctx) {
+	ns_cookiecache_t *cache;
+	unsigned int i;
+
+	REQUIRE(SCTX_VALID(sctx));
+
+	cache = sctx->cookiecache;
+	for (i = 0; i < COOKIECACHE_SIZE; i++) {
+		isc_mutex_t *lock = &cache->locks[i % COOKIECACHE_LOCKS];
+
+		LOCK(lock);
+		cache->entries[i].family = 0;
+		UNLOCK(lock);
+	}
+}
+
+isc_boolean_t
+ns_server_findcookie(ns_server_t *sctx, const isc_netaddr_t *addr,
+		     const unsigned char *cookie)
+{
+	ns_cookiecache_t *cache;
+	cookieentry_t *entry;
+	const unsigned char *data = NULL;
+	unsigned int slot;
+	isc_boolean_t found;
+	size_t len;
+
+	REQUIRE(SCTX_VALID(sctx));
+	REQUIRE(addr != NULL && cookie != NULL);
+
+	len = cookieaddr(addr, &data);
+	cache = sctx->cookiecache;
+	slot = cookieslot(cookie);
+	entry = &cache->entries[slot];
+
+	LOCK(&cache->locks[slot % COOKIECACHE_LOCKS]);
+	found = ISC_TF(entry->family == addr->family &&
+		       memcmp(entry->addr, data, len) == 0 &&
+		       isc_safe_memequal(entry->cookie, cookie,
+					 NS_COOKIE_SIZE));
+	UNLOCK(&cache->locks[slot % COOKIECACHE_LOCKS]);
+
+	return (found);
+}
+
+void
+ns_server_addcookie(ns_server_t *sctx, const isc_netaddr_t *addr,
+		    const unsigned char *cookie)
+{
+	ns_cookiecache_t *cache;
+	cookieentry_t *entry;
+	const unsigned char *data = NULL;
+	unsigned int slot;
+	size_t len;
+
+	REQUIRE(SCTX_VALID(sctx));
+	REQUIRE(addr != NULL && cookie != NULL);
+
+	len = cookieaddr(addr, &data);
+	cache = sctx->cookiecache;
+	slot = cookieslot(cookie);
+	entry = &cache->entries[slot];
+
+	LOCK(&cache->locks[slot % COOKIECACHE_LOCKS]);
+	entry->family = addr->family;
+	memset(entry->addr, 0, sizeof(entry->addr));
+	memmove(entry->addr, data, len);
+	memmove(entry->cookie, cookie, NS_COOKIE_SIZE);
+	UNLOCK(&cache->locks[slot % COOKIECACHE_LOCKS]);
+}
@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2018  Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*! \file */
+
+#include <config.h>
+
+#include <atf-c.h>
+
+#include <string.h>
+
+#include <isc/buffer.h>
+#include <isc/mem.h>
+#include <isc/net.h>
+#include <isc/netaddr.h>
+#include <isc/sockaddr.h>
+#include <isc/socket.h>
+#include <isc/util.h>
+
+#include <dns/message.h>
+
+#include <ns/client.h>
+#include <ns/server.h>
+
+#include "nstest.h"
+
+/*
+ * A UDP query for a.example.com/A.
+ */
+static unsigned char query[] = {
+	0x12, 0x34, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00,
+	0x01, 'a', 0x07, 'e', 'x', 'a', 'm', 'p', 'l', 'e',
+	0x03, 'c', 'o', 'm', 0x00, 0x00, 0x01, 0x00, 0x01
+};
+
+static unsigned int responses;
+static dns_rcode_t lastrcode;
+
+static void
+count_response(isc_buffer_t *buf) {
+	isc_result_t result;
+	dns_message_t *message = NULL;
+
+	result = dns_message_create(mctx, DNS_MESSAGE_INTENTPARSE, &message);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	result = dns_message_parse(message, buf, 0);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	lastrcode = message->rcode;
+	responses++;
+
+	dns_message_destroy(&message);
+}
+
+/*
+ * Feed 'query' to 'client' as if it had just been received on its UDP
+ * socket, then finish the request.  The client is mortal, so once the
+ * request is done it goes back to its pool's inactive queue.
+ */
+static void
+udp_request(ns_client_t *client) {
+	isc_socketevent_t *sevent = client->recvevent;
+	struct in_addr ina;
+
+	client->mortal = ISC_TRUE;
+	client->sendcb = count_response;
+
+	memmove(client->recvbuf, query, sizeof(query));
+	sevent->region.base = client->recvbuf;
+	sevent->region.length = sizeof(query);
+	sevent->n = sizeof(query);
+	sevent->result = ISC_R_SUCCESS;
+	sevent->attributes = 0;
+	ina.s_addr = htonl(INADDR_LOOPBACK);
+	isc_sockaddr_fromin(&sevent->address, &ina, 53000);
+	client->nrecvs++;
+
+	ns__client_request(client->task, (isc_event_t *)sevent);
+
+	/*
+	 * The send callback replaces the socket send, so the request
+	 * has to be completed here rather than in client_senddone().
+	 */
+	ns_client_next(client, ISC_R_SUCCESS);
+}
+
+ATF_TC(recycle);
+ATF_TC_HEAD(recycle, tc) {
+	atf_tc_set_md_var(tc, "descr",
+			  "UDP clients are recycled through their pool "
+			  "without allocating");
+}
+ATF_TC_BODY(recycle, tc) {
+	isc_result_t result;
+	ns_client_t *client = NULL, *first = NULL;
+	size_t inuse = 0;
+	unsigned int i;
+
+	UNUSED(tc);
+
+	result = ns_test_begin(NULL, ISC_TRUE);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	for (i = 0; i < 32; i++) {
+		ns_client_t *c;
+
+		client = NULL;
+		result = ns_test_getclient(NULL, ISC_FALSE, &client);
+		ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+		/*
+		 * The first request warms up the client's message and
+		 * memory pools; every later one must reuse the same
+		 * client object and leave its memory context untouched.
+		 */
+		if (i == 0) {
+			first = client;
+		} else {
+			ATF_CHECK_EQ(client, first);
+		}
+		if (i == 1) {
+			inuse = isc_mem_inuse(client->mctx);
+		} else if (i > 1) {
+			ATF_CHECK_EQ(isc_mem_inuse(client->mctx), inuse);
+		}
+
+		c = client;
+		ns_client_detach(&client);
+		udp_request(c);
+	}
+
+	ATF_CHECK_EQ(responses, 32);
+	ATF_CHECK_EQ(lastrcode, dns_rcode_refused);
+
+	ns_test_end();
+}
+
+ATF_TC(cookiecache);
+ATF_TC_HEAD(cookiecache, tc) {
+	atf_tc_set_md_var(tc, "descr",
+			  "validated server cookies are remembered per "
+			  "client address until flushed");
+}
+ATF_TC_BODY(cookiecache, tc) {
+	isc_result_t result;
+	isc_netaddr_t addr, other;
+	struct in_addr ina;
+	struct in6_addr in6a;
+	unsigned char cookie[24], cookie2[24];
+	unsigned int i;
+
+	UNUSED(tc);
+
+	result = ns_test_begin(NULL, ISC_TRUE);
+	ATF_REQUIRE_EQ(result, ISC_R_SUCCESS);
+
+	for (i = 0; i < sizeof(cookie); i++)
+		cookie[i] = i * 7;
+
+	ina.s_addr = htonl(0x0a000001);
+	isc_netaddr_fromin(&addr, &ina);
+	memset(&in6a, 0, sizeof(in6a));
+	memmove(&in6a, &ina, sizeof(ina));
+	isc_netaddr_fromin6(&other, &in6a);
+
+	ATF_CHECK(!ns_server_findcookie(sctx, &addr, cookie));
+	ns_server_addcookie(sctx, &addr, cookie);
+	ATF_CHECK(ns_server_findcookie(sctx, &addr, cookie));
+
+	/*
+	 * The same cookie from another address, or a different cookie
+	 * landing in the same slot, is not a match.
+	 */
+	ATF_CHECK(!ns_server_findcookie(sctx, &other, cookie));
+	memmove(cookie2, cookie, sizeof(cookie2));
+	cookie2[23] ^= 0x01;
+	ATF_CHECK(!ns_server_findcookie(sctx, &addr, cookie2));
+
+	/*
+	 * The newer cookie replaces the older one.
+	 */
+	ns_server_addcookie(sctx, &addr, cookie2);
+	ATF_CHECK(ns_server_findcookie(sctx, &addr, cookie2));
+	ATF_CHECK(!ns_server_findcookie(sctx, &addr, cookie));
+
+	ns_server_flushcookies(sctx);
+	ATF_CHECK(!ns_server_findcookie(sctx, &addr, cookie2));
+
+	ns_test_end();
+}
+
+/*
+ * Main
+ */
+ATF_TP_ADD_TCS(tp) {
+	ATF_TP_ADD_TC(tp, recycle);
+	ATF_TP_ADD_TC(tp, cookiecache);
+	return (atf_no_error());
+}
@@ -199,7 +199,7 @@ create_managers(void) {
 				     socketmgr, dispatchmgr, maintask,
 				     ncpus, NULL, &interfacemgr));
 
-	CHECK(ns_clientmgr_create(mctx, sctx, taskmgr, timermgr,
+	CHECK(ns_clientmgr_create(mctx, sctx, taskmgr, timermgr, ncpus,
 				  &clientmgr));
 
 	CHECK(ns_listenlist_default(mctx, 5300, -1, ISC_TRUE, &listenon));
@@ -644,6 +644,21 @@ static rrstream_methods_t compound_rrstream_methods = {
  * in progress.
  */
 
+/*%
+ * Number of rendered TCP messages that may be queued for sending,
+ * including the one being sent.  While one message is on its way to
+ * the socket, the next one is rendered so that it can be sent as
+ * soon as the first send completes.
+ */
+#define XFROUT_READAHEAD	2
+
+typedef struct {
+	isc_buffer_t 		txlenbuf;	/* Transmit length buffer */
+	isc_buffer_t		txbuf;		/* Transmit message buffer */
+	void 			*txmem;
+	unsigned int 		txmemlen;
+} xfrout_txmsg_t;
+
 typedef struct {
 	isc_mem_t 		*mctx;
 	ns_client_t		*client;
@@ -659,11 +674,14 @@ typedef struct {
 	isc_boolean_t		end_of_stream;	/* EOS has been reached */
 	isc_buffer_t 		buf;		/* Buffer for message owner
 						   names and rdatas */
-	isc_buffer_t 		txlenbuf;	/* Transmit length buffer */
-	isc_buffer_t		txbuf;		/* Transmit message buffer */
-	void 			*txmem;
-	unsigned int 		txmemlen;
+	xfrout_txmsg_t		tx[XFROUT_READAHEAD];
+	unsigned int		txhead;		/* Next message to send */
+	unsigned int		ntx;		/* Messages rendered but not
+						   yet sent */
 	unsigned int		nmsg;		/* Number of messages sent */
+	unsigned int		nrecs;		/* Number of records sent */
+	isc_uint64_t		nbytes;		/* Number of bytes sent */
+	isc_time_t		start;		/* Start time of transfer */
 	dns_tsigkey_t		*tsigkey;	/* Key used to create TSIG */
 	isc_buffer_t		*lasttsig;	/* the last TSIG */
 	isc_boolean_t		verified_tsig;	/* verified request MAC */
@@ -1147,7 +1165,7 @@ xfrout_ctx_create(isc_mem_t *mctx, ns_client_t *client, unsigned int id,
 {
 	xfrout_ctx_t *xfr;
 	isc_result_t result;
-	unsigned int len;
+	unsigned int len, i;
 	void *mem;
 
 	INSIST(xfrp != NULL && *xfrp == NULL);
@@ -1174,14 +1192,21 @@ xfrout_ctx_create(isc_mem_t *mctx, ns_client_t *client, unsigned int id,
 	xfr->lasttsig = lasttsig;
 	xfr->verified_tsig = verified_tsig;
 	xfr->nmsg = 0;
+	xfr->nrecs = 0;
+	xfr->nbytes = 0;
+	isc_time_now(&xfr->start);
 	xfr->many_answers = many_answers;
 	xfr->sends = 0;
 	xfr->shuttingdown = ISC_FALSE;
 	xfr->mnemonic = NULL;
 	xfr->buf.base = NULL;
 	xfr->buf.length = 0;
-	xfr->txmem = NULL;
-	xfr->txmemlen = 0;
+	for (i = 0; i < XFROUT_READAHEAD; i++) {
+		xfr->tx[i].txmem = NULL;
+		xfr->tx[i].txmemlen = 0;
+	}
+	xfr->txhead = 0;
+	xfr->ntx = 0;
 	xfr->stream = NULL;
 	xfr->quota = NULL;
 
@@ -1204,19 +1229,26 @@ xfrout_ctx_create(isc_mem_t *mctx, ns_client_t *client, unsigned int id,
 	isc_buffer_init(&xfr->buf, mem, len);
 
 	/*
-	 * Allocate another temporary buffer for the compressed
-	 * response message and its TCP length prefix.
+	 * Allocate more temporary buffers for the compressed
+	 * response messages and their TCP length prefixes.  Only
+	 * TCP transfers render ahead of the socket.
 	 */
-	len = 2 + 65535;
-	mem = isc_mem_get(mctx, len);
-	if (mem == NULL) {
-		result = ISC_R_NOMEMORY;
-		goto failure;
+	for (i = 0; i < XFROUT_READAHEAD; i++) {
+		xfrout_txmsg_t *tx = &xfr->tx[i];
+
+		if (i > 0 && (client->attributes & NS_CLIENTATTR_TCP) == 0)
+			break;
+		len = 2 + 65535;
+		mem = isc_mem_get(mctx, len);
+		if (mem == NULL) {
+			result = ISC_R_NOMEMORY;
+			goto failure;
+		}
+		isc_buffer_init(&tx->txlenbuf, mem, 2);
+		isc_buffer_init(&tx->txbuf, (char *) mem + 2, len - 2);
+		tx->txmem = mem;
+		tx->txmemlen = len;
 	}
-	isc_buffer_init(&xfr->txlenbuf, mem, 2);
-	isc_buffer_init(&xfr->txbuf, (char *) mem + 2, len - 2);
-	xfr->txmem = mem;
-	xfr->txmemlen = len;
 
 	CHECK(dns_timer_setidle(xfr->client->timer,
 				maxtime, idletime, ISC_FALSE));
@@ -1245,20 +1277,22 @@ failure:
 
 
 /*
- * Arrange to send as much as we can of "stream" without blocking.
+ * Render the next message of "stream".  For TCP, the message is
+ * queued in the next free transmit buffer; for UDP, it is left in
+ * the client message.
  *
  * Requires:
  *	The stream iterator is initialized and points at an RR,
  *      or possibly at the end of the stream (that is, the
  *      _first method of the iterator has been called).
  */
-static void
-sendstream(xfrout_ctx_t *xfr) {
+static isc_result_t
+renderstream(xfrout_ctx_t *xfr) {
 	dns_message_t *tcpmsg = NULL;
 	dns_message_t *msg = NULL; /* Client message if UDP, tcpmsg if TCP */
+	xfrout_txmsg_t *tx = NULL;
 	isc_result_t result;
 	isc_region_t used;
-	isc_region_t region;
 	dns_rdataset_t *qrdataset;
 	dns_name_t *msgname = NULL;
 	dns_rdata_t *msgrdata = NULL;
@@ -1271,8 +1305,6 @@ sendstream(xfrout_ctx_t *xfr) {
 	int n_rrs;
 
 	isc_buffer_clear(&xfr->buf);
-	isc_buffer_clear(&xfr->txlenbuf);
-	isc_buffer_clear(&xfr->txbuf);
 
 	is_tcp = ISC_TF((xfr->client->attributes & NS_CLIENTATTR_TCP) != 0);
 	if (!is_tcp) {
@@ -1290,6 +1322,10 @@ sendstream(xfrout_ctx_t *xfr) {
 		 * in xfr->buf, the compressed data will surely fit in a TCP
 		 * message.
 		 */
+		INSIST(xfr->ntx < XFROUT_READAHEAD);
+		tx = &xfr->tx[(xfr->txhead + xfr->ntx) % XFROUT_READAHEAD];
+		isc_buffer_clear(&tx->txlenbuf);
+		isc_buffer_clear(&tx->txbuf);
 
 		CHECK(dns_message_create(xfr->mctx,
 					 DNS_MESSAGE_INTENTRENDER, &tcpmsg));
@@ -1468,6 +1504,7 @@ sendstream(xfrout_ctx_t *xfr) {
 
 		dns_message_addname(msg, msgname, DNS_SECTION_ANSWER);
 		msgname = NULL;
+		xfr->nrecs++;
 
 		result = xfr->stream->methods->next(xfr->stream);
 		if (result == ISC_R_NOMORE) {
@@ -1492,36 +1529,23 @@ sendstream(xfrout_ctx_t *xfr) {
 		CHECK(dns_compress_init(&cctx, -1, xfr->mctx));
 		dns_compress_setsensitive(&cctx, ISC_TRUE);
 		cleanup_cctx = ISC_TRUE;
-		CHECK(dns_message_renderbegin(msg, &cctx, &xfr->txbuf));
+		CHECK(dns_message_renderbegin(msg, &cctx, &tx->txbuf));
 		CHECK(dns_message_rendersection(msg, DNS_SECTION_QUESTION, 0));
 		CHECK(dns_message_rendersection(msg, DNS_SECTION_ANSWER, 0));
 		CHECK(dns_message_renderend(msg));
 		dns_compress_invalidate(&cctx);
 		cleanup_cctx = ISC_FALSE;
 
-		isc_buffer_usedregion(&xfr->txbuf, &used);
-		isc_buffer_putuint16(&xfr->txlenbuf,
+		isc_buffer_usedregion(&tx->txbuf, &used);
+		isc_buffer_putuint16(&tx->txlenbuf,
 				     (isc_uint16_t)used.length);
-		region.base = xfr->txlenbuf.base;
-		region.length = 2 + used.length;
-		xfrout_log(xfr, ISC_LOG_DEBUG(8),
-			   "sending TCP message of %d bytes",
-			   used.length);
-		CHECK(isc_socket_send(xfr->client->tcpsocket, /* XXX */
-				      &region, xfr->client->task,
-				      xfrout_senddone,
-				      xfr));
-		xfr->sends++;
-	} else {
-		xfrout_log(xfr, ISC_LOG_DEBUG(8), "sending IXFR UDP response");
-		ns_client_send(xfr->client);
-		xfr->stream->methods->pause(xfr->stream);
-		xfrout_ctx_destroy(&xfr);
-		return;
-	}
+		xfr->nbytes += 2 + used.length;
+		xfr->ntx++;
 
-	/* Advance lasttsig to be the last TSIG generated */
-	CHECK(dns_message_getquerytsig(msg, xfr->mctx, &xfr->lasttsig));
+		/* Advance lasttsig to be the last TSIG generated */
+		CHECK(dns_message_getquerytsig(msg, xfr->mctx,
+					       &xfr->lasttsig));
+	}
 
 	xfr->nmsg++;
 
@@ -1552,9 +1576,57 @@ sendstream(xfrout_ctx_t *xfr) {
 	 */
 	xfr->stream->methods->pause(xfr->stream);
 
-	if (result == ISC_R_SUCCESS)
+	return (result);
+}
+
+/*
+ * Arrange to send as much as we can of "stream" without blocking,
+ * rendering up to XFROUT_READAHEAD messages ahead of the socket.
+ *
+ * Requires:
+ *	The stream iterator is initialized and points at an RR,
+ *      or possibly at the end of the stream (that is, the
+ *      _first method of the iterator has been called).
+ */
+static void
+sendstream(xfrout_ctx_t *xfr) {
+	xfrout_txmsg_t *tx;
+	isc_result_t result;
+	isc_region_t used;
+	isc_region_t region;
+
+	if ((xfr->client->attributes & NS_CLIENTATTR_TCP) == 0) {
+		CHECK(renderstream(xfr));
+		xfrout_log(xfr, ISC_LOG_DEBUG(8), "sending IXFR UDP response");
+		ns_client_send(xfr->client);
+		xfrout_ctx_destroy(&xfr);
 		return;
+	}
 
+	for (;;) {
+		if (xfr->sends == 0 && xfr->ntx > 0) {
+			tx = &xfr->tx[xfr->txhead];
+			isc_buffer_usedregion(&tx->txbuf, &used);
+			region.base = tx->txlenbuf.base;
+			region.length = 2 + used.length;
+			xfrout_log(xfr, ISC_LOG_DEBUG(8),
+				   "sending TCP message of %d bytes",
+				   used.length);
+			CHECK(isc_socket_send(xfr->client->tcpsocket, /* XXX */
+					      &region, xfr->client->task,
+					      xfrout_senddone,
+					      xfr));
+			xfr->sends++;
+		} else if (! xfr->end_of_stream &&
+			   xfr->ntx < XFROUT_READAHEAD)
+		{
+			CHECK(renderstream(xfr));
+		} else
+			break;
+	}
+	return;
+
+ failure:
 	xfrout_fail(xfr, result, "sending zone data");
 }
 
@@ -1562,6 +1634,7 @@ static void
 xfrout_ctx_destroy(xfrout_ctx_t **xfrp) {
 	xfrout_ctx_t *xfr = *xfrp;
 	ns_client_t *client = NULL;
+	unsigned int i;
 
 	INSIST(xfr->sends == 0);
 
@@ -1572,8 +1645,11 @@ xfrout_ctx_destroy(xfrout_ctx_t **xfrp) {
 		xfr->stream->methods->destroy(&xfr->stream);
 	if (xfr->buf.base != NULL)
 		isc_mem_put(xfr->mctx, xfr->buf.base, xfr->buf.length);
-	if (xfr->txmem != NULL)
-		isc_mem_put(xfr->mctx, xfr->txmem, xfr->txmemlen);
+	for (i = 0; i < XFROUT_READAHEAD; i++) {
+		if (xfr->tx[i].txmem != NULL)
+			isc_mem_put(xfr->mctx, xfr->tx[i].txmem,
+				    xfr->tx[i].txmemlen);
+	}
 	if (xfr->lasttsig != NULL)
 		isc_buffer_free(&xfr->lasttsig);
 	if (xfr->quota != NULL)
@@ -1610,18 +1686,36 @@ xfrout_senddone(isc_task_t *task, isc_event_t *event) {
 	isc_event_free(&event);
 	xfr->sends--;
 	INSIST(xfr->sends == 0);
+	INSIST(xfr->ntx > 0);
+	xfr->txhead = (xfr->txhead + 1) % XFROUT_READAHEAD;
+	xfr->ntx--;
 
 	(void)isc_timer_touch(xfr->client->timer);
 	if (xfr->shuttingdown == ISC_TRUE) {
 		xfrout_maybe_destroy(xfr);
 	} else if (evresult != ISC_R_SUCCESS) {
 		xfrout_fail(xfr, evresult, "send");
-	} else if (xfr->end_of_stream == ISC_FALSE) {
+	} else if (xfr->end_of_stream == ISC_FALSE || xfr->ntx > 0) {
 		sendstream(xfr);
 	} else {
 		/* End of zone transfer stream. */
+		isc_time_t now;
+		isc_uint64_t usecs, persec;
+
 		inc_stats(xfr->client, xfr->zone, ns_statscounter_xfrdone);
-		xfrout_log(xfr, ISC_LOG_INFO, "%s ended", xfr->mnemonic);
+		isc_time_now(&now);
+		usecs = isc_time_microdiff(&now, &xfr->start);
+		if (xfr->zone != NULL)
+			dns_zone_addxfroutstats(xfr->zone, xfr->nbytes, usecs);
+		persec = (xfr->nbytes * 1000000) / ISC_MAX(usecs, 1);
+		xfrout_log(xfr, ISC_LOG_INFO,
+			   "%s ended: %u messages, %u records, "
+			   "%" ISC_PRINT_QUADFORMAT "u bytes, "
+			   "%u.%03u secs (%u bytes/sec)",
+			   xfr->mnemonic, xfr->nmsg, xfr->nrecs, xfr->nbytes,
+			   (unsigned int) (usecs / 1000000),
+			   (unsigned int) ((usecs / 1000) % 1000),
+			   (unsigned int) persec);
 		ns_client_next(xfr->client, ISC_R_SUCCESS);
 		xfrout_ctx_destroy(&xfr);
 	}